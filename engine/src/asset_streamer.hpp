@@ -0,0 +1,421 @@
+#pragma once
+#ifndef _TE_ASSET_STREAMER_
+#define _TE_ASSET_STREAMER_
+
+#include "core.hpp"
+#include "buffers_gl.hpp"
+#include "tiff_loader.hpp"
+#include "ul_mesh.hpp"
+#include "ul_bitmap.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace te {
+    enum AssetState {
+        AS_Queued,
+        AS_Decoding,
+        // CPU data is ready, waiting for main thread upload
+        AS_Decoded,
+        AS_Ready,
+        AS_Failed
+    };
+
+    /**
+     * @brief Shared state of one streamed asset. Decode runs on worker thread, upload (GL calls) on main thread inside
+     * AssetStreamer::Pump, mData may only be touched after state is AS_Decoded or later
+     *
+     * @tparam T decoded data type
+     */
+    template<typename T>
+    struct Asset {
+        std::atomic<uint32_t> mState = AS_Queued;
+        std::string mPath;
+        T mData{};
+
+        // Completes with decode, wait on it only from worker threads or when nothing needs uploading
+        std::shared_future<bool> mDecoded;
+
+        bool IsReady() { return mState.load(std::memory_order_acquire) == AS_Ready; }
+        bool IsFailed() { return mState.load(std::memory_order_acquire) == AS_Failed; }
+        bool IsDone() { uint32_t state = mState.load(std::memory_order_acquire); return state == AS_Ready || state == AS_Failed; }
+    };
+
+    template<typename T>
+    using AssetHandle = std::shared_ptr<Asset<T>>;
+
+    typedef struct BitmapAsset {
+        // RGBA8, top row first
+        std::vector<uint8_t> mPixels;
+        uint32_t mWidth, mHeight;
+    } BitmapAsset;
+
+    typedef struct ShaderAsset {
+        std::string mSource;
+        uint32_t mType;
+        GLShader mShader;
+    } ShaderAsset;
+
+    class AssetStreamer {
+    private:
+        std::vector<std::jthread> mWorkers;
+        // Jobs and uploads get false when Stop drops them, they fail their asset instead of running
+        std::deque<std::function<void(bool)>> mJobs;
+        std::mutex mJobsMutex;
+        std::condition_variable mJobsCondition;
+        bool mStopping = false;
+
+        std::deque<std::function<void(bool)>> mUploads;
+        std::mutex mUploadsMutex;
+
+        uint32_t mThreadCount = 0;
+        double mUploadBudgetMs = 2.0;
+        double mLastPumpMs = 0.0;
+
+        void Worker() {
+            while(true) {
+                std::function<void(bool)> job;
+
+                {
+                    std::unique_lock<std::mutex> lock(mJobsMutex);
+
+                    mJobsCondition.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+
+                    if(mStopping) return;
+
+                    job = std::move(mJobs.front());
+                    mJobs.pop_front();
+                }
+
+                job(true);
+            }
+        }
+
+        void StartWorkers() {
+            if(!mWorkers.empty()) return;
+
+            uint32_t count = mThreadCount;
+
+            if(count == 0) {
+                // Leave one hardware thread for main loop
+                count = std::thread::hardware_concurrency() > 2 ? std::thread::hardware_concurrency() - 1 : 1;
+            }
+
+            for(uint32_t i = 0; i < count; i++) {
+                mWorkers.emplace_back(&AssetStreamer::Worker, this);
+            }
+        }
+
+    public:
+        /**
+         * @brief Global static pointer to main AssetStreamer
+         *
+         */
+        static AssetStreamer* pGlobal;
+
+        AssetStreamer() {
+            if(!pGlobal) {
+                pGlobal = this;
+
+                TE_INFO("Created global AssetStreamer")
+            }
+            else {
+                TE_WARN("Cannot create another global AssetStreamer!")
+            }
+        }
+
+        ~AssetStreamer() {
+            Stop();
+
+            if(pGlobal == this) {
+                pGlobal = nullptr;
+            }
+        }
+
+        /**
+         * @brief Set amount of worker threads, 0 uses all hardware threads but one. Only has effect before first load
+         *
+         * @param count
+         */
+        void SetThreadCount(uint32_t count) { mThreadCount = count; }
+
+        /**
+         * @brief Set how long Pump may spend on uploads every frame
+         *
+         * @param milliseconds
+         */
+        void SetUploadBudget(double milliseconds) { mUploadBudgetMs = milliseconds; }
+
+        /**
+         * @brief Time spent in last Pump call
+         *
+         * @return double milliseconds
+         */
+        double GetLastPumpTime() { return mLastPumpMs; }
+
+        /**
+         * @brief Amount of decoded assets waiting for upload
+         *
+         * @return size_t
+         */
+        size_t GetPendingUploads() {
+            std::lock_guard<std::mutex> lock(mUploadsMutex);
+
+            return mUploads.size();
+        }
+
+        /**
+         * @brief Queue asset load
+         *
+         * @tparam T decoded data type
+         * @param path passed to decode, also kept in Asset::mPath
+         * @param decode runs on worker thread, fills data and returns false on failure. Must not call GL
+         * @param upload optional, runs on main thread inside Pump after successful decode, may call GL
+         * @return AssetHandle<T>
+         */
+        template<typename T>
+        AssetHandle<T> Load(std::string path, std::function<bool(const std::string&, T*)> decode, std::function<void(T*)> upload = {}) {
+            AssetHandle<T> asset = std::make_shared<Asset<T>>();
+            asset->mPath = path;
+
+            std::shared_ptr<std::promise<bool>> decoded = std::make_shared<std::promise<bool>>();
+            asset->mDecoded = decoded->get_future().share();
+
+            std::function<void(bool)> job = [this, asset, decoded, decode = std::move(decode), upload = std::move(upload)](bool run) {
+                if(!run) {
+                    asset->mState.store(AS_Failed, std::memory_order_release);
+                    decoded->set_value(false);
+
+                    return;
+                }
+
+                asset->mState.store(AS_Decoding, std::memory_order_release);
+
+                bool result = false;
+
+                // Exception would leave worker thread and terminate
+                try {
+                    result = decode(asset->mPath, &asset->mData);
+                }
+                catch(const std::exception& e) {
+                    TE_ERR("Decode of " << asset->mPath << " threw: " << e.what())
+                }
+                catch(...) {
+                    TE_ERR("Decode of " << asset->mPath << " threw")
+                }
+
+                if(!result) {
+                    asset->mState.store(AS_Failed, std::memory_order_release);
+                    decoded->set_value(false);
+
+                    return;
+                }
+
+                asset->mState.store(AS_Decoded, std::memory_order_release);
+                decoded->set_value(true);
+
+                std::lock_guard<std::mutex> lock(mUploadsMutex);
+
+                mUploads.push_back([asset, upload](bool run) {
+                    if(!run) {
+                        asset->mState.store(AS_Failed, std::memory_order_release);
+
+                        return;
+                    }
+
+                    if(upload) {
+                        try {
+                            upload(&asset->mData);
+                        }
+                        catch(const std::exception& e) {
+                            TE_ERR("Upload of " << asset->mPath << " threw: " << e.what())
+
+                            asset->mState.store(AS_Failed, std::memory_order_release);
+
+                            return;
+                        }
+                        catch(...) {
+                            TE_ERR("Upload of " << asset->mPath << " threw")
+
+                            asset->mState.store(AS_Failed, std::memory_order_release);
+
+                            return;
+                        }
+                    }
+
+                    asset->mState.store(AS_Ready, std::memory_order_release);
+                });
+            };
+
+            bool stopping;
+
+            {
+                std::lock_guard<std::mutex> lock(mJobsMutex);
+
+                stopping = mStopping;
+
+                if(!stopping) {
+                    StartWorkers();
+
+                    mJobs.push_back(std::move(job));
+                }
+            }
+
+            // Load from decode callback while Stop runs, nothing would pick it up
+            if(stopping) {
+                TE_WARN("AssetStreamer is stopping, load of " << path << " failed")
+
+                job(false);
+
+                return asset;
+            }
+
+            mJobsCondition.notify_one();
+
+            return asset;
+        }
+
+        /**
+         * @brief Queue mesh load through ulMeshLoad, no upload step
+         *
+         * @param path
+         * @param type ULMtype_
+         * @param flags ULMflag_
+         * @return AssetHandle<ul_mesh_t>
+         */
+        AssetHandle<ul_mesh_t> LoadMesh(std::string path, uint32_t type, uint32_t flags = 0) {
+            return Load<ul_mesh_t>(path, [type, flags](const std::string& p, ul_mesh_t* pMesh) { return ulMeshLoad(pMesh, p.c_str(), type, flags) != 0; });
+        }
+
+        /**
+         * @brief Queue bitmap load through ulLoadBitmapFromFile
+         *
+         * @param path
+         * @param upload optional, e.g. texture upload
+         * @return AssetHandle<BitmapAsset>
+         */
+        AssetHandle<BitmapAsset> LoadBitmap(std::string path, std::function<void(BitmapAsset*)> upload = {}) {
+            return Load<BitmapAsset>(path, [](const std::string& p, BitmapAsset* pBitmap) {
+                pBitmap->mPixels = ulLoadBitmapFromFile(p, &pBitmap->mWidth, &pBitmap->mHeight);
+
+                return !pBitmap->mPixels.empty();
+            }, std::move(upload));
+        }
+
+        /**
+         * @brief Queue TIFF load, strips/tiles of one file are decoded on threadCount threads
+         *
+         * @param path
+         * @param threadCount passed to TIFF::Load, 1 by default as streamer workers already load files in parallel
+         * @return AssetHandle<TIFF>
+         */
+        AssetHandle<TIFF> LoadTIFF(std::string path, uint32_t threadCount = 1) {
+            return Load<TIFF>(path, [threadCount](const std::string& p, TIFF* pTiff) { return pTiff->Load(p, threadCount); });
+        }
+
+        /**
+         * @brief Queue shader load, file is read on worker and compiled on main thread
+         *
+         * @param path
+         * @return AssetHandle<ShaderAsset>
+         */
+        AssetHandle<ShaderAsset> LoadShader(std::string path) {
+            return Load<ShaderAsset>(path, [](const std::string& p, ShaderAsset* pShader) {
+                return GLShader::ReadShaderFile(p, &pShader->mSource, &pShader->mType);
+            }, [](ShaderAsset* pShader) {
+                pShader->mShader.LoadShader(pShader->mSource.c_str(), pShader->mType);
+            });
+        }
+
+        /**
+         * @brief Run uploads of decoded assets on calling (GL) thread until upload budget is used up. At least one upload
+         * runs every call, so single huge upload can`t starve
+         *
+         * @return size_t amount of uploads done
+         */
+        size_t Pump() {
+            std::chrono::time_point start = std::chrono::steady_clock::now();
+            size_t done = 0;
+
+            while(true) {
+                std::function<void(bool)> upload;
+
+                {
+                    std::lock_guard<std::mutex> lock(mUploadsMutex);
+
+                    if(mUploads.empty()) break;
+
+                    upload = std::move(mUploads.front());
+                    mUploads.pop_front();
+                }
+
+                upload(true);
+                done++;
+
+                if(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= mUploadBudgetMs) break;
+            }
+
+            mLastPumpMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            return done;
+        }
+
+        /**
+         * @brief Stop and join workers. Loads that didn`t start, loads queued while stopping (e.g. from decode callback)
+         * and pending uploads are dropped, their assets become AS_Failed (mDecoded of load that didn`t start completes
+         * with false)
+         *
+         */
+        void Stop() {
+            std::deque<std::function<void(bool)>> jobs, uploads;
+            std::vector<std::jthread> workers;
+
+            {
+                std::lock_guard<std::mutex> lock(mJobsMutex);
+
+                mStopping = true;
+                jobs.swap(mJobs);
+                // Load reads and grows mWorkers under same lock
+                workers.swap(mWorkers);
+            }
+
+            mJobsCondition.notify_all();
+
+            for(std::function<void(bool)>& job : jobs) job(false);
+
+            workers.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(mJobsMutex);
+
+                // Load rejects jobs while stopping, drain again in case anything still got in
+                jobs.clear();
+                jobs.swap(mJobs);
+
+                // Next Load starts workers again
+                mStopping = false;
+            }
+
+            for(std::function<void(bool)>& job : jobs) job(false);
+
+            // Workers are joined, nothing pushes uploads anymore
+            {
+                std::lock_guard<std::mutex> lock(mUploadsMutex);
+
+                uploads.swap(mUploads);
+            }
+
+            for(std::function<void(bool)>& upload : uploads) upload(false);
+        }
+    };
+
+    AssetStreamer* AssetStreamer::pGlobal = nullptr;
+}
+
+#endif
@@ -3,65 +3,151 @@
 #define _TE_BUFFERS_GL_
 
 #include "core.hpp"
+#include "gl_state.hpp"
+#include "ul_mesh_pack.hpp"
 #include <vector>
-
+#include <span>
+#include <array>
+#include <ranges>
+#include <type_traits>
+#include <stddef.h>
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
 #include <fstream>
 
 namespace te {
     typedef struct GLShader {
-        uint32_t mId;
+        uint32_t mId = 0;
 
         /**
-         * @brief Load shader from memory
+         * @brief Load shader from memory, compile errors are logged
          * 
          * @param src 
          * @param type 
+         * @return true shader compiled
          */
-        void LoadShader(const char* src, uint32_t type) {
+        bool LoadShader(const char* src, uint32_t type) {
             mId = glCreateShader(type);
             glShaderSource(mId, 1, &src, nullptr);
             glCompileShader(mId);
+
+            return CheckCompile(mId, "");
         }
 
-        
-        void LoadShader(std::string file) {
-            uint32_t type;
-            
-            if(file.find(".vert") != -1 || file.find(".vs") != -1) {
-                type = GL_VERTEX_SHADER;
-            }
-            else if(file.find(".frag") != -1 || file.find(".fs") != -1) {
-                type = GL_FRAGMENT_SHADER;
-            }
-            else if(file.find(".geom") != -1 || file.find(".gs") != -1) {
-                type = GL_GEOMETRY_SHADER;
-            } 
-            else if(file.find(".comp") != -1 || file.find(".cs") != -1) {
-                type = GL_COMPUTE_SHADER;
-            }
-            else if(file.find(".tesc") != -1 || file.find(".tcs") != -1) {
-                type = GL_TESS_CONTROL_SHADER;
-            }
-            else if(file.find(".tese") != -1 || file.find(".tes") != -1) {
-                type = GL_TESS_EVALUATION_SHADER;
+        /**
+         * @brief Check compile status and log info log on failure, blocks until compile finished
+         *
+         * @param id shader
+         * @param name shown in log
+         * @return true compiled
+         */
+        static bool CheckCompile(uint32_t id, const std::string& name) {
+            int status = 0, length = 0;
+
+            glGetShaderiv(id, GL_COMPILE_STATUS, &status);
+
+            if(status) return true;
+
+            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+
+            std::string log(length > 0 ? length : 1, '\0');
+            glGetShaderInfoLog(id, (int)log.size(), nullptr, log.data());
+
+            TE_ERR("Shader " << name << " failed to compile:\n" << log.c_str())
+
+            return false;
+        }
+
+        /**
+         * @brief Shader stage from file extension, any dot separated part of file name counts (light.frag, light.frag.glsl)
+         *
+         * @param file
+         * @return uint32_t GL_*_SHADER, 0 when name has no known extension
+         */
+        static uint32_t GetStageFromPath(const std::string& file) {
+            static const std::pair<const char*, uint32_t> stages[] = {
+                { "vert", GL_VERTEX_SHADER }, { "vs", GL_VERTEX_SHADER },
+                { "frag", GL_FRAGMENT_SHADER }, { "fs", GL_FRAGMENT_SHADER },
+                { "geom", GL_GEOMETRY_SHADER }, { "gs", GL_GEOMETRY_SHADER },
+                { "comp", GL_COMPUTE_SHADER }, { "cs", GL_COMPUTE_SHADER },
+                { "tesc", GL_TESS_CONTROL_SHADER }, { "tcs", GL_TESS_CONTROL_SHADER },
+                { "tese", GL_TESS_EVALUATION_SHADER }, { "tes", GL_TESS_EVALUATION_SHADER }
+            };
+
+            // Only file name, directories like shaders.vs/ don`t decide stage
+            const size_t name_start = file.find_last_of("/\\");
+            size_t dot = file.find('.', name_start == std::string::npos ? 0 : name_start + 1);
+
+            while(dot != std::string::npos) {
+                const size_t next = file.find('.', dot + 1);
+                const std::string extension = file.substr(dot + 1, next == std::string::npos ? std::string::npos : next - dot - 1);
+
+                for(const auto& stage : stages) {
+                    if(extension == stage.first) return stage.second;
+                }
+
+                dot = next;
             }
-            else {
+
+            return 0;
+        }
+
+        /**
+         * @brief Read shader source from file and pick shader type from its extension, doesn`t touch GL so it can run on any thread
+         *
+         * @param file
+         * @param pSource
+         * @param pType
+         * @return true file was read
+         */
+        static bool ReadShaderFile(std::string file, std::string* pSource, uint32_t* pType) {
+            uint32_t type = GetStageFromPath(file);
+
+            if(type == 0) {
+                TE_WARN("Unknown shader extension of " << file << ", compiling as vertex shader")
+
                 type = GL_VERTEX_SHADER;
             }
 
             std::ifstream f(file, std::ios::binary | std::ios::ate);
 
+            if(!f.is_open()) return false;
+
             size_t len = f.tellg();
             f.seekg(0, std::ios::beg);
 
-            std::string src;
-            src.resize(len);
+            pSource->resize(len);
 
-            f.read(src.data(), src.size());
+            f.read(pSource->data(), pSource->size());
 
             f.close();
 
-            LoadShader(src.c_str(), type);
+            *pType = type;
+
+            return true;
+        }
+
+        bool LoadShader(std::string file) {
+            std::string src;
+            uint32_t type;
+
+            if(!ReadShaderFile(file, &src, &type)) {
+                TE_ERR("Cannot read shader " << file)
+
+                return false;
+            }
+
+            mId = glCreateShader(type);
+
+            const char* p_src = src.c_str();
+            glShaderSource(mId, 1, &p_src, nullptr);
+            glCompileShader(mId);
+
+            return CheckCompile(mId, file);
         }
 
         ~GLShader() {
@@ -88,41 +174,76 @@ namespace te {
         void Use() {
             Init();
 
-            glUseProgram(mId);
+            GLStateCache::Get().UseProgram(mId);
         }
 
         void Unuse() {
-            glUseProgram(0);
+            GLStateCache::Get().UseProgram(0);
         }
 
-        void Attach(GLShader sh) {
+        void Attach(const GLShader& sh) {
             Init();
 
             glAttachShader(mId, sh.mId);
         }
 
-        void Link() {
+        /**
+         * @brief Check link status and log info log on failure, blocks until link finished
+         *
+         * @param id program
+         * @return true linked
+         */
+        static bool CheckLink(uint32_t id) {
+            int status = 0, length = 0;
+
+            glGetProgramiv(id, GL_LINK_STATUS, &status);
+
+            if(status) return true;
+
+            glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
+
+            std::string log(length > 0 ? length : 1, '\0');
+            glGetProgramInfoLog(id, (int)log.size(), nullptr, log.data());
+
+            TE_ERR("Program failed to link:\n" << log.c_str())
+
+            return false;
+        }
+
+        /**
+         * @brief Link attached shaders, blocks. ShaderCache links without blocking and skips compile on later runs
+         *
+         * @return true linked
+         */
+        bool Link() {
             Init();
 
             glLinkProgram(mId);
+
+            return CheckLink(mId);
         }
         
         ~GLProgram() {
             if(mCreated) {
                 glDeleteProgram(mId);
+                GLStateCache::Get().OnDeleteProgram(mId);
 
                 mCreated = false;
             }
         }
     } GLProgram;
 
-    typedef struct GLArray {
+    typedef struct GLBuffer {
         uint32_t mId;
         bool mCreated = false;
+        // Bytes holding data and bytes of storage behind mId. Storage is mutable (glNamedBufferData) so growing and
+        // orphaning keep buffer name, vertex arrays configured with it stay valid
+        size_t mSize = 0;
+        size_t mCapacity = 0;
 
         void Init() {
             if(!mCreated) {
-                glGenVertexArrays(1, &mId);
+                glCreateBuffers(1, &mId);
 
                 mCreated = true;
             }
@@ -131,29 +252,251 @@ namespace te {
         void Bind() {
             Init();
 
-            glBindVertexArray(mId);
+            GLStateCache::Get().BindBuffer(GL_ARRAY_BUFFER, mId);
         }
 
-        void Unbind() {
-            glBindVertexArray(0);
+        void BindPlace(uint32_t index, uint32_t dimm) {
+            Bind();
+
+            glVertexAttribPointer(index, dimm, GL_FLOAT, 0, 0, nullptr);
+            glEnableVertexAttribArray(index);
         }
 
-        ~GLArray() {
+        /**
+         * @brief Make sure storage holds at least size bytes, growing reallocates storage under same buffer name and
+         * drops contents
+         *
+         * @param size
+         * @return true storage was reallocated
+         */
+        bool Reserve(size_t size) {
+            Init();
+
+            if(size <= mCapacity) return false;
+
+            // First allocation is exact (static meshes), regrowth leaves headroom for data that keeps growing
+            mCapacity = mCapacity == 0 ? size : std::max(size, mCapacity + mCapacity / 2);
+            mSize = 0;
+
+            glNamedBufferData(mId, mCapacity, nullptr, GL_DYNAMIC_DRAW);
+
+            return true;
+        }
+
+        /**
+         * @brief Upload bytes at offset, storage has to be large enough (see Reserve). Writing storage GPU still reads
+         * waits for it, per frame data goes through Replace/BindData or GLStreamBuffer
+         *
+         * @param data
+         * @param size
+         * @param offset in bytes
+         */
+        void SubData(const void* data, size_t size, size_t offset = 0) {
+            if(offset + size > mCapacity) {
+                TE_ERR("Write of " << size << " bytes at " << offset << " past buffer storage of " << mCapacity << " bytes")
+
+                return;
+            }
+
+            glNamedBufferSubData(mId, offset, size, data);
+
+            mSize = std::max(mSize, offset + size);
+        }
+
+        /**
+         * @brief Upload floats at offset, storage has to be large enough (see Reserve)
+         *
+         * @param data
+         * @param offset in floats
+         */
+        void SubData(std::span<const float> data, size_t offset = 0) {
+            SubData(data.data(), data.size_bytes(), offset * sizeof(float));
+        }
+
+        /**
+         * @brief Replace whole contents. Old storage is orphaned: driver keeps it for draws still reading it and hands out
+         * fresh one, so upload never waits for GPU
+         *
+         * @param data
+         * @param size in bytes
+         */
+        void Replace(const void* data, size_t size) {
+            Init();
+
+            if(size > mCapacity) mCapacity = mCapacity == 0 ? size : std::max(size, mCapacity + mCapacity / 2);
+
+            // Filling all of it is one call, otherwise fresh storage first and data on top
+            if(size == mCapacity) {
+                glNamedBufferData(mId, mCapacity, data, GL_DYNAMIC_DRAW);
+            }
+            else {
+                glNamedBufferData(mId, mCapacity, nullptr, GL_DYNAMIC_DRAW);
+                glNamedBufferSubData(mId, 0, size, data);
+            }
+
+            mSize = size;
+        }
+
+        /**
+         * @brief Replace buffer contents (see Replace) and bind it as GL_ARRAY_BUFFER
+         *
+         * @param data
+         * @param size in bytes
+         */
+        void BindData(const void* data, size_t size) {
+            Replace(data, size);
+
+            GLStateCache::Get().BindBuffer(GL_ARRAY_BUFFER, mId);
+        }
+
+        void BindData(std::span<const float> data) {
+            BindData(data.data(), data.size_bytes());
+        }
+
+        /**
+         * @brief Replace buffer contents with interleaved vertices (or any other contiguous range)
+         *
+         * @param range std::vector<Vertex>, std::array...
+         */
+        template<std::ranges::contiguous_range R>
+        void BindData(const R& range) {
+            BindData(std::ranges::data(range), std::ranges::size(range) * sizeof(std::ranges::range_value_t<R>));
+        }
+
+        /**
+         * @brief Bind buffer as index buffer of currently bound GLArray and upload indices, draw with glDrawElements(..., GL_UNSIGNED_INT, ...)
+         *
+         * @param data
+         */
+        void BindIndexData(std::span<const uint32_t> data) {
+            Replace(data.data(), data.size_bytes());
+
+            GLStateCache::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mId);
+        }
+
+        /**
+         * @brief Bind buffer as index buffer of currently bound GLArray and upload indices, draw with glDrawElements(..., GL_UNSIGNED_SHORT, ...)
+         *
+         * @param data
+         */
+        void BindIndexData(std::span<const uint16_t> data) {
+            Replace(data.data(), data.size_bytes());
+
+            GLStateCache::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mId);
+        }
+
+        ~GLBuffer() {
             if(mCreated) {
-                glDeleteVertexArrays(1, &mId);
+                glDeleteBuffers(1, &mId);
+                GLStateCache::Get().OnDeleteBuffer(mId);
 
                 mCreated = false;
             }
         }
-    } GLArray;
+    } GLBuffer;
 
-    typedef struct GLBuffer {
+    typedef struct GLVertexAttribute {
+        uint32_t mLocation;
+        uint32_t mCount;
+        // GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_SHORT, GL_INT_2_10_10_10_REV...
+        uint32_t mType;
+        bool mNormalized;
+        // Read as ivec/uvec in shader (glVertexArrayAttribIFormat)
+        bool mInteger;
+        uint32_t mOffset;
+    } GLVertexAttribute;
+
+    // Component storage types without own C++ type
+    typedef struct GLHalf { uint16_t mBits; } GLHalf;
+    // All 4 components in one uint32_t, signed
+    typedef struct GLPacked2101010 { uint32_t mBits; } GLPacked2101010;
+
+    template<typename T> struct GLComponentType;
+    template<> struct GLComponentType<float> { static constexpr uint32_t mType = GL_FLOAT, mComponents = 1; };
+    template<> struct GLComponentType<GLHalf> { static constexpr uint32_t mType = GL_HALF_FLOAT, mComponents = 1; };
+    template<> struct GLComponentType<int8_t> { static constexpr uint32_t mType = GL_BYTE, mComponents = 1; };
+    template<> struct GLComponentType<uint8_t> { static constexpr uint32_t mType = GL_UNSIGNED_BYTE, mComponents = 1; };
+    template<> struct GLComponentType<int16_t> { static constexpr uint32_t mType = GL_SHORT, mComponents = 1; };
+    template<> struct GLComponentType<uint16_t> { static constexpr uint32_t mType = GL_UNSIGNED_SHORT, mComponents = 1; };
+    template<> struct GLComponentType<int32_t> { static constexpr uint32_t mType = GL_INT, mComponents = 1; };
+    template<> struct GLComponentType<uint32_t> { static constexpr uint32_t mType = GL_UNSIGNED_INT, mComponents = 1; };
+    template<> struct GLComponentType<GLPacked2101010> { static constexpr uint32_t mType = GL_INT_2_10_10_10_REV, mComponents = 4; };
+
+    enum GLAttribMode {
+        // Converted to float as is
+        ATTRIB_MODE_Float,
+        // Integers mapped to [0, 1] (unsigned) or [-1, 1] (signed)
+        ATTRIB_MODE_Normalized,
+        // Stay integers in shader
+        ATTRIB_MODE_Integer
+    };
+
+    /**
+     * @brief One attribute of interleaved vertex, checked at compile time. Use TE_VERTEX_ATTRIB to deduce type, count
+     * and offset from struct member
+     *
+     * @tparam LOCATION shader location
+     * @tparam T component type, see GLComponentType
+     * @tparam COUNT components
+     * @tparam OFFSET byte offset inside vertex
+     * @tparam MODE GLAttribMode
+     */
+    template<uint32_t LOCATION, typename T, uint32_t COUNT, uint32_t OFFSET, GLAttribMode MODE = ATTRIB_MODE_Float>
+    struct GLAttrib {
+        static_assert(COUNT >= 1 && COUNT <= 4, "Vertex attribute has 1 to 4 components");
+        static_assert(MODE != ATTRIB_MODE_Integer || std::is_integral_v<T>, "Integer attribute needs integer components");
+        static_assert(GLComponentType<T>::mComponents == 1 || (COUNT == 4 && MODE != ATTRIB_MODE_Integer), "Packed 2_10_10_10 attribute is 4 float components");
+
+        static constexpr uint32_t mEnd = OFFSET + sizeof(T) * COUNT / GLComponentType<T>::mComponents;
+
+        static constexpr GLVertexAttribute Get() {
+            return { LOCATION, COUNT, GLComponentType<T>::mType, MODE == ATTRIB_MODE_Normalized, MODE == ATTRIB_MODE_Integer, OFFSET };
+        }
+    };
+
+    // Attribute from member of vertex struct, arrays give component count (float pos[3] -> 3 x GL_FLOAT)
+    #define TE_VERTEX_ATTRIB(location, Vertex, member, mode) te::GLAttrib<location, std::remove_all_extents_t<decltype(Vertex::member)>, \
+        (std::extent_v<decltype(Vertex::member)> == 0 ? 1 : (uint32_t)std::extent_v<decltype(Vertex::member)>) * te::GLComponentType<std::remove_all_extents_t<decltype(Vertex::member)>>::mComponents, \
+        (uint32_t)offsetof(Vertex, member), mode>
+
+    /**
+     * @brief Interleaved vertex layout, e.g.
+     * GLVertexLayout<Vertex, TE_VERTEX_ATTRIB(0, Vertex, position, ATTRIB_MODE_Float), TE_VERTEX_ATTRIB(1, Vertex, normal, ATTRIB_MODE_Normalized)>
+     *
+     * @tparam VERTEX vertex struct, stride is its size
+     * @tparam ATTRIBS GLAttrib
+     */
+    template<typename VERTEX, typename... ATTRIBS>
+    struct GLVertexLayout {
+        typedef VERTEX Vertex;
+
+        static_assert(((ATTRIBS::mEnd <= sizeof(VERTEX)) && ...), "Vertex attribute reaches past vertex end");
+
+        static constexpr uint32_t mStride = sizeof(VERTEX);
+        static constexpr std::array<GLVertexAttribute, sizeof...(ATTRIBS)> mAttributes = { ATTRIBS::Get()... };
+    };
+
+    /**
+     * @brief Map ULMcomponent_ (ul_mesh_pack.hpp) to GL type
+     *
+     */
+    inline uint32_t GLGetComponentType(uint32_t ulmComponent) {
+        switch(ulmComponent) {
+        case ULMcomponent_half: return GL_HALF_FLOAT;
+        case ULMcomponent_uint16: return GL_UNSIGNED_SHORT;
+        case ULMcomponent_int16: return GL_SHORT;
+        case ULMcomponent_int_2_10_10_10_rev: return GL_INT_2_10_10_10_REV;
+        default: return GL_FLOAT;
+        }
+    }
+
+    typedef struct GLArray {
         uint32_t mId;
         bool mCreated = false;
 
         void Init() {
             if(!mCreated) {
-                glGenBuffers(1, &mId);
+                glCreateVertexArrays(1, &mId);
 
                 mCreated = true;
             }
@@ -162,30 +505,272 @@ namespace te {
         void Bind() {
             Init();
 
-            glBindBuffer(GL_ARRAY_BUFFER, mId);
+            GLStateCache::Get().BindVertexArray(mId);
         }
 
-        void BindPlace(uint32_t index, uint32_t dimm) {
-            Bind();
+        void Unbind() {
+            GLStateCache::Get().BindVertexArray(0);
+        }
 
-            glVertexAttribPointer(index, dimm, GL_FLOAT, 0, 0, nullptr);
-            glEnableVertexAttribArray(index);
+        /**
+         * @brief Describe attributes read from one buffer binding, no bind needed (DSA)
+         *
+         * @param attributes
+         * @param buffer source of all attributes, can be swapped later with SetVertexBuffer while layout stays
+         * @param stride bytes between vertices
+         * @param binding buffer binding index
+         * @param offset bytes to first vertex
+         */
+        void Configure(std::span<const GLVertexAttribute> attributes, const GLBuffer& buffer, uint32_t stride, uint32_t binding = 0, size_t offset = 0) {
+            Init();
+
+            for(const GLVertexAttribute& attribute : attributes) {
+                if(attribute.mInteger) {
+                    glVertexArrayAttribIFormat(mId, attribute.mLocation, attribute.mCount, attribute.mType, attribute.mOffset);
+                }
+                else {
+                    glVertexArrayAttribFormat(mId, attribute.mLocation, attribute.mCount, attribute.mType, attribute.mNormalized, attribute.mOffset);
+                }
+
+                glVertexArrayAttribBinding(mId, attribute.mLocation, binding);
+                glEnableVertexArrayAttrib(mId, attribute.mLocation);
+            }
+
+            SetVertexBuffer(buffer, stride, binding, offset);
         }
 
-        void BindData(std::vector<float> data) {
-            Bind();
+        /**
+         * @brief Describe attributes from compile time layout
+         *
+         * @tparam LAYOUT GLVertexLayout
+         */
+        template<typename LAYOUT>
+        void Configure(const GLBuffer& buffer, uint32_t binding = 0, size_t offset = 0) {
+            Configure(LAYOUT::mAttributes, buffer, LAYOUT::mStride, binding, offset);
+        }
+
+        /**
+         * @brief Describe attributes of ulMeshPack output, shader location is ULMattrib_ value and positions come as
+         * normalized [0, 1] to scale with positionMin/positionScale
+         *
+         * @param mesh
+         * @param buffer holding mesh.data
+         */
+        void Configure(const ul_packed_mesh_t& mesh, const GLBuffer& buffer, uint32_t binding = 0) {
+            std::vector<GLVertexAttribute> attributes;
+            attributes.reserve(mesh.attributes.size());
+
+            for(const ul_vertex_attribute_t& attribute : mesh.attributes) {
+                attributes.push_back({ attribute.attribute, attribute.components, GLGetComponentType(attribute.type), attribute.normalized != 0, false, attribute.offset });
+            }
 
-            glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_DYNAMIC_DRAW);
+            Configure(attributes, buffer, mesh.stride, binding);
         }
 
-        ~GLBuffer() {
+        void SetVertexBuffer(const GLBuffer& buffer, uint32_t stride, uint32_t binding = 0, size_t offset = 0) {
+            Init();
+
+            glVertexArrayVertexBuffer(mId, binding, buffer.mId, offset, stride);
+        }
+
+        void SetIndexBuffer(const GLBuffer& buffer) {
+            Init();
+
+            glVertexArrayElementBuffer(mId, buffer.mId);
+
+            // Changed without binding, cached element binding of bound vertex array is stale
+            GLStateCache& state = GLStateCache::Get();
+
+            if(state.mVertexArray == mId) state.mBuffers[GLStateCache::GetBufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = TE_GL_STATE_UNKNOWN;
+        }
+
+        ~GLArray() {
             if(mCreated) {
-                glDeleteBuffers(1, &mId);
+                glDeleteVertexArrays(1, &mId);
+                GLStateCache::Get().OnDeleteVertexArray(mId);
 
                 mCreated = false;
             }
         }
-    } GLBuffer;
+    } GLArray;
+
+    #define TE_STREAM_BUFFER_REGIONS 3
+
+    /**
+     * @brief Persistently mapped ring for per frame dynamic data. Buffer is split in TE_STREAM_BUFFER_REGIONS regions, frame
+     * writes into its region and fences it on EndFrame, region is reused only after GPU passed its fence
+     *
+     */
+    typedef struct GLStreamBuffer {
+        uint32_t mId = 0;
+        uint8_t* pMapped = nullptr;
+        size_t mRegionSize = 0;
+        uint32_t mRegion = 0;
+        // Bytes used in current region
+        size_t mHead = 0;
+        GLsync mFences[TE_STREAM_BUFFER_REGIONS] = {};
+        // Full region was reported this frame
+        bool mFullReported = false;
+
+        // Times EndFrame had to wait for GPU and total time waited
+        uint64_t mWaitCount = 0;
+        uint64_t mWaitNs = 0;
+
+        GLStreamBuffer() = default;
+        GLStreamBuffer(const GLStreamBuffer&) = delete;
+        GLStreamBuffer& operator=(const GLStreamBuffer&) = delete;
+
+        /**
+         * @brief Create and map storage
+         *
+         * @param regionSize bytes available to one frame, rounded up so every region starts at uniform/storage buffer
+         * offset alignment
+         * @return true success
+         */
+        bool Init(size_t regionSize) {
+            Destroy();
+
+            GLint uniform_alignment = 0, storage_alignment = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+
+            // Allocate aligns inside of region, so regions 1 and 2 have to start aligned too
+            const size_t alignment = std::max({ (size_t)256, (size_t)uniform_alignment, (size_t)storage_alignment });
+
+            mRegionSize = (regionSize + alignment - 1) / alignment * alignment;
+            mFullReported = false;
+
+            const uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            glCreateBuffers(1, &mId);
+            glNamedBufferStorage(mId, mRegionSize * TE_STREAM_BUFFER_REGIONS, nullptr, flags);
+
+            pMapped = (uint8_t*)glMapNamedBufferRange(mId, 0, mRegionSize * TE_STREAM_BUFFER_REGIONS, flags);
+
+            if(pMapped == nullptr) {
+                TE_ERR("Failed to map stream buffer of " << mRegionSize * TE_STREAM_BUFFER_REGIONS << " bytes")
+
+                Destroy();
+
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Reserve bytes in current frame region
+         *
+         * @param size
+         * @param alignment power of two up to 256, regions start aligned to it and to uniform/storage offset alignment
+         * @param pOffset offset from buffer start, for glBindBufferRange/glVertexArrayVertexBuffer/draw offsets
+         * @return void* write pointer, nullptr when region is full
+         */
+        void* Allocate(size_t size, size_t alignment, size_t* pOffset) {
+            const size_t start = (mHead + alignment - 1) & ~(alignment - 1);
+
+            if(start + size > mRegionSize) {
+                // Once per frame, caller usually keeps trying for rest of it
+                if(!mFullReported) {
+                    TE_WARN("Stream buffer region full, " << size << " bytes requested, " << mRegionSize - mHead << " left")
+
+                    mFullReported = true;
+                }
+
+                return nullptr;
+            }
+
+            mHead = start + size;
+            *pOffset = (size_t)mRegion * mRegionSize + start;
+
+            return pMapped + *pOffset;
+        }
+
+        /**
+         * @brief Copy data into current frame region
+         *
+         * @return size_t offset from buffer start, SIZE_MAX when region is full
+         */
+        size_t Write(const void* data, size_t size, size_t alignment = 16) {
+            size_t offset;
+            void* p = Allocate(size, alignment, &offset);
+
+            if(p == nullptr) return SIZE_MAX;
+
+            memcpy(p, data, size);
+
+            return offset;
+        }
+
+        template<typename T>
+        size_t Write(std::span<const T> data, size_t alignment = alignof(T) < 16 ? 16 : alignof(T)) {
+            return Write(data.data(), data.size_bytes(), alignment);
+        }
+
+        /**
+         * @brief Fence commands issued against current region and move to next one, waits when GPU still reads it
+         *
+         */
+        void EndFrame() {
+            if(mFences[mRegion] != nullptr) glDeleteSync(mFences[mRegion]);
+
+            mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            mRegion = (mRegion + 1) % TE_STREAM_BUFFER_REGIONS;
+            mHead = 0;
+            mFullReported = false;
+
+            GLsync fence = mFences[mRegion];
+
+            if(fence == nullptr) return;
+
+            // Poll first, only count real stalls
+            GLenum result = glClientWaitSync(fence, 0, 0);
+
+            if(result == GL_TIMEOUT_EXPIRED) {
+                auto start = std::chrono::steady_clock::now();
+
+                do {
+                    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                } while(result == GL_TIMEOUT_EXPIRED);
+
+                mWaitCount++;
+                mWaitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            if(result == GL_WAIT_FAILED) {
+                TE_ERR("Waiting for stream buffer fence failed")
+            }
+
+            glDeleteSync(fence);
+
+            mFences[mRegion] = nullptr;
+        }
+
+        void Destroy() {
+            for(GLsync& fence : mFences) {
+                if(fence != nullptr) glDeleteSync(fence);
+
+                fence = nullptr;
+            }
+
+            if(mId != 0) {
+                if(pMapped != nullptr) glUnmapNamedBuffer(mId);
+
+                glDeleteBuffers(1, &mId);
+                GLStateCache::Get().OnDeleteBuffer(mId);
+            }
+
+            mId = 0;
+            pMapped = nullptr;
+            mRegion = 0;
+            mHead = 0;
+        }
+
+        ~GLStreamBuffer() {
+            Destroy();
+        }
+    } GLStreamBuffer;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#pragma once
+#ifndef _TE_FIXED_STEP_
+#define _TE_FIXED_STEP_
+
+#include "core.hpp"
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
+#include <functional>
+#include <algorithm>
+#include <math.h>
+
+namespace te {
+    typedef struct FixedStepStats {
+        uint64_t mTicks = 0;
+        // Ticks dropped by catch up limit, simulation ran slower than real time by that many steps
+        uint64_t mDroppedTicks = 0;
+        // Times scheduler was behind by whole step or more when it woke up
+        uint64_t mLateWakeups = 0;
+        // Tick start minus its deadline
+        double mMeanLatenessMs = 0.0;
+        double mMaxLatenessMs = 0.0;
+        // Standard deviation of time between tick starts against step, over on-time ticks
+        double mJitterMs = 0.0;
+        // Ticks per second measured over whole run
+        double mTickRate = 0.0;
+    } FixedStepStats;
+
+    /**
+     * @brief Runs callback at fixed rate on own thread. Deadlines are absolute (start + n * step) so error doesn`t
+     * accumulate, thread sleeps until shortly before deadline and spins (yielding) rest of way. When callback runs long,
+     * missed steps run back to back up to catch up limit, rest is dropped instead of spiraling
+     *
+     */
+    class FixedStepScheduler {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        std::jthread mThread;
+        std::function<void()> mTick;
+        Clock::duration mStep{};
+        Clock::duration mSpin = std::chrono::microseconds(200);
+        uint32_t mMaxCatchUp = 4;
+
+        std::mutex mStatsMutex;
+        FixedStepStats mStats;
+
+        // Sums behind mStats
+        double mLatenessSum = 0.0;
+        double mIntervalSum = 0.0, mIntervalSquareSum = 0.0;
+        uint64_t mIntervalCount = 0;
+
+        void Loop(std::stop_token stopToken) {
+            std::mutex sleep_mutex;
+            std::condition_variable_any sleep_condition;
+
+            const Clock::time_point start = Clock::now();
+            Clock::time_point deadline = start + mStep;
+            Clock::time_point last_tick = start;
+            bool last_on_time = false;
+            const double step_ms = std::chrono::duration<double, std::milli>(mStep).count();
+
+            while(!stopToken.stop_requested()) {
+                // Coarse sleep, stop request wakes it right away
+                {
+                    std::unique_lock<std::mutex> lock(sleep_mutex);
+
+                    sleep_condition.wait_until(lock, stopToken, deadline - mSpin, [] { return false; });
+                }
+
+                if(stopToken.stop_requested()) break;
+
+                while(Clock::now() < deadline) std::this_thread::yield();
+
+                // Accumulated time past deadline decides how many steps are due
+                const Clock::time_point now = Clock::now();
+                const uint64_t due = (uint64_t)((now - deadline) / mStep) + 1;
+                const uint64_t run = std::min<uint64_t>(due, mMaxCatchUp);
+
+                for(uint64_t i = 0; i < run && !stopToken.stop_requested(); i++) {
+                    const Clock::time_point tick_start = Clock::now();
+                    const double lateness = std::chrono::duration<double, std::milli>(tick_start - (deadline + i * mStep)).count();
+                    const double interval = std::chrono::duration<double, std::milli>(tick_start - last_tick).count();
+                    const bool on_time = due == 1;
+
+                    mTick();
+
+                    std::lock_guard<std::mutex> lock(mStatsMutex);
+
+                    mStats.mTicks++;
+                    mLatenessSum += lateness;
+                    mStats.mMeanLatenessMs = mLatenessSum / mStats.mTicks;
+                    mStats.mMaxLatenessMs = std::max(mStats.mMaxLatenessMs, lateness);
+
+                    // Catch up ticks are back to back on purpose, they would only hide real jitter
+                    if(on_time && last_on_time) {
+                        mIntervalSum += interval - step_ms;
+                        mIntervalSquareSum += (interval - step_ms) * (interval - step_ms);
+                        mIntervalCount++;
+
+                        const double mean = mIntervalSum / mIntervalCount;
+                        mStats.mJitterMs = sqrt(std::max(0.0, mIntervalSquareSum / mIntervalCount - mean * mean));
+                    }
+
+                    mStats.mTickRate = mStats.mTicks / std::chrono::duration<double>(Clock::now() - start).count();
+
+                    last_tick = tick_start;
+                    last_on_time = on_time;
+                }
+
+                if(due > 1) {
+                    std::lock_guard<std::mutex> lock(mStatsMutex);
+
+                    mStats.mLateWakeups++;
+                    mStats.mDroppedTicks += due - run;
+                }
+
+                deadline += due * mStep;
+            }
+        }
+
+    public:
+        FixedStepScheduler() = default;
+        FixedStepScheduler(const FixedStepScheduler&) = delete;
+        FixedStepScheduler& operator=(const FixedStepScheduler&) = delete;
+
+        /**
+         * @brief Start ticking, stops previous run first
+         *
+         * @param ticksPerSecond
+         * @param tick runs on scheduler thread
+         * @param maxCatchUp most ticks run back to back after stall
+         * @param spin time before deadline spent spinning instead of sleeping, covers OS wakeup latency
+         */
+        void Start(uint32_t ticksPerSecond, std::function<void()> tick, uint32_t maxCatchUp = 4, std::chrono::microseconds spin = std::chrono::microseconds(200)) {
+            Stop();
+
+            mTick = std::move(tick);
+            mStep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / std::max(ticksPerSecond, 1u)));
+            mMaxCatchUp = std::max(maxCatchUp, 1u);
+            mSpin = std::min<Clock::duration>(spin, mStep);
+
+            {
+                std::lock_guard<std::mutex> lock(mStatsMutex);
+
+                mStats = FixedStepStats();
+                mLatenessSum = mIntervalSum = mIntervalSquareSum = 0.0;
+                mIntervalCount = 0;
+            }
+
+            mThread = std::jthread([this](std::stop_token stopToken) { Loop(stopToken); });
+        }
+
+        /**
+         * @brief Stop and join, tick in progress finishes first
+         *
+         */
+        void Stop() {
+            if(mThread.joinable()) {
+                mThread.request_stop();
+                mThread.join();
+            }
+        }
+
+        bool IsRunning() const { return mThread.joinable(); }
+
+        double GetStepSeconds() const { return std::chrono::duration<double>(mStep).count(); }
+
+        FixedStepStats GetStats() {
+            std::lock_guard<std::mutex> lock(mStatsMutex);
+
+            return mStats;
+        }
+
+        ~FixedStepScheduler() {
+            Stop();
+        }
+    };
+}
+
+#endif
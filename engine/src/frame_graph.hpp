@@ -0,0 +1,487 @@
+#pragma once
+#ifndef _TE_FRAME_GRAPH_
+#define _TE_FRAME_GRAPH_
+
+#include "core.hpp"
+#include "job_system.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+
+// Resource every GL call touches, stages declaring it run on main thread (context is current there)
+#define TE_RESOURCE_GL "gl"
+
+namespace te {
+    /**
+     * @brief Id of named resource for read/write declarations (FNV-1a)
+     *
+     * @param name
+     * @return constexpr uint64_t
+     */
+    constexpr uint64_t GetResourceId(std::string_view name) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for(char c : name) {
+            hash ^= (uint8_t)c;
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    typedef struct FrameStage {
+        std::string mName;
+        std::function<void()> mTask;
+        std::vector<uint64_t> mReads;
+        std::vector<uint64_t> mWrites;
+        // Stage that declared nothing may touch anything, it conflicts with every other stage and runs on main thread
+        bool mDeclared = false;
+        // Stage touches nothing other stages use (LF_Concurrent), conflicts with nothing, not even undeclared stages
+        bool mIndependent = false;
+        bool mMainThread = false;
+    } FrameStage;
+
+    typedef struct FrameStageTiming {
+        // Milliseconds since start of Run
+        double mStartMs = 0.0;
+        double mEndMs = 0.0;
+        bool mOnMainThread = false;
+    } FrameStageTiming;
+
+    /**
+     * @brief Stages of one frame with declared resources. Build orders every conflicting pair (write/write, read/write)
+     * by insertion order, directly or through other stages, Run executes DAG on JobSystem with main thread stages kept on
+     * calling thread and records timings for DumpCriticalPath
+     *
+     */
+    class FrameGraph {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        std::vector<FrameStage> mStages;
+        std::vector<std::vector<uint32_t>> mSuccessors;
+        std::vector<std::vector<uint32_t>> mPredecessors;
+        // Depend edges (task, dependency), Build adds them on top of conflict edges
+        std::vector<std::pair<uint32_t, uint32_t>> mDependencies;
+        std::vector<FrameStageTiming> mTimings;
+        std::unique_ptr<std::atomic<uint32_t>[]> mPending;
+        std::atomic<uint32_t> mRemaining = 0;
+        bool mBuilt = false;
+        // Two clock reads per stage cost more than tiny stage, only Runs that are dumped record them
+        bool mTimed = false;
+
+        JobSystem* pJobs = nullptr;
+        Clock::time_point mFrameStart;
+        std::thread::id mMainThread;
+
+        // Ready stages only main thread may run
+        std::vector<uint32_t> mMainQueue;
+        size_t mMainHead = 0;
+        std::mutex mMainMutex;
+        std::atomic<uint32_t> mMainCount = 0;
+
+        // Who touched resource since its last write, Build walks stages once keeping this per resource
+        typedef struct ResourceUse {
+            int64_t mWriter = -1;
+            std::vector<uint32_t> mReaders;
+        } ResourceUse;
+
+        double GetMs() {
+            return std::chrono::duration<double, std::milli>(Clock::now() - mFrameStart).count();
+        }
+
+        void Dispatch(uint32_t stage) {
+            if(mStages[stage].mMainThread || !pJobs) {
+                std::lock_guard<std::mutex> lock(mMainMutex);
+
+                mMainQueue.push_back(stage);
+                mMainCount.fetch_add(1, std::memory_order_release);
+
+                return;
+            }
+
+            pJobs->Submit([this, stage]() { Execute(stage); });
+        }
+
+        // Worker stages that became ready together go out as few jobs, one job per tiny stage costs more than stage
+        void DispatchReady(std::vector<uint32_t>& ready) {
+            if(ready.empty()) return;
+
+            if(!pJobs || ready.size() == 1) {
+                for(uint32_t stage : ready) Dispatch(stage);
+
+                ready.clear();
+
+                return;
+            }
+
+            // Few chunks per thread, work stealing still evens out uneven stages
+            const size_t chunks = std::min<size_t>(ready.size(), (size_t)pJobs->GetThreadCount() * 4);
+
+            for(size_t c = 0; c < chunks; c++) {
+                std::vector<uint32_t> chunk(ready.begin() + ready.size() * c / chunks, ready.begin() + ready.size() * (c + 1) / chunks);
+
+                pJobs->Submit([this, chunk = std::move(chunk)]() {
+                    for(uint32_t stage : chunk) Execute(stage);
+                });
+            }
+
+            ready.clear();
+        }
+
+        void RunStage(uint32_t stage) {
+            if(!mTimed) {
+                mStages[stage].mTask();
+
+                return;
+            }
+
+            FrameStageTiming& timing = mTimings[stage];
+            timing.mOnMainThread = std::this_thread::get_id() == mMainThread;
+            timing.mStartMs = GetMs();
+
+            mStages[stage].mTask();
+
+            timing.mEndMs = GetMs();
+        }
+
+        // Thread that made worker stage ready runs one of them itself, job per chain of tiny stages costs more than chain
+        void Execute(uint32_t stage) {
+            std::vector<uint32_t> ready;
+
+            while(true) {
+                RunStage(stage);
+
+                for(uint32_t successor : mSuccessors[stage]) {
+                    if(mPending[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+
+                    if(mStages[successor].mMainThread) Dispatch(successor);
+                    else ready.push_back(successor);
+                }
+
+                const bool next = !ready.empty();
+                const uint32_t next_stage = next ? ready.back() : 0;
+
+                if(next) ready.pop_back();
+
+                DispatchReady(ready);
+
+                // Last touch of graph by this stage, Run may return right after unless next one is still to run
+                mRemaining.fetch_sub(1, std::memory_order_acq_rel);
+
+                if(!next) return;
+
+                stage = next_stage;
+            }
+        }
+
+        int PopMain() {
+            if(mMainCount.load(std::memory_order_acquire) == 0) return -1;
+
+            std::lock_guard<std::mutex> lock(mMainMutex);
+
+            if(mMainHead == mMainQueue.size()) return -1;
+
+            // Oldest first, keeps insertion order among main thread stages. Head moves instead of front erase, thousands
+            // of layer stages made that quadratic
+            const uint32_t stage = mMainQueue[mMainHead++];
+
+            if(mMainHead == mMainQueue.size()) {
+                mMainQueue.clear();
+                mMainHead = 0;
+            }
+            mMainCount.fetch_sub(1, std::memory_order_release);
+
+            return (int)stage;
+        }
+
+    public:
+        FrameGraph() = default;
+        FrameGraph(const FrameGraph&) = delete;
+        FrameGraph& operator=(const FrameGraph&) = delete;
+
+        void Clear() {
+            mStages.clear();
+            mSuccessors.clear();
+            mPredecessors.clear();
+            mDependencies.clear();
+            mTimings.clear();
+            mPending.reset();
+            mBuilt = false;
+        }
+
+        /**
+         * @brief Add stage, order of adding decides which of two conflicting stages goes first
+         *
+         * @param stage
+         * @return uint32_t stage index
+         */
+        uint32_t Add(FrameStage stage) {
+            // GL context is current only on main thread
+            const uint64_t gl = GetResourceId(TE_RESOURCE_GL);
+
+            if((!stage.mDeclared && !stage.mIndependent) || std::find(stage.mReads.begin(), stage.mReads.end(), gl) != stage.mReads.end() || std::find(stage.mWrites.begin(), stage.mWrites.end(), gl) != stage.mWrites.end()) {
+                stage.mMainThread = true;
+            }
+
+            mStages.push_back(std::move(stage));
+            mBuilt = false;
+
+            return (uint32_t)mStages.size() - 1;
+        }
+
+        /**
+         * @brief Order task after dependency on top of resource conflicts, kept through every later Build
+         *
+         * @param task
+         * @param dependency added before task
+         */
+        void Depend(uint32_t task, uint32_t dependency) {
+            if(dependency >= task || task >= mStages.size()) {
+                TE_WARN("Frame stage can only depend on stage added before it!")
+
+                return;
+            }
+
+            mDependencies.push_back({ task, dependency });
+            mBuilt = false;
+        }
+
+        /**
+         * @brief Make edges from resource declarations and Depend calls, edges always point from earlier to later stage
+         * so graph is acyclic. One pass over stages: reader waits for last writer of resource, writer for readers since
+         * last write (or last writer), undeclared stage for everything since previous undeclared one. Conflicting pairs
+         * without own edge are ordered through these
+         *
+         */
+        void Build() {
+            const size_t count = mStages.size();
+
+            mSuccessors.assign(count, {});
+            mPredecessors.assign(count, {});
+            mTimings.assign(count, {});
+            mPending = std::make_unique<std::atomic<uint32_t>[]>(count);
+
+            std::unordered_map<uint64_t, ResourceUse> resources;
+            // Last undeclared stage and declared stages after it
+            int64_t barrier = -1;
+            std::vector<uint32_t> since_barrier;
+
+            for(size_t j = 0; j < count; j++) {
+                const FrameStage& stage = mStages[j];
+                std::vector<uint32_t>& predecessors = mPredecessors[j];
+
+                if(stage.mIndependent) continue;
+
+                if(!stage.mDeclared) {
+                    predecessors = since_barrier;
+
+                    if(predecessors.empty() && barrier >= 0) predecessors.push_back((uint32_t)barrier);
+
+                    // Later stages wait for this one, it waited for everything before
+                    barrier = (int64_t)j;
+                    since_barrier.clear();
+                    resources.clear();
+
+                    continue;
+                }
+
+                if(barrier >= 0) predecessors.push_back((uint32_t)barrier);
+
+                since_barrier.push_back((uint32_t)j);
+
+                for(uint64_t resource : stage.mReads) {
+                    ResourceUse& use = resources[resource];
+
+                    if(use.mWriter >= 0) predecessors.push_back((uint32_t)use.mWriter);
+                    if(use.mReaders.empty() || use.mReaders.back() != j) use.mReaders.push_back((uint32_t)j);
+                }
+
+                for(uint64_t resource : stage.mWrites) {
+                    ResourceUse& use = resources[resource];
+
+                    // Listed twice
+                    if(use.mWriter == (int64_t)j) continue;
+
+                    bool own_read = false;
+
+                    for(uint32_t reader : use.mReaders) {
+                        if(reader == j) own_read = true;
+                        else predecessors.push_back(reader);
+                    }
+
+                    // Readers since write already wait for writer
+                    if(use.mWriter >= 0 && (use.mReaders.empty() || (own_read && use.mReaders.size() == 1))) predecessors.push_back((uint32_t)use.mWriter);
+
+                    use.mWriter = (int64_t)j;
+                    use.mReaders.clear();
+                }
+
+                std::sort(predecessors.begin(), predecessors.end());
+                predecessors.erase(std::unique(predecessors.begin(), predecessors.end()), predecessors.end());
+            }
+
+            for(const std::pair<uint32_t, uint32_t>& edge : mDependencies) {
+                std::vector<uint32_t>& predecessors = mPredecessors[edge.first];
+
+                if(std::find(predecessors.begin(), predecessors.end(), edge.second) != predecessors.end()) continue;
+
+                predecessors.push_back(edge.second);
+            }
+
+            for(size_t j = 0; j < count; j++) {
+                for(uint32_t predecessor : mPredecessors[j]) mSuccessors[predecessor].push_back((uint32_t)j);
+            }
+
+            mBuilt = true;
+        }
+
+        /**
+         * @brief Run all stages and return when last one finished, calling thread runs main thread stages and helps
+         * with the rest while waiting
+         *
+         * @param pJobSystem nullptr or stopped system runs everything on calling thread in order
+         * @param timed record stage timings for GetCriticalPath and DumpCriticalPath
+         */
+        void Run(JobSystem* pJobSystem, bool timed = true) {
+            if(mStages.empty()) return;
+
+            if(!mBuilt) Build();
+
+            mTimed = timed;
+            pJobs = pJobSystem && pJobSystem->IsRunning() ? pJobSystem : nullptr;
+            mMainThread = std::this_thread::get_id();
+            mFrameStart = Clock::now();
+
+            // Edges point forward, insertion order is valid order
+            if(!pJobs) {
+                for(uint32_t i = 0; i < mStages.size(); i++) RunStage(i);
+
+                return;
+            }
+
+            for(size_t i = 0; i < mStages.size(); i++) mPending[i].store((uint32_t)mPredecessors[i].size(), std::memory_order_relaxed);
+
+            mRemaining.store((uint32_t)mStages.size(), std::memory_order_release);
+
+            std::vector<uint32_t> ready;
+
+            for(uint32_t i = 0; i < mStages.size(); i++) {
+                if(!mPredecessors[i].empty()) continue;
+
+                if(mStages[i].mMainThread) Dispatch(i);
+                else ready.push_back(i);
+            }
+
+            DispatchReady(ready);
+
+            while(mRemaining.load(std::memory_order_acquire) != 0) {
+                const int stage = PopMain();
+
+                if(stage >= 0) {
+                    Execute((uint32_t)stage);
+
+                    continue;
+                }
+
+                if(pJobs && pJobs->RunOne()) continue;
+
+                TE_JOB_PAUSE();
+            }
+        }
+
+        /**
+         * @brief Stages of last Run that bound its length, walking back from last finished stage over predecessor that
+         * finished last
+         *
+         * @return std::vector<uint32_t> stage indices, first to last, empty if last Run wasn`t timed
+         */
+        std::vector<uint32_t> GetCriticalPath() {
+            std::vector<uint32_t> path;
+
+            if(mTimings.empty() || !mTimed) return path;
+
+            uint32_t stage = 0;
+
+            for(uint32_t i = 1; i < mTimings.size(); i++) {
+                if(mTimings[i].mEndMs > mTimings[stage].mEndMs) stage = i;
+            }
+
+            while(true) {
+                path.push_back(stage);
+
+                if(mPredecessors[stage].empty()) break;
+
+                uint32_t gate = mPredecessors[stage][0];
+
+                for(uint32_t predecessor : mPredecessors[stage]) {
+                    if(mTimings[predecessor].mEndMs > mTimings[gate].mEndMs) gate = predecessor;
+                }
+
+                stage = gate;
+            }
+
+            std::reverse(path.begin(), path.end());
+
+            return path;
+        }
+
+        /**
+         * @brief Log critical path of last Run, wait is time between gating stage finishing and this one starting
+         * (main thread busy or workers late)
+         *
+         */
+        void DumpCriticalPath() {
+            const std::vector<uint32_t> path = GetCriticalPath();
+
+            if(path.empty()) return;
+
+            double busy = 0.0, frame = 0.0;
+
+            for(const FrameStageTiming& timing : mTimings) {
+                busy += timing.mEndMs - timing.mStartMs;
+                frame = std::max(frame, timing.mEndMs);
+            }
+
+            std::stringstream dump;
+            dump << std::fixed << std::setprecision(3);
+            dump << "Frame graph: " << mStages.size() << " stages, " << frame << " ms, " << busy << " ms of stage work (parallelism " << (frame > 0.0 ? busy / frame : 0.0) << "), critical path:";
+
+            double previous_end = 0.0;
+
+            for(uint32_t stage : path) {
+                const FrameStageTiming& timing = mTimings[stage];
+
+                dump << "\n    " << mStages[stage].mName << ": " << timing.mEndMs - timing.mStartMs << " ms";
+                dump << " (wait " << std::max(0.0, timing.mStartMs - previous_end) << " ms, " << (timing.mOnMainThread ? "main" : "worker") << ")";
+
+                previous_end = timing.mEndMs;
+            }
+
+            TE_INFO(dump.str())
+        }
+
+        bool IsBuilt() { return mBuilt; }
+
+        uint32_t GetSize() { return (uint32_t)mStages.size(); }
+
+        const FrameStage& GetStage(uint32_t stage) { return mStages[stage]; }
+
+        // Valid after Build
+        const std::vector<uint32_t>& GetPredecessors(uint32_t stage) { return mPredecessors[stage]; }
+
+        const FrameStageTiming& GetTiming(uint32_t stage) { return mTimings[stage]; }
+    };
+}
+
+#endif
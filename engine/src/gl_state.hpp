@@ -0,0 +1,249 @@
+#pragma once
+#ifndef _TE_GL_STATE_
+#define _TE_GL_STATE_
+
+#include "core.hpp"
+#include <stdint.h>
+#include <string.h>
+
+namespace te {
+    enum GLStateCall {
+        GSC_Program,
+        GSC_VertexArray,
+        GSC_Buffer,
+        GSC_Texture,
+        GSC_Capability,
+        GSC_Blend,
+        GSC_Depth,
+
+        GSC_END_DONT_USE
+    };
+
+    typedef struct GLStateCounters {
+        // GL calls made and calls skipped because state already matched, per GLStateCall
+        uint64_t mIssued[GSC_END_DONT_USE] = {};
+        uint64_t mSkipped[GSC_END_DONT_USE] = {};
+
+        uint64_t GetIssued() const { uint64_t sum = 0; for(uint64_t count : mIssued) sum += count; return sum; }
+        uint64_t GetSkipped() const { uint64_t sum = 0; for(uint64_t count : mSkipped) sum += count; return sum; }
+    } GLStateCounters;
+
+    // Cached value not known, next set always reaches GL
+#define TE_GL_STATE_UNKNOWN 0xFFFFFFFFu
+#define TE_GL_STATE_TEXTURE_UNITS 32
+
+    /**
+     * @brief Shadow of bind/enable state of context current on this thread, skips GL calls that wouldn`t change anything.
+     * GL calls made around it (other libraries, raw glBind*) make shadow stale, call Invalidate after them
+     *
+     */
+    typedef struct GLStateCache {
+        uint32_t mProgram;
+        uint32_t mVertexArray;
+        // GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER (part of vertex array state), GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER,
+        // GL_DRAW_INDIRECT_BUFFER, GL_PIXEL_UNPACK_BUFFER, anything else goes straight to GL
+        uint32_t mBuffers[6];
+        uint32_t mTextures[TE_GL_STATE_TEXTURE_UNITS];
+        // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_MULTISAMPLE as 0/1
+        uint32_t mCapabilities[5];
+        uint32_t mBlendSourceRGB, mBlendDestinationRGB, mBlendSourceAlpha, mBlendDestinationAlpha;
+        uint32_t mBlendEquationRGB, mBlendEquationAlpha;
+        uint32_t mDepthFunc;
+        uint32_t mDepthMask;
+
+        GLStateCounters mCounters;
+        // Counters of last finished frame, see EndFrame
+        GLStateCounters mLastFrame;
+
+        GLStateCache() { Invalidate(); }
+
+        /**
+         * @brief State cache of calling thread (GL contexts are current per thread)
+         *
+         */
+        static GLStateCache& Get() {
+            thread_local GLStateCache cache;
+
+            return cache;
+        }
+
+        /**
+         * @brief Forget everything, use after GL state was changed behind cache or context was made current
+         *
+         */
+        void Invalidate() {
+            mProgram = TE_GL_STATE_UNKNOWN;
+            mVertexArray = TE_GL_STATE_UNKNOWN;
+            memset(mBuffers, 0xFF, sizeof(mBuffers));
+            memset(mTextures, 0xFF, sizeof(mTextures));
+            memset(mCapabilities, 0xFF, sizeof(mCapabilities));
+            mBlendSourceRGB = mBlendDestinationRGB = mBlendSourceAlpha = mBlendDestinationAlpha = TE_GL_STATE_UNKNOWN;
+            mBlendEquationRGB = mBlendEquationAlpha = TE_GL_STATE_UNKNOWN;
+            mDepthFunc = TE_GL_STATE_UNKNOWN;
+            mDepthMask = TE_GL_STATE_UNKNOWN;
+        }
+
+        void ResetCounters() { mCounters = GLStateCounters(); }
+
+        /**
+         * @brief Keep counters of frame that just ended in mLastFrame and start counting next one
+         *
+         */
+        void EndFrame() {
+            mLastFrame = mCounters;
+            ResetCounters();
+        }
+
+        // Count call and tell if it has to be made
+        bool Change(uint32_t* pCached, uint32_t value, uint32_t call) {
+            if(*pCached == value) {
+                mCounters.mSkipped[call]++;
+
+                return false;
+            }
+
+            *pCached = value;
+            mCounters.mIssued[call]++;
+
+            return true;
+        }
+
+        static int GetBufferSlot(uint32_t target) {
+            switch(target) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_UNIFORM_BUFFER: return 2;
+            case GL_SHADER_STORAGE_BUFFER: return 3;
+            case GL_DRAW_INDIRECT_BUFFER: return 4;
+            case GL_PIXEL_UNPACK_BUFFER: return 5;
+            default: return -1;
+            }
+        }
+
+        static int GetCapabilitySlot(uint32_t capability) {
+            switch(capability) {
+            case GL_BLEND: return 0;
+            case GL_DEPTH_TEST: return 1;
+            case GL_CULL_FACE: return 2;
+            case GL_SCISSOR_TEST: return 3;
+            case GL_MULTISAMPLE: return 4;
+            default: return -1;
+            }
+        }
+
+        void UseProgram(uint32_t id) {
+            if(Change(&mProgram, id, GSC_Program)) glUseProgram(id);
+        }
+
+        void BindVertexArray(uint32_t id) {
+            if(Change(&mVertexArray, id, GSC_VertexArray)) {
+                glBindVertexArray(id);
+
+                // Element buffer binding belongs to vertex array
+                mBuffers[1] = TE_GL_STATE_UNKNOWN;
+            }
+        }
+
+        void BindBuffer(uint32_t target, uint32_t id) {
+            const int slot = GetBufferSlot(target);
+
+            if(slot < 0) {
+                mCounters.mIssued[GSC_Buffer]++;
+
+                glBindBuffer(target, id);
+            }
+            else if(Change(&mBuffers[slot], id, GSC_Buffer)) {
+                glBindBuffer(target, id);
+            }
+        }
+
+        /**
+         * @brief Bind texture to unit (DSA, no active texture switching)
+         *
+         */
+        void BindTextureUnit(uint32_t unit, uint32_t id) {
+            if(unit >= TE_GL_STATE_TEXTURE_UNITS) {
+                mCounters.mIssued[GSC_Texture]++;
+
+                glBindTextureUnit(unit, id);
+            }
+            else if(Change(&mTextures[unit], id, GSC_Texture)) {
+                glBindTextureUnit(unit, id);
+            }
+        }
+
+        void SetCapability(uint32_t capability, bool enabled) {
+            const int slot = GetCapabilitySlot(capability);
+
+            if(slot >= 0 && !Change(&mCapabilities[slot], enabled, GSC_Capability)) return;
+
+            if(slot < 0) mCounters.mIssued[GSC_Capability]++;
+
+            if(enabled) glEnable(capability);
+            else glDisable(capability);
+        }
+
+        void Enable(uint32_t capability) { SetCapability(capability, true); }
+        void Disable(uint32_t capability) { SetCapability(capability, false); }
+
+        void BlendFunc(uint32_t source, uint32_t destination) {
+            BlendFuncSeparate(source, destination, source, destination);
+        }
+
+        void BlendFuncSeparate(uint32_t sourceRGB, uint32_t destinationRGB, uint32_t sourceAlpha, uint32_t destinationAlpha) {
+            if(mBlendSourceRGB == sourceRGB && mBlendDestinationRGB == destinationRGB && mBlendSourceAlpha == sourceAlpha && mBlendDestinationAlpha == destinationAlpha) {
+                mCounters.mSkipped[GSC_Blend]++;
+
+                return;
+            }
+
+            mBlendSourceRGB = sourceRGB;
+            mBlendDestinationRGB = destinationRGB;
+            mBlendSourceAlpha = sourceAlpha;
+            mBlendDestinationAlpha = destinationAlpha;
+            mCounters.mIssued[GSC_Blend]++;
+
+            glBlendFuncSeparate(sourceRGB, destinationRGB, sourceAlpha, destinationAlpha);
+        }
+
+        void BlendEquation(uint32_t rgb, uint32_t alpha) {
+            if(mBlendEquationRGB == rgb && mBlendEquationAlpha == alpha) {
+                mCounters.mSkipped[GSC_Blend]++;
+
+                return;
+            }
+
+            mBlendEquationRGB = rgb;
+            mBlendEquationAlpha = alpha;
+            mCounters.mIssued[GSC_Blend]++;
+
+            glBlendEquationSeparate(rgb, alpha);
+        }
+
+        void DepthFunc(uint32_t func) {
+            if(Change(&mDepthFunc, func, GSC_Depth)) glDepthFunc(func);
+        }
+
+        void DepthMask(bool write) {
+            if(Change(&mDepthMask, write, GSC_Depth)) glDepthMask(write);
+        }
+
+        // Deleting bound object resets binding to 0, deleted names can come back from glCreate*
+        void OnDeleteProgram(uint32_t id) { if(mProgram == id) mProgram = TE_GL_STATE_UNKNOWN; }
+        void OnDeleteVertexArray(uint32_t id) { if(mVertexArray == id) { mVertexArray = TE_GL_STATE_UNKNOWN; mBuffers[1] = TE_GL_STATE_UNKNOWN; } }
+
+        void OnDeleteBuffer(uint32_t id) {
+            for(uint32_t& buffer : mBuffers) {
+                if(buffer == id) buffer = TE_GL_STATE_UNKNOWN;
+            }
+        }
+
+        void OnDeleteTexture(uint32_t id) {
+            for(uint32_t& texture : mTextures) {
+                if(texture == id) texture = TE_GL_STATE_UNKNOWN;
+            }
+        }
+    } GLStateCache;
+}
+
+#endif
@@ -0,0 +1,505 @@
+#pragma once
+#ifndef _TE_JOB_SYSTEM_
+#define _TE_JOB_SYSTEM_
+
+#include "core.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#define TE_JOB_PAUSE() _mm_pause()
+#else
+#define TE_JOB_PAUSE() std::this_thread::yield()
+#endif
+
+namespace te {
+    // Jobs left to finish, Wait on it helps running jobs instead of blocking (no fibers, waiting thread stays on its stack)
+    typedef std::atomic<uint32_t> JobCounter;
+
+    typedef struct Job {
+        std::function<void()> mTask;
+        JobCounter* pCounter = nullptr;
+    } Job;
+
+    /**
+     * @brief Recycled jobs of one thread, deletes them when thread exits
+     *
+     */
+    typedef struct JobFreeList {
+        std::vector<Job*> mJobs;
+
+        ~JobFreeList() {
+            for(Job* p_job : mJobs) delete p_job;
+        }
+    } JobFreeList;
+
+    // Chase-Lev deque sizes, owner pushes and pops bottom, thieves take top
+#define TE_JOB_DEQUE_SIZE 4096
+
+    /**
+     * @brief Lock free work stealing deque of fixed size (Chase-Lev, Le et al. memory orders)
+     *
+     */
+    typedef struct JobDeque {
+        std::atomic<int64_t> mTop = 0;
+        // Separate cache line, thieves hammer mTop
+        alignas(64) std::atomic<int64_t> mBottom = 0;
+        std::atomic<Job*> mJobs[TE_JOB_DEQUE_SIZE];
+
+        // Owner only, false when full
+        bool Push(Job* pJob) {
+            const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+            const int64_t top = mTop.load(std::memory_order_acquire);
+
+            if(bottom - top >= TE_JOB_DEQUE_SIZE) return false;
+
+            mJobs[bottom & (TE_JOB_DEQUE_SIZE - 1)].store(pJob, std::memory_order_relaxed);
+            // Release store instead of standalone fence, same guarantee and thread sanitizer understands it
+            mBottom.store(bottom + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Owner only, newest job first (still hot in cache)
+        Job* Pop() {
+            const int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+            mBottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = mTop.load(std::memory_order_relaxed);
+
+            if(top > bottom) {
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+
+                return nullptr;
+            }
+
+            Job* p_job = mJobs[bottom & (TE_JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+
+            // Last job, race thieves for it
+            if(top == bottom) {
+                if(!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) p_job = nullptr;
+
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+
+            return p_job;
+        }
+
+        // Any thread, oldest job first
+        Job* Steal() {
+            int64_t top = mTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t bottom = mBottom.load(std::memory_order_acquire);
+
+            if(top >= bottom) return nullptr;
+
+            Job* p_job = mJobs[top & (TE_JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+
+            if(!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+
+            return p_job;
+        }
+    } JobDeque;
+
+    /**
+     * @brief Work stealing job system. Thread that calls Start and worker threads own deques, other threads (FixedUpdate)
+     * submit through shared queue. Waiting runs other jobs until counter drops to zero
+     *
+     */
+    class JobSystem {
+    private:
+        std::vector<std::unique_ptr<JobDeque>> mDeques;
+        std::vector<std::jthread> mWorkers;
+
+        std::deque<Job*> mShared;
+        std::mutex mSharedMutex;
+        std::atomic<uint32_t> mSharedCount = 0;
+
+        // Bumped on every submit, idle workers sleep on it
+        std::atomic<uint32_t> mEpoch = 0;
+        std::atomic<uint32_t> mSleeping = 0;
+        std::atomic<bool> mStopping = false;
+        // Submitted and not yet finished, Stop waits for 0 so no job (or continuation it submits) is dropped
+        std::atomic<uint32_t> mInFlight = 0;
+
+        // Deque index of calling thread, -1 outside of system
+        static inline thread_local int tIndex = -1;
+        static inline thread_local JobSystem* tOwner = nullptr;
+        // Finished jobs are recycled per thread
+        static inline thread_local JobFreeList tFreeJobs;
+
+        int GetIndex() { return tOwner == this ? tIndex : -1; }
+
+        Job* AllocateJob() {
+            if(tFreeJobs.mJobs.empty()) return new Job();
+
+            Job* p_job = tFreeJobs.mJobs.back();
+            tFreeJobs.mJobs.pop_back();
+
+            return p_job;
+        }
+
+        void FreeJob(Job* pJob) {
+            pJob->mTask = nullptr;
+            pJob->pCounter = nullptr;
+
+            if(tFreeJobs.mJobs.size() < 1024) tFreeJobs.mJobs.push_back(pJob);
+            else delete pJob;
+        }
+
+        void Execute(Job* pJob) {
+            pJob->mTask();
+
+            JobCounter* p_counter = pJob->pCounter;
+
+            FreeJob(pJob);
+
+            if(p_counter) p_counter->fetch_sub(1, std::memory_order_acq_rel);
+
+            // Jobs this one submitted were counted before it, so 0 means nothing left anywhere
+            mInFlight.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        Job* FindJob() {
+            const int index = GetIndex();
+
+            if(index >= 0) {
+                if(Job* p_job = mDeques[index]->Pop()) return p_job;
+            }
+
+            if(mSharedCount.load(std::memory_order_acquire) != 0) {
+                std::lock_guard<std::mutex> lock(mSharedMutex);
+
+                if(!mShared.empty()) {
+                    Job* p_job = mShared.front();
+                    mShared.pop_front();
+                    mSharedCount.fetch_sub(1, std::memory_order_release);
+
+                    return p_job;
+                }
+            }
+
+            // Start at neighbour so thieves spread over victims
+            const size_t count = mDeques.size();
+
+            for(size_t i = 1; i <= count; i++) {
+                const size_t victim = (size_t)(index + i) % count;
+
+                if((int)victim == index) continue;
+
+                if(Job* p_job = mDeques[victim]->Steal()) return p_job;
+            }
+
+            return nullptr;
+        }
+
+        void Wake() {
+            mEpoch.fetch_add(1, std::memory_order_seq_cst);
+
+            if(mSleeping.load(std::memory_order_seq_cst) != 0) mEpoch.notify_one();
+        }
+
+        void Worker(int index) {
+            tIndex = index;
+            tOwner = this;
+
+            while(!mStopping.load(std::memory_order_acquire)) {
+                const uint32_t epoch = mEpoch.load(std::memory_order_seq_cst);
+                Job* p_job = FindJob();
+
+                // Short spin catches jobs submitted right after, sleeping costs a syscall on both sides
+                for(int spin = 0; !p_job && spin < 64; spin++) {
+                    TE_JOB_PAUSE();
+
+                    p_job = FindJob();
+                }
+
+                if(p_job) {
+                    Execute(p_job);
+
+                    continue;
+                }
+
+                mSleeping.fetch_add(1, std::memory_order_seq_cst);
+                mEpoch.wait(epoch, std::memory_order_seq_cst);
+                mSleeping.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+            tOwner = nullptr;
+        }
+
+    public:
+        /**
+         * @brief Global static pointer to main JobSystem
+         *
+         */
+        static JobSystem* pGlobal;
+
+        JobSystem() {
+            if(!pGlobal) {
+                pGlobal = this;
+
+                TE_INFO("Created global JobSystem")
+            }
+            else {
+                TE_WARN("Cannot create another global JobSystem!")
+            }
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /**
+         * @brief Start worker threads, calling thread becomes participant too (it runs jobs while waiting)
+         *
+         * @param workerCount threads besides caller, 0 uses all hardware threads but one
+         */
+        void Start(uint32_t workerCount = 0) {
+            Stop();
+
+            if(workerCount == 0) workerCount = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0;
+
+            mStopping = false;
+            mDeques.clear();
+
+            for(uint32_t i = 0; i <= workerCount; i++) mDeques.push_back(std::make_unique<JobDeque>());
+
+            tIndex = 0;
+            tOwner = this;
+
+            for(uint32_t i = 1; i <= workerCount; i++) {
+                mWorkers.emplace_back(&JobSystem::Worker, this, (int)i);
+            }
+        }
+
+        /**
+         * @brief Run what is left and join workers, jobs that are running and everything they submit finish first
+         *
+         */
+        void Stop() {
+            if(mDeques.empty()) return;
+
+            // Workers keep running too, job in progress can still push continuation to own deque
+            while(mInFlight.load(std::memory_order_acquire) != 0) {
+                if(Job* p_job = FindJob()) Execute(p_job);
+                else TE_JOB_PAUSE();
+            }
+
+            mStopping = true;
+            mEpoch.fetch_add(1);
+            mEpoch.notify_all();
+
+            mWorkers.clear();
+            mDeques.clear();
+
+            if(tOwner == this) tOwner = nullptr;
+        }
+
+        bool IsRunning() { return !mDeques.empty(); }
+
+        // Threads running jobs, caller included
+        uint32_t GetThreadCount() { return mDeques.empty() ? 1 : (uint32_t)mDeques.size(); }
+
+        /**
+         * @brief Queue task, runs inline when system isn`t running or own deque is full
+         *
+         * @param task
+         * @param pCounter incremented now, decremented when task finished, optional
+         */
+        void Submit(std::function<void()> task, JobCounter* pCounter = nullptr) {
+            if(pCounter) pCounter->fetch_add(1, std::memory_order_relaxed);
+
+            Job* p_job = AllocateJob();
+            p_job->mTask = std::move(task);
+            p_job->pCounter = pCounter;
+
+            mInFlight.fetch_add(1, std::memory_order_relaxed);
+
+            if(mDeques.empty()) {
+                Execute(p_job);
+
+                return;
+            }
+
+            const int index = GetIndex();
+
+            if(index >= 0) {
+                if(!mDeques[index]->Push(p_job)) {
+                    Execute(p_job);
+
+                    return;
+                }
+            }
+            else {
+                std::lock_guard<std::mutex> lock(mSharedMutex);
+
+                mShared.push_back(p_job);
+                mSharedCount.fetch_add(1, std::memory_order_release);
+            }
+
+            Wake();
+        }
+
+        /**
+         * @brief Run jobs until counter reaches zero
+         *
+         */
+        void Wait(JobCounter* pCounter) {
+            while(pCounter->load(std::memory_order_acquire) != 0) {
+                if(Job* p_job = FindJob()) {
+                    Execute(p_job);
+                }
+                else {
+                    // Remaining jobs run elsewhere, on oversubscribed machine give them the core
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        /**
+         * @brief Run one queued job on calling thread if there is any, for threads waiting on something else than counter
+         *
+         * @return true job was run
+         */
+        bool RunOne() {
+            if(mDeques.empty()) return false;
+
+            Job* p_job = FindJob();
+
+            if(!p_job) return false;
+
+            Execute(p_job);
+
+            return true;
+        }
+
+        /**
+         * @brief Call function(begin, end) over [0, count) split in chunks of grain, chunks are grabbed dynamically so
+         * uneven chunks balance out. Returns when all chunks are done
+         *
+         * @param count
+         * @param grain items per chunk, 0 picks size giving each thread about 4 chunks
+         * @param function void(size_t begin, size_t end)
+         */
+        template<typename F>
+        void ParallelFor(size_t count, size_t grain, F&& function) {
+            if(count == 0) return;
+
+            const size_t threads = GetThreadCount();
+
+            if(grain == 0) grain = std::max<size_t>(1, count / (threads * 4));
+
+            const size_t chunks = (count + grain - 1) / grain;
+
+            if(chunks == 1 || threads == 1) {
+                function((size_t)0, count);
+
+                return;
+            }
+
+            std::atomic<size_t> next = 0;
+            auto run = [&]() {
+                for(size_t chunk = next.fetch_add(1, std::memory_order_relaxed); chunk < chunks; chunk = next.fetch_add(1, std::memory_order_relaxed)) {
+                    function(chunk * grain, std::min(count, (chunk + 1) * grain));
+                }
+            };
+
+            JobCounter counter = 0;
+            const size_t helpers = std::min(chunks, threads) - 1;
+
+            for(size_t i = 0; i < helpers; i++) Submit(run, &counter);
+
+            run();
+
+            Wait(&counter);
+        }
+
+        ~JobSystem() {
+            Stop();
+
+            if(pGlobal == this) pGlobal = nullptr;
+        }
+    };
+
+    JobSystem* JobSystem::pGlobal = nullptr;
+
+    /**
+     * @brief Tasks with dependencies. Task is submitted once all tasks it depends on finished (continuation passing,
+     * finishing task submits its ready successors), Run waits for whole graph
+     *
+     */
+    class JobGraph {
+    private:
+        typedef struct Node {
+            std::function<void()> mTask;
+            std::vector<uint32_t> mSuccessors;
+            uint32_t mDependencyCount = 0;
+            std::atomic<uint32_t> mPending = 0;
+        } Node;
+
+        std::vector<std::unique_ptr<Node>> mNodes;
+
+        void SubmitNode(JobSystem* pSystem, uint32_t index, JobCounter* pCounter) {
+            pSystem->Submit([this, pSystem, index, pCounter]() {
+                Node* p_node = mNodes[index].get();
+
+                p_node->mTask();
+
+                for(uint32_t successor : p_node->mSuccessors) {
+                    if(mNodes[successor]->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) SubmitNode(pSystem, successor, pCounter);
+                }
+            }, pCounter);
+        }
+
+    public:
+        /**
+         * @brief Add task
+         *
+         * @return uint32_t task index for Depend
+         */
+        uint32_t Add(std::function<void()> task) {
+            mNodes.push_back(std::make_unique<Node>());
+            mNodes.back()->mTask = std::move(task);
+
+            return (uint32_t)mNodes.size() - 1;
+        }
+
+        /**
+         * @brief Task runs only after dependency finished
+         *
+         */
+        void Depend(uint32_t task, uint32_t dependency) {
+            mNodes[dependency]->mSuccessors.push_back(task);
+            mNodes[task]->mDependencyCount++;
+        }
+
+        size_t GetSize() { return mNodes.size(); }
+
+        void Clear() { mNodes.clear(); }
+
+        /**
+         * @brief Run all tasks and wait for them, graph can run again afterwards
+         *
+         */
+        void Run(JobSystem* pSystem) {
+            JobCounter counter = 0;
+
+            for(const std::unique_ptr<Node>& node : mNodes) node->mPending.store(node->mDependencyCount, std::memory_order_relaxed);
+
+            for(uint32_t i = 0; i < mNodes.size(); i++) {
+                if(mNodes[i]->mDependencyCount == 0) SubmitNode(pSystem, i, &counter);
+            }
+
+            pSystem->Wait(&counter);
+        }
+    };
+}
+
+#endif
@@ -6,7 +6,14 @@
 #include <vector>
 #include <cstdint>
 #include <algorithm>
+#include <functional>
+#include <atomic>
+#include <typeindex>
+#include <unordered_map>
 #include "core.hpp"
+#include "job_system.hpp"
+#include "frame_graph.hpp"
+#include "snapshot.hpp"
 
 namespace te {
     enum LayerFlags {
@@ -17,16 +24,74 @@ namespace te {
         LF_Update = 0x10,
         LF_LateUpdate = 0x20,
         LF_FixedUpdate = 0x40,
-        LF_End = 0x80
+        LF_End = 0x80,
+        // Layer touches nothing other layers use during a phase, may run on worker thread next to them (opt-in, see
+        // LayerHandler::SetConcurrentLayers). In frame graph it conflicts with no stage, undeclared ones included
+        LF_Concurrent = 0x100,
+        // Layers of same class with this flag are handed to RunBatch of first of them together (opt-in, order against
+        // other layers follows first one of class)
+        LF_Batch = 0x200
     };
 
+    class Layer;
+
+    enum LayerCommandType {
+        LC_Add,
+        LC_Remove,
+        LC_RemoveByName,
+        LC_RemoveByTag
+    };
+
+    // Layer list change waiting for ApplyLayerChanges, linked into lock free stack
+    typedef struct LayerCommand {
+        LayerCommandType mType;
+        Layer* pLayer = nullptr;
+        std::string mKey;
+        LayerCommand* pNext = nullptr;
+    } LayerCommand;
+
     class Layer {
     protected:
         std::string mName = "N_DEF";
         std::string mTag = "T_DEF";
         std::string mType = "T_LAYER";
 
-        uint8_t mFlags;
+        // Read by FixedUpdate thread while main thread may change it. Change it through SetFlag, dispatch lists only
+        // notice changes that bump flags version
+        std::atomic<uint32_t> mFlags = 0;
+
+        static inline std::atomic<uint32_t> sFlagsVersion = 0;
+
+        // Resources touched in Update and LateUpdate, see Reads/Writes
+        std::vector<uint64_t> mReads;
+        std::vector<uint64_t> mWrites;
+        bool mDeclaresResources = false;
+
+        /**
+         * @brief Declare resource layer reads in Update/LateUpdate. Layer that declares anything (or nothing but has
+         * LF_Concurrent) joins frame graph and runs next to layers it doesn`t conflict with, TE_RESOURCE_GL keeps it on
+         * main thread
+         *
+         * @param resource
+         */
+        void Reads(std::string_view resource) {
+            mReads.push_back(GetResourceId(resource));
+            mDeclaresResources = true;
+            // Declarations change frame graph the same way flags do
+            sFlagsVersion.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Declare resource layer writes in Update/LateUpdate
+         *
+         * @param resource
+         */
+        void Writes(std::string_view resource) {
+            mWrites.push_back(GetResourceId(resource));
+            mDeclaresResources = true;
+            // Declarations change frame graph the same way flags do
+            sFlagsVersion.fetch_add(1, std::memory_order_release);
+        }
 
     public:
         /**
@@ -34,14 +99,19 @@ namespace te {
          * 
          * @param flags 
          */
-        void SetFlag(uint8_t flags) { mFlags = flags; }
+        void SetFlag(uint32_t flags) {
+            if(mFlags.exchange(flags, std::memory_order_relaxed) != flags) sFlagsVersion.fetch_add(1, std::memory_order_release);
+        }
 
         /**
          * @brief Get the Flags
          * 
-         * @return uint8_t 
+         * @return uint32_t 
          */
-        uint8_t GetFlags() { return mFlags; }
+        uint32_t GetFlags() { return mFlags.load(std::memory_order_relaxed); }
+
+        // Bumped by every SetFlag that changed something and every resource declaration, on any layer
+        static uint32_t GetFlagsVersion() { return sFlagsVersion.load(std::memory_order_acquire); }
 
         void SetName(std::string name) { mName = name; }
         void SetTag(std::string tag) { mTag = tag; }
@@ -50,6 +120,16 @@ namespace te {
         std::string GetTag() { return mTag; }
         std::string GetType() { return mType; }
 
+        const std::vector<uint64_t>& GetReads() { return mReads; }
+        const std::vector<uint64_t>& GetWrites() { return mWrites; }
+
+        /**
+         * @brief Layer said what it touches, without it layer is assumed to touch everything
+         *
+         * @return bool
+         */
+        bool DeclaresResources() { return mDeclaresResources || (mFlags & LF_Concurrent); }
+
         /**
          * @brief Awake layer
          * 
@@ -85,11 +165,292 @@ namespace te {
          * 
          */
         virtual void End() {}
+
+        /**
+         * @brief Run phase on all LF_Batch layers of this class at once, called on first of them. Override to walk
+         * them in one tight loop (they are all this class, static_cast is safe)
+         *
+         * @param phase LF_Update, LF_LateUpdate or LF_FixedUpdate
+         * @param pLayers
+         * @param count
+         */
+        virtual void RunBatch(uint32_t phase, Layer* const* pLayers, size_t count) {
+            for(size_t i = 0; i < count; i++) {
+                switch(phase) {
+                case LF_Update: pLayers[i]->Update(); break;
+                case LF_LateUpdate: pLayers[i]->LateUpdate(); break;
+                case LF_FixedUpdate: pLayers[i]->FixedUpdate(); break;
+                default: break;
+                }
+            }
+        }
     };
 
+    // Consecutive layers in dispatch list, batch goes to RunBatch of first layer
+    typedef struct LayerRun {
+        uint32_t mBegin;
+        uint32_t mCount;
+        bool mBatch;
+    } LayerRun;
+
+    /**
+     * @brief Layers of one phase that have its flag, flat so running phase doesn`t test flags of every layer
+     *
+     */
+    typedef struct LayerDispatch {
+        // Runs in order on calling thread, batch members next to each other
+        std::vector<Layer*> mLayers;
+        std::vector<LayerRun> mRuns;
+        // LF_Concurrent layers when concurrent layers are on, go to JobSystem
+        std::vector<Layer*> mConcurrent;
+        bool mHasBatches = false;
+
+        uint32_t mFlagsVersion = 0;
+        uint64_t mGeneration = 0;
+        bool mConcurrentLayers = false;
+        bool mBuilt = false;
+
+        bool IsStale(uint64_t generation, bool concurrentLayers) {
+            return !mBuilt || mGeneration != generation || mConcurrentLayers != concurrentLayers || mFlagsVersion != Layer::GetFlagsVersion();
+        }
+
+        void Build(const std::vector<Layer*>& layers, uint32_t flag, uint64_t generation, bool concurrentLayers) {
+            // Version first, flag change racing with build makes next check stale instead of getting lost
+            mFlagsVersion = Layer::GetFlagsVersion();
+            mGeneration = generation;
+            mConcurrentLayers = concurrentLayers;
+            mBuilt = true;
+
+            mLayers.clear();
+            mRuns.clear();
+            mConcurrent.clear();
+            mHasBatches = false;
+
+            // Batch of each class in order its first layer appears
+            std::vector<std::vector<Layer*>> batches;
+            std::unordered_map<std::type_index, size_t> batch_index;
+            std::vector<std::pair<Layer*, int64_t>> order;
+
+            for(Layer* l : layers) {
+                const uint32_t flags = l->GetFlags();
+
+                if(!(flags & flag)) continue;
+
+                if(concurrentLayers && (flags & LF_Concurrent)) {
+                    mConcurrent.push_back(l);
+                }
+                else if(flags & LF_Batch) {
+                    const std::pair<std::unordered_map<std::type_index, size_t>::iterator, bool> inserted = batch_index.insert({ std::type_index(typeid(*l)), batches.size() });
+
+                    if(inserted.second) {
+                        batches.push_back({});
+                        order.push_back({ nullptr, (int64_t)inserted.first->second });
+                    }
+
+                    batches[inserted.first->second].push_back(l);
+                }
+                else {
+                    order.push_back({ l, -1 });
+                }
+            }
+
+            for(const std::pair<Layer*, int64_t>& entry : order) {
+                const uint32_t begin = (uint32_t)mLayers.size();
+
+                if(entry.first) {
+                    mLayers.push_back(entry.first);
+                    mRuns.push_back({ begin, 1, false });
+                }
+                else {
+                    const std::vector<Layer*>& batch = batches[entry.second];
+
+                    mLayers.insert(mLayers.end(), batch.begin(), batch.end());
+                    mRuns.push_back({ begin, (uint32_t)batch.size(), true });
+                    mHasBatches = true;
+                }
+            }
+        }
+    } LayerDispatch;
+
     class LayerHandler {
     private:
+        // Main thread only, changes go through command queue and land in ApplyLayerChanges
         std::vector<Layer*> mLayerPtr;
+        // Also read by FixedUpdate thread
+        std::atomic<bool> mConcurrentLayers = false;
+
+        std::atomic<LayerCommand*> pCommands = nullptr;
+
+        // Update and LateUpdate are main thread only, FixedUpdate one belongs to FixedUpdate thread
+        LayerDispatch mUpdateDispatch;
+        LayerDispatch mLateUpdateDispatch;
+        LayerDispatch mFixedUpdateDispatch;
+
+        // Copy of list for FixedUpdate thread, published on every change. Generation is snapshot tick
+        SnapshotBuffer<std::vector<Layer*>> mFixedLayers;
+        uint64_t mLayerGeneration = 0;
+        std::atomic<uint64_t> mFixedGeneration = 0;
+
+        void PushCommand(LayerCommandType type, Layer* pLayer, std::string key) {
+            LayerCommand* p_command = new LayerCommand{ type, pLayer, std::move(key), pCommands.load(std::memory_order_relaxed) };
+
+            while(!pCommands.compare_exchange_weak(p_command->pNext, p_command, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        bool ApplyCommand(const LayerCommand& command) {
+            if(command.mType == LC_Add) {
+                mLayerPtr.push_back(command.pLayer);
+
+                return true;
+            }
+
+            std::vector<Layer*>::iterator iter = mLayerPtr.end();
+
+            switch(command.mType) {
+            case LC_Remove: iter = std::find(mLayerPtr.begin(), mLayerPtr.end(), command.pLayer); break;
+            case LC_RemoveByName: iter = std::find_if(mLayerPtr.begin(), mLayerPtr.end(), [&](Layer* l) { return l->GetName() == command.mKey; }); break;
+            case LC_RemoveByTag: iter = std::find_if(mLayerPtr.begin(), mLayerPtr.end(), [&](Layer* l) { return l->GetTag() == command.mKey; }); break;
+            default: break;
+            }
+
+            if(iter == mLayerPtr.end()) {
+                TE_WARN("Cannot remove layer " << (command.pLayer ? command.pLayer->GetName() : command.mKey) << ", it isn`t added!")
+
+                return false;
+            }
+
+            mLayerPtr.erase(iter);
+
+            return true;
+        }
+
+        // Update, present and LateUpdate of one frame, rebuilt when layers, their flags or declarations change
+        FrameGraph mFrameGraph;
+        std::function<void()> mPresent;
+        uint64_t mFrameGraphGeneration = 0;
+        uint32_t mFrameGraphFlagsVersion = 0;
+        std::atomic<bool> mDumpCriticalPath = false;
+
+        /**
+         * @brief Add stages of one phase, grouped same way as dispatch list: one stage per layer or per LF_Batch class
+         * calling its RunBatch with union of members declarations, LF_Concurrent layers stay alone
+         *
+         * @param flag LF_Update or LF_LateUpdate
+         * @param suffix of stage names
+         * @param phase layer member to call
+         * @param pStages output, stage of every layer in phase
+         */
+        void AddFrameGraphPhase(uint32_t flag, const char* suffix, void (Layer::*phase)(), std::unordered_map<Layer*, uint32_t>* pStages) {
+            LayerDispatch dispatch;
+            dispatch.Build(mLayerPtr, flag, mLayerGeneration, true);
+
+            for(const LayerRun& run : dispatch.mRuns) {
+                Layer* const* p_layers = &dispatch.mLayers[run.mBegin];
+                Layer* l = p_layers[0];
+
+                if(!run.mBatch) {
+                    (*pStages)[l] = mFrameGraph.Add({ l->GetName() + " " + suffix, [l, phase]() { (l->*phase)(); }, l->GetReads(), l->GetWrites(), l->DeclaresResources() });
+
+                    continue;
+                }
+
+                std::vector<Layer*> batch(p_layers, p_layers + run.mCount);
+                FrameStage stage = { l->GetName() + " (batch of " + std::to_string(run.mCount) + ") " + suffix, {}, {}, {}, true };
+
+                for(Layer* member : batch) {
+                    for(uint64_t resource : member->GetReads()) {
+                        if(std::find(stage.mReads.begin(), stage.mReads.end(), resource) == stage.mReads.end()) stage.mReads.push_back(resource);
+                    }
+
+                    for(uint64_t resource : member->GetWrites()) {
+                        if(std::find(stage.mWrites.begin(), stage.mWrites.end(), resource) == stage.mWrites.end()) stage.mWrites.push_back(resource);
+                    }
+
+                    // One undeclared member makes whole batch undeclared
+                    stage.mDeclared &= member->DeclaresResources();
+                    (*pStages)[member] = (uint32_t)mFrameGraph.GetSize();
+                }
+
+                stage.mTask = [batch, flag]() { batch[0]->RunBatch(flag, batch.data(), batch.size()); };
+
+                mFrameGraph.Add(std::move(stage));
+            }
+
+            for(Layer* l : dispatch.mConcurrent) {
+                (*pStages)[l] = mFrameGraph.Add({ l->GetName() + " " + suffix, [l, phase]() { (l->*phase)(); }, l->GetReads(), l->GetWrites(), l->DeclaresResources(), true });
+            }
+        }
+
+        void BuildFrameGraph() {
+            mFrameGraphFlagsVersion = Layer::GetFlagsVersion();
+            mFrameGraph.Clear();
+
+            std::unordered_map<Layer*, uint32_t> updates, late_updates;
+
+            AddFrameGraphPhase(LF_Update, "Update", &Layer::Update, &updates);
+
+            // Swap waits on GPU, stages after it that don`t touch GL overlap with it
+            mFrameGraph.Add({ "Present", [this]() { mPresent(); }, {}, { GetResourceId(TE_RESOURCE_GL) }, true });
+
+            AddFrameGraphPhase(LF_LateUpdate, "LateUpdate", &Layer::LateUpdate, &late_updates);
+
+            // Layer that only reads (or LF_Concurrent one) could otherwise LateUpdate before its own Update, batch stages
+            // would give same edge once per member
+            std::vector<std::pair<uint32_t, uint32_t>> same_layer;
+
+            for(const std::pair<Layer* const, uint32_t>& late : late_updates) {
+                std::unordered_map<Layer*, uint32_t>::iterator update = updates.find(late.first);
+
+                if(update != updates.end()) same_layer.push_back({ late.second, update->second });
+            }
+
+            std::sort(same_layer.begin(), same_layer.end());
+            same_layer.erase(std::unique(same_layer.begin(), same_layer.end()), same_layer.end());
+
+            for(const std::pair<uint32_t, uint32_t>& edge : same_layer) mFrameGraph.Depend(edge.first, edge.second);
+
+            mFrameGraph.Build();
+            mFrameGraphGeneration = mLayerGeneration;
+        }
+
+        /**
+         * @brief Run phase from its dispatch list, rebuilt first if membership, flags or concurrent setting changed.
+         * With concurrent layers on, LF_Concurrent layers go to JobSystem and run next to others, rest still runs in
+         * order on calling thread
+         *
+         * @param pDispatch list of phase, owned by calling thread
+         * @param layers main list or FixedUpdate copy
+         * @param generation layer list generation of layers
+         * @param flag LF_Update, LF_LateUpdate or LF_FixedUpdate
+         * @param phase layer member to call
+         */
+        void RunPhase(LayerDispatch* pDispatch, const std::vector<Layer*>& layers, uint64_t generation, uint32_t flag, void (Layer::*phase)()) {
+            JobSystem* p_jobs = JobSystem::pGlobal;
+            const bool concurrent = mConcurrentLayers.load(std::memory_order_relaxed) && p_jobs && p_jobs->IsRunning();
+
+            if(pDispatch->IsStale(generation, concurrent)) pDispatch->Build(layers, flag, generation, concurrent);
+
+            JobCounter counter = 0;
+
+            for(Layer* l : pDispatch->mConcurrent) {
+                p_jobs->Submit([l, phase]() { (l->*phase)(); }, &counter);
+            }
+
+            Layer* const* p_layers = pDispatch->mLayers.data();
+
+            // No batches, skip runs
+            if(!pDispatch->mHasBatches) {
+                for(Layer* l : pDispatch->mLayers) (l->*phase)();
+            }
+            else {
+                for(const LayerRun& run : pDispatch->mRuns) {
+                    if(run.mBatch) p_layers[run.mBegin]->RunBatch(flag, p_layers + run.mBegin, run.mCount);
+                    else (p_layers[run.mBegin]->*phase)();
+                }
+            }
+
+            if(!pDispatch->mConcurrent.empty()) p_jobs->Wait(&counter);
+        }
 
     public:
         /**
@@ -109,42 +470,91 @@ namespace te {
             }
         }
 
-        void AddLayer(Layer* pLayer) {
-            mLayerPtr.push_back(pLayer);
-        }
+        /**
+         * @brief Let LF_Concurrent layers update on JobSystem workers, Window runs frames through LayersFrame
+         *
+         * @param enabled
+         */
+        void SetConcurrentLayers(bool enabled) { mConcurrentLayers = enabled; }
 
-        void RemoveLayer(Layer* pLayer) {
-            std::vector<Layer*>::iterator iter = std::find(mLayerPtr.begin(), mLayerPtr.end(), pLayer);
+        bool GetConcurrentLayers() { return mConcurrentLayers; }
 
-            mLayerPtr.erase(iter);
-        }
+        /**
+         * @brief Queue layer to be added, safe from any thread (layer callbacks, FixedUpdate). Takes effect on next
+         * ApplyLayerChanges, which every main thread phase starting a frame calls
+         *
+         * @param pLayer
+         */
+        void AddLayer(Layer* pLayer) { PushCommand(LC_Add, pLayer, ""); }
 
-        void RemoveLayer(std::string name) {
-            size_t i = 0;
-            
-            for(Layer* l : mLayerPtr) {
-                if(l->GetName() == name) {
-                    break;
-                }
+        /**
+         * @brief Queue layer to be removed, safe from any thread. FixedUpdate tick already running may still call it,
+         * layer can be destroyed once IsFixedUpdateCaughtUp(GetLayerGeneration()) after change was applied
+         *
+         * @param pLayer
+         */
+        void RemoveLayer(Layer* pLayer) { PushCommand(LC_Remove, pLayer, ""); }
+
+        void RemoveLayer(std::string name) { PushCommand(LC_RemoveByName, nullptr, std::move(name)); }
+
+        void RemoveLayerByTag(std::string tag) { PushCommand(LC_RemoveByTag, nullptr, std::move(tag)); }
+
+        /**
+         * @brief Main thread only, apply queued changes in order they were made and hand new list to FixedUpdate thread
+         *
+         */
+        void ApplyLayerChanges() {
+            LayerCommand* p_command = pCommands.exchange(nullptr, std::memory_order_acquire);
 
-                i++;
+            if(!p_command) return;
+
+            // Stack is newest first
+            LayerCommand* p_ordered = nullptr;
+
+            while(p_command) {
+                LayerCommand* p_next = p_command->pNext;
+                p_command->pNext = p_ordered;
+                p_ordered = p_command;
+                p_command = p_next;
             }
 
-            mLayerPtr.erase(mLayerPtr.begin() + i);
-        }
+            bool changed = false;
 
-        void RemoveLayerByTag(std::string tag) {
-            size_t i = 0;
-            
-            for(Layer* l : mLayerPtr) {
-                if(l->GetTag() == tag) {
-                    break;
-                }
+            while(p_ordered) {
+                LayerCommand* p_next = p_ordered->pNext;
+
+                changed |= ApplyCommand(*p_ordered);
 
-                i++;
+                delete p_ordered;
+                p_ordered = p_next;
             }
 
-            mLayerPtr.erase(mLayerPtr.begin() + i);
+            if(!changed) return;
+
+            mFixedLayers.GetWrite() = mLayerPtr;
+            mFixedLayers.Publish(++mLayerGeneration);
+        }
+
+        // Number of applied layer list changes
+        uint64_t GetLayerGeneration() { return mLayerGeneration; }
+
+        /**
+         * @brief FixedUpdate thread started tick with list of generation or newer, so no tick uses anything older
+         *
+         * @param generation
+         * @return bool
+         */
+        bool IsFixedUpdateCaughtUp(uint64_t generation) { return mFixedGeneration.load(std::memory_order_acquire) >= generation; }
+
+        ~LayerHandler() {
+            LayerCommand* p_command = pCommands.exchange(nullptr);
+
+            while(p_command) {
+                LayerCommand* p_next = p_command->pNext;
+
+                delete p_command;
+                p_command = p_next;
+            }
         }
 
         /**
@@ -152,6 +562,8 @@ namespace te {
          * 
          */
         void LayersAwake() {
+            ApplyLayerChanges();
+
             for(Layer* l : mLayerPtr) {
                 if(l->GetFlags() & LF_Awake && !(l->GetFlags() & LF_Awakend)) {
                     l->Awake();
@@ -166,6 +578,8 @@ namespace te {
          * 
          */
         void LayersStart() {
+            ApplyLayerChanges();
+
             for(Layer* l : mLayerPtr) {
                 if(l->GetFlags() & LF_Start && !(l->GetFlags() & LF_Start)) {
                     l->Start();
@@ -180,11 +594,9 @@ namespace te {
          * 
          */
         void LayersUpdate() {
-            for(Layer* l : mLayerPtr) {
-                if(l->GetFlags() & LF_Update) {
-                    l->Update();
-                }
-            }
+            ApplyLayerChanges();
+
+            RunPhase(&mUpdateDispatch, mLayerPtr, mLayerGeneration, LF_Update, &Layer::Update);
         }
 
         /**
@@ -192,23 +604,47 @@ namespace te {
          * 
          */
         void LayersLateUpdate() {
-            for(Layer* l : mLayerPtr) {
-                if(l->GetFlags() & LF_LateUpdate) {
-                    l->LateUpdate();
-                }
-            }
+            RunPhase(&mLateUpdateDispatch, mLayerPtr, mLayerGeneration, LF_LateUpdate, &Layer::LateUpdate);
         }
 
         /**
-         * @brief Fixed update all added layers
+         * @brief Update, present and late update as one graph. Layers that declared resources run in parallel with
+         * everything they don`t conflict with, undeclared layers keep old serial order on calling thread. LateUpdate
+         * stages that stay off GL overlap with present
+         *
+         * @param present swaps buffers, runs on calling thread
+         */
+        void LayersFrame(std::function<void()> present) {
+            ApplyLayerChanges();
+
+            mPresent = std::move(present);
+
+            if(!mFrameGraph.IsBuilt() || mFrameGraphGeneration != mLayerGeneration || mFrameGraphFlagsVersion != Layer::GetFlagsVersion()) BuildFrameGraph();
+
+            const bool dump = mDumpCriticalPath.exchange(false);
+
+            mFrameGraph.Run(JobSystem::pGlobal, dump);
+
+            if(dump) mFrameGraph.DumpCriticalPath();
+        }
+
+        /**
+         * @brief Log critical path of next LayersFrame, safe from any thread
+         *
+         */
+        void RequestCriticalPathDump() { mDumpCriticalPath = true; }
+
+        FrameGraph& GetFrameGraph() { return mFrameGraph; }
+
+        /**
+         * @brief Fixed update all added layers, uses newest list main thread published and never touches main list
          * 
          */
         void LayersFixedUpdate() {
-            for(Layer* l : mLayerPtr) {
-                if(l->GetFlags() & LF_FixedUpdate) {
-                    l->FixedUpdate();
-                }
-            }
+            mFixedLayers.Acquire();
+            mFixedGeneration.store(mFixedLayers.GetCurrentTick(), std::memory_order_release);
+
+            RunPhase(&mFixedUpdateDispatch, mFixedLayers.GetCurrent(), mFixedLayers.GetCurrentTick(), LF_FixedUpdate, &Layer::FixedUpdate);
         }
 
         /**
@@ -216,6 +652,8 @@ namespace te {
          * 
          */
         void LayersEnd() {
+            ApplyLayerChanges();
+
             for(Layer* l : mLayerPtr) {
                 if(l->GetFlags() & LF_End) {
                     l->End();
@@ -3,13 +3,30 @@
 #define _TE_LOAD_PNG_
 
 #include "core.hpp"
+#include "ul_mapped_file.hpp"
 #include <vector>
 #include <fstream>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TE_PNG_SSE2
+#endif
+
+// Largest image decoders accept, 16K x 16K, RGBA8 output is 1 GiB. Bigger IHDR is rejected before anything is allocated
+#ifndef TE_PNG_MAX_PIXELS
+#define TE_PNG_MAX_PIXELS (1ull << 28)
+#endif
 
 namespace te {
     /**
      * @brief Copy memory (bytes) by given size specified by T, by T it means it can operate on arbitrary sizes
-     * 
+     *
      * @tparam T type of returned data (mainly for size)
      * @param ptr pointer to bytes to convert
      * @return T our data returned by desired type
@@ -19,25 +36,1443 @@ namespace te {
         return *(T*)ptr;
     }
 
-    std::vector<uint8_t> PNGLoadPNGFile(std::string path, uint32_t* pWidth, uint32_t* pHeight) {
+    enum PNGColorType {
+        PNG_CT_Grayscale = 0,
+        PNG_CT_RGB = 2,
+        PNG_CT_Palette = 3,
+        PNG_CT_GrayscaleAlpha = 4,
+        PNG_CT_RGBA = 6
+    };
+
+    enum PNGFormat {
+        // 4 bytes per pixel, 16 bit images keep their high byte
+        PNG_RGBA8,
+        // 4 native endian uint16_t per pixel, 8 bit and lower images are scaled up to full range
+        PNG_RGBA16
+    };
+
+    typedef struct PNGInfo {
+        uint32_t mWidth, mHeight;
+        uint8_t mBitDepth;
+        uint8_t mColorType;
+        uint8_t mInterlace;
+    } PNGInfo;
+
+    static inline uint32_t PNGReadBE32(const uint8_t* p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3]; }
+
+    // ---------------------------------------------------------------- Inflate ----------------------------------------------------------------
+
+    // Codes up to this length resolve with single table lookup, longer ones walk canonical code counts
+    #define TE_PNG_FAST_BITS 10
+
+    typedef struct PNGHuffman {
+        // (symbol << 4) | length, 0 when code is longer than TE_PNG_FAST_BITS
+        uint16_t mFast[1 << TE_PNG_FAST_BITS];
+        uint16_t mCount[16];
+        uint16_t mSymbol[288];
+    } PNGHuffman;
+
+    /**
+     * @brief Build decoding tables from code lengths
+     *
+     * @param pTable
+     * @param lengths code length of every symbol, 0 for unused
+     * @param count amount of symbols
+     * @return true lengths describe valid (possibly incomplete) prefix code
+     */
+    bool PNGBuildHuffman(PNGHuffman* pTable, const uint8_t* lengths, uint32_t count) {
+        memset(pTable->mCount, 0, sizeof(pTable->mCount));
+        memset(pTable->mFast, 0, sizeof(pTable->mFast));
+
+        for(uint32_t i = 0; i < count; i++) pTable->mCount[lengths[i]]++;
+
+        pTable->mCount[0] = 0;
+
+        int32_t left = 1;
+
+        for(uint32_t len = 1; len < 16; len++) {
+            left <<= 1;
+            left -= pTable->mCount[len];
+
+            if(left < 0) return false;
+        }
+
+        uint16_t offsets[16];
+        uint32_t next_code[16];
+        uint32_t code = 0;
+
+        offsets[1] = 0;
+
+        for(uint32_t len = 1; len < 16; len++) {
+            if(len > 1) offsets[len] = offsets[len - 1] + pTable->mCount[len - 1];
+
+            next_code[len] = code;
+            code = (code + pTable->mCount[len]) << 1;
+        }
+
+        for(uint32_t i = 0; i < count; i++) {
+            const uint32_t len = lengths[i];
+
+            if(len == 0) continue;
+
+            pTable->mSymbol[offsets[len]++] = (uint16_t)i;
+
+            const uint32_t c = next_code[len]++;
+
+            if(len > TE_PNG_FAST_BITS) continue;
+
+            // Deflate sends codes from most significant bit while bit reader hands them out from least significant one
+            uint32_t reversed = 0;
+
+            for(uint32_t b = 0; b < len; b++) reversed |= ((c >> b) & 1) << (len - 1 - b);
+
+            for(uint32_t fill = reversed; fill < (1u << TE_PNG_FAST_BITS); fill += 1u << len) {
+                pTable->mFast[fill] = (uint16_t)(i << 4 | len);
+            }
+        }
+
+        return true;
+    }
+
+    typedef struct PNGBitReader {
+        const uint8_t* mStart;
+        const uint8_t* mPtr;
+        const uint8_t* mEnd;
+        uint64_t mBits;
+        uint32_t mCount;
+        // Zero bytes fed after input ran out
+        size_t mOverrun;
+
+        void Init(const uint8_t* data, size_t size) {
+            mStart = mPtr = data;
+            mEnd = data + size;
+            mBits = 0;
+            mCount = 0;
+            mOverrun = 0;
+        }
+
+        // Keep at least 56 bits buffered, enough for longest length + distance pair
+        inline void Refill() {
+            if(mEnd - mPtr >= 8) {
+                uint64_t v;
+                memcpy(&v, mPtr, 8);
+
+                mBits |= v << mCount;
+                mPtr += (63 - mCount) >> 3;
+                mCount |= 56;
+
+                return;
+            }
+
+            while(mCount <= 56) {
+                uint64_t byte = 0;
+
+                if(mPtr < mEnd) {
+                    byte = *mPtr++;
+                }
+                else {
+                    mOverrun++;
+                }
+
+                mBits |= byte << mCount;
+                mCount += 8;
+            }
+        }
+
+        inline uint32_t Peek(uint32_t count) { return (uint32_t)(mBits & ((1ull << count) - 1)); }
+        inline void Drop(uint32_t count) { mBits >>= count; mCount -= count; }
+        inline uint32_t Get(uint32_t count) { uint32_t v = Peek(count); Drop(count); return v; }
+
+        /**
+         * @brief Amount of input bits actually used
+         *
+         * @return size_t
+         */
+        size_t ConsumedBits() { return (size_t)(mPtr - mStart + mOverrun) * 8 - mCount; }
+
+        bool Overrun() { return ConsumedBits() > (size_t)(mEnd - mStart) * 8; }
+    } PNGBitReader;
+
+    static inline uint32_t PNGDecodeSymbol(PNGBitReader* pReader, const PNGHuffman* pTable) {
+        const uint16_t fast = pTable->mFast[pReader->Peek(TE_PNG_FAST_BITS)];
+
+        if(fast) {
+            pReader->Drop(fast & 0xf);
+
+            return fast >> 4;
+        }
+
+        // Canonical walk, one bit at a time, bit reader always holds at least 15 bits here
+        int32_t code = 0, first = 0, index = 0;
+
+        for(uint32_t len = 1; len < 16; len++) {
+            code |= (int32_t)((pReader->mBits >> (len - 1)) & 1);
+
+            const int32_t count = pTable->mCount[len];
+
+            if(code - first < count) {
+                pReader->Drop(len);
+
+                return pTable->mSymbol[index + code - first];
+            }
+
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+
+        // Code not in table, caller treats symbols out of range as error
+        return 0xffff;
+    }
+
+    static const uint16_t gPNGLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t gPNGLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t gPNGDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const uint8_t gPNGDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    static const uint8_t gPNGCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    enum PNGInflateResult {
+        // Final block decoded
+        PNG_INFLATE_Done,
+        // Input ended exactly after non final block
+        PNG_INFLATE_BlockEnd,
+        PNG_INFLATE_Error
+    };
+
+    /**
+     * @brief Inflate raw deflate stream (no zlib header) into preallocated buffer
+     *
+     * @param in compressed data
+     * @param inSize size of compressed data
+     * @param out output buffer
+     * @param outStart where to start writing, back references can`t reach before it
+     * @param outCapacity size of out, overflowing it is an error
+     * @param pOutEnd output, end of written data
+     * @param pProgress optional, released every block and every 64 KiB so other thread can consume output while it is inflated
+     * @param pInEnd optional, bytes of input used by stream once it is done (zlib trailer follows)
+     * @return PNGInflateResult
+     */
+    PNGInflateResult PNGInflateRaw(const uint8_t* in, size_t inSize, uint8_t* out, size_t outStart, size_t outCapacity, size_t* pOutEnd, std::atomic<size_t>* pProgress = nullptr, size_t* pInEnd = nullptr) {
+        static PNGHuffman fixed_literals, fixed_distances;
+        static const bool fixed_built = [] {
+            uint8_t lengths[288];
+
+            for(int i = 0; i < 144; i++) lengths[i] = 8;
+            for(int i = 144; i < 256; i++) lengths[i] = 9;
+            for(int i = 256; i < 280; i++) lengths[i] = 7;
+            for(int i = 280; i < 288; i++) lengths[i] = 8;
+
+            PNGBuildHuffman(&fixed_literals, lengths, 288);
+
+            for(int i = 0; i < 30; i++) lengths[i] = 5;
+
+            PNGBuildHuffman(&fixed_distances, lengths, 30);
+
+            return true;
+        }();
+        (void)fixed_built;
+
+        PNGHuffman dynamic_literals, dynamic_distances;
+        PNGBitReader br;
+        br.Init(in, inSize);
+
+        size_t pos = outStart;
+        size_t published = pos;
+        bool final_block = false;
+
+        *pOutEnd = pos;
+
+        while(!final_block) {
+            if(br.ConsumedBits() >= inSize * 8) {
+                // Clean end of input between blocks
+                return PNG_INFLATE_BlockEnd;
+            }
+
+            br.Refill();
+
+            final_block = br.Get(1);
+            const uint32_t type = br.Get(2);
+
+            const PNGHuffman* literals = &fixed_literals;
+            const PNGHuffman* distances = &fixed_distances;
+
+            if(type == 0) {
+                // Stored block, skip to byte boundary and copy LEN bytes
+                br.Drop(br.mCount & 7);
+                br.Refill();
+
+                const uint32_t len = br.Get(16);
+                const uint32_t nlen = br.Get(16);
+
+                if((len ^ 0xffff) != nlen || pos + len > outCapacity) return PNG_INFLATE_Error;
+
+                uint32_t left = len;
+
+                while(left && br.mCount >= 8) {
+                    out[pos++] = (uint8_t)br.Get(8);
+                    left--;
+                }
+
+                // Fast refill leaves bits of next byte above mCount, they would get mixed with whatever comes after raw copy
+                if(br.mCount == 0) br.mBits = 0;
+
+                if(left) {
+                    // Bit buffer is empty now, so its bytes were all handed out
+                    if((size_t)(br.mEnd - br.mPtr) < left) return PNG_INFLATE_Error;
+
+                    memcpy(out + pos, br.mPtr, left);
+                    br.mPtr += left;
+                    pos += left;
+                }
+            }
+            else if(type == 1 || type == 2) {
+                if(type == 2) {
+                    const uint32_t hlit = br.Get(5) + 257;
+                    const uint32_t hdist = br.Get(5) + 1;
+                    const uint32_t hclen = br.Get(4) + 4;
+
+                    uint8_t code_lengths[19] = {};
+
+                    // Up to 57 bits, one refill isn`t enough
+                    for(uint32_t i = 0; i < hclen; i++) {
+                        if(i % 16 == 0) br.Refill();
+
+                        code_lengths[gPNGCodeLengthOrder[i]] = (uint8_t)br.Get(3);
+                    }
+
+                    PNGHuffman code_table;
+
+                    if(!PNGBuildHuffman(&code_table, code_lengths, 19)) return PNG_INFLATE_Error;
+
+                    uint8_t lengths[288 + 32];
+                    uint32_t n = 0;
+
+                    while(n < hlit + hdist) {
+                        br.Refill();
+
+                        const uint32_t sym = PNGDecodeSymbol(&br, &code_table);
+
+                        if(sym < 16) {
+                            lengths[n++] = (uint8_t)sym;
+                        }
+                        else if(sym < 19) {
+                            uint32_t repeat;
+                            uint8_t value = 0;
+
+                            if(sym == 16) {
+                                if(n == 0) return PNG_INFLATE_Error;
+
+                                value = lengths[n - 1];
+                                repeat = 3 + br.Get(2);
+                            }
+                            else if(sym == 17) {
+                                repeat = 3 + br.Get(3);
+                            }
+                            else {
+                                repeat = 11 + br.Get(7);
+                            }
+
+                            if(n + repeat > hlit + hdist) return PNG_INFLATE_Error;
+
+                            memset(lengths + n, value, repeat);
+                            n += repeat;
+                        }
+                        else {
+                            return PNG_INFLATE_Error;
+                        }
+                    }
+
+                    if(lengths[256] == 0) return PNG_INFLATE_Error;
+                    if(!PNGBuildHuffman(&dynamic_literals, lengths, hlit)) return PNG_INFLATE_Error;
+                    if(!PNGBuildHuffman(&dynamic_distances, lengths + hlit, hdist)) return PNG_INFLATE_Error;
+
+                    literals = &dynamic_literals;
+                    distances = &dynamic_distances;
+                }
+
+                while(true) {
+                    br.Refill();
+
+                    uint32_t sym = PNGDecodeSymbol(&br, literals);
+
+                    if(sym < 256) {
+                        if(pos >= outCapacity) return PNG_INFLATE_Error;
+
+                        out[pos++] = (uint8_t)sym;
+
+                        continue;
+                    }
+
+                    if(sym == 256) break;
+
+                    sym -= 257;
+
+                    if(sym >= 29) return PNG_INFLATE_Error;
+
+                    const uint32_t length = gPNGLengthBase[sym] + br.Get(gPNGLengthExtra[sym]);
+                    const uint32_t dsym = PNGDecodeSymbol(&br, distances);
+
+                    if(dsym >= 30) return PNG_INFLATE_Error;
+
+                    const uint32_t distance = gPNGDistanceBase[dsym] + br.Get(gPNGDistanceExtra[dsym]);
+
+                    if(distance > pos - outStart || pos + length > outCapacity) return PNG_INFLATE_Error;
+
+                    uint8_t* dst = out + pos;
+                    const uint8_t* src = dst - distance;
+
+                    if(distance >= 8 && pos + length + 8 <= outCapacity) {
+                        // Overlapping 8 byte copies are fine once source is at least 8 bytes behind, tail overshoot gets overwritten later
+                        for(uint32_t i = 0; i < length; i += 8) memcpy(dst + i, src + i, 8);
+                    }
+                    else if(distance == 1) {
+                        memset(dst, *src, length);
+                    }
+                    else {
+                        for(uint32_t i = 0; i < length; i++) dst[i] = src[i];
+                    }
+
+                    pos += length;
+
+                    if(pProgress && pos - published >= 0x10000) {
+                        published = pos;
+                        pProgress->store(pos, std::memory_order_release);
+                        pProgress->notify_all();
+                    }
+                }
+            }
+            else {
+                return PNG_INFLATE_Error;
+            }
+
+            if(br.Overrun()) return PNG_INFLATE_Error;
+
+            *pOutEnd = pos;
+
+            if(pProgress) {
+                published = pos;
+                pProgress->store(pos, std::memory_order_release);
+                pProgress->notify_all();
+            }
+        }
+
+        if(pInEnd) *pInEnd = (br.ConsumedBits() + 7) / 8;
+
+        return PNG_INFLATE_Done;
+    }
+
+    /**
+     * @brief Adler-32 of zlib trailer, can be continued over consecutive ranges
+     *
+     * @param data
+     * @param size
+     * @param adler value of data before, 1 to start
+     * @return uint32_t
+     */
+    uint32_t PNGAdler32(const uint8_t* data, size_t size, uint32_t adler = 1) {
+        uint32_t a = adler & 0xffff, b = adler >> 16;
+
+        while(size) {
+            // Most bytes sums can take before 32 bits overflow
+            size_t n = std::min<size_t>(size, 5552);
+            size -= n;
+
+            for(; n >= 8; n -= 8, data += 8) {
+                a += data[0]; b += a;
+                a += data[1]; b += a;
+                a += data[2]; b += a;
+                a += data[3]; b += a;
+                a += data[4]; b += a;
+                a += data[5]; b += a;
+                a += data[6]; b += a;
+                a += data[7]; b += a;
+            }
+
+            for(; n; n--) {
+                a += *data++;
+                b += a;
+            }
+
+            a %= 65521;
+            b %= 65521;
+        }
+
+        return b << 16 | a;
+    }
+
+    /**
+     * @brief Check 2 byte zlib header, compression method 8, no preset dictionary, header checksum
+     *
+     * @param in
+     * @param inSize
+     * @return true
+     */
+    static inline bool PNGCheckZlibHeader(const uint8_t* in, size_t inSize) {
+        return inSize >= 2 && (in[0] & 0xf) == 8 && !(in[1] & 0x20) && ((uint32_t)in[0] << 8 | in[1]) % 31 == 0;
+    }
+
+    /**
+     * @brief Inflate zlib stream (as found in IDAT chunks) into preallocated buffer and check its Adler-32
+     *
+     * @param in
+     * @param inSize
+     * @param out
+     * @param outCapacity
+     * @param pOutSize output, amount of bytes written
+     * @param pProgress optional, see PNGInflateRaw
+     * @return true stream was complete and valid
+     */
+    bool PNGInflateZlib(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t* pOutSize, std::atomic<size_t>* pProgress = nullptr) {
+        if(!PNGCheckZlibHeader(in, inSize)) return false;
+
+        size_t in_end = 0;
+
+        if(PNGInflateRaw(in + 2, inSize - 2, out, 0, outCapacity, pOutSize, pProgress, &in_end) != PNG_INFLATE_Done) return false;
+
+        return inSize - 2 - in_end >= 4 && PNGReadBE32(in + 2 + in_end) == PNGAdler32(out, *pOutSize);
+    }
+
+    // --------------------------------------------------------------- Unfilter ----------------------------------------------------------------
+
+    enum PNGFilter {
+        PNG_F_None,
+        PNG_F_Sub,
+        PNG_F_Up,
+        PNG_F_Avg,
+        PNG_F_Paeth
+    };
+
+    static inline uint8_t PNGPaethPredictor(int32_t a, int32_t b, int32_t c) {
+        const int32_t p = a + b - c;
+        const int32_t pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+        if(pa <= pb && pa <= pc) return (uint8_t)a;
+        if(pb <= pc) return (uint8_t)b;
+
+        return (uint8_t)c;
+    }
+
+    static void PNGUnfilterRowScalar(uint32_t filter, uint8_t* row, const uint8_t* prev, size_t length, uint32_t bpp) {
+        switch(filter) {
+        case PNG_F_Sub:
+            for(size_t i = bpp; i < length; i++) row[i] += row[i - bpp];
+
+            break;
+
+        case PNG_F_Up:
+            for(size_t i = 0; i < length; i++) row[i] += prev[i];
+
+            break;
+
+        case PNG_F_Avg:
+            for(size_t i = 0; i < bpp && i < length; i++) row[i] += prev[i] >> 1;
+            for(size_t i = bpp; i < length; i++) row[i] += (uint8_t)(((uint32_t)row[i - bpp] + prev[i]) >> 1);
+
+            break;
+
+        case PNG_F_Paeth:
+            for(size_t i = 0; i < bpp && i < length; i++) row[i] += prev[i];
+            for(size_t i = bpp; i < length; i++) row[i] += PNGPaethPredictor(row[i - bpp], prev[i], prev[i - bpp]);
+
+            break;
+
+        default:
+            break;
+        }
+    }
+
+#ifdef TE_PNG_SSE2
+    // Pixels of 3 or 4 bytes go through one 32 bit lane each, 3 byte pixels are stored back byte exact
+    template<uint32_t BPP>
+    static inline __m128i PNGLoadPixel(const uint8_t* p) {
+        uint32_t v = 0;
+        memcpy(&v, p, BPP);
+
+        return _mm_cvtsi32_si128((int)v);
+    }
+
+    template<uint32_t BPP>
+    static inline void PNGStorePixel(uint8_t* p, __m128i v) {
+        uint32_t x = (uint32_t)_mm_cvtsi128_si32(v);
+        memcpy(p, &x, BPP);
+    }
+
+    template<uint32_t BPP>
+    static void PNGUnfilterPixelsSSE2(uint32_t filter, uint8_t* row, const uint8_t* prev, size_t length) {
+        __m128i a = _mm_setzero_si128();
+        __m128i c = _mm_setzero_si128();
+        const __m128i zero = _mm_setzero_si128();
+
+        if(filter == PNG_F_Sub) {
+            for(size_t i = 0; i < length; i += BPP) {
+                a = _mm_add_epi8(a, PNGLoadPixel<BPP>(row + i));
+                PNGStorePixel<BPP>(row + i, a);
+            }
+        }
+        else if(filter == PNG_F_Avg) {
+            const __m128i one = _mm_set1_epi8(1);
+
+            for(size_t i = 0; i < length; i += BPP) {
+                const __m128i b = PNGLoadPixel<BPP>(prev + i);
+
+                // _mm_avg_epu8 rounds up, take the rounding back where a + b is odd
+                __m128i avg = _mm_avg_epu8(a, b);
+                avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), one));
+
+                a = _mm_add_epi8(avg, PNGLoadPixel<BPP>(row + i));
+                PNGStorePixel<BPP>(row + i, a);
+            }
+        }
+        else if(filter == PNG_F_Paeth) {
+            // a, b and c widened to 16 bit, p - a = b - c, p - b = a - c, p - c = a + b - 2c
+            for(size_t i = 0; i < length; i += BPP) {
+                const __m128i b = _mm_unpacklo_epi8(PNGLoadPixel<BPP>(prev + i), zero);
+                const __m128i a16 = _mm_unpacklo_epi8(a, zero);
+
+                __m128i pa = _mm_sub_epi16(b, c);
+                __m128i pb = _mm_sub_epi16(a16, c);
+                __m128i pc = _mm_add_epi16(pa, pb);
+
+                pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+                // Pick c where it is strictly best, then b over a where b is strictly better
+                const __m128i use_c = _mm_and_si128(_mm_cmpgt_epi16(pa, pc), _mm_cmpgt_epi16(pb, pc));
+                const __m128i pick_b = _mm_cmpgt_epi16(pa, pb);
+
+                __m128i predictor = _mm_or_si128(_mm_and_si128(pick_b, b), _mm_andnot_si128(pick_b, a16));
+                predictor = _mm_or_si128(_mm_and_si128(use_c, c), _mm_andnot_si128(use_c, predictor));
+
+                a = _mm_add_epi8(_mm_packus_epi16(predictor, predictor), PNGLoadPixel<BPP>(row + i));
+                PNGStorePixel<BPP>(row + i, a);
+
+                c = b;
+            }
+        }
+    }
+
+    static void PNGUnfilterRowSSE2(uint32_t filter, uint8_t* row, const uint8_t* prev, size_t length, uint32_t bpp) {
+        if(filter == PNG_F_Up) {
+            size_t i = 0;
+
+            for(; i + 16 <= length; i += 16) {
+                _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(_mm_loadu_si128((const __m128i*)(row + i)), _mm_loadu_si128((const __m128i*)(prev + i))));
+            }
+
+            for(; i < length; i++) row[i] += prev[i];
+
+            return;
+        }
+
+        if((bpp != 3 && bpp != 4) || filter == PNG_F_None || length % bpp != 0) {
+            PNGUnfilterRowScalar(filter, row, prev, length, bpp);
+
+            return;
+        }
+
+        if(bpp == 4) {
+            PNGUnfilterPixelsSSE2<4>(filter, row, prev, length);
+        }
+        else {
+            PNGUnfilterPixelsSSE2<3>(filter, row, prev, length);
+        }
+    }
+#endif
+
+    /**
+     * @brief Undo PNG filter of one row in place
+     *
+     * @param filter filter type byte preceding row
+     * @param row filtered row, without filter byte
+     * @param prev already unfiltered previous row, zeros for first row of image or pass
+     * @param length bytes in row
+     * @param bpp bytes per complete pixel, at least 1
+     */
+    void PNGUnfilterRow(uint32_t filter, uint8_t* row, const uint8_t* prev, size_t length, uint32_t bpp) {
+#ifdef TE_PNG_SSE2
+        PNGUnfilterRowSSE2(filter, row, prev, length, bpp);
+#else
+        PNGUnfilterRowScalar(filter, row, prev, length, bpp);
+#endif
+    }
+
+    // ------------------------------------------------------------ Pixel conversion -----------------------------------------------------------
+
+    typedef struct PNGDecodeState {
+        PNGInfo mInfo;
+        uint32_t mChannels;
+        uint32_t mBitsPerPixel;
+        uint8_t mPalette[256 * 4];
+        uint32_t mPaletteSize = 0;
+        // Color key from tRNS for grayscale and RGB, in sample units
+        bool mHasKey = false;
+        uint16_t mKey[3];
+
+        // IDAT data, points into file when there is only one chunk
+        const uint8_t* mIdat = nullptr;
+        size_t mIdatSize = 0;
+        std::vector<uint8_t> mIdatJoined;
+    } PNGDecodeState;
+
+    static const uint8_t gPNGAdam7[7][4] = {
+        // x0, y0, dx, dy
+        { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+    };
+
+    static inline size_t PNGRowBytes(const PNGDecodeState* pState, uint32_t width) {
+        return ((size_t)width * pState->mBitsPerPixel + 7) / 8;
+    }
+
+    /**
+     * @brief Write one unfiltered row into output pixels
+     *
+     * @param pState
+     * @param src unfiltered row
+     * @param width pixels in row
+     * @param out first output pixel
+     * @param step distance between output pixels in pixels (Adam7 pass spacing)
+     * @param format PNGFormat
+     */
+    static void PNGConvertRow(const PNGDecodeState* pState, const uint8_t* src, uint32_t width, uint8_t* out, uint32_t step, uint32_t format) {
+        const uint32_t depth = pState->mInfo.mBitDepth;
+        const uint32_t type = pState->mInfo.mColorType;
+        const size_t out_pixel = format == PNG_RGBA16 ? 8 : 4;
+        const size_t stride = out_pixel * step;
+
+        // Common 8 bit layouts straight to RGBA8
+        if(format == PNG_RGBA8 && depth == 8 && !pState->mHasKey) {
+            if(type == PNG_CT_RGBA) {
+                if(step == 1) {
+                    memcpy(out, src, (size_t)width * 4);
+                }
+                else {
+                    for(uint32_t x = 0; x < width; x++) memcpy(out + x * stride, src + x * 4, 4);
+                }
+
+                return;
+            }
+
+            if(type == PNG_CT_RGB) {
+                for(uint32_t x = 0; x < width; x++) {
+                    uint8_t* o = out + x * stride;
+
+                    o[0] = src[x * 3 + 0];
+                    o[1] = src[x * 3 + 1];
+                    o[2] = src[x * 3 + 2];
+                    o[3] = 0xff;
+                }
+
+                return;
+            }
+
+            if(type == PNG_CT_Palette) {
+                for(uint32_t x = 0; x < width; x++) memcpy(out + x * stride, &pState->mPalette[src[x] * 4], 4);
+
+                return;
+            }
+        }
+
+        const uint32_t max_value = (1u << depth) - 1;
+
+        for(uint32_t x = 0; x < width; x++) {
+            // Samples at source depth
+            uint32_t samples[4] = { 0, 0, 0, 0 };
+            uint32_t alpha = max_value;
+            uint32_t count = pState->mChannels;
+
+            if(depth < 8) {
+                const size_t bit = (size_t)x * depth;
+
+                samples[0] = (src[bit >> 3] >> (8 - depth - (bit & 7))) & max_value;
+            }
+            else if(depth == 8) {
+                for(uint32_t c = 0; c < count; c++) samples[c] = src[(size_t)x * count + c];
+            }
+            else {
+                for(uint32_t c = 0; c < count; c++) samples[c] = (uint32_t)src[((size_t)x * count + c) * 2] << 8 | src[((size_t)x * count + c) * 2 + 1];
+            }
+
+            uint32_t rgba[4];
+            uint32_t scale_max = max_value;
+
+            switch(type) {
+            case PNG_CT_Grayscale:
+                if(pState->mHasKey && samples[0] == pState->mKey[0]) alpha = 0;
+
+                rgba[0] = rgba[1] = rgba[2] = samples[0];
+                rgba[3] = alpha;
+
+                break;
+
+            case PNG_CT_GrayscaleAlpha:
+                rgba[0] = rgba[1] = rgba[2] = samples[0];
+                rgba[3] = samples[1];
+
+                break;
+
+            case PNG_CT_RGB:
+                if(pState->mHasKey && samples[0] == pState->mKey[0] && samples[1] == pState->mKey[1] && samples[2] == pState->mKey[2]) alpha = 0;
+
+                rgba[0] = samples[0];
+                rgba[1] = samples[1];
+                rgba[2] = samples[2];
+                rgba[3] = alpha;
+
+                break;
+
+            case PNG_CT_RGBA:
+                rgba[0] = samples[0];
+                rgba[1] = samples[1];
+                rgba[2] = samples[2];
+                rgba[3] = samples[3];
+
+                break;
+
+            default: {
+                // Palette entries are always 8 bit
+                const uint8_t* entry = &pState->mPalette[(samples[0] & 0xff) * 4];
+
+                rgba[0] = entry[0];
+                rgba[1] = entry[1];
+                rgba[2] = entry[2];
+                rgba[3] = entry[3];
+                scale_max = 255;
+
+                break;
+            }
+            }
+
+            uint8_t* o = out + x * stride;
+
+            if(format == PNG_RGBA16) {
+                uint16_t wide[4];
+
+                for(int c = 0; c < 4; c++) wide[c] = (uint16_t)(rgba[c] * 65535u / scale_max);
+
+                memcpy(o, wide, 8);
+            }
+            else {
+                for(int c = 0; c < 4; c++) o[c] = scale_max == 65535 ? (uint8_t)(rgba[c] >> 8) : (uint8_t)(rgba[c] * 255u / scale_max);
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------- Decoder ----------------------------------------------------------------
+
+    /**
+     * @brief Parse PNG chunks, fill image description, palette and IDAT location
+     *
+     * @param data whole file
+     * @param size
+     * @param pState
+     * @param joinIdat copy split IDAT chunks into one stream, not needed when only reading header
+     * @return true file is valid PNG this decoder supports
+     */
+    bool PNGParse(const uint8_t* data, size_t size, PNGDecodeState* pState, bool joinIdat = true) {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+        if(size < 8 || memcmp(data, signature, 8) != 0) {
+            TE_ERR("Not a PNG file!")
+
+            return false;
+        }
+
+        bool header = false;
+        uint32_t idat_count = 0;
+        std::vector<std::pair<size_t, uint32_t>> idats;
+        size_t p = 8;
+
+        // Indices past end of PLTE (broken file) decode as opaque black
+        for(uint32_t i = 0; i < 256; i++) {
+            pState->mPalette[i * 4 + 0] = 0;
+            pState->mPalette[i * 4 + 1] = 0;
+            pState->mPalette[i * 4 + 2] = 0;
+            pState->mPalette[i * 4 + 3] = 0xff;
+        }
+
+        while(p + 12 <= size) {
+            const uint32_t length = PNGReadBE32(data + p);
+            const uint8_t* type = data + p + 4;
+            const uint8_t* chunk = data + p + 8;
+
+            if(length > size - p - 12) {
+                TE_ERR("PNG chunk is cut off!")
+
+                return false;
+            }
+
+            if(memcmp(type, "IHDR", 4) == 0) {
+                if(length < 13) return false;
+
+                pState->mInfo.mWidth = PNGReadBE32(chunk);
+                pState->mInfo.mHeight = PNGReadBE32(chunk + 4);
+                pState->mInfo.mBitDepth = chunk[8];
+                pState->mInfo.mColorType = chunk[9];
+                pState->mInfo.mInterlace = chunk[12];
+
+                header = true;
+            }
+            else if(memcmp(type, "PLTE", 4) == 0) {
+                pState->mPaletteSize = std::min<uint32_t>(length / 3, 256);
+
+                for(uint32_t i = 0; i < pState->mPaletteSize; i++) {
+                    pState->mPalette[i * 4 + 0] = chunk[i * 3 + 0];
+                    pState->mPalette[i * 4 + 1] = chunk[i * 3 + 1];
+                    pState->mPalette[i * 4 + 2] = chunk[i * 3 + 2];
+                    pState->mPalette[i * 4 + 3] = 0xff;
+                }
+            }
+            else if(memcmp(type, "tRNS", 4) == 0) {
+                if(pState->mInfo.mColorType == PNG_CT_Palette) {
+                    for(uint32_t i = 0; i < length && i < 256; i++) pState->mPalette[i * 4 + 3] = chunk[i];
+                }
+                else if(pState->mInfo.mColorType == PNG_CT_Grayscale && length >= 2) {
+                    pState->mHasKey = true;
+                    pState->mKey[0] = (uint16_t)(chunk[0] << 8 | chunk[1]);
+                }
+                else if(pState->mInfo.mColorType == PNG_CT_RGB && length >= 6) {
+                    pState->mHasKey = true;
+
+                    for(int c = 0; c < 3; c++) pState->mKey[c] = (uint16_t)(chunk[c * 2] << 8 | chunk[c * 2 + 1]);
+                }
+            }
+            else if(memcmp(type, "IDAT", 4) == 0) {
+                idats.push_back({ p + 8, length });
+                idat_count++;
+            }
+            else if(memcmp(type, "IEND", 4) == 0) {
+                break;
+            }
+            else if(!(type[0] & 0x20)) {
+                TE_ERR("PNG has unknown critical chunk!")
+
+                return false;
+            }
+
+            p += (size_t)length + 12;
+        }
+
+        const PNGInfo& info = pState->mInfo;
+
+        if(!header || idat_count == 0 || info.mWidth == 0 || info.mHeight == 0 || info.mInterlace > 1) {
+            TE_ERR("PNG is missing IHDR or IDAT!")
+
+            return false;
+        }
+
+        if(info.mWidth > 0x7fffffffu || info.mHeight > 0x7fffffffu || (uint64_t)info.mWidth * info.mHeight > TE_PNG_MAX_PIXELS) {
+            TE_ERR("PNG is too large: " << info.mWidth << "x" << info.mHeight)
+
+            return false;
+        }
+
+        const uint32_t depth = info.mBitDepth;
+        bool valid_depth;
+
+        switch(info.mColorType) {
+        case PNG_CT_Grayscale: pState->mChannels = 1; valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+        case PNG_CT_RGB: pState->mChannels = 3; valid_depth = depth == 8 || depth == 16; break;
+        case PNG_CT_Palette: pState->mChannels = 1; valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+        case PNG_CT_GrayscaleAlpha: pState->mChannels = 2; valid_depth = depth == 8 || depth == 16; break;
+        case PNG_CT_RGBA: pState->mChannels = 4; valid_depth = depth == 8 || depth == 16; break;
+        default: valid_depth = false; break;
+        }
+
+        if(!valid_depth || (info.mColorType == PNG_CT_Palette && pState->mPaletteSize == 0)) {
+            TE_ERR("PNG has invalid color type or bit depth!")
+
+            return false;
+        }
+
+        pState->mBitsPerPixel = pState->mChannels * depth;
+
+        size_t idat_total = 0;
+
+        for(auto& idat : idats) idat_total += idat.second;
+
+        // Deflate expands at most 1032 times, IHDR claiming more than IDAT can hold is damaged (or hostile) file
+        if((PNGRowBytes(pState, info.mWidth) + 1) * info.mHeight / 1032 > idat_total + 1024) {
+            TE_ERR("PNG image data is too short for " << info.mWidth << "x" << info.mHeight)
+
+            return false;
+        }
+
+        if(!joinIdat) return true;
+
+        if(idats.size() == 1) {
+            pState->mIdat = data + idats[0].first;
+            pState->mIdatSize = idats[0].second;
+        }
+        else {
+            size_t total = 0;
+
+            pState->mIdatJoined.resize(idat_total);
+
+            for(auto& idat : idats) {
+                memcpy(pState->mIdatJoined.data() + total, data + idat.first, idat.second);
+                total += idat.second;
+            }
+
+            pState->mIdat = pState->mIdatJoined.data();
+            pState->mIdatSize = total;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Read image description without decoding
+     *
+     * @param data whole file
+     * @param size
+     * @param pInfo
+     * @return true
+     */
+    bool PNGReadInfo(const uint8_t* data, size_t size, PNGInfo* pInfo) {
+        PNGDecodeState state;
+
+        if(!PNGParse(data, size, &state, false)) return false;
+
+        *pInfo = state.mInfo;
+
+        return true;
+    }
+
+    /**
+     * @brief Size of buffer PNGDecode needs for image
+     *
+     * @param pInfo
+     * @param format PNGFormat
+     * @return size_t
+     */
+    size_t PNGOutputSize(const PNGInfo* pInfo, uint32_t format) {
+        return (size_t)pInfo->mWidth * pInfo->mHeight * (format == PNG_RGBA16 ? 8 : 4);
+    }
+
+    /**
+     * @brief Size of inflated (still filtered) image data, every row of every pass with its filter byte
+     *
+     * @param pState
+     * @return size_t
+     */
+    static size_t PNGFilteredSize(const PNGDecodeState* pState) {
+        const PNGInfo& info = pState->mInfo;
+
+        if(!info.mInterlace) return (PNGRowBytes(pState, info.mWidth) + 1) * info.mHeight;
+
+        size_t total = 0;
+
+        for(int pass = 0; pass < 7; pass++) {
+            const uint32_t w = (info.mWidth + gPNGAdam7[pass][2] - 1 - gPNGAdam7[pass][0]) / gPNGAdam7[pass][2];
+            const uint32_t h = (info.mHeight + gPNGAdam7[pass][3] - 1 - gPNGAdam7[pass][1]) / gPNGAdam7[pass][3];
+
+            if(info.mWidth <= gPNGAdam7[pass][0] || info.mHeight <= gPNGAdam7[pass][1]) continue;
+
+            total += (PNGRowBytes(pState, w) + 1) * h;
+        }
+
+        return total;
+    }
+
+    /**
+     * @brief Unfilter rows [rowBegin, rowEnd) of non interlaced image in place and convert them to output
+     *
+     * @param pState
+     * @param filtered inflated data
+     * @param rowBegin
+     * @param rowEnd
+     * @param out output pixels
+     * @param format PNGFormat
+     * @return true all filter types were valid
+     */
+    static bool PNGUnfilterRows(const PNGDecodeState* pState, uint8_t* filtered, uint32_t rowBegin, uint32_t rowEnd, uint8_t* out, uint32_t format) {
+        const PNGInfo& info = pState->mInfo;
+        const size_t row_bytes = PNGRowBytes(pState, info.mWidth);
+        const uint32_t bpp = std::max<uint32_t>(1, pState->mBitsPerPixel / 8);
+        const size_t out_row = (size_t)info.mWidth * (format == PNG_RGBA16 ? 8 : 4);
+
+        // Zero row in front of image, so first row needs no special case
+        static thread_local std::vector<uint8_t> zero_row;
+
+        if(zero_row.size() < row_bytes) zero_row.assign(row_bytes, 0);
+
+        for(uint32_t y = rowBegin; y < rowEnd; y++) {
+            uint8_t* line = filtered + (row_bytes + 1) * y;
+            const uint8_t* prev = y == 0 ? zero_row.data() : line - row_bytes;
+
+            if(line[0] > PNG_F_Paeth) return false;
+
+            PNGUnfilterRow(line[0], line + 1, prev, row_bytes, bpp);
+            PNGConvertRow(pState, line + 1, info.mWidth, out + out_row * y, 1, format);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Unfilter all seven Adam7 passes and scatter them into output
+     *
+     * @param pState
+     * @param filtered
+     * @param out
+     * @param format
+     * @return true
+     */
+    static bool PNGUnfilterInterlaced(const PNGDecodeState* pState, uint8_t* filtered, uint8_t* out, uint32_t format) {
+        const PNGInfo& info = pState->mInfo;
+        const uint32_t bpp = std::max<uint32_t>(1, pState->mBitsPerPixel / 8);
+        const size_t out_pixel = format == PNG_RGBA16 ? 8 : 4;
+        std::vector<uint8_t> zero_row(PNGRowBytes(pState, info.mWidth), 0);
+
+        for(int pass = 0; pass < 7; pass++) {
+            if(info.mWidth <= gPNGAdam7[pass][0] || info.mHeight <= gPNGAdam7[pass][1]) continue;
+
+            const uint32_t w = (info.mWidth + gPNGAdam7[pass][2] - 1 - gPNGAdam7[pass][0]) / gPNGAdam7[pass][2];
+            const uint32_t h = (info.mHeight + gPNGAdam7[pass][3] - 1 - gPNGAdam7[pass][1]) / gPNGAdam7[pass][3];
+            const size_t row_bytes = PNGRowBytes(pState, w);
+
+            for(uint32_t y = 0; y < h; y++) {
+                uint8_t* line = filtered + (row_bytes + 1) * y;
+                const uint8_t* prev = y == 0 ? zero_row.data() : line - row_bytes;
+
+                if(line[0] > PNG_F_Paeth) return false;
+
+                PNGUnfilterRow(line[0], line + 1, prev, row_bytes, bpp);
+
+                const size_t out_y = (size_t)gPNGAdam7[pass][1] + (size_t)y * gPNGAdam7[pass][3];
+
+                PNGConvertRow(pState, line + 1, w, out + (out_y * info.mWidth + gPNGAdam7[pass][0]) * out_pixel, gPNGAdam7[pass][2], format);
+            }
+
+            filtered += (row_bytes + 1) * h;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Decode PNG from memory into caller provided buffer, top row first
+     *
+     * @param data whole file
+     * @param size
+     * @param pOut output pixels, at least PNGOutputSize bytes
+     * @param outSize size of pOut
+     * @param format PNGFormat
+     * @param pInfo optional, image description
+     * @return true
+     */
+    bool PNGDecode(const uint8_t* data, size_t size, void* pOut, size_t outSize, uint32_t format = PNG_RGBA8, PNGInfo* pInfo = nullptr) {
+        PNGDecodeState state;
+
+        if(!PNGParse(data, size, &state)) return false;
+
+        if(pInfo) *pInfo = state.mInfo;
+
+        if(outSize < PNGOutputSize(&state.mInfo, format)) {
+            TE_ERR("PNG output buffer is too small!")
+
+            return false;
+        }
+
+        const size_t filtered_size = PNGFilteredSize(&state);
+        std::vector<uint8_t> filtered(filtered_size);
+        size_t inflated = 0;
+
+        if(!PNGInflateZlib(state.mIdat, state.mIdatSize, filtered.data(), filtered_size, &inflated) || inflated != filtered_size) {
+            TE_ERR("PNG image data is corrupted!")
+
+            return false;
+        }
+
+        bool result;
+
+        if(state.mInfo.mInterlace) {
+            result = PNGUnfilterInterlaced(&state, filtered.data(), (uint8_t*)pOut, format);
+        }
+        else {
+            result = PNGUnfilterRows(&state, filtered.data(), 0, state.mInfo.mHeight, (uint8_t*)pOut, format);
+        }
+
+        if(!result) TE_ERR("PNG has invalid filter type!")
+
+        return result;
+    }
+
+    // ---------------------------------------------------------------- Parallel ---------------------------------------------------------------
+
+    /**
+     * @brief Find segment boundaries of deflate stream at possible full flush points. Full flush ends with empty stored
+     * block, whose LEN/NLEN bytes are 00 00 FF FF, and resets history, so data after it can be inflated on its own.
+     * Same bytes can show up anywhere else too, so boundaries are only candidates and decoder has to verify them
+     *
+     * @param stream raw deflate stream
+     * @param size
+     * @param minSpacing smallest compressed segment worth separate thread
+     * @return std::vector<size_t> segment starts followed by stream size
+     */
+    std::vector<size_t> PNGFindFlushPoints(const uint8_t* stream, size_t size, size_t minSpacing) {
+        std::vector<size_t> bounds = { 0 };
+
+        for(size_t i = 1; i + 4 <= size; i++) {
+            const uint8_t* hit = (const uint8_t*)memchr(stream + i, 0xff, size - i);
+
+            if(!hit) break;
+
+            i = hit - stream;
+
+            // 00 00 [FF] FF
+            if(i >= 2 && i + 2 <= size && stream[i - 2] == 0 && stream[i - 1] == 0 && stream[i + 1] == 0xff && i + 2 - bounds.back() >= minSpacing && i + 2 < size) {
+                bounds.push_back(i + 2);
+            }
+        }
+
+        bounds.push_back(size);
+
+        return bounds;
+    }
+
+    typedef struct PNGSegment {
+        size_t mBegin, mEnd;
+        std::unique_ptr<uint8_t[]> mBuffer;
+        size_t mSize = 0;
+        // Input used by last segment, zlib trailer follows it
+        size_t mInEnd = 0;
+        PNGInflateResult mResult = PNG_INFLATE_Error;
+        std::atomic<bool> mDone = false;
+    } PNGSegment;
+
+    /**
+     * @brief Decode PNG on several threads. Inflate runs on worker threads while calling thread unfilters rows as soon as
+     * they are inflated. When encoder left full flush points in stream, segments between them are inflated concurrently.
+     * Falls back to PNGDecode when candidate flush points turn out not to be real ones
+     *
+     * @param data whole file
+     * @param size
+     * @param pOut output pixels, at least PNGOutputSize bytes
+     * @param outSize size of pOut
+     * @param format PNGFormat
+     * @param threadCount inflate threads, 0 for all hardware threads
+     * @param pInfo optional, image description
+     * @return true
+     */
+    bool PNGDecodeParallel(const uint8_t* data, size_t size, void* pOut, size_t outSize, uint32_t format = PNG_RGBA8, uint32_t threadCount = 0, PNGInfo* pInfo = nullptr) {
+        PNGDecodeState state;
+
+        if(!PNGParse(data, size, &state)) return false;
+
+        if(pInfo) *pInfo = state.mInfo;
+
+        if(outSize < PNGOutputSize(&state.mInfo, format)) {
+            TE_ERR("PNG output buffer is too small!")
+
+            return false;
+        }
+
+        if(!PNGCheckZlibHeader(state.mIdat, state.mIdatSize)) {
+            TE_ERR("PNG image data is corrupted!")
+
+            return false;
+        }
+
+        if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        const PNGInfo& info = state.mInfo;
+        const uint8_t* stream = state.mIdat + 2;
+        const size_t stream_size = state.mIdatSize - 2;
+        const size_t filtered_size = PNGFilteredSize(&state);
+        const size_t row_bytes = PNGRowBytes(&state, info.mWidth);
+
+        // Few segments per thread evens out uneven compression ratios
+        const std::vector<size_t> bounds = PNGFindFlushPoints(stream, stream_size, std::max<size_t>(stream_size / (threadCount * 4), 0x10000));
+        const size_t segment_count = bounds.size() - 1;
+
+        std::vector<PNGSegment> segments(segment_count);
+
+        for(size_t i = 0; i < segment_count; i++) {
+            segments[i].mBegin = bounds[i];
+            segments[i].mEnd = bounds[i + 1];
+        }
+
+        // Left uninitialized, pages are only touched by inflate
+        std::unique_ptr<uint8_t[]> filtered(new uint8_t[filtered_size]);
+        std::atomic<size_t> progress = 0;
+        std::atomic<size_t> next = 0;
+        std::atomic<bool> abort = false;
+
+        auto worker = [&]() {
+            size_t k;
+
+            while(!abort.load(std::memory_order_relaxed) && (k = next.fetch_add(1)) < segment_count) {
+                PNGSegment& segment = segments[k];
+
+                if(k == 0) {
+                    // First segment knows its place, inflate straight into image and let rows be unfiltered behind it
+                    segment.mResult = PNGInflateRaw(stream, segment.mEnd, filtered.get(), 0, filtered_size, &segment.mSize, &progress, &segment.mInEnd);
+                }
+                else {
+                    // Deflate can`t expand data more than 1032 times
+                    const size_t capacity = std::min(filtered_size, (segment.mEnd - segment.mBegin) * 1032 + 64);
+
+                    segment.mBuffer.reset(new uint8_t[capacity]);
+                    segment.mResult = PNGInflateRaw(stream + segment.mBegin, segment.mEnd - segment.mBegin, segment.mBuffer.get(), 0, capacity, &segment.mSize, nullptr, &segment.mInEnd);
+                }
+
+                segment.mDone.store(true, std::memory_order_release);
+                segment.mDone.notify_all();
+
+                if(k == 0) {
+                    progress.store(SIZE_MAX, std::memory_order_release);
+                    progress.notify_all();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+
+        for(size_t i = 0; i < std::min<size_t>(threadCount, segment_count); i++) {
+            workers.emplace_back(worker);
+        }
+
+        uint8_t* out = (uint8_t*)pOut;
+        const size_t out_row = (size_t)info.mWidth * (format == PNG_RGBA16 ? 8 : 4);
+        const uint32_t bpp = std::max<uint32_t>(1, state.mBitsPerPixel / 8);
+        uint32_t rows_done = 0;
+        bool valid = true;
+        // Adler-32 of consumed rows, they are still in cache
+        uint32_t adler = 1;
+
+        // Inflate still reads back references from filtered rows, so they are unfiltered in two scratch rows instead of in place
+        std::vector<uint8_t> scratch(row_bytes * 2, 0);
+        uint8_t* prev_row = scratch.data();
+        uint8_t* row = scratch.data() + row_bytes;
+
+        auto consume = [&](size_t available) {
+            if(info.mInterlace) return;
+
+            const uint32_t rows_ready = (uint32_t)std::min<size_t>(available / (row_bytes + 1), info.mHeight);
+
+            for(; rows_done < rows_ready; rows_done++) {
+                const uint8_t* line = filtered.get() + (row_bytes + 1) * rows_done;
+
+                if(line[0] > PNG_F_Paeth) valid = false;
+
+                adler = PNGAdler32(line, row_bytes + 1, adler);
+
+                memcpy(row, line + 1, row_bytes);
+                PNGUnfilterRow(line[0], row, prev_row, row_bytes, bpp);
+                PNGConvertRow(&state, row, info.mWidth, out + out_row * rows_done, 1, format);
+
+                std::swap(row, prev_row);
+            }
+        };
+
+        // Segment 0 streams its progress
+        size_t seen = 0;
+
+        while(true) {
+            progress.wait(seen, std::memory_order_acquire);
+            seen = progress.load(std::memory_order_acquire);
+
+            if(seen == SIZE_MAX) break;
+
+            consume(seen);
+        }
+
+        // Verify segments in order, boundary k is real only if segment k - 1 ended exactly there and segment k needs no history
+        size_t offset = segments[0].mSize;
+        bool segmented = segments[0].mResult == (segment_count == 1 ? PNG_INFLATE_Done : PNG_INFLATE_BlockEnd);
+
+        consume(segmented ? offset : 0);
+
+        for(size_t k = 1; k < segment_count && segmented; k++) {
+            PNGSegment& segment = segments[k];
+
+            segment.mDone.wait(false, std::memory_order_acquire);
+
+            if(segment.mResult != (k + 1 == segment_count ? PNG_INFLATE_Done : PNG_INFLATE_BlockEnd) || offset + segment.mSize > filtered_size) {
+                segmented = false;
+
+                break;
+            }
+
+            memcpy(filtered.get() + offset, segment.mBuffer.get(), segment.mSize);
+            segment.mBuffer.reset();
+            offset += segment.mSize;
+
+            consume(offset);
+        }
+
+        abort.store(true, std::memory_order_relaxed);
+
+        for(std::thread& w : workers) w.join();
+
+        if(!segmented) {
+            // Some candidate wasn`t a full flush point (or stream is broken), serial decode sorts it out
+            return PNGDecode(data, size, pOut, outSize, format);
+        }
+
+        const PNGSegment& last = segments.back();
+
+        if(info.mInterlace) adler = PNGAdler32(filtered.get(), filtered_size);
+
+        if(offset != filtered_size || stream_size - last.mBegin - last.mInEnd < 4 || PNGReadBE32(stream + last.mBegin + last.mInEnd) != adler) {
+            TE_ERR("PNG image data is corrupted!")
+
+            return false;
+        }
+
+        if(info.mInterlace) valid = PNGUnfilterInterlaced(&state, filtered.get(), out, format);
+
+        if(!valid) TE_ERR("PNG has invalid filter type!")
+
+        return valid;
+    }
+
+    /**
+     * @brief Load PNG file as RGBA8, top row first
+     *
+     * @param path
+     * @param pWidth
+     * @param pHeight
+     * @param threadCount 1 decodes on calling thread, anything else goes through PNGDecodeParallel (0 for all hardware threads)
+     * @return std::vector<uint8_t> pixels, empty on failure
+     */
+    std::vector<uint8_t> PNGLoadPNGFile(std::string path, uint32_t* pWidth, uint32_t* pHeight, uint32_t threadCount = 1) {
         std::vector<uint8_t> result;
 
-        std::ifstream fpng(path, std::ios::binary | std::ios::ate);
+        *pWidth = 0;
+        *pHeight = 0;
 
-        size_t fpng_length = fpng.tellg();
-        fpng.seekg(0, std::ios::beg);
+        ul_mapped_file_t file;
 
-        std::string fpng_data;
-        fpng_data.resize(fpng_length);
-        fpng.read(fpng_data.data(), fpng_data.size());
-        fpng.close();
+        if(!ulMapFile(&file, path.c_str())) {
+            TE_ERR("Cannot open PNG file " << path)
 
-        if(PNGCopyMemoryToSizeOf<uint64_t>((void*)&fpng_data[0]) == 0x89504E470D0A1A0AUL)
+            return result;
+        }
+
+        PNGInfo info;
+
+        if(PNGReadInfo(file.data, file.size, &info)) {
+            result.resize(PNGOutputSize(&info, PNG_RGBA8));
 
-        for(size_t i = 0; i < fpng_data.size(); i++) {
-            
+            const bool decoded = threadCount == 1 ? PNGDecode(file.data, file.size, result.data(), result.size(), PNG_RGBA8) : PNGDecodeParallel(file.data, file.size, result.data(), result.size(), PNG_RGBA8, threadCount);
+
+            if(decoded) {
+                *pWidth = info.mWidth;
+                *pHeight = info.mHeight;
+            }
+            else {
+                result.clear();
+            }
         }
+
+        ulUnmapFile(&file);
+
+        return result;
     }
 }
 
-#endif
\ No newline at end of file
+#endif
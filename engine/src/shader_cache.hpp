@@ -0,0 +1,432 @@
+#pragma once
+#ifndef _TE_SHADER_CACHE_
+#define _TE_SHADER_CACHE_
+
+#include "core.hpp"
+#include "buffers_gl.hpp"
+#include "ul_mapped_file.hpp"
+#include "ul_hash.hpp"
+#include <vector>
+#include <string>
+#include <span>
+#include <memory>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
+#include <stdio.h>
+
+// GL_KHR_parallel_shader_compile, not part of generated GL headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace te {
+    // Program binary file (.twp), one per program named by its key
+#define TE_TWP_MAGIC 0x31505754u // "TWP1"
+#define TE_TWP_VERSION 1
+
+    typedef struct TWPHeader {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        // Hash of stage types and sources
+        uint64_t mKey;
+        // Hash of GL vendor, renderer and version, binaries don`t survive driver change
+        uint64_t mDriverHash;
+        // Hash of binary
+        uint64_t mContentHash;
+        uint32_t mBinaryFormat;
+        uint32_t mBinarySize;
+    } TWPHeader;
+
+    typedef struct GLShaderSource {
+        // GL_*_SHADER
+        uint32_t mType;
+        std::string mSource;
+    } GLShaderSource;
+
+    enum CachedProgramState {
+        // Compile/link issued, driver may still work on it in background
+        CPS_Compiling,
+        CPS_Ready,
+        CPS_Failed
+    };
+
+    typedef struct CachedProgram {
+        uint32_t mId = 0;
+        uint64_t mKey = 0;
+        uint32_t mState = CPS_Compiling;
+        // Loaded from program binary, no compile happened
+        bool mFromBinary = false;
+        // Shaders stay alive until link finished, names for logs
+        std::vector<uint32_t> mShaders;
+        std::vector<std::string> mNames;
+
+        bool IsReady() const { return mState == CPS_Ready; }
+        bool IsFailed() const { return mState == CPS_Failed; }
+
+        // Safe to call only when ready
+        void Use() const { GLStateCache::Get().UseProgram(mId); }
+    } CachedProgram;
+
+    /**
+     * @brief Programs keyed by hash of their sources. Linked programs are stored with glGetProgramBinary in cache
+     * directory and loaded with glProgramBinary on later runs, compiles that still happen run in background on drivers
+     * with GL_KHR_parallel_shader_compile (poll with Update/Poll, Wait blocks). All calls need GL context current
+     *
+     */
+    class ShaderCache {
+    private:
+        typedef void (GLAD_API_PTR *MaxShaderCompilerThreadsFn)(uint32_t count);
+
+        std::string mDirectory;
+        uint64_t mDriverHash = 0;
+        bool mBinarySupported = false;
+        bool mParallel = false;
+
+        std::unordered_map<uint64_t, std::unique_ptr<CachedProgram>> mPrograms;
+        std::vector<CachedProgram*> mPending;
+
+        std::string GetBinaryPath(uint64_t key) {
+            char name[32];
+            snprintf(name, sizeof(name), "%016llx.twp", (unsigned long long)key);
+
+            return mDirectory + "/" + name;
+        }
+
+        bool LoadBinary(CachedProgram* pProgram) {
+            if(!mBinarySupported) return false;
+
+            ul_mapped_file_t file;
+
+            if(!ulMapFile(&file, GetBinaryPath(pProgram->mKey).c_str())) return false;
+
+            TWPHeader header;
+            bool valid = file.size >= sizeof(header);
+
+            if(valid) {
+                memcpy(&header, file.data, sizeof(header));
+
+                valid = header.mMagic == TE_TWP_MAGIC && header.mVersion == TE_TWP_VERSION && header.mKey == pProgram->mKey && header.mDriverHash == mDriverHash &&
+                    header.mBinarySize == file.size - sizeof(header) && ulHash64(file.data + sizeof(header), header.mBinarySize, 0) == header.mContentHash;
+            }
+
+            if(valid) {
+                pProgram->mId = glCreateProgram();
+                glProgramBinary(pProgram->mId, header.mBinaryFormat, file.data + sizeof(header), header.mBinarySize);
+
+                int status = 0;
+                glGetProgramiv(pProgram->mId, GL_LINK_STATUS, &status);
+
+                // Driver may reject binary anyway (e.g. updated without version change), compile again then
+                if(!status) {
+                    TE_WARN("Driver rejected cached program binary " << GetBinaryPath(pProgram->mKey))
+
+                    glDeleteProgram(pProgram->mId);
+                    pProgram->mId = 0;
+                    valid = false;
+                }
+            }
+
+            ulUnmapFile(&file);
+
+            return valid;
+        }
+
+        void SaveBinary(const CachedProgram* pProgram) {
+            if(!mBinarySupported) return;
+
+            int length = 0;
+            glGetProgramiv(pProgram->mId, GL_PROGRAM_BINARY_LENGTH, &length);
+
+            if(length <= 0) return;
+
+            std::vector<uint8_t> binary(length);
+            uint32_t binary_format = 0;
+            glGetProgramBinary(pProgram->mId, length, &length, &binary_format, binary.data());
+
+            TWPHeader header = {};
+            header.mMagic = TE_TWP_MAGIC;
+            header.mVersion = TE_TWP_VERSION;
+            header.mKey = pProgram->mKey;
+            header.mDriverHash = mDriverHash;
+            header.mBinaryFormat = binary_format;
+            header.mBinarySize = (uint32_t)length;
+            header.mContentHash = ulHash64(binary.data(), length, 0);
+
+            const std::string path = GetBinaryPath(pProgram->mKey);
+            const std::string temp_path = ulTempPath(path.c_str());
+            FILE* file = fopen(temp_path.c_str(), "wb");
+
+            if(!file) {
+                TE_WARN("Cannot create program binary: " << path)
+
+                return;
+            }
+
+            bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, length, file) == (size_t)length;
+            written &= fclose(file) == 0;
+
+            remove(path.c_str());
+
+            if(!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+                remove(temp_path.c_str());
+
+                TE_WARN("Cannot write program binary: " << path)
+            }
+        }
+
+        // Link status is known (or will block for it), finish program either way
+        void Finish(CachedProgram* pProgram) {
+            int status = 0;
+            glGetProgramiv(pProgram->mId, GL_LINK_STATUS, &status);
+
+            if(!status) {
+                // Compile errors explain most link failures, log them first
+                for(size_t i = 0; i < pProgram->mShaders.size(); i++) {
+                    GLShader::CheckCompile(pProgram->mShaders[i], pProgram->mNames[i]);
+                }
+
+                GLProgram::CheckLink(pProgram->mId);
+
+                pProgram->mState = CPS_Failed;
+            }
+            else {
+                SaveBinary(pProgram);
+
+                pProgram->mState = CPS_Ready;
+            }
+
+            for(uint32_t shader : pProgram->mShaders) {
+                glDetachShader(pProgram->mId, shader);
+                glDeleteShader(shader);
+            }
+
+            pProgram->mShaders.clear();
+            pProgram->mNames.clear();
+        }
+
+    public:
+        // Programs loaded from binary, programs compiled from source
+        uint32_t mBinaryHits = 0;
+        uint32_t mCompiles = 0;
+
+        ShaderCache() = default;
+        ShaderCache(const ShaderCache&) = delete;
+        ShaderCache& operator=(const ShaderCache&) = delete;
+
+        /**
+         * @brief Prepare cache, needs current context
+         *
+         * @param directory where program binaries are kept, created when missing
+         * @param load GL function loader (glfwGetProcAddress), used for extension entry points
+         * @return true directory is usable, cache works without it but compiles every run
+         */
+        bool Init(const std::string& directory, GLADloadfunc load) {
+            mDirectory = directory;
+
+            std::string driver;
+
+            for(uint32_t name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+                const char* value = (const char*)glGetString(name);
+
+                driver += value ? value : "";
+                driver += '\n';
+            }
+
+            mDriverHash = ulHash64(driver.data(), driver.size(), 0);
+
+            int formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+            mBinarySupported = formats > 0;
+
+            int extensions = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+
+            for(int i = 0; i < extensions; i++) {
+                const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+
+                if(strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(extension, "GL_ARB_parallel_shader_compile") == 0) {
+                    MaxShaderCompilerThreadsFn max_threads = (MaxShaderCompilerThreadsFn)load("glMaxShaderCompilerThreadsKHR");
+
+                    if(!max_threads) max_threads = (MaxShaderCompilerThreadsFn)load("glMaxShaderCompilerThreadsARB");
+
+                    if(max_threads) {
+                        // Let driver pick thread count
+                        max_threads(0xFFFFFFFFu);
+
+                        mParallel = true;
+                    }
+
+                    break;
+                }
+            }
+
+            TE_INFO("Shader cache in " << mDirectory << ", program binaries " << (mBinarySupported ? "on" : "off") << ", parallel compile " << (mParallel ? "on" : "off"))
+
+            std::error_code error;
+            std::filesystem::create_directories(mDirectory, error);
+
+            if(error) {
+                TE_WARN("Cannot create shader cache directory " << mDirectory << ": " << error.message())
+
+                mBinarySupported = false;
+
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Key of program made from stages
+         *
+         */
+        static uint64_t GetKey(std::span<const GLShaderSource> stages) {
+            uint64_t key = TE_TWP_VERSION;
+
+            for(const GLShaderSource& stage : stages) {
+                key = ulHash64(&stage.mType, sizeof(stage.mType), key);
+                key = ulHash64(stage.mSource.data(), stage.mSource.size(), key);
+            }
+
+            return key;
+        }
+
+        /**
+         * @brief Get program from memory, binary on disk or start compiling it
+         *
+         * @param stages
+         * @param names shown in compile logs, optional
+         * @return CachedProgram* owned by cache, check IsReady before use
+         */
+        CachedProgram* Request(std::span<const GLShaderSource> stages, std::span<const std::string> names = {}) {
+            const uint64_t key = GetKey(stages);
+            auto found = mPrograms.find(key);
+
+            if(found != mPrograms.end()) return found->second.get();
+
+            std::unique_ptr<CachedProgram> program = std::make_unique<CachedProgram>();
+            CachedProgram* p_program = program.get();
+
+            p_program->mKey = key;
+            mPrograms.emplace(key, std::move(program));
+
+            if(LoadBinary(p_program)) {
+                p_program->mFromBinary = true;
+                p_program->mState = CPS_Ready;
+
+                mBinaryHits++;
+
+                return p_program;
+            }
+
+            // No status queries here, with parallel compile driver works on it while caller continues
+            p_program->mId = glCreateProgram();
+
+            for(size_t i = 0; i < stages.size(); i++) {
+                const uint32_t shader = glCreateShader(stages[i].mType);
+                const char* source = stages[i].mSource.c_str();
+
+                glShaderSource(shader, 1, &source, nullptr);
+                glCompileShader(shader);
+                glAttachShader(p_program->mId, shader);
+
+                p_program->mShaders.push_back(shader);
+                p_program->mNames.push_back(i < names.size() ? names[i] : std::to_string(i));
+            }
+
+            if(mBinarySupported) glProgramParameteri(p_program->mId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+            glLinkProgram(p_program->mId);
+
+            mCompiles++;
+            mPending.push_back(p_program);
+
+            return p_program;
+        }
+
+        /**
+         * @brief Request program from shader files, stage comes from extension (GLShader::GetStageFromPath)
+         *
+         * @param paths
+         * @return CachedProgram* nullptr when file can`t be read
+         */
+        CachedProgram* RequestFiles(std::span<const std::string> paths) {
+            std::vector<GLShaderSource> stages(paths.size());
+
+            for(size_t i = 0; i < paths.size(); i++) {
+                if(!GLShader::ReadShaderFile(paths[i], &stages[i].mSource, &stages[i].mType)) {
+                    TE_ERR("Cannot read shader " << paths[i])
+
+                    return nullptr;
+                }
+            }
+
+            return Request(stages, paths);
+        }
+
+        /**
+         * @brief Finish program if driver is done with it, never blocks with parallel compile
+         *
+         * @return true program is ready or failed
+         */
+        bool Poll(CachedProgram* pProgram) {
+            if(pProgram->mState != CPS_Compiling) return true;
+
+            if(mParallel) {
+                int complete = 0;
+                glGetProgramiv(pProgram->mId, GL_COMPLETION_STATUS_KHR, &complete);
+
+                if(!complete) return false;
+            }
+
+            Finish(pProgram);
+
+            std::erase(mPending, pProgram);
+
+            return true;
+        }
+
+        /**
+         * @brief Block until program is finished
+         *
+         * @return true program is ready
+         */
+        bool Wait(CachedProgram* pProgram) {
+            if(pProgram->mState == CPS_Compiling) {
+                Finish(pProgram);
+
+                std::erase(mPending, pProgram);
+            }
+
+            return pProgram->IsReady();
+        }
+
+        /**
+         * @brief Poll every pending program, call once per frame
+         *
+         * @return size_t programs still compiling
+         */
+        size_t Update() {
+            std::vector<CachedProgram*> pending = mPending;
+
+            for(CachedProgram* p_program : pending) Poll(p_program);
+
+            return mPending.size();
+        }
+
+        ~ShaderCache() {
+            for(auto& [key, program] : mPrograms) {
+                for(uint32_t shader : program->mShaders) glDeleteShader(shader);
+
+                if(program->mId != 0) {
+                    glDeleteProgram(program->mId);
+                    GLStateCache::Get().OnDeleteProgram(program->mId);
+                }
+            }
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef _TE_SNAPSHOT_
+#define _TE_SNAPSHOT_
+
+#include "core.hpp"
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+// Set on published slot index until reader takes it
+#define TE_SNAPSHOT_FRESH 0x4u
+#define TE_SNAPSHOT_INDEX 0x3u
+
+namespace te {
+    /**
+     * @brief Lock free handoff of state from one writer thread (FixedUpdate) to one reader thread (Update). Writer fills
+     * own slot and publishes it with one exchange, reader takes newest one with another. Reader keeps newest and one
+     * before it for interpolation, so there are four slots: writer, published, current, previous. Neither side ever
+     * waits, writer publishing faster than reader reads just replaces unread snapshot
+     *
+     * @tparam T copyable state
+     */
+    template<typename T>
+    class SnapshotBuffer {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Slot {
+            T mState{};
+            uint64_t mTick = 0;
+            Clock::time_point mTime{};
+        };
+
+        Slot mSlots[4];
+        // Writer side
+        alignas(64) uint32_t mWrite = 0;
+        alignas(64) std::atomic<uint32_t> mPublished = 1;
+        // Reader side
+        alignas(64) uint32_t mCurrent = 2;
+        uint32_t mPrevious = 3;
+
+    public:
+        SnapshotBuffer() = default;
+        SnapshotBuffer(const SnapshotBuffer&) = delete;
+        SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+        /**
+         * @brief Writer only, slot to fill, holds whatever was in it few publishes ago so write all of it
+         *
+         * @return T&
+         */
+        T& GetWrite() { return mSlots[mWrite].mState; }
+
+        /**
+         * @brief Writer only, hand written slot to reader
+         *
+         * @param tick simulation step state belongs to
+         */
+        void Publish(uint64_t tick) {
+            mSlots[mWrite].mTick = tick;
+            mSlots[mWrite].mTime = Clock::now();
+
+            mWrite = mPublished.exchange(mWrite | TE_SNAPSHOT_FRESH, std::memory_order_acq_rel) & TE_SNAPSHOT_INDEX;
+        }
+
+        /**
+         * @brief Reader only, take newest published state if there is one, current becomes previous
+         *
+         * @return true new state arrived
+         */
+        bool Acquire() {
+            if(!(mPublished.load(std::memory_order_relaxed) & TE_SNAPSHOT_FRESH)) return false;
+
+            // Oldest slot goes back to writer side
+            const uint32_t fresh = mPublished.exchange(mPrevious, std::memory_order_acq_rel) & TE_SNAPSHOT_INDEX;
+
+            mPrevious = mCurrent;
+            mCurrent = fresh;
+
+            return true;
+        }
+
+        const T& GetCurrent() const { return mSlots[mCurrent].mState; }
+        const T& GetPrevious() const { return mSlots[mPrevious].mState; }
+
+        uint64_t GetCurrentTick() const { return mSlots[mCurrent].mTick; }
+
+        /**
+         * @brief Reader only, how far render time is between previous and current state, lerp(previous, current, alpha)
+         * shows smooth motion one step behind simulation
+         *
+         * @param stepSeconds fixed step length
+         * @return float in [0, 1]
+         */
+        float GetAlpha(double stepSeconds) const {
+            // Nothing published yet
+            if(mSlots[mCurrent].mTime == Clock::time_point{} || stepSeconds <= 0.0) return 1.0f;
+
+            const double since = std::chrono::duration<double>(Clock::now() - mSlots[mCurrent].mTime).count();
+
+            return (float)std::clamp(since / stepSeconds, 0.0, 1.0);
+        }
+    };
+}
+
+#endif
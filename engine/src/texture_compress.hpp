@@ -0,0 +1,1459 @@
+#pragma once
+#ifndef _TE_TEXTURE_COMPRESS_
+#define _TE_TEXTURE_COMPRESS_
+
+#include "core.hpp"
+#include "gl_state.hpp"
+#include "ul_mapped_file.hpp"
+#include "ul_hash.hpp"
+#include "ul_bitmap.hpp"
+#include "load_png.hpp"
+#include "tiff_loader.hpp"
+#include "texture_mips.hpp"
+#include <vector>
+#include <string>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// S3TC is an extension, not part of generated GL headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace te {
+    enum BCFormat {
+        // RGB, 4 bpp
+        BC_FORMAT_BC1,
+        // RGBA, BC4 alpha + BC1 color, 8 bpp
+        BC_FORMAT_BC3,
+        // R, 4 bpp
+        BC_FORMAT_BC4,
+        // RG (normal maps), 8 bpp
+        BC_FORMAT_BC5,
+        // RGBA, modes 6 and 5 only, 8 bpp
+        BC_FORMAT_BC7,
+
+        BC_FORMAT_END_DONT_USE
+    };
+
+    typedef struct BCStats {
+        double mEncodeMs = 0.0;
+        double mMegapixelsPerSecond = 0.0;
+        // Over channels format stores, see BCGetChannelMask
+        double mPSNR = 0.0;
+    } BCStats;
+
+    inline uint32_t BCGetBlockSize(uint32_t format) { return format == BC_FORMAT_BC1 || format == BC_FORMAT_BC4 ? 8 : 16; }
+
+    inline size_t BCGetCompressedSize(uint32_t format, uint32_t width, uint32_t height) {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BCGetBlockSize(format);
+    }
+
+    /**
+     * @brief Channels stored by format, bit per RGBA channel
+     *
+     */
+    inline uint32_t BCGetChannelMask(uint32_t format) {
+        switch(format) {
+        case BC_FORMAT_BC1: return 0x7;
+        case BC_FORMAT_BC4: return 0x1;
+        case BC_FORMAT_BC5: return 0x3;
+        default: return 0xF;
+        }
+    }
+
+    inline uint32_t BCGetGLFormat(uint32_t format, bool srgb) {
+        switch(format) {
+        case BC_FORMAT_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BC_FORMAT_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BC_FORMAT_BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BC_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+        default: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    inline uint16_t BCPack565(int r, int g, int b) {
+        return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+    }
+
+    inline void BCUnpack565(uint16_t c, int* rgb) {
+        const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+
+        rgb[0] = r << 3 | r >> 2;
+        rgb[1] = g << 2 | g >> 4;
+        rgb[2] = b << 3 | b >> 2;
+    }
+
+    typedef struct BCTables {
+        // Endpoint pair whose 2/3 interpolant is closest to value, for flat blocks
+        uint8_t mMatch5[256][2];
+        uint8_t mMatch6[256][2];
+    } BCTables;
+
+    inline const BCTables& BCGetTables() {
+        static const BCTables tables = []() {
+            BCTables t;
+
+            auto build = [](uint8_t (*match)[2], int bits) {
+                const int levels = 1 << bits;
+
+                for(int v = 0; v < 256; v++) {
+                    int best = 1 << 30;
+
+                    for(int a = 0; a < levels; a++) {
+                        for(int b = 0; b < levels; b++) {
+                            const int ea = bits == 5 ? (a << 3 | a >> 2) : (a << 2 | a >> 4);
+                            const int eb = bits == 5 ? (b << 3 | b >> 2) : (b << 2 | b >> 4);
+                            // Slightly prefer close endpoints, decoders that interpolate differently agree more on them
+                            const int err = abs((2 * ea + eb) / 3 - v) * 100 + abs(ea - eb);
+
+                            if(err < best) {
+                                best = err;
+                                match[v][0] = (uint8_t)a;
+                                match[v][1] = (uint8_t)b;
+                            }
+                        }
+                    }
+                }
+            };
+
+            build(t.mMatch5, 5);
+            build(t.mMatch6, 6);
+
+            return t;
+        }();
+
+        return tables;
+    }
+
+    /**
+     * @brief Principal axis of up to 16 points by power iteration
+     *
+     * @param pixels RGBA8, 16 pixels
+     * @param dims 3 for RGB, 4 for RGBA
+     * @param mean output
+     * @param axis output, unit length
+     */
+    inline void BCPrincipalAxis(const uint8_t* pixels, int dims, float* mean, float* axis) {
+        float cov[4][4] = {};
+
+        for(int d = 0; d < dims; d++) {
+            mean[d] = 0.0f;
+
+            for(int i = 0; i < 16; i++) mean[d] += pixels[i * 4 + d];
+
+            mean[d] /= 16.0f;
+        }
+
+        for(int i = 0; i < 16; i++) {
+            float p[4];
+
+            for(int d = 0; d < dims; d++) p[d] = pixels[i * 4 + d] - mean[d];
+
+            for(int a = 0; a < dims; a++) {
+                for(int b = a; b < dims; b++) cov[a][b] += p[a] * p[b];
+            }
+        }
+
+        for(int a = 0; a < dims; a++) {
+            for(int b = 0; b < a; b++) cov[a][b] = cov[b][a];
+        }
+
+        // Start from row of channel with largest variance, converges in few steps for 16 points
+        int start = 0;
+
+        for(int d = 1; d < dims; d++) {
+            if(cov[d][d] > cov[start][start]) start = d;
+        }
+
+        for(int d = 0; d < dims; d++) axis[d] = cov[start][d];
+
+        for(int iteration = 0; iteration < 8; iteration++) {
+            float next[4] = {};
+            float length = 0.0f;
+
+            for(int a = 0; a < dims; a++) {
+                for(int b = 0; b < dims; b++) next[a] += cov[a][b] * axis[b];
+
+                length += next[a] * next[a];
+            }
+
+            if(length < 1e-12f) break;
+
+            length = 1.0f / sqrtf(length);
+
+            for(int d = 0; d < dims; d++) axis[d] = next[d] * length;
+        }
+
+        float length = 0.0f;
+
+        for(int d = 0; d < dims; d++) length += axis[d] * axis[d];
+
+        if(length < 1e-12f) {
+            for(int d = 0; d < dims; d++) axis[d] = 1.0f / sqrtf((float)dims);
+        }
+        else {
+            length = 1.0f / sqrtf(length);
+
+            for(int d = 0; d < dims; d++) axis[d] *= length;
+        }
+    }
+
+    /**
+     * @brief Pick BC1 indices for endpoints already in 4 color order
+     *
+     * @return uint32_t squared RGB error
+     */
+    inline uint32_t BCSelectBC1Indices(uint16_t c0, uint16_t c1, const uint8_t* pixels, uint32_t* pIndices) {
+        int palette[4][3];
+
+        BCUnpack565(c0, palette[0]);
+        BCUnpack565(c1, palette[1]);
+
+        for(int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        uint32_t indices = 0, error = 0;
+
+        for(int i = 0; i < 16; i++) {
+            uint32_t best = ~0u, best_index = 0;
+
+            for(uint32_t j = 0; j < 4; j++) {
+                const int dr = pixels[i * 4] - palette[j][0], dg = pixels[i * 4 + 1] - palette[j][1], db = pixels[i * 4 + 2] - palette[j][2];
+                const uint32_t d = (uint32_t)(dr * dr + dg * dg + db * db);
+
+                if(d < best) {
+                    best = d;
+                    best_index = j;
+                }
+            }
+
+            indices |= best_index << (i * 2);
+            error += best;
+        }
+
+        *pIndices = indices;
+
+        return error;
+    }
+
+    /**
+     * @brief Order endpoints for 4 color mode and select indices
+     *
+     */
+    inline uint32_t BCFinishBC1(uint16_t* pC0, uint16_t* pC1, const uint8_t* pixels, uint32_t* pIndices) {
+        if(*pC0 < *pC1) std::swap(*pC0, *pC1);
+
+        if(*pC0 == *pC1) {
+            // Every palette entry (any mode) we use is endpoint itself
+            uint32_t ignored;
+            const uint32_t error = BCSelectBC1Indices(*pC0, *pC1, pixels, &ignored);
+
+            *pIndices = 0;
+
+            return error;
+        }
+
+        return BCSelectBC1Indices(*pC0, *pC1, pixels, pIndices);
+    }
+
+    /**
+     * @brief Least squares endpoints for given BC1 indices
+     *
+     * @return false when indices don`t constrain both endpoints
+     */
+    inline bool BCRefineBC1(const uint8_t* pixels, uint32_t indices, uint16_t* pC0, uint16_t* pC1) {
+        static const float weight[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        float ax[3] = {}, bx[3] = {};
+
+        for(int i = 0; i < 16; i++) {
+            const float a = weight[(indices >> (i * 2)) & 3], b = 1.0f - a;
+
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+
+            for(int c = 0; c < 3; c++) {
+                ax[c] += a * pixels[i * 4 + c];
+                bx[c] += b * pixels[i * 4 + c];
+            }
+        }
+
+        const float det = aa * bb - ab * ab;
+
+        if(fabsf(det) < 1e-6f) return false;
+
+        int e0[3], e1[3];
+
+        for(int c = 0; c < 3; c++) {
+            e0[c] = std::clamp((int)lroundf((ax[c] * bb - bx[c] * ab) / det), 0, 255);
+            e1[c] = std::clamp((int)lroundf((bx[c] * aa - ax[c] * ab) / det), 0, 255);
+        }
+
+        *pC0 = BCPack565(e0[0], e0[1], e0[2]);
+        *pC1 = BCPack565(e1[0], e1[1], e1[2]);
+
+        return true;
+    }
+
+    /**
+     * @brief Encode 4x4 RGB block, always 4 color mode so block is also valid color half of BC3
+     *
+     * @param pOut 8 bytes
+     * @param pixels 16 RGBA8 pixels, alpha ignored
+     */
+    inline void BCEncodeBlockBC1(uint8_t* pOut, const uint8_t* pixels) {
+        uint16_t c0, c1;
+        uint32_t indices, error;
+
+        bool flat = true;
+
+        for(int i = 1; i < 16 && flat; i++) {
+            flat = pixels[i * 4] == pixels[0] && pixels[i * 4 + 1] == pixels[1] && pixels[i * 4 + 2] == pixels[2];
+        }
+
+        if(flat) {
+            const BCTables& tables = BCGetTables();
+
+            c0 = (uint16_t)(tables.mMatch5[pixels[0]][0] << 11 | tables.mMatch6[pixels[1]][0] << 5 | tables.mMatch5[pixels[2]][0]);
+            c1 = (uint16_t)(tables.mMatch5[pixels[0]][1] << 11 | tables.mMatch6[pixels[1]][1] << 5 | tables.mMatch5[pixels[2]][1]);
+            error = BCFinishBC1(&c0, &c1, pixels, &indices);
+
+            // Exact quantization can still win when endpoints swapped order
+            uint16_t q0 = BCPack565(pixels[0], pixels[1], pixels[2]), q1 = q0;
+            uint32_t q_indices;
+
+            if(BCFinishBC1(&q0, &q1, pixels, &q_indices) < error) {
+                c0 = q0;
+                c1 = q1;
+                indices = q_indices;
+            }
+        }
+        else {
+            float mean[4], axis[4];
+            BCPrincipalAxis(pixels, 3, mean, axis);
+
+            int min_i = 0, max_i = 0;
+            float min_d = 1e30f, max_d = -1e30f;
+
+            for(int i = 0; i < 16; i++) {
+                const float d = pixels[i * 4] * axis[0] + pixels[i * 4 + 1] * axis[1] + pixels[i * 4 + 2] * axis[2];
+
+                if(d < min_d) { min_d = d; min_i = i; }
+                if(d > max_d) { max_d = d; max_i = i; }
+            }
+
+            c0 = BCPack565(pixels[max_i * 4], pixels[max_i * 4 + 1], pixels[max_i * 4 + 2]);
+            c1 = BCPack565(pixels[min_i * 4], pixels[min_i * 4 + 1], pixels[min_i * 4 + 2]);
+            error = BCFinishBC1(&c0, &c1, pixels, &indices);
+
+            for(int iteration = 0; iteration < 2 && error > 0; iteration++) {
+                uint16_t r0, r1;
+                uint32_t r_indices;
+
+                if(!BCRefineBC1(pixels, indices, &r0, &r1)) break;
+
+                const uint32_t r_error = BCFinishBC1(&r0, &r1, pixels, &r_indices);
+
+                if(r_error >= error) break;
+
+                c0 = r0;
+                c1 = r1;
+                indices = r_indices;
+                error = r_error;
+            }
+        }
+
+        memcpy(pOut, &c0, 2);
+        memcpy(pOut + 2, &c1, 2);
+        memcpy(pOut + 4, &indices, 4);
+    }
+
+    inline void BCBuildBC4Palette(int a0, int a1, int* palette) {
+        palette[0] = a0;
+        palette[1] = a1;
+
+        if(a0 > a1) {
+            for(int i = 2; i < 8; i++) palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+        }
+        else {
+            for(int i = 2; i < 6; i++) palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    inline uint32_t BCSelectBC4Indices(int a0, int a1, const uint8_t* values, uint64_t* pIndices) {
+        int palette[8];
+        BCBuildBC4Palette(a0, a1, palette);
+
+        uint64_t indices = 0;
+        uint32_t error = 0;
+
+        for(int i = 0; i < 16; i++) {
+            uint32_t best = ~0u, best_index = 0;
+
+            for(uint32_t j = 0; j < 8; j++) {
+                const int d = values[i * 4] - palette[j];
+
+                if((uint32_t)(d * d) < best) {
+                    best = (uint32_t)(d * d);
+                    best_index = j;
+                }
+            }
+
+            indices |= (uint64_t)best_index << (i * 3);
+            error += best;
+        }
+
+        *pIndices = indices;
+
+        return error;
+    }
+
+    /**
+     * @brief Encode one channel of 4x4 block as BC4
+     *
+     * @param pOut 8 bytes
+     * @param values first value, stride is 4 bytes (channel of RGBA8 block)
+     */
+    inline void BCEncodeBlockBC4(uint8_t* pOut, const uint8_t* values) {
+        int lo = 255, hi = 0, inner_lo = 255, inner_hi = 0;
+
+        for(int i = 0; i < 16; i++) {
+            const int v = values[i * 4];
+
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+
+            if(v != 0 && v != 255) {
+                inner_lo = std::min(inner_lo, v);
+                inner_hi = std::max(inner_hi, v);
+            }
+        }
+
+        int a0 = hi, a1 = lo;
+        uint64_t indices = 0;
+        uint32_t error = 0;
+
+        if(hi != lo) {
+            error = BCSelectBC4Indices(a0, a1, values, &indices);
+
+            // Nudging endpoints inward often helps, interpolants are rounded
+            for(int step = 1; step <= 2 && error; step++) {
+                const int b0 = hi - step, b1 = lo + step;
+
+                if(b0 <= b1) break;
+
+                uint64_t b_indices;
+                const uint32_t b_error = BCSelectBC4Indices(b0, b1, values, &b_indices);
+
+                if(b_error < error) {
+                    a0 = b0;
+                    a1 = b1;
+                    indices = b_indices;
+                    error = b_error;
+                }
+            }
+
+            // 6 value mode has exact 0 and 255, good for blocks with few saturated values
+            if(error && (lo == 0 || hi == 255)) {
+                const int b0 = inner_lo > inner_hi ? 0 : inner_lo, b1 = inner_lo > inner_hi ? 0 : inner_hi;
+
+                uint64_t b_indices;
+                const uint32_t b_error = BCSelectBC4Indices(b0, b1, values, &b_indices);
+
+                if(b_error < error) {
+                    a0 = b0;
+                    a1 = b1;
+                    indices = b_indices;
+                }
+            }
+        }
+
+        pOut[0] = (uint8_t)a0;
+        pOut[1] = (uint8_t)a1;
+
+        for(int i = 0; i < 6; i++) pOut[2 + i] = (uint8_t)(indices >> (i * 8));
+    }
+
+    inline void BCEncodeBlockBC3(uint8_t* pOut, const uint8_t* pixels) {
+        BCEncodeBlockBC4(pOut, pixels + 3);
+        BCEncodeBlockBC1(pOut + 8, pixels);
+    }
+
+    inline void BCEncodeBlockBC5(uint8_t* pOut, const uint8_t* pixels) {
+        BCEncodeBlockBC4(pOut, pixels);
+        BCEncodeBlockBC4(pOut + 8, pixels + 1);
+    }
+
+    static const int gBC7Weights2[4] = {0, 21, 43, 64};
+    static const int gBC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    // 128 bit BC7 block, fields are written LSB first
+    typedef struct BCBitWriter {
+        uint64_t mLo = 0, mHi = 0;
+        uint32_t mBit = 0;
+
+        void Put(uint64_t value, uint32_t count) {
+            if(mBit < 64) {
+                mLo |= value << mBit;
+
+                if(mBit + count > 64) mHi |= value >> (64 - mBit);
+            }
+            else {
+                mHi |= value << (mBit - 64);
+            }
+
+            mBit += count;
+        }
+
+        void Store(uint8_t* pOut) {
+            memcpy(pOut, &mLo, 8);
+            memcpy(pOut + 8, &mHi, 8);
+        }
+    } BCBitWriter;
+
+    typedef struct BCBitReader {
+        uint64_t mLo, mHi;
+        uint32_t mBit = 0;
+
+        BCBitReader(const uint8_t* block) {
+            memcpy(&mLo, block, 8);
+            memcpy(&mHi, block + 8, 8);
+        }
+
+        uint32_t Get(uint32_t count) {
+            uint64_t value;
+
+            if(mBit >= 64) value = mHi >> (mBit - 64);
+            else if(mBit + count > 64) value = mLo >> mBit | mHi << (64 - mBit);
+            else value = mLo >> mBit;
+
+            mBit += count;
+
+            return (uint32_t)(value & ((1u << count) - 1));
+        }
+    } BCBitReader;
+
+    /**
+     * @brief Pick BC7 indices for expanded 8 bit endpoints over first channels of every pixel
+     *
+     * @tparam LEVELS 4 or 16 interpolation steps
+     * @tparam CHANNELS 3 (RGB) or 4 (RGBA)
+     * @return uint32_t squared error
+     */
+    template<int LEVELS, int CHANNELS>
+    inline uint32_t BCSelectBC7Indices(const int* e0, const int* e1, const uint8_t* pixels, uint8_t* pIndices) {
+        const int* weights = LEVELS == 4 ? gBC7Weights2 : gBC7Weights4;
+        int palette[LEVELS][4];
+
+        for(int j = 0; j < LEVELS; j++) {
+            for(int c = 0; c < CHANNELS; c++) palette[j][c] = ((64 - weights[j]) * e0[c] + weights[j] * e1[c] + 32) >> 6;
+        }
+
+        float dir[4], length = 0.0f;
+
+        for(int c = 0; c < CHANNELS; c++) {
+            dir[c] = (float)(e1[c] - e0[c]);
+            length += dir[c] * dir[c];
+        }
+
+        const float scale = length > 0.0f ? (LEVELS - 1) / length : 0.0f;
+        uint32_t error = 0;
+
+        for(int i = 0; i < 16; i++) {
+            const uint8_t* p = pixels + i * 4;
+
+            // Weights are nearly uniform, projection lands within one step of best entry
+            float t = 0.0f;
+
+            for(int c = 0; c < CHANNELS; c++) t += (p[c] - e0[c]) * dir[c];
+
+            const int guess = std::clamp((int)lroundf(t * scale), 0, LEVELS - 1);
+            uint32_t best = ~0u;
+            int best_index = guess;
+
+            for(int j = std::max(0, guess - 1); j <= std::min(LEVELS - 1, guess + 1); j++) {
+                uint32_t d = 0;
+
+                for(int c = 0; c < CHANNELS; c++) d += (uint32_t)((p[c] - palette[j][c]) * (p[c] - palette[j][c]));
+
+                if(d < best) {
+                    best = d;
+                    best_index = j;
+                }
+            }
+
+            pIndices[i] = (uint8_t)best_index;
+            error += best;
+        }
+
+        return error;
+    }
+
+    /**
+     * @brief Least squares endpoints for given BC7 indices, values of first CHANNELS channels
+     *
+     */
+    template<int CHANNELS>
+    inline bool BCRefineBC7(const uint8_t* pixels, const uint8_t* indices, const int* weights, float* end0, float* end1) {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[4] = {}, bx[4] = {};
+
+        for(int i = 0; i < 16; i++) {
+            const float b = weights[indices[i]] / 64.0f, a = 1.0f - b;
+
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+
+            for(int c = 0; c < CHANNELS; c++) {
+                ax[c] += a * pixels[i * 4 + c];
+                bx[c] += b * pixels[i * 4 + c];
+            }
+        }
+
+        const float det = aa * bb - ab * ab;
+
+        if(fabsf(det) < 1e-6f) return false;
+
+        for(int c = 0; c < CHANNELS; c++) {
+            end0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+            end1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Endpoints along principal axis through extremes of block
+     *
+     */
+    template<int CHANNELS>
+    inline void BCAxisEndpoints(const uint8_t* pixels, float* end0, float* end1) {
+        float mean[4], axis[4];
+        BCPrincipalAxis(pixels, CHANNELS, mean, axis);
+
+        float min_d = 1e30f, max_d = -1e30f;
+
+        for(int i = 0; i < 16; i++) {
+            float d = 0.0f;
+
+            for(int c = 0; c < CHANNELS; c++) d += (pixels[i * 4 + c] - mean[c]) * axis[c];
+
+            min_d = std::min(min_d, d);
+            max_d = std::max(max_d, d);
+        }
+
+        for(int c = 0; c < CHANNELS; c++) {
+            end0[c] = std::clamp(mean[c] + axis[c] * min_d, 0.0f, 255.0f);
+            end1[c] = std::clamp(mean[c] + axis[c] * max_d, 0.0f, 255.0f);
+        }
+    }
+
+    /**
+     * @brief BC7 mode 6: single subset RGBA, 7777 endpoints with p bits, 4 bit indices
+     *
+     * @return uint32_t squared RGBA error
+     */
+    inline uint32_t BCEncodeBC7Mode6(uint8_t* pOut, const uint8_t* pixels) {
+        float end0[4], end1[4];
+        BCAxisEndpoints<4>(pixels, end0, end1);
+
+        uint32_t best_error = ~0u;
+        int best_q[2][4] = {}, best_p[2] = {};
+        uint8_t best_indices[16] = {};
+
+        for(int iteration = 0; iteration < 2; iteration++) {
+            for(int pbits = 0; pbits < 4; pbits++) {
+                int q[2][4], e[2][4];
+                const int p[2] = {pbits & 1, pbits >> 1};
+
+                for(int c = 0; c < 4; c++) {
+                    q[0][c] = std::clamp((int)lroundf((end0[c] - p[0]) * 0.5f), 0, 127);
+                    q[1][c] = std::clamp((int)lroundf((end1[c] - p[1]) * 0.5f), 0, 127);
+                    e[0][c] = q[0][c] << 1 | p[0];
+                    e[1][c] = q[1][c] << 1 | p[1];
+                }
+
+                uint8_t indices[16];
+                const uint32_t error = BCSelectBC7Indices<16, 4>(e[0], e[1], pixels, indices);
+
+                if(error < best_error) {
+                    best_error = error;
+                    memcpy(best_q, q, sizeof(q));
+                    best_p[0] = p[0];
+                    best_p[1] = p[1];
+                    memcpy(best_indices, indices, sizeof(indices));
+                }
+            }
+
+            if(best_error == 0 || iteration == 1 || !BCRefineBC7<4>(pixels, best_indices, gBC7Weights4, end0, end1)) break;
+        }
+
+        // Anchor index is stored with one bit less, its top bit has to be zero
+        if(best_indices[0] & 8) {
+            for(int c = 0; c < 4; c++) std::swap(best_q[0][c], best_q[1][c]);
+
+            std::swap(best_p[0], best_p[1]);
+
+            for(int i = 0; i < 16; i++) best_indices[i] = 15 - best_indices[i];
+        }
+
+        BCBitWriter writer;
+        writer.Put(1u << 6, 7);
+
+        for(int c = 0; c < 4; c++) {
+            writer.Put((uint64_t)best_q[0][c], 7);
+            writer.Put((uint64_t)best_q[1][c], 7);
+        }
+
+        writer.Put((uint64_t)best_p[0], 1);
+        writer.Put((uint64_t)best_p[1], 1);
+
+        for(int i = 0; i < 16; i++) writer.Put(best_indices[i], i == 0 ? 3 : 4);
+
+        writer.Store(pOut);
+
+        return best_error;
+    }
+
+    /**
+     * @brief BC7 mode 5: RGB and alpha interpolated separately (777 + 8 bit endpoints, 2 bit indices each), for blocks
+     * where alpha doesn`t follow color, e.g. cutout edges
+     *
+     * @return uint32_t squared RGBA error
+     */
+    inline uint32_t BCEncodeBC7Mode5(uint8_t* pOut, const uint8_t* pixels) {
+        float end0[4], end1[4];
+        BCAxisEndpoints<3>(pixels, end0, end1);
+
+        uint32_t color_error = ~0u;
+        int color_q[2][3] = {};
+        uint8_t color_indices[16] = {};
+
+        for(int iteration = 0; iteration < 2; iteration++) {
+            int q[2][3], e[2][3];
+
+            for(int c = 0; c < 3; c++) {
+                q[0][c] = std::clamp((int)lroundf(end0[c] * (127.0f / 255.0f)), 0, 127);
+                q[1][c] = std::clamp((int)lroundf(end1[c] * (127.0f / 255.0f)), 0, 127);
+                e[0][c] = q[0][c] << 1 | q[0][c] >> 6;
+                e[1][c] = q[1][c] << 1 | q[1][c] >> 6;
+            }
+
+            uint8_t indices[16];
+            const uint32_t error = BCSelectBC7Indices<4, 3>(e[0], e[1], pixels, indices);
+
+            if(error < color_error) {
+                color_error = error;
+                memcpy(color_q, q, sizeof(q));
+                memcpy(color_indices, indices, sizeof(indices));
+            }
+
+            if(color_error == 0 || iteration == 1 || !BCRefineBC7<3>(pixels, color_indices, gBC7Weights2, end0, end1)) break;
+        }
+
+        int alpha_lo = 255, alpha_hi = 0;
+
+        for(int i = 0; i < 16; i++) {
+            alpha_lo = std::min<int>(alpha_lo, pixels[i * 4 + 3]);
+            alpha_hi = std::max<int>(alpha_hi, pixels[i * 4 + 3]);
+        }
+
+        uint32_t alpha_error = 0;
+        int alpha_e[2] = {alpha_lo, alpha_hi};
+        uint8_t alpha_indices[16] = {};
+
+        if(alpha_lo != alpha_hi) {
+            alpha_error = ~0u;
+
+            // Inset endpoints, 2 bit palette rarely wants the exact extremes
+            for(int inset = 0; inset <= (alpha_hi - alpha_lo) / 8; inset++) {
+                const int a0 = alpha_lo + inset, a1 = alpha_hi - inset;
+                uint32_t error = 0;
+                uint8_t indices[16];
+
+                for(int i = 0; i < 16; i++) {
+                    uint32_t best = ~0u;
+
+                    for(int j = 0; j < 4; j++) {
+                        const int d = pixels[i * 4 + 3] - (((64 - gBC7Weights2[j]) * a0 + gBC7Weights2[j] * a1 + 32) >> 6);
+
+                        if((uint32_t)(d * d) < best) {
+                            best = (uint32_t)(d * d);
+                            indices[i] = (uint8_t)j;
+                        }
+                    }
+
+                    error += best;
+                }
+
+                if(error < alpha_error) {
+                    alpha_error = error;
+                    alpha_e[0] = a0;
+                    alpha_e[1] = a1;
+                    memcpy(alpha_indices, indices, sizeof(indices));
+                }
+            }
+        }
+
+        if(color_indices[0] & 2) {
+            for(int c = 0; c < 3; c++) std::swap(color_q[0][c], color_q[1][c]);
+            for(int i = 0; i < 16; i++) color_indices[i] = 3 - color_indices[i];
+        }
+
+        if(alpha_indices[0] & 2) {
+            std::swap(alpha_e[0], alpha_e[1]);
+            for(int i = 0; i < 16; i++) alpha_indices[i] = 3 - alpha_indices[i];
+        }
+
+        BCBitWriter writer;
+        writer.Put(1u << 5, 6);
+        // No channel rotation
+        writer.Put(0, 2);
+
+        for(int c = 0; c < 3; c++) {
+            writer.Put((uint64_t)color_q[0][c], 7);
+            writer.Put((uint64_t)color_q[1][c], 7);
+        }
+
+        writer.Put((uint64_t)alpha_e[0], 8);
+        writer.Put((uint64_t)alpha_e[1], 8);
+
+        for(int i = 0; i < 16; i++) writer.Put(color_indices[i], i == 0 ? 1 : 2);
+        for(int i = 0; i < 16; i++) writer.Put(alpha_indices[i], i == 0 ? 1 : 2);
+
+        writer.Store(pOut);
+
+        return color_error + alpha_error;
+    }
+
+    /**
+     * @brief Encode 4x4 RGBA block as BC7, mode 6 or mode 5 when alpha varies and separate alpha fits better
+     *
+     * @param pOut 16 bytes
+     * @param pixels 16 RGBA8 pixels
+     */
+    inline void BCEncodeBlockBC7(uint8_t* pOut, const uint8_t* pixels) {
+        const uint32_t error = BCEncodeBC7Mode6(pOut, pixels);
+
+        bool alpha_varies = false;
+
+        for(int i = 1; i < 16 && !alpha_varies; i++) alpha_varies = pixels[i * 4 + 3] != pixels[3];
+
+        if(!alpha_varies || error == 0) return;
+
+        uint8_t block[16];
+
+        if(BCEncodeBC7Mode5(block, pixels) < error) memcpy(pOut, block, 16);
+    }
+
+    inline void BCDecodeBlockBC1(uint8_t* pixels, const uint8_t* block, bool forceFourColor) {
+        uint16_t c0, c1;
+        uint32_t indices;
+
+        memcpy(&c0, block, 2);
+        memcpy(&c1, block + 2, 2);
+        memcpy(&indices, block + 4, 4);
+
+        int palette[4][4];
+
+        BCUnpack565(c0, palette[0]);
+        BCUnpack565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+        for(int c = 0; c < 3; c++) {
+            if(c0 > c1 || forceFourColor) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+
+        if(c0 <= c1 && !forceFourColor) palette[3][3] = 0;
+
+        for(int i = 0; i < 16; i++) {
+            const int j = (indices >> (i * 2)) & 3;
+
+            for(int c = 0; c < 4; c++) pixels[i * 4 + c] = (uint8_t)palette[j][c];
+        }
+    }
+
+    inline void BCDecodeBlockBC4(uint8_t* values, const uint8_t* block) {
+        int palette[8];
+        BCBuildBC4Palette(block[0], block[1], palette);
+
+        uint64_t indices = 0;
+
+        for(int i = 0; i < 6; i++) indices |= (uint64_t)block[2 + i] << (i * 8);
+
+        for(int i = 0; i < 16; i++) values[i * 4] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+    }
+
+    /**
+     * @brief Decode BC7 block, only modes 5 and 6 (what BCEncodeBlockBC7 writes)
+     *
+     * @return false for other modes, pixels are left untouched
+     */
+    inline bool BCDecodeBlockBC7(uint8_t* pixels, const uint8_t* block) {
+        BCBitReader reader(block);
+
+        if((block[0] & 0x7F) == 0x40) {
+            reader.Get(7);
+
+            int e[2][4];
+
+            for(int c = 0; c < 4; c++) {
+                e[0][c] = (int)reader.Get(7) << 1;
+                e[1][c] = (int)reader.Get(7) << 1;
+            }
+
+            const uint32_t p0 = reader.Get(1), p1 = reader.Get(1);
+
+            for(int c = 0; c < 4; c++) {
+                e[0][c] |= p0;
+                e[1][c] |= p1;
+            }
+
+            for(int i = 0; i < 16; i++) {
+                const int w = gBC7Weights4[reader.Get(i == 0 ? 3 : 4)];
+
+                for(int c = 0; c < 4; c++) pixels[i * 4 + c] = (uint8_t)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+            }
+
+            return true;
+        }
+
+        if((block[0] & 0x3F) == 0x20) {
+            reader.Get(6);
+
+            const uint32_t rotation = reader.Get(2);
+            int e[2][4];
+
+            for(int c = 0; c < 3; c++) {
+                const int q0 = (int)reader.Get(7), q1 = (int)reader.Get(7);
+
+                e[0][c] = q0 << 1 | q0 >> 6;
+                e[1][c] = q1 << 1 | q1 >> 6;
+            }
+
+            e[0][3] = (int)reader.Get(8);
+            e[1][3] = (int)reader.Get(8);
+
+            uint32_t color[16];
+
+            for(int i = 0; i < 16; i++) color[i] = reader.Get(i == 0 ? 1 : 2);
+
+            for(int i = 0; i < 16; i++) {
+                uint8_t* p = pixels + i * 4;
+                const int wc = gBC7Weights2[color[i]], wa = gBC7Weights2[reader.Get(i == 0 ? 1 : 2)];
+
+                for(int c = 0; c < 3; c++) p[c] = (uint8_t)(((64 - wc) * e[0][c] + wc * e[1][c] + 32) >> 6);
+
+                p[3] = (uint8_t)(((64 - wa) * e[0][3] + wa * e[1][3] + 32) >> 6);
+
+                if(rotation) std::swap(p[3], p[rotation - 1]);
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Gather 4x4 block, pixels past image edge repeat last row/column
+     *
+     */
+    inline void BCLoadBlock(uint8_t* block, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by) {
+        for(uint32_t y = 0; y < 4; y++) {
+            const uint32_t sy = std::min(by * 4 + y, height - 1);
+
+            for(uint32_t x = 0; x < 4; x++) {
+                const uint32_t sx = std::min(bx * 4 + x, width - 1);
+
+                memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+            }
+        }
+    }
+
+    /**
+     * @brief Decode whole compressed image back to RGBA8 (reference decoder). Channels format doesn`t store are 0,
+     * alpha is 255 where not stored
+     *
+     * @param pRGBA output, width * height * 4 bytes
+     * @param blocks
+     * @param width
+     * @param height
+     * @param format BC_FORMAT_
+     * @return false on BC7 block in mode other than 5 or 6
+     */
+    inline bool BCDecompress(uint8_t* pRGBA, const uint8_t* blocks, uint32_t width, uint32_t height, uint32_t format) {
+        const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+        const uint32_t block_size = BCGetBlockSize(format);
+
+        bool result = true;
+
+        for(uint32_t by = 0; by < blocks_y; by++) {
+            for(uint32_t bx = 0; bx < blocks_x; bx++) {
+                const uint8_t* block = blocks + ((size_t)by * blocks_x + bx) * block_size;
+
+                uint8_t pixels[64];
+
+                for(int i = 0; i < 16; i++) {
+                    pixels[i * 4] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = 0;
+                    pixels[i * 4 + 3] = 255;
+                }
+
+                switch(format) {
+                case BC_FORMAT_BC1: BCDecodeBlockBC1(pixels, block, false); break;
+                case BC_FORMAT_BC3: BCDecodeBlockBC1(pixels, block + 8, true); BCDecodeBlockBC4(pixels + 3, block); break;
+                case BC_FORMAT_BC4: BCDecodeBlockBC4(pixels, block); break;
+                case BC_FORMAT_BC5: BCDecodeBlockBC4(pixels, block); BCDecodeBlockBC4(pixels + 1, block + 8); break;
+                case BC_FORMAT_BC7: result &= BCDecodeBlockBC7(pixels, block); break;
+                }
+
+                for(uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+                    for(uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+                        memcpy(pRGBA + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, pixels + (y * 4 + x) * 4, 4);
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief PSNR between two RGBA8 images over selected channels
+     *
+     * @param a
+     * @param b
+     * @param width
+     * @param height
+     * @param channelMask bit per RGBA channel, see BCGetChannelMask
+     * @return double dB, 999 for identical images
+     */
+    inline double BCComputePSNR(const uint8_t* a, const uint8_t* b, uint32_t width, uint32_t height, uint32_t channelMask) {
+        uint64_t sum = 0, count = 0;
+
+        for(size_t i = 0; i < (size_t)width * height; i++) {
+            for(uint32_t c = 0; c < 4; c++) {
+                if(!(channelMask & (1u << c))) continue;
+
+                const int d = a[i * 4 + c] - b[i * 4 + c];
+
+                sum += (uint64_t)(d * d);
+                count++;
+            }
+        }
+
+        if(sum == 0) return 999.0;
+
+        return 10.0 * log10(255.0 * 255.0 * count / sum);
+    }
+
+    /**
+     * @brief Compress RGBA8 image, rows of blocks are spread over threads
+     *
+     * @param pOut BCGetCompressedSize bytes
+     * @param rgba
+     * @param width
+     * @param height
+     * @param format BC_FORMAT_
+     * @param threadCount 0 for all hardware threads
+     * @param pStats optional, encode time and throughput; also PSNR, which costs extra decode
+     * @return true on success
+     */
+    inline bool BCCompress(uint8_t* pOut, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t format, uint32_t threadCount = 0, BCStats* pStats = nullptr) {
+        if(!rgba || width == 0 || height == 0 || format >= BC_FORMAT_END_DONT_USE) {
+            TE_ERR("Invalid texture compression input")
+
+            return false;
+        }
+
+        std::chrono::time_point start = std::chrono::steady_clock::now();
+
+        const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+        const uint32_t block_size = BCGetBlockSize(format);
+
+        // Tables are built on first use, not inside every worker
+        BCGetTables();
+
+        std::atomic<uint32_t> next_row = 0;
+
+        auto worker = [&]() {
+            uint8_t block[64];
+
+            for(uint32_t by = next_row++; by < blocks_y; by = next_row++) {
+                uint8_t* out = pOut + (size_t)by * blocks_x * block_size;
+
+                for(uint32_t bx = 0; bx < blocks_x; bx++, out += block_size) {
+                    BCLoadBlock(block, rgba, width, height, bx, by);
+
+                    switch(format) {
+                    case BC_FORMAT_BC1: BCEncodeBlockBC1(out, block); break;
+                    case BC_FORMAT_BC3: BCEncodeBlockBC3(out, block); break;
+                    case BC_FORMAT_BC4: BCEncodeBlockBC4(out, block); break;
+                    case BC_FORMAT_BC5: BCEncodeBlockBC5(out, block); break;
+                    case BC_FORMAT_BC7: BCEncodeBlockBC7(out, block); break;
+                    }
+                }
+            }
+        };
+
+        if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        std::vector<std::thread> workers;
+
+        for(uint32_t i = 1; i < std::min(threadCount, blocks_y); i++) {
+            workers.emplace_back(worker);
+        }
+
+        worker();
+
+        for(std::thread& w : workers) w.join();
+
+        if(pStats) {
+            pStats->mEncodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            pStats->mMegapixelsPerSecond = (double)width * height / std::max(pStats->mEncodeMs, 1e-6) / 1000.0;
+
+            std::vector<uint8_t> decoded((size_t)width * height * 4);
+            BCDecompress(decoded.data(), pOut, width, height, format);
+
+            pStats->mPSNR = BCComputePSNR(rgba, decoded.data(), width, height, BCGetChannelMask(format));
+        }
+
+        return true;
+    }
+
+    // Engine native compressed texture (.twt), little endian, levels 16 byte aligned so they upload straight from mapping
+#define TE_TWT_MAGIC 0x31545754u // "TWT1"
+#define TE_TWT_VERSION 1
+
+#define TE_TWT_FLAG_SRGB 0x1
+
+    typedef struct TWTHeader {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        // Hash of source image and encode settings this file was generated from
+        uint64_t mSourceHash;
+        // Hash of everything after header
+        uint64_t mContentHash;
+        // BC_FORMAT_
+        uint32_t mFormat;
+        // TE_TWT_FLAG_
+        uint32_t mFlags;
+        uint32_t mWidth, mHeight;
+        uint32_t mLevelCount;
+        uint32_t mReserved;
+    } TWTHeader;
+
+    typedef struct TWTLevel {
+        uint32_t mWidth, mHeight;
+        // Byte offset from start of file
+        uint64_t mOffset;
+        uint64_t mSize;
+    } TWTLevel;
+
+    typedef struct TWTView {
+        ul_mapped_file_t mFile;
+        uint64_t mSourceHash = 0;
+        uint32_t mFormat = 0, mFlags = 0;
+        uint32_t mWidth = 0, mHeight = 0;
+        std::vector<TWTLevel> mLevels;
+
+        // Points into mapping, valid until TWTUnmap
+        const uint8_t* GetLevel(uint32_t level) const { return mFile.data + mLevels[level].mOffset; }
+    } TWTView;
+
+    /**
+     * @brief Save compressed levels, written through temporary file so readers never see half written file
+     *
+     * @param path
+     * @param format BC_FORMAT_
+     * @param flags TE_TWT_FLAG_
+     * @param levels compressed data of every level, level 0 first
+     * @param sizes level sizes in pixels, width and height interleaved
+     * @param sourceHash see TWTLoadCached
+     * @return true on success
+     */
+    inline bool TWTSave(const char* path, uint32_t format, uint32_t flags, const std::vector<std::vector<uint8_t>>& levels, const std::vector<uint32_t>& sizes, uint64_t sourceHash) {
+        TWTHeader header = {};
+        header.mMagic = TE_TWT_MAGIC;
+        header.mVersion = TE_TWT_VERSION;
+        header.mSourceHash = sourceHash;
+        header.mFormat = format;
+        header.mFlags = flags;
+        header.mWidth = sizes[0];
+        header.mHeight = sizes[1];
+        header.mLevelCount = (uint32_t)levels.size();
+
+        std::vector<TWTLevel> table(levels.size());
+        std::vector<uint8_t> body(table.size() * sizeof(TWTLevel));
+        uint64_t offset = sizeof(TWTHeader) + body.size();
+
+        for(size_t i = 0; i < levels.size(); i++) {
+            while(offset % 16) {
+                body.push_back(0);
+                offset++;
+            }
+
+            table[i] = {sizes[i * 2], sizes[i * 2 + 1], offset, levels[i].size()};
+
+            body.insert(body.end(), levels[i].begin(), levels[i].end());
+            offset += levels[i].size();
+        }
+
+        memcpy(body.data(), table.data(), table.size() * sizeof(TWTLevel));
+
+        header.mContentHash = ulHash64(body.data(), body.size(), 0);
+
+        const std::string temp_path = ulTempPath(path);
+        FILE* file = fopen(temp_path.c_str(), "wb");
+
+        if(!file) {
+            TE_ERR("Cannot create twt file: " << path)
+
+            return false;
+        }
+
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(body.data(), 1, body.size(), file) == body.size();
+        written &= fclose(file) == 0;
+
+        remove(path);
+
+        if(!written || rename(temp_path.c_str(), path) != 0) {
+            remove(temp_path.c_str());
+            TE_ERR("Cannot write twt file: " << path)
+
+            return false;
+        }
+
+        return true;
+    }
+
+    inline void TWTUnmap(TWTView* pView) {
+        ulUnmapFile(&pView->mFile);
+
+        pView->mLevels.clear();
+    }
+
+    /**
+     * @brief Map .twt file, level data is not copied
+     *
+     * @param pView output, release with TWTUnmap, view that is already mapped is unmapped first
+     * @param path
+     * @param verify check content hash (reads whole file)
+     * @return false when file is missing, damaged or from other version
+     */
+    inline bool TWTMap(TWTView* pView, const char* path, bool verify) {
+        TWTUnmap(pView);
+
+        if(!ulMapFile(&pView->mFile, path)) return false;
+
+        const uint8_t* data = pView->mFile.data;
+        const size_t size = pView->mFile.size;
+
+        TWTHeader header;
+
+        if(size < sizeof(header)) {
+            TWTUnmap(pView);
+
+            return false;
+        }
+
+        memcpy(&header, data, sizeof(header));
+
+        if(header.mMagic != TE_TWT_MAGIC || header.mVersion != TE_TWT_VERSION || header.mFormat >= BC_FORMAT_END_DONT_USE || header.mLevelCount == 0 || header.mLevelCount > 32 ||
+           size < sizeof(header) + header.mLevelCount * sizeof(TWTLevel)) {
+            TWTUnmap(pView);
+
+            return false;
+        }
+
+        if(verify && ulHash64(data + sizeof(header), size - sizeof(header), 0) != header.mContentHash) {
+            TWTUnmap(pView);
+
+            return false;
+        }
+
+        pView->mLevels.resize(header.mLevelCount);
+        memcpy(pView->mLevels.data(), data + sizeof(header), header.mLevelCount * sizeof(TWTLevel));
+
+        for(const TWTLevel& level : pView->mLevels) {
+            if(level.mOffset % 16 || level.mOffset > size || level.mSize > size - level.mOffset || level.mSize != BCGetCompressedSize(header.mFormat, level.mWidth, level.mHeight)) {
+                TWTUnmap(pView);
+
+                return false;
+            }
+        }
+
+        pView->mSourceHash = header.mSourceHash;
+        pView->mFormat = header.mFormat;
+        pView->mFlags = header.mFlags;
+        pView->mWidth = header.mWidth;
+        pView->mHeight = header.mHeight;
+
+        return true;
+    }
+
+    /**
+     * @brief Load image (.bmp, .png, .tif/.tiff) as RGBA8 through matching loader, all of them give top row first
+     *
+     */
+    inline bool TWTLoadSourceImage(const std::string& path, std::vector<uint8_t>* pPixels, uint32_t* pWidth, uint32_t* pHeight) {
+        std::string extension = path.substr(path.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+
+        if(extension == "bmp") {
+            *pPixels = ulLoadBitmapFromFile(path, pWidth, pHeight);
+        }
+        else if(extension == "png") {
+            *pPixels = PNGLoadPNGFile(path, pWidth, pHeight);
+        }
+        else if(extension == "tif" || extension == "tiff") {
+            TIFF tiff;
+
+            if(!tiff.Load(path) || !tiff.ConvertToRGBA8(pPixels)) return false;
+
+            *pWidth = tiff.mWidth;
+            *pHeight = tiff.mHeight;
+        }
+        else {
+            TE_ERR("Unknown image type: " << path)
+
+            return false;
+        }
+
+        return !pPixels->empty();
+    }
+
+    /**
+     * @brief Map compressed texture through .twt cache next to source image (path + ".twt"). Cache is used when it was
+     * generated from source with same content and settings, otherwise image is loaded, mip chain built, every level
+     * compressed and cache regenerated
+     *
+     * @param pView output, release with TWTUnmap
+     * @param path source image
+     * @param format BC_FORMAT_
+     * @param srgb color is sRGB (mips are filtered in linear space, GL format is sRGB one)
+     * @param mips build full mip chain, otherwise only level 0
+     * @param threadCount encoder threads, 0 for all hardware threads
+     * @return true on success
+     */
+    inline bool TWTLoadCached(TWTView* pView, const std::string& path, uint32_t format, bool srgb = true, bool mips = true, uint32_t threadCount = 0) {
+        uint64_t source_hash;
+
+        if(!ulHashFile(path.c_str(), &source_hash)) {
+            TE_ERR("Cannot open source image: " << path)
+
+            return false;
+        }
+
+        const uint64_t key_data[4] = { (uint64_t)format, (uint64_t)srgb, (uint64_t)mips, TE_TWT_VERSION };
+        source_hash = ulHash64(key_data, sizeof(key_data), source_hash);
+
+        const std::string cache_path = path + ".twt";
+
+        // Cache is what gets uploaded, damaged one (torn copy, disk error) is rebuilt instead of trusted
+        if(TWTMap(pView, cache_path.c_str(), true)) {
+            if(pView->mSourceHash == source_hash) return true;
+
+            TWTUnmap(pView);
+        }
+
+        std::vector<uint8_t> pixels;
+        uint32_t width, height;
+
+        if(!TWTLoadSourceImage(path, &pixels, &width, &height)) return false;
+
+        MipChain chain;
+
+        if(!MipBuildChain(&chain, pixels, width, height, srgb)) return false;
+
+        const uint32_t level_count = mips ? (uint32_t)chain.mLevels.size() : 1;
+
+        std::vector<std::vector<uint8_t>> levels(level_count);
+        std::vector<uint32_t> sizes;
+
+        for(uint32_t i = 0; i < level_count; i++) {
+            const MipLevel& level = chain.mLevels[i];
+
+            levels[i].resize(BCGetCompressedSize(format, level.mWidth, level.mHeight));
+            sizes.push_back(level.mWidth);
+            sizes.push_back(level.mHeight);
+
+            BCStats stats;
+
+            if(!BCCompress(levels[i].data(), chain.GetLevel(i), level.mWidth, level.mHeight, format, threadCount, i == 0 ? &stats : nullptr)) return false;
+
+            if(i == 0) {
+                TE_INFO("Compressed " << path << " " << width << "x" << height << ": " << stats.mEncodeMs << " ms, " << stats.mMegapixelsPerSecond << " MPix/s, PSNR " << stats.mPSNR << " dB")
+            }
+        }
+
+        if(!TWTSave(cache_path.c_str(), format, srgb ? TE_TWT_FLAG_SRGB : 0, levels, sizes, source_hash)) return false;
+
+        return TWTMap(pView, cache_path.c_str(), true);
+    }
+
+    /**
+     * @brief Create immutable GL texture from mapped levels, needs GL context
+     *
+     * @param view
+     * @return uint32_t texture name, 0 on failure
+     */
+    inline uint32_t TWTCreateTexture(const TWTView& view) {
+        if(view.mLevels.empty()) return 0;
+
+        uint32_t texture = 0;
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, (GLsizei)view.mLevels.size(), BCGetGLFormat(view.mFormat, view.mFlags & TE_TWT_FLAG_SRGB), view.mWidth, view.mHeight);
+
+        for(uint32_t i = 0; i < view.mLevels.size(); i++) {
+            const TWTLevel& level = view.mLevels[i];
+
+            glCompressedTextureSubImage2D(texture, i, 0, 0, level.mWidth, level.mHeight, BCGetGLFormat(view.mFormat, view.mFlags & TE_TWT_FLAG_SRGB), (GLsizei)level.mSize, view.GetLevel(i));
+        }
+
+        return texture;
+    }
+
+    /**
+     * @brief Delete texture made by TWTCreateTexture, state cache forgets units it was bound to
+     *
+     * @param texture
+     */
+    inline void TWTDeleteTexture(uint32_t texture) {
+        if(texture == 0) return;
+
+        glDeleteTextures(1, &texture);
+        GLStateCache::Get().OnDeleteTexture(texture);
+    }
+}
+
+#endif
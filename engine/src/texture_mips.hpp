@@ -0,0 +1,494 @@
+#pragma once
+#ifndef _TE_TEXTURE_MIPS_
+#define _TE_TEXTURE_MIPS_
+
+#include "core.hpp"
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TE_MIP_SSE2
+#endif
+
+namespace te {
+    enum MipFilter {
+        MIP_FILTER_Box,
+        // Windowed sinc, sharper than box at cost of 13 taps per axis (2:1, 3 output pixels each side)
+        MIP_FILTER_Kaiser
+    };
+
+    typedef struct MipLevel {
+        size_t mOffset;
+        uint32_t mWidth, mHeight;
+    } MipLevel;
+
+    /**
+     * @brief Full RGBA8 mip chain in one allocation, level 0 first, every level tightly packed at its mOffset
+     *
+     */
+    typedef struct MipChain {
+        std::vector<uint8_t> mData;
+        std::vector<MipLevel> mLevels;
+        bool mSRGB = true;
+
+        uint8_t* GetLevel(uint32_t level) { return mData.data() + mLevels[level].mOffset; }
+
+        size_t GetLevelSize(uint32_t level) { return (size_t)mLevels[level].mWidth * mLevels[level].mHeight * 4; }
+    } MipChain;
+
+    typedef struct MipTables {
+        float mSRGBToLinear[256];
+        float mUnorm[256];
+        // Indexed by linear value * 65535, fine enough that near black it rounds like exact formula
+        uint8_t mLinearToSRGB[65536];
+    } MipTables;
+
+    inline double MipSRGBToLinear(double c) { return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4); }
+
+    inline double MipLinearToSRGB(double l) { return l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055; }
+
+    inline const MipTables& MipGetTables() {
+        static const MipTables* tables = []() {
+            MipTables* t = new MipTables;
+
+            for(uint32_t i = 0; i < 256; i++) {
+                t->mSRGBToLinear[i] = (float)MipSRGBToLinear(i / 255.0);
+                t->mUnorm[i] = i / 255.0f;
+            }
+
+            for(uint32_t i = 0; i < 65536; i++) {
+                t->mLinearToSRGB[i] = (uint8_t)(MipLinearToSRGB(i / 65535.0) * 255.0 + 0.5);
+            }
+
+            return t;
+        }();
+
+        return *tables;
+    }
+
+    /**
+     * @brief Source taps of every output pixel along one axis, mCount per pixel, indices already clamped to edge
+     *
+     */
+    typedef struct MipTaps {
+        uint32_t mCount;
+        std::vector<uint32_t> mIndex;
+        std::vector<float> mWeight;
+    } MipTaps;
+
+    inline double MipKaiser(double x) {
+        // Same width and alpha as NVTT defaults
+        const double width = 3.0, alpha = 4.0;
+
+        if(fabs(x) >= width) return 0.0;
+
+        auto bessel_i0 = [](double v) {
+            double sum = 1.0, term = 1.0;
+
+            for(int k = 1; k < 32; k++) {
+                term *= (v * 0.5 / k) * (v * 0.5 / k);
+                sum += term;
+            }
+
+            return sum;
+        };
+
+        const double sinc = fabs(x) < 1e-9 ? 1.0 : sin(std::numbers::pi * x) / (std::numbers::pi * x);
+        const double t = x / width;
+
+        return sinc * bessel_i0(alpha * sqrt(1.0 - t * t)) / bessel_i0(alpha);
+    }
+
+    /**
+     * @brief Compute filter taps for downsampling srcSize pixels to dstSize, handles odd sizes (scale slightly above 2)
+     *
+     * @param pTaps
+     * @param srcSize
+     * @param dstSize
+     * @param filter MIP_FILTER_
+     */
+    inline void MipComputeTaps(MipTaps* pTaps, uint32_t srcSize, uint32_t dstSize, uint32_t filter) {
+        const double scale = (double)srcSize / dstSize;
+        // Box covers one output pixel, Kaiser three on each side
+        const double radius = filter == MIP_FILTER_Box ? scale * 0.5 : scale * 3.0;
+
+        pTaps->mCount = (uint32_t)ceil(radius * 2.0) + 1;
+        pTaps->mIndex.resize((size_t)dstSize * pTaps->mCount);
+        pTaps->mWeight.resize((size_t)dstSize * pTaps->mCount);
+
+        for(uint32_t i = 0; i < dstSize; i++) {
+            const double center = (i + 0.5) * scale;
+            const int64_t first = (int64_t)floor(center - radius);
+
+            double sum = 0.0;
+
+            for(uint32_t t = 0; t < pTaps->mCount; t++) {
+                const int64_t k = first + t;
+                double w;
+
+                if(filter == MIP_FILTER_Box) {
+                    // Coverage of source pixel [k, k + 1] by output footprint
+                    w = std::max(0.0, std::min<double>(k + 1, center + radius) - std::max<double>(k, center - radius));
+                }
+                else {
+                    w = MipKaiser((k + 0.5 - center) / scale);
+                }
+
+                pTaps->mIndex[i * pTaps->mCount + t] = (uint32_t)std::clamp<int64_t>(k, 0, srcSize - 1);
+                pTaps->mWeight[i * pTaps->mCount + t] = (float)w;
+                sum += w;
+            }
+
+            for(uint32_t t = 0; t < pTaps->mCount; t++) {
+                pTaps->mWeight[i * pTaps->mCount + t] = (float)(pTaps->mWeight[i * pTaps->mCount + t] / sum);
+            }
+        }
+    }
+
+    // Below this filtered alpha color is meaningless (and dividing by it blows up ringing), pixel becomes transparent black
+#define TE_MIP_MIN_ALPHA (0.5f / 255.0f)
+
+    // Four lanes, one RGBA pixel. Kernels below are written once against these and compile to SSE2 or plain floats
+#ifdef TE_MIP_SSE2
+    typedef __m128 MipVec;
+
+    inline MipVec MipZero() { return _mm_setzero_ps(); }
+    inline MipVec MipSet1(float v) { return _mm_set1_ps(v); }
+    inline MipVec MipLoad(const float* p) { return _mm_loadu_ps(p); }
+    inline void MipStore(float* p, MipVec v) { _mm_storeu_ps(p, v); }
+    inline MipVec MipAdd(MipVec a, MipVec b) { return _mm_add_ps(a, b); }
+    inline MipVec MipMul(MipVec a, MipVec b) { return _mm_mul_ps(a, b); }
+    inline MipVec MipMulAdd(MipVec acc, MipVec a, MipVec b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+
+    inline MipVec MipDecode(const uint8_t* p, const float* color, const float* alpha) {
+        return _mm_set_ps(alpha[p[3]], color[p[2]], color[p[1]], color[p[0]]);
+    }
+
+    // Color premultiplied by alpha, so transparent pixels don`t bleed their color into neighbours
+    inline MipVec MipDecodeWeighted(const uint8_t* p, const float* color, const float* alpha) {
+        const float a = alpha[p[3]];
+
+        return _mm_mul_ps(_mm_set_ps(1.0f, color[p[2]], color[p[1]], color[p[0]]), _mm_set_ps(a, a, a, a));
+    }
+
+    // Back from premultiplied, color of (nearly) transparent pixel is 0
+    inline MipVec MipUnweight(MipVec v) {
+        const __m128 a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128 alpha_lane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        const __m128 scale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), a), _mm_cmpge_ps(a, _mm_set1_ps(TE_MIP_MIN_ALPHA)));
+
+        return _mm_mul_ps(v, _mm_or_ps(_mm_andnot_ps(alpha_lane, scale), _mm_and_ps(alpha_lane, _mm_set1_ps(1.0f))));
+    }
+
+    inline void MipEncode(uint8_t* p, MipVec v, const MipTables& tables, bool srgb) {
+        v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+        // Round half up like scalar path, cvtps would round exact box averages half to even
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        if(srgb) {
+            alignas(16) int32_t index[4];
+            _mm_store_si128((__m128i*)index, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set_ps(255.0f, 65535.0f, 65535.0f, 65535.0f)), half)));
+
+            p[0] = tables.mLinearToSRGB[index[0]];
+            p[1] = tables.mLinearToSRGB[index[1]];
+            p[2] = tables.mLinearToSRGB[index[2]];
+            p[3] = (uint8_t)index[3];
+
+            return;
+        }
+
+        const __m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), half));
+        const int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(q, q), _mm_setzero_si128()));
+
+        memcpy(p, &packed, 4);
+    }
+#else
+    typedef struct MipVec { float v[4]; } MipVec;
+
+    inline MipVec MipZero() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+    inline MipVec MipSet1(float v) { return {{v, v, v, v}}; }
+    inline MipVec MipLoad(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+    inline void MipStore(float* p, MipVec v) { memcpy(p, v.v, sizeof(v.v)); }
+    inline MipVec MipAdd(MipVec a, MipVec b) { for(int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+    inline MipVec MipMul(MipVec a, MipVec b) { for(int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+    inline MipVec MipMulAdd(MipVec acc, MipVec a, MipVec b) { for(int i = 0; i < 4; i++) acc.v[i] += a.v[i] * b.v[i]; return acc; }
+
+    inline MipVec MipDecode(const uint8_t* p, const float* color, const float* alpha) {
+        return {{color[p[0]], color[p[1]], color[p[2]], alpha[p[3]]}};
+    }
+
+    inline MipVec MipDecodeWeighted(const uint8_t* p, const float* color, const float* alpha) {
+        const float a = alpha[p[3]];
+
+        return {{color[p[0]] * a, color[p[1]] * a, color[p[2]] * a, a}};
+    }
+
+    inline MipVec MipUnweight(MipVec v) {
+        const float scale = v.v[3] >= TE_MIP_MIN_ALPHA ? 1.0f / v.v[3] : 0.0f;
+
+        return {{v.v[0] * scale, v.v[1] * scale, v.v[2] * scale, v.v[3]}};
+    }
+
+    inline void MipEncode(uint8_t* p, MipVec v, const MipTables& tables, bool srgb) {
+        for(int i = 0; i < 4; i++) {
+            const float c = std::clamp(v.v[i], 0.0f, 1.0f);
+
+            p[i] = srgb && i < 3 ? tables.mLinearToSRGB[(uint32_t)(c * 65535.0f + 0.5f)] : (uint8_t)(c * 255.0f + 0.5f);
+        }
+    }
+#endif
+
+    template<bool WEIGHTED>
+    inline MipVec MipDecodePixel(const uint8_t* p, const float* color, const float* alpha) {
+        if constexpr(WEIGHTED) return MipDecodeWeighted(p, color, alpha);
+        else return MipDecode(p, color, alpha);
+    }
+
+    template<bool WEIGHTED>
+    inline void MipEncodePixel(uint8_t* p, MipVec v, const MipTables& tables, bool srgb) {
+        if constexpr(WEIGHTED) MipEncode(p, MipUnweight(v), tables, srgb);
+        else MipEncode(p, v, tables, srgb);
+    }
+
+    /**
+     * @brief 2x2 box downsample of even sized level, the common case
+     *
+     */
+    template<bool WEIGHTED>
+    inline void MipDownsampleBox2x2(uint8_t* dst, const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, bool srgb) {
+        const MipTables& tables = MipGetTables();
+        const float* color = srgb ? tables.mSRGBToLinear : tables.mUnorm;
+        const uint32_t width = srcWidth / 2, height = srcHeight / 2;
+        const MipVec quarter = MipSet1(0.25f);
+
+        for(uint32_t y = 0; y < height; y++) {
+            const uint8_t* row0 = src + (size_t)y * 2 * srcWidth * 4;
+            const uint8_t* row1 = row0 + (size_t)srcWidth * 4;
+            uint8_t* out = dst + (size_t)y * width * 4;
+
+            for(uint32_t x = 0; x < width; x++) {
+                MipVec sum = MipAdd(MipDecodePixel<WEIGHTED>(row0 + x * 8, color, tables.mUnorm), MipDecodePixel<WEIGHTED>(row0 + x * 8 + 4, color, tables.mUnorm));
+                sum = MipAdd(sum, MipAdd(MipDecodePixel<WEIGHTED>(row1 + x * 8, color, tables.mUnorm), MipDecodePixel<WEIGHTED>(row1 + x * 8 + 4, color, tables.mUnorm)));
+
+                MipEncodePixel<WEIGHTED>(out + x * 4, MipMul(sum, quarter), tables, srgb);
+            }
+        }
+    }
+
+    /**
+     * @brief Separable downsample with arbitrary taps. Every source row is decoded and filtered horizontally once into
+     * small ring of rows, vertical taps then read from ring
+     *
+     */
+    template<bool WEIGHTED>
+    inline void MipDownsampleSeparable(uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t filter, bool srgb) {
+        const MipTables& tables = MipGetTables();
+        const float* color = srgb ? tables.mSRGBToLinear : tables.mUnorm;
+
+        MipTaps taps_x, taps_y;
+        MipComputeTaps(&taps_x, srcWidth, dstWidth, filter);
+        MipComputeTaps(&taps_y, srcHeight, dstHeight, filter);
+
+        // Window of one output row spans at most mCount source rows and slides forward, ring bigger than that never
+        // evicts row still in use
+        const uint32_t ring_size = taps_y.mCount + 2;
+        std::vector<float> ring((size_t)ring_size * dstWidth * 4);
+        std::vector<int64_t> ring_row(ring_size, -1);
+        std::vector<float> decoded((size_t)srcWidth * 4);
+        std::vector<float> accum((size_t)dstWidth * 4);
+
+        auto horizontal = [&](uint32_t row) -> const float* {
+            const uint32_t slot = row % ring_size;
+            float* out = ring.data() + (size_t)slot * dstWidth * 4;
+
+            if(ring_row[slot] == row) return out;
+
+            ring_row[slot] = row;
+
+            const uint8_t* in = src + (size_t)row * srcWidth * 4;
+
+            for(uint32_t x = 0; x < srcWidth; x++) {
+                MipStore(decoded.data() + x * 4, MipDecodePixel<WEIGHTED>(in + x * 4, color, tables.mUnorm));
+            }
+
+            for(uint32_t x = 0; x < dstWidth; x++) {
+                const uint32_t* index = taps_x.mIndex.data() + (size_t)x * taps_x.mCount;
+                const float* weight = taps_x.mWeight.data() + (size_t)x * taps_x.mCount;
+
+                MipVec sum = MipZero();
+
+                for(uint32_t t = 0; t < taps_x.mCount; t++) {
+                    sum = MipMulAdd(sum, MipLoad(decoded.data() + index[t] * 4), MipSet1(weight[t]));
+                }
+
+                MipStore(out + x * 4, sum);
+            }
+
+            return out;
+        };
+
+        for(uint32_t y = 0; y < dstHeight; y++) {
+            const uint32_t* index = taps_y.mIndex.data() + (size_t)y * taps_y.mCount;
+            const float* weight = taps_y.mWeight.data() + (size_t)y * taps_y.mCount;
+
+            std::fill(accum.begin(), accum.end(), 0.0f);
+
+            for(uint32_t t = 0; t < taps_y.mCount; t++) {
+                if(weight[t] == 0.0f) continue;
+
+                const float* row = horizontal(index[t]);
+                const MipVec w = MipSet1(weight[t]);
+
+                for(size_t i = 0; i < accum.size(); i += 4) {
+                    MipStore(accum.data() + i, MipMulAdd(MipLoad(accum.data() + i), MipLoad(row + i), w));
+                }
+            }
+
+            uint8_t* out = dst + (size_t)y * dstWidth * 4;
+
+            for(uint32_t x = 0; x < dstWidth; x++) {
+                MipEncodePixel<WEIGHTED>(out + x * 4, MipLoad(accum.data() + x * 4), tables, srgb);
+            }
+        }
+    }
+
+    inline void MipAllocateChain(MipChain* pChain, uint32_t width, uint32_t height, bool srgb) {
+        pChain->mLevels.clear();
+        pChain->mSRGB = srgb;
+
+        size_t offset = 0;
+
+        while(true) {
+            pChain->mLevels.push_back({offset, width, height});
+            offset += (size_t)width * height * 4;
+
+            if(width == 1 && height == 1) break;
+
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+
+        pChain->mData.resize(offset);
+    }
+
+    /**
+     * @brief Build full mip chain down to 1x1, every level is filtered from previous one in linear space
+     *
+     * @param pChain output
+     * @param pixels RGBA8, e.g. from ulLoadBitmapFromFile, PNGLoadPNGFile or TIFF::ConvertToRGBA8
+     * @param width
+     * @param height
+     * @param srgb color channels are sRGB encoded (alpha is always linear), false for normal maps and other data
+     * @param filter MIP_FILTER_
+     * @param alphaWeighted filter color premultiplied by alpha (levels stay straight alpha), so color of transparent pixels
+     * doesn`t bleed into visible ones. False filters all four channels independently, e.g. for data in alpha
+     * @return true on success
+     */
+    inline bool MipBuildChain(MipChain* pChain, const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb = true, uint32_t filter = MIP_FILTER_Box, bool alphaWeighted = true) {
+        if(!pixels || width == 0 || height == 0) {
+            TE_ERR("Invalid mip chain source")
+
+            return false;
+        }
+
+        MipAllocateChain(pChain, width, height, srgb);
+
+        memcpy(pChain->GetLevel(0), pixels, pChain->GetLevelSize(0));
+
+        for(uint32_t i = 1; i < pChain->mLevels.size(); i++) {
+            const MipLevel& src = pChain->mLevels[i - 1];
+            const MipLevel& dst = pChain->mLevels[i];
+
+            if(filter == MIP_FILTER_Box && src.mWidth == dst.mWidth * 2 && src.mHeight == dst.mHeight * 2) {
+                if(alphaWeighted) MipDownsampleBox2x2<true>(pChain->GetLevel(i), pChain->GetLevel(i - 1), src.mWidth, src.mHeight, srgb);
+                else MipDownsampleBox2x2<false>(pChain->GetLevel(i), pChain->GetLevel(i - 1), src.mWidth, src.mHeight, srgb);
+            }
+            else if(alphaWeighted) {
+                MipDownsampleSeparable<true>(pChain->GetLevel(i), dst.mWidth, dst.mHeight, pChain->GetLevel(i - 1), src.mWidth, src.mHeight, filter, srgb);
+            }
+            else {
+                MipDownsampleSeparable<false>(pChain->GetLevel(i), dst.mWidth, dst.mHeight, pChain->GetLevel(i - 1), src.mWidth, src.mHeight, filter, srgb);
+            }
+        }
+
+        return true;
+    }
+
+    inline bool MipBuildChain(MipChain* pChain, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, bool srgb = true, uint32_t filter = MIP_FILTER_Box, bool alphaWeighted = true) {
+        if(pixels.size() < (size_t)width * height * 4) {
+            TE_ERR("Mip chain source smaller than " << width << "x" << height << " RGBA8")
+
+            return false;
+        }
+
+        return MipBuildChain(pChain, pixels.data(), width, height, srgb, filter, alphaWeighted);
+    }
+
+    /**
+     * @brief Scalar double precision reference of MipBuildChain, exact transfer functions and direct 2D filtering.
+     * Slow, meant for validating fast path
+     *
+     */
+    inline bool MipBuildChainReference(MipChain* pChain, const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb = true, uint32_t filter = MIP_FILTER_Box, bool alphaWeighted = true) {
+        if(!pixels || width == 0 || height == 0) return false;
+
+        MipAllocateChain(pChain, width, height, srgb);
+
+        memcpy(pChain->GetLevel(0), pixels, pChain->GetLevelSize(0));
+
+        double decode[256];
+
+        for(uint32_t i = 0; i < 256; i++) decode[i] = srgb ? MipSRGBToLinear(i / 255.0) : i / 255.0;
+
+        for(uint32_t i = 1; i < pChain->mLevels.size(); i++) {
+            const MipLevel src = pChain->mLevels[i - 1];
+            const MipLevel dst = pChain->mLevels[i];
+            const uint8_t* in = pChain->GetLevel(i - 1);
+            uint8_t* out = pChain->GetLevel(i);
+
+            MipTaps taps_x, taps_y;
+            MipComputeTaps(&taps_x, src.mWidth, dst.mWidth, filter);
+            MipComputeTaps(&taps_y, src.mHeight, dst.mHeight, filter);
+
+            for(uint32_t y = 0; y < dst.mHeight; y++) {
+                for(uint32_t x = 0; x < dst.mWidth; x++) {
+                    double sum[4] = {0.0, 0.0, 0.0, 0.0};
+
+                    for(uint32_t ty = 0; ty < taps_y.mCount; ty++) {
+                        for(uint32_t tx = 0; tx < taps_x.mCount; tx++) {
+                            const double w = (double)taps_y.mWeight[y * taps_y.mCount + ty] * taps_x.mWeight[x * taps_x.mCount + tx];
+                            const uint8_t* p = in + ((size_t)taps_y.mIndex[y * taps_y.mCount + ty] * src.mWidth + taps_x.mIndex[x * taps_x.mCount + tx]) * 4;
+
+                            const double a = p[3] / 255.0;
+
+                            for(uint32_t c = 0; c < 3; c++) sum[c] += w * decode[p[c]] * (alphaWeighted ? a : 1.0);
+
+                            sum[3] += w * a;
+                        }
+                    }
+
+                    if(alphaWeighted) {
+                        const double scale = sum[3] >= TE_MIP_MIN_ALPHA ? 1.0 / sum[3] : 0.0;
+
+                        for(uint32_t c = 0; c < 3; c++) sum[c] *= scale;
+                    }
+
+                    for(uint32_t c = 0; c < 4; c++) {
+                        const double v = std::clamp(sum[c], 0.0, 1.0);
+
+                        out[((size_t)y * dst.mWidth + x) * 4 + c] = (uint8_t)((srgb && c < 3 ? MipLinearToSRGB(v) : v) * 255.0 + 0.5);
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+#endif
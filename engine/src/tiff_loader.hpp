@@ -6,9 +6,253 @@
 #include <string>
 #include <cstdint>
 #include "core.hpp"
-#include <fstream>
+#include "ul_mapped_file.hpp"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <thread>
+
+#define TIFF_TAG_IMAGE_WIDTH 256
+#define TIFF_TAG_IMAGE_LENGTH 257
+#define TIFF_TAG_BITS_PER_SAMPLE 258
+#define TIFF_TAG_COMPRESSION 259
+#define TIFF_TAG_PHOTOMETRIC 262
+#define TIFF_TAG_STRIP_OFFSETS 273
+#define TIFF_TAG_SAMPLES_PER_PIXEL 277
+#define TIFF_TAG_ROWS_PER_STRIP 278
+#define TIFF_TAG_STRIP_BYTE_COUNTS 279
+#define TIFF_TAG_PLANAR_CONFIG 284
+#define TIFF_TAG_PREDICTOR 317
+#define TIFF_TAG_COLOR_MAP 320
+#define TIFF_TAG_TILE_WIDTH 322
+#define TIFF_TAG_TILE_LENGTH 323
+#define TIFF_TAG_TILE_OFFSETS 324
+#define TIFF_TAG_TILE_BYTE_COUNTS 325
+#define TIFF_TAG_SAMPLE_FORMAT 339
+
+#define TIFF_COMPRESSION_NONE 1
+#define TIFF_COMPRESSION_LZW 5
+#define TIFF_COMPRESSION_PACKBITS 32773
+
+#define TIFF_PREDICTOR_NONE 1
+#define TIFF_PREDICTOR_HORIZONTAL 2
+#define TIFF_PREDICTOR_FLOAT 3
+
+#define TIFF_PLANAR_CHUNKY 1
+#define TIFF_PLANAR_SEPARATE 2
+
+#define TIFF_SAMPLE_UINT 1
+#define TIFF_SAMPLE_INT 2
+#define TIFF_SAMPLE_FLOAT 3
 
 namespace te {
+    /**
+     * @brief Decode TIFF (MSB first, early change) LZW stream
+     *
+     * @param in compressed data
+     * @param inSize
+     * @param out
+     * @param outSize decoding stops once output is full
+     * @param pError set on invalid code
+     * @return size_t bytes written
+     */
+    inline size_t TIFFDecodeLZW(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize, bool* pError) {
+        *pError = false;
+
+        // Pre 6.0 LSB first variant, libtiff detects it the same way
+        if(inSize >= 2 && in[0] == 0 && (in[1] & 1)) {
+            *pError = true;
+
+            return 0;
+        }
+
+        // Every string in table is a run of already written output, so entry is just its position and length
+        uint32_t start[4096];
+        uint16_t length[4096];
+
+        uint64_t bits = 0;
+        uint32_t count = 0;
+        size_t ip = 0, op = 0;
+
+        uint32_t code_len = 9;
+        uint32_t next = 258;
+        bool has_prev = false;
+        size_t prev_pos = 0, prev_len = 0;
+
+        while(op < outSize) {
+            while(count <= 56 && ip < inSize) {
+                bits |= (uint64_t)in[ip++] << (56 - count);
+                count += 8;
+            }
+
+            if(count < code_len) break;
+
+            const uint32_t code = (uint32_t)(bits >> (64 - code_len));
+            bits <<= code_len;
+            count -= code_len;
+
+            if(code == 257) break;
+
+            if(code == 256) {
+                code_len = 9;
+                next = 258;
+                has_prev = false;
+
+                continue;
+            }
+
+            const size_t pos = op;
+            size_t len;
+
+            if(code < 256) {
+                out[op++] = (uint8_t)code;
+                len = 1;
+            }
+            else if(!has_prev || code > next) {
+                *pError = true;
+
+                return op;
+            }
+            else if(code < next) {
+                len = length[code];
+
+                const size_t copy = std::min(len, outSize - op);
+                const uint8_t* src = out + start[code];
+
+                if(len <= 16 && op + 16 <= outSize) {
+                    // Fixed size over copy, bytes past string get overwritten by following codes. Source ends before
+                    // op, so loading whole chunk before storing is safe even though it can run into destination
+                    uint8_t chunk[16];
+                    memcpy(chunk, src, 16);
+                    memcpy(out + op, chunk, 16);
+                }
+                else if(copy < 16) {
+                    for(size_t i = 0; i < copy; i++) out[op + i] = src[i];
+                }
+                else {
+                    memcpy(out + op, src, copy);
+                }
+
+                op += copy;
+            }
+            else {
+                // Code being defined right now: previous string plus its own first byte
+                len = prev_len + 1;
+
+                const size_t copy = std::min(len, outSize - op);
+
+                for(size_t i = 0; i < copy; i++) out[op + i] = out[prev_pos + i];
+
+                op += copy;
+            }
+
+            if(has_prev && next < 4096) {
+                start[next] = (uint32_t)prev_pos;
+                length[next] = (uint16_t)(prev_len + 1);
+                next++;
+
+                // Early change, width grows one code before table actually needs it
+                if(next == (1u << code_len) - 1 && code_len < 12) code_len++;
+            }
+
+            has_prev = true;
+            prev_pos = pos;
+            prev_len = len;
+        }
+
+        return op;
+    }
+
+    /**
+     * @brief Decode PackBits run length stream
+     *
+     * @param in compressed data
+     * @param inSize
+     * @param out
+     * @param outSize decoding stops once output is full
+     * @return size_t bytes written
+     */
+    inline size_t TIFFDecodePackBits(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize) {
+        size_t ip = 0, op = 0;
+
+        while(ip < inSize && op < outSize) {
+            const int8_t n = (int8_t)in[ip++];
+
+            if(n >= 0) {
+                const size_t run = std::min({(size_t)n + 1, inSize - ip, outSize - op});
+
+                memcpy(out + op, in + ip, run);
+                ip += (size_t)n + 1;
+                op += run;
+            }
+            else if(n != -128) {
+                if(ip >= inSize) break;
+
+                const size_t run = std::min((size_t)(1 - n), outSize - op);
+
+                memset(out + op, in[ip++], run);
+                op += run;
+            }
+        }
+
+        return op;
+    }
+
+    template<typename T, size_t STRIDE>
+    inline void TIFFUndoHorizontalFixed(T* row, size_t samples) {
+        // Running sums in separate scalars so they stay in registers instead of reloading just stored sample
+        T s0 = row[0], s1 = 0, s2 = 0, s3 = 0;
+
+        if constexpr(STRIDE > 1) s1 = row[1];
+        if constexpr(STRIDE > 2) s2 = row[2];
+        if constexpr(STRIDE > 3) s3 = row[3];
+
+        for(size_t i = STRIDE; i < samples; i += STRIDE) {
+            row[i] = s0 = (T)(s0 + row[i]);
+
+            if constexpr(STRIDE > 1) row[i + 1] = s1 = (T)(s1 + row[i + 1]);
+            if constexpr(STRIDE > 2) row[i + 2] = s2 = (T)(s2 + row[i + 2]);
+            if constexpr(STRIDE > 3) row[i + 3] = s3 = (T)(s3 + row[i + 3]);
+        }
+    }
+
+    /**
+     * @brief Undo horizontal differencing (predictor 2) of one row
+     *
+     * @tparam T sample type
+     * @param row
+     * @param samples samples in row, multiple of stride
+     * @param stride samples per pixel
+     */
+    template<typename T>
+    inline void TIFFUndoHorizontal(T* row, size_t samples, size_t stride) {
+        if(samples < stride) return;
+
+        switch(stride) {
+        case 1: TIFFUndoHorizontalFixed<T, 1>(row, samples); return;
+        case 2: TIFFUndoHorizontalFixed<T, 2>(row, samples); return;
+        case 3: TIFFUndoHorizontalFixed<T, 3>(row, samples); return;
+        case 4: TIFFUndoHorizontalFixed<T, 4>(row, samples); return;
+        }
+
+        for(size_t i = stride; i < samples; i++) {
+            row[i] = (T)(row[i] + row[i - stride]);
+        }
+    }
+
+    template<typename T>
+    inline void TIFFByteSwap(T* data, size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            data[i] = std::byteswap(data[i]);
+        }
+    }
+
+    /**
+     * @brief One image file directory. mTagsDataOffset points at tag data in file, for values that fit in 4 bytes that is
+     * the value field of entry itself, so every tag is read the same way
+     *
+     */
     typedef struct TIFF_Ifd {
         uint16_t mDirEntries;
         std::vector<uint16_t> mTagsId;
@@ -18,37 +262,571 @@ namespace te {
         uint32_t mNextOffset;
     } TIFF_Ifd;
 
+    /**
+     * @brief TIFF reader. Pixels are kept as stored (samples of mBitsPerSample, chunky, native byte order), so 16 bit
+     * and float height maps keep their precision; palette images give indices and mColorMap. Strips are treated as
+     * tiles mWidth wide, so ReadTile works on both layouts. File stays mapped after Open for partial reads
+     *
+     */
     typedef struct TIFF {
         bool mLittleEndian;
         uint32_t mOffset;
         uint32_t mWidth, mHeight;
 
         std::vector<TIFF_Ifd> mIfds;
-        
-        void Load(std::string path) {
-            std::ifstream file(path, std::ios::binary | std::ios::ate);
 
-            size_t len = file.tellg();
-            file.seekg(0, std::ios::beg);
+        uint16_t mBitsPerSample = 0, mSamplesPerPixel = 0, mSampleFormat = 0;
+        uint16_t mCompression = 0, mPredictor = 0, mPlanarConfig = 0, mPhotometric = 0;
+        bool mTiled = false;
+        uint32_t mTileWidth = 0, mTileHeight = 0;
+        uint32_t mTilesAcross = 0, mTilesDown = 0;
+        std::vector<uint32_t> mTileOffsets, mTileByteCounts;
+        std::vector<uint16_t> mColorMap;
+
+        // Whole image after Load, mWidth * mHeight * GetPixelSize() bytes
+        std::vector<uint8_t> mPixels;
+
+        ul_mapped_file_t mFile;
+
+        TIFF() = default;
+        TIFF(const TIFF&) = delete;
+        TIFF& operator=(const TIFF&) = delete;
+
+        ~TIFF() { ulUnmapFile(&mFile); }
+
+        uint16_t Read16(size_t offset) {
+            const uint16_t v = (uint16_t)(mFile.data[offset] | mFile.data[offset + 1] << 8);
+
+            return mLittleEndian ? v : std::byteswap(v);
+        }
+
+        uint32_t Read32(size_t offset) {
+            uint32_t v;
+            memcpy(&v, mFile.data + offset, 4);
+
+            return (mLittleEndian == (std::endian::native == std::endian::little)) ? v : std::byteswap(v);
+        }
+
+        /**
+         * @brief Read integer tag values (BYTE, SHORT or LONG)
+         *
+         * @param ifd
+         * @param tag TIFF_TAG_
+         * @param pValues
+         * @return true when tag exists and is readable
+         */
+        bool GetTag(const TIFF_Ifd& ifd, uint16_t tag, std::vector<uint32_t>* pValues) {
+            for(size_t i = 0; i < ifd.mTagsId.size(); i++) {
+                if(ifd.mTagsId[i] != tag) continue;
+
+                const uint16_t type = ifd.mTagsDataType[i];
+                const size_t size = type == 1 ? 1 : type == 3 ? 2 : type == 4 ? 4 : 0;
+                const size_t count = ifd.mTagsDataCount[i];
+                const size_t offset = ifd.mTagsDataOffset[i];
+
+                if(size == 0 || offset > mFile.size || count > (mFile.size - offset) / size) return false;
+
+                pValues->resize(count);
+
+                for(size_t j = 0; j < count; j++) {
+                    (*pValues)[j] = size == 1 ? mFile.data[offset + j] : size == 2 ? Read16(offset + j * 2) : Read32(offset + j * 4);
+                }
+
+                return true;
+            }
+
+            return false;
+        }
+
+        uint32_t GetTagValue(const TIFF_Ifd& ifd, uint16_t tag, uint32_t defaultValue) {
+            std::vector<uint32_t> values;
+
+            return GetTag(ifd, tag, &values) && !values.empty() ? values[0] : defaultValue;
+        }
+
+        size_t GetPixelSize() { return (size_t)mSamplesPerPixel * (mBitsPerSample / 8); }
+
+        uint32_t GetTileCount() { return mTilesAcross * mTilesDown; }
+
+        /**
+         * @brief Size of buffer ReadTile fills, whole tile including padding past image edge
+         *
+         * @return size_t
+         */
+        size_t GetTileSize() { return (size_t)mTileWidth * mTileHeight * GetPixelSize(); }
+
+        /**
+         * @brief Map file, parse all IFDs and prepare image for decoding without decoding anything
+         *
+         * @param path
+         * @param image IFD index, e.g. reduced resolution levels in pyramid files
+         * @return true on success
+         */
+        bool Open(std::string path, uint32_t image = 0) {
+            // Reopening drops previous file, also when new one cannot be opened
+            ulUnmapFile(&mFile);
+
+            mIfds.clear();
+            mPixels.clear();
+            mTileOffsets.clear();
+            mTileByteCounts.clear();
+
+            if(!ulMapFile(&mFile, path.c_str())) {
+                TE_ERR("Cannot open TIFF file: " << path)
+
+                return false;
+            }
+
+            const uint8_t* source = mFile.data;
+
+            if(mFile.size < 8 || !((source[0] == 0x49 && source[1] == 0x49) || (source[0] == 0x4D && source[1] == 0x4D))) {
+                TE_ERR("Not a TIFF file: " << path)
+
+                return false;
+            }
+
+            mLittleEndian = source[0] == 0x49;
+
+            if(Read16(2) != 42) {
+                TE_ERR("Unsupported TIFF version (BigTIFF?): " << path)
+
+                return false;
+            }
+
+            mOffset = Read32(4);
+
+            uint32_t offset = mOffset;
+
+            while(offset != 0) {
+                if((size_t)offset + 2 > mFile.size) {
+                    TE_WARN("IFD offset past end of file: " << path)
+
+                    break;
+                }
+
+                TIFF_Ifd ifd;
+                ifd.mDirEntries = Read16(offset);
+
+                if((size_t)offset + 2 + ifd.mDirEntries * 12 + 4 > mFile.size) {
+                    TE_WARN("Truncated IFD: " << path)
+
+                    break;
+                }
+
+                ifd.mTagsId.resize(ifd.mDirEntries);
+                ifd.mTagsDataType.resize(ifd.mDirEntries);
+                ifd.mTagsDataCount.resize(ifd.mDirEntries);
+                ifd.mTagsDataOffset.resize(ifd.mDirEntries);
+
+                for(uint16_t i = 0; i < ifd.mDirEntries; i++) {
+                    const size_t entry = (size_t)offset + 2 + i * 12;
+
+                    ifd.mTagsId[i] = Read16(entry);
+                    ifd.mTagsDataType[i] = Read16(entry + 2);
+                    ifd.mTagsDataCount[i] = Read32(entry + 4);
+
+                    static const uint8_t type_size[13] = {0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8};
+                    const uint64_t bytes = (uint64_t)ifd.mTagsDataCount[i] * (ifd.mTagsDataType[i] < 13 ? type_size[ifd.mTagsDataType[i]] : 0);
+
+                    ifd.mTagsDataOffset[i] = bytes <= 4 ? (uint32_t)(entry + 8) : Read32(entry + 8);
+                }
+
+                ifd.mNextOffset = Read32((size_t)offset + 2 + ifd.mDirEntries * 12);
+
+                mIfds.push_back(std::move(ifd));
+
+                // Directory chain pointing back to itself
+                if(mIfds.back().mNextOffset <= offset) break;
+
+                offset = mIfds.back().mNextOffset;
+            }
+
+            if(image >= mIfds.size()) {
+                TE_ERR("TIFF has no image " << image << ": " << path)
+
+                return false;
+            }
+
+            const TIFF_Ifd& ifd = mIfds[image];
+
+            mWidth = GetTagValue(ifd, TIFF_TAG_IMAGE_WIDTH, 0);
+            mHeight = GetTagValue(ifd, TIFF_TAG_IMAGE_LENGTH, 0);
+            mBitsPerSample = (uint16_t)GetTagValue(ifd, TIFF_TAG_BITS_PER_SAMPLE, 1);
+            mSamplesPerPixel = (uint16_t)GetTagValue(ifd, TIFF_TAG_SAMPLES_PER_PIXEL, 1);
+            mSampleFormat = (uint16_t)GetTagValue(ifd, TIFF_TAG_SAMPLE_FORMAT, TIFF_SAMPLE_UINT);
+            mCompression = (uint16_t)GetTagValue(ifd, TIFF_TAG_COMPRESSION, TIFF_COMPRESSION_NONE);
+            mPredictor = (uint16_t)GetTagValue(ifd, TIFF_TAG_PREDICTOR, TIFF_PREDICTOR_NONE);
+            mPlanarConfig = (uint16_t)GetTagValue(ifd, TIFF_TAG_PLANAR_CONFIG, TIFF_PLANAR_CHUNKY);
+            mPhotometric = (uint16_t)GetTagValue(ifd, TIFF_TAG_PHOTOMETRIC, 1);
+
+            std::vector<uint32_t> bits;
+
+            if(GetTag(ifd, TIFF_TAG_BITS_PER_SAMPLE, &bits) && std::any_of(bits.begin(), bits.end(), [&](uint32_t b) { return b != mBitsPerSample; })) {
+                TE_ERR("Mixed bits per sample are not supported: " << path)
+
+                return false;
+            }
+
+            if(mWidth == 0 || mHeight == 0 || mSamplesPerPixel == 0) {
+                TE_ERR("Invalid TIFF image size: " << path)
+
+                return false;
+            }
+
+            if(mBitsPerSample != 8 && mBitsPerSample != 16 && mBitsPerSample != 32 && mBitsPerSample != 64) {
+                TE_ERR("Unsupported TIFF bits per sample " << mBitsPerSample << ": " << path)
+
+                return false;
+            }
+
+            if(mCompression != TIFF_COMPRESSION_NONE && mCompression != TIFF_COMPRESSION_LZW && mCompression != TIFF_COMPRESSION_PACKBITS) {
+                TE_ERR("Unsupported TIFF compression " << mCompression << ": " << path)
+
+                return false;
+            }
+
+            if(mPredictor < TIFF_PREDICTOR_NONE || mPredictor > TIFF_PREDICTOR_FLOAT || (mPredictor == TIFF_PREDICTOR_FLOAT && mSampleFormat != TIFF_SAMPLE_FLOAT)) {
+                TE_ERR("Unsupported TIFF predictor " << mPredictor << ": " << path)
 
-            std::vector<uint8_t> source;
-            source.resize(len);
+                return false;
+            }
+
+            if(mPlanarConfig != TIFF_PLANAR_CHUNKY && mPlanarConfig != TIFF_PLANAR_SEPARATE) {
+                TE_ERR("Unsupported TIFF planar configuration " << mPlanarConfig << ": " << path)
+
+                return false;
+            }
 
-            file.read((char*)source.data(), source.size());
+            mTiled = GetTag(ifd, TIFF_TAG_TILE_OFFSETS, &mTileOffsets);
 
-            file.close();
+            if(mTiled) {
+                mTileWidth = GetTagValue(ifd, TIFF_TAG_TILE_WIDTH, 0);
+                mTileHeight = GetTagValue(ifd, TIFF_TAG_TILE_LENGTH, 0);
 
-            if(source[0] == 0x49) {
-                mLittleEndian = true;
-                mOffset = source[4] | source[5] << 8 | source[6] << 16 | source[7] << 24;
+                GetTag(ifd, TIFF_TAG_TILE_BYTE_COUNTS, &mTileByteCounts);
             }
             else {
-                mLittleEndian = false;
-                mOffset = source[7] | source[6] << 8 | source[5] << 16 | source[4] << 24;
+                GetTag(ifd, TIFF_TAG_STRIP_OFFSETS, &mTileOffsets);
+                GetTag(ifd, TIFF_TAG_STRIP_BYTE_COUNTS, &mTileByteCounts);
+
+                mTileWidth = mWidth;
+                mTileHeight = std::min(GetTagValue(ifd, TIFF_TAG_ROWS_PER_STRIP, mHeight), mHeight);
+            }
+
+            if(mTileWidth == 0 || mTileHeight == 0) {
+                TE_ERR("Invalid TIFF tile size: " << path)
+
+                return false;
             }
+
+            mTilesAcross = (mWidth + mTileWidth - 1) / mTileWidth;
+            mTilesDown = (mHeight + mTileHeight - 1) / mTileHeight;
+
+            const size_t chunks = (size_t)GetTileCount() * (mPlanarConfig == TIFF_PLANAR_SEPARATE ? mSamplesPerPixel : 1);
+
+            if(mTileOffsets.size() < chunks || mTileByteCounts.size() < chunks) {
+                TE_ERR("Missing TIFF strip/tile offsets or byte counts: " << path)
+
+                return false;
+            }
+
+            mColorMap.clear();
+
+            if(mPhotometric == 3) {
+                std::vector<uint32_t> map;
+                GetTag(ifd, TIFF_TAG_COLOR_MAP, &map);
+
+                mColorMap.assign(map.begin(), map.end());
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Decompress one strip/tile of one plane into rows of pOut, fixing byte order and undoing predictor
+         *
+         * @param chunk index into mTileOffsets
+         * @param pOut
+         * @param rows rows stored in chunk
+         * @return true on success
+         */
+        bool DecodeChunk(size_t chunk, uint8_t* pOut, uint32_t rows) {
+            const size_t sample_size = mBitsPerSample / 8;
+            const size_t samples = mPlanarConfig == TIFF_PLANAR_SEPARATE ? 1 : mSamplesPerPixel;
+            const size_t row_samples = (size_t)mTileWidth * samples;
+            const size_t expected = row_samples * sample_size * rows;
+
+            const size_t offset = mTileOffsets[chunk];
+            const size_t size = std::min<size_t>(mTileByteCounts[chunk], offset < mFile.size ? mFile.size - offset : 0);
+            const uint8_t* in = mFile.data + offset;
+
+            size_t written = 0;
+            bool error = false;
+
+            switch(mCompression) {
+            case TIFF_COMPRESSION_NONE:
+                written = std::min(size, expected);
+                memcpy(pOut, in, written);
+                break;
+
+            case TIFF_COMPRESSION_LZW:
+                written = TIFFDecodeLZW(in, size, pOut, expected, &error);
+                break;
+
+            case TIFF_COMPRESSION_PACKBITS:
+                written = TIFFDecodePackBits(in, size, pOut, expected);
+                break;
+            }
+
+            if(error) return false;
+
+            // Short strips are padded like libtiff does
+            if(written < expected) memset(pOut + written, 0, expected - written);
+
+            if(mPredictor == TIFF_PREDICTOR_FLOAT) {
+                // Bytes of each row are split into planes (most significant first) and differenced as bytes
+                std::vector<uint8_t> row(row_samples * sample_size);
+
+                for(uint32_t y = 0; y < rows; y++) {
+                    uint8_t* dst = pOut + y * row.size();
+
+                    TIFFUndoHorizontal(dst, row.size(), samples);
+                    memcpy(row.data(), dst, row.size());
+
+                    for(size_t i = 0; i < row_samples; i++) {
+                        for(size_t b = 0; b < sample_size; b++) {
+                            const size_t byte = std::endian::native == std::endian::little ? sample_size - 1 - b : b;
+
+                            dst[i * sample_size + byte] = row[b * row_samples + i];
+                        }
+                    }
+                }
+
+                return true;
+            }
+
+            if(sample_size > 1 && mLittleEndian != (std::endian::native == std::endian::little)) {
+                switch(sample_size) {
+                case 2: TIFFByteSwap((uint16_t*)pOut, expected / 2); break;
+                case 4: TIFFByteSwap((uint32_t*)pOut, expected / 4); break;
+                case 8: TIFFByteSwap((uint64_t*)pOut, expected / 8); break;
+                }
+            }
+
+            if(mPredictor == TIFF_PREDICTOR_HORIZONTAL) {
+                for(uint32_t y = 0; y < rows; y++) {
+                    switch(sample_size) {
+                    case 1: TIFFUndoHorizontal(pOut + y * row_samples, row_samples, samples); break;
+                    case 2: TIFFUndoHorizontal((uint16_t*)pOut + y * row_samples, row_samples, samples); break;
+                    case 4: TIFFUndoHorizontal((uint32_t*)pOut + y * row_samples, row_samples, samples); break;
+                    case 8: TIFFUndoHorizontal((uint64_t*)pOut + y * row_samples, row_samples, samples); break;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Decode tile (all planes) and store cols x rows pixels of it into pOut
+         *
+         * @param index tile index, row major
+         * @param pOut first pixel of destination
+         * @param outStride destination row size in bytes
+         * @param cols
+         * @param rows
+         * @param scratch reused between calls
+         * @return true on success
+         */
+        bool DecodeTile(uint32_t index, uint8_t* pOut, size_t outStride, uint32_t cols, uint32_t rows, std::vector<uint8_t>& scratch) {
+            const size_t pixel = GetPixelSize();
+            // Tiles are always stored whole, strips only have rows that are in image
+            const uint32_t stored_rows = mTiled ? mTileHeight : rows;
+
+            if(mPlanarConfig == TIFF_PLANAR_CHUNKY) {
+                // Straight into destination when rows are contiguous there (strips, ReadTile)
+                if(cols == mTileWidth && outStride == cols * pixel && stored_rows == rows) {
+                    return DecodeChunk(index, pOut, rows);
+                }
+
+                scratch.resize((size_t)mTileWidth * stored_rows * pixel);
+
+                if(!DecodeChunk(index, scratch.data(), stored_rows)) return false;
+
+                for(uint32_t y = 0; y < rows; y++) {
+                    memcpy(pOut + y * outStride, scratch.data() + (size_t)y * mTileWidth * pixel, cols * pixel);
+                }
+
+                return true;
+            }
+
+            const size_t sample_size = mBitsPerSample / 8;
+
+            scratch.resize((size_t)mTileWidth * stored_rows * sample_size);
+
+            for(uint16_t s = 0; s < mSamplesPerPixel; s++) {
+                if(!DecodeChunk((size_t)s * GetTileCount() + index, scratch.data(), stored_rows)) return false;
+
+                for(uint32_t y = 0; y < rows; y++) {
+                    const uint8_t* src = scratch.data() + (size_t)y * mTileWidth * sample_size;
+                    uint8_t* dst = pOut + y * outStride + s * sample_size;
+
+                    for(uint32_t x = 0; x < cols; x++) {
+                        memcpy(dst + x * pixel, src + x * sample_size, sample_size);
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Decode single tile (or strip) of opened image without touching the rest of file
+         *
+         * @param index tile index, row major, tileY * mTilesAcross + tileX
+         * @param pOut receives mTileWidth x mTileHeight pixels, rows past bottom of image in last strip are zeroed
+         * @return true on success
+         */
+        bool ReadTile(uint32_t index, std::vector<uint8_t>* pOut) {
+            if(!mFile.data || index >= GetTileCount()) {
+                TE_ERR("Invalid TIFF tile " << index)
+
+                return false;
+            }
+
+            pOut->assign(GetTileSize(), 0);
+
+            const uint32_t rows = mTiled ? mTileHeight : std::min(mTileHeight, mHeight - (index / mTilesAcross) * mTileHeight);
+
+            std::vector<uint8_t> scratch;
+
+            return DecodeTile(index, pOut->data(), mTileWidth * GetPixelSize(), mTileWidth, rows, scratch);
+        }
+
+        /**
+         * @brief Load whole image into mPixels, independent strips/tiles are decoded in parallel
+         *
+         * @param path
+         * @param threadCount 0 for all hardware threads
+         * @param image IFD index
+         * @return true on success
+         */
+        bool Load(std::string path, uint32_t threadCount = 0, uint32_t image = 0) {
+            if(!Open(path, image)) return false;
+
+            const size_t pixel = GetPixelSize();
+            const uint32_t tiles = GetTileCount();
+
+            mPixels.resize((size_t)mWidth * mHeight * pixel);
+
+            std::atomic<uint32_t> next_tile = 0;
+            std::atomic<bool> failed = false;
+
+            auto worker = [&]() {
+                std::vector<uint8_t> scratch;
+
+                for(uint32_t t = next_tile++; t < tiles && !failed.load(std::memory_order_relaxed); t = next_tile++) {
+                    const uint32_t x = (t % mTilesAcross) * mTileWidth;
+                    const uint32_t y = (t / mTilesAcross) * mTileHeight;
+
+                    uint8_t* dst = mPixels.data() + ((size_t)y * mWidth + x) * pixel;
+
+                    if(!DecodeTile(t, dst, mWidth * pixel, std::min(mTileWidth, mWidth - x), std::min(mTileHeight, mHeight - y), scratch)) {
+                        failed = true;
+                    }
+                }
+            };
+
+            if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+            std::vector<std::thread> workers;
+
+            for(uint32_t i = 1; i < std::min(threadCount, tiles); i++) {
+                workers.emplace_back(worker);
+            }
+
+            worker();
+
+            for(std::thread& w : workers) w.join();
+
+            if(failed) {
+                TE_ERR("Corrupted TIFF data: " << path)
+
+                mPixels.clear();
+
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Convert loaded mPixels to RGBA8 (top row first). Gray, gray + alpha, RGB, RGBA and palette images are
+         * supported; 16 bit samples keep their high byte and float samples are clamped to [0, 1]
+         *
+         * @param pOut
+         * @return true on success
+         */
+        bool ConvertToRGBA8(std::vector<uint8_t>* pOut) {
+            const size_t count = (size_t)mWidth * mHeight;
+
+            if(mPixels.size() != count * GetPixelSize() || mSampleFormat == TIFF_SAMPLE_INT) {
+                TE_ERR("Cannot convert TIFF to RGBA8")
+
+                return false;
+            }
+
+            const bool palette = mPhotometric == 3 && mSamplesPerPixel == 1 && mBitsPerSample <= 16 && mColorMap.size() >= 3u << mBitsPerSample;
+
+            auto sample = [&](size_t i) -> uint32_t {
+                switch(mBitsPerSample) {
+                case 8: return mPixels[i];
+                case 16: { uint16_t v; memcpy(&v, mPixels.data() + i * 2, 2); return palette ? v : v >> 8; }
+                case 32:
+                    if(mSampleFormat == TIFF_SAMPLE_FLOAT) { float v; memcpy(&v, mPixels.data() + i * 4, 4); return (uint32_t)(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); }
+                    else { uint32_t v; memcpy(&v, mPixels.data() + i * 4, 4); return v >> 24; }
+                default:
+                    if(mSampleFormat == TIFF_SAMPLE_FLOAT) { double v; memcpy(&v, mPixels.data() + i * 8, 8); return (uint32_t)(std::clamp(v, 0.0, 1.0) * 255.0 + 0.5); }
+                    else { uint64_t v; memcpy(&v, mPixels.data() + i * 8, 8); return (uint32_t)(v >> 56); }
+                }
+            };
+
+            pOut->resize(count * 4);
+
+            uint8_t* out = pOut->data();
+            const size_t spp = mSamplesPerPixel;
+            const size_t palette_size = palette ? (size_t)1 << mBitsPerSample : 0;
+
+            for(size_t i = 0; i < count; i++) {
+                if(palette) {
+                    const size_t index = sample(i);
+
+                    out[i * 4 + 0] = (uint8_t)(mColorMap[index] >> 8);
+                    out[i * 4 + 1] = (uint8_t)(mColorMap[palette_size + index] >> 8);
+                    out[i * 4 + 2] = (uint8_t)(mColorMap[palette_size * 2 + index] >> 8);
+                    out[i * 4 + 3] = 255;
+                }
+                else if(spp < 3) {
+                    uint8_t gray = (uint8_t)sample(i * spp);
+
+                    // WhiteIsZero
+                    if(mPhotometric == 0) gray = 255 - gray;
+
+                    out[i * 4 + 0] = out[i * 4 + 1] = out[i * 4 + 2] = gray;
+                    out[i * 4 + 3] = spp == 2 ? (uint8_t)sample(i * spp + 1) : 255;
+                }
+                else {
+                    out[i * 4 + 0] = (uint8_t)sample(i * spp);
+                    out[i * 4 + 1] = (uint8_t)sample(i * spp + 1);
+                    out[i * 4 + 2] = (uint8_t)sample(i * spp + 2);
+                    out[i * 4 + 3] = spp >= 4 ? (uint8_t)sample(i * spp + 3) : 255;
+                }
+            }
+
+            return true;
         }
 
     } TIFF;
 }
 
-#endif
\ No newline at end of file
+#endif
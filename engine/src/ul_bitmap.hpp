@@ -2,11 +2,13 @@
  * @file ul_bitmap.hpp
  * @author Piotr "UjemnyGH" Plombon
  * @brief Loads bitmap images (C++ warp)
- * @version 0.1
+ * @version 0.2
  * @date 2024-03-12
- * 
+ *
  * @copyright Copyleft (c) 2024
- * 
+ *
+ * Supports 1/4/8 bit palettized, 16 bit (555, 565 or bitfields), 24 bit and 32 bit (BGRA or bitfields) images, both
+ * bottom-up and top-down. Output is always RGBA8 with top row first, same as PNG and TIFF loaders
  */
 
 #pragma once
@@ -16,7 +18,16 @@
 #include <vector>
 #include <cstdint>
 #include <string>
-#include <fstream>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include "ul_mapped_file.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// Shuffle kernels are compiled for SSSE3/AVX2 regardless of -m flags and picked at runtime
+#define UL_BITMAP_X86_DISPATCH
+#endif
 
 // Offsets
 #define DONT_CARE_OFFSET        0xd
@@ -24,6 +35,11 @@
 #define BM_WIDTH                0x12
 #define BM_HEIGHT               0x16
 #define BM_BITS_PER_PIXEL       0x1c
+#define BM_PIXEL_OFFSET         0xa
+#define BM_PLANES               0x1a
+#define BM_COMPRESSION          0x1e
+#define BM_COLORS_USED          0x2e
+#define BM_BITFIELDS            0x36
 
 // Values
 #define BM_BPP_1                0x1
@@ -33,82 +49,375 @@
 #define BM_BPP_24               0x18
 #define BM_BPP_32               0x20
 
-std::vector<uint8_t> ulLoadBitmapFromFile(std::string filename, uint32_t* w, uint32_t* h, bool recieveSizes = true) {
-    *w = 0;
-    *h = 0;
+#define BM_CORE_HEADER_SIZE     0xc
+#define BM_INFO_HEADER_SIZE     0x28
 
-    uint32_t headerSize = 0;
-    uint32_t *width = w, *height = h;
-    uint16_t bitsPerPixel = 0;
+#define BM_BI_RGB               0x0
+#define BM_BI_BITFIELDS         0x3
+#define BM_BI_ALPHABITFIELDS    0x6
 
-    std::ifstream f(filename, std::ios_base::binary);
+static inline uint32_t __ulBitmapRead16(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8; }
+static inline uint32_t __ulBitmapRead32(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
 
-    f.seekg(HEADER_SIZE, std::ios_base::beg);
+typedef struct ul_bitmap_channel_s {
+    uint32_t mask, shift, bits;
+} ul_bitmap_channel_t;
 
-    for(uint32_t i = 0; i < 4; i++) {
-        uint32_t cc = f.get();
+static inline ul_bitmap_channel_t __ulBitmapChannel(uint32_t mask) {
+    ul_bitmap_channel_t channel = { mask, 0, 0 };
+
+    if(mask == 0) return channel;
+
+    while(!((mask >> channel.shift) & 1)) channel.shift++;
+    while(channel.shift + channel.bits < 32 && ((mask >> (channel.shift + channel.bits)) & 1)) channel.bits++;
+
+    return channel;
+}
 
-        headerSize |= cc << (i * 8);
+// Scale masked channel to 8 bits, short channels repeat their bits so full intensity stays 255
+static inline uint8_t __ulBitmapExpand(uint32_t pixel, const ul_bitmap_channel_t* pChannel, uint8_t missing) {
+    if(pChannel->bits == 0) return missing;
+
+    uint32_t v = (pixel & pChannel->mask) >> pChannel->shift;
+
+    if(pChannel->bits >= 8) return (uint8_t)(v >> (pChannel->bits - 8));
+
+    uint32_t result = 0;
+
+    for(int32_t filled = 8; filled > 0; filled -= (int32_t)pChannel->bits) {
+        result |= filled >= (int32_t)pChannel->bits ? v << (filled - pChannel->bits) : v >> (pChannel->bits - filled);
     }
 
-    if(recieveSizes) {
-        f.seekg(BM_WIDTH, std::ios_base::beg);
+    return (uint8_t)result;
+}
 
-        for(uint32_t i = 0; i < 4; i++) {
-            uint32_t cc = f.get();
+static void __ulBitmapRowBGR24Scalar(uint8_t* dst, const uint8_t* src, uint32_t count) {
+    for(uint32_t x = 0; x < count; x++) {
+        dst[x * 4 + 0] = src[x * 3 + 2];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 0];
+        dst[x * 4 + 3] = 0xff;
+    }
+}
 
-            *width |= cc << (i * 8);
-        }
+static void __ulBitmapRowBGRA32Scalar(uint8_t* dst, const uint8_t* src, uint32_t count) {
+    for(uint32_t x = 0; x < count; x++) {
+        dst[x * 4 + 0] = src[x * 4 + 2];
+        dst[x * 4 + 1] = src[x * 4 + 1];
+        dst[x * 4 + 2] = src[x * 4 + 0];
+        dst[x * 4 + 3] = src[x * 4 + 3];
+    }
+}
+
+#ifdef UL_BITMAP_X86_DISPATCH
+__attribute__((target("ssse3"))) static void __ulBitmapRowBGR24SSSE3(uint8_t* dst, const uint8_t* src, uint32_t count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    uint32_t x = 0;
+
+    // 16 byte load covers 4 pixels and 4 bytes of next ones, stay 2 pixels away from row end so it never reads past it
+    for(; x + 6 <= count; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + x * 3));
+
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+
+    __ulBitmapRowBGR24Scalar(dst + x * 4, src + x * 3, count - x);
+}
+
+__attribute__((target("ssse3"))) static void __ulBitmapRowBGRA32SSSE3(uint8_t* dst, const uint8_t* src, uint32_t count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    uint32_t x = 0;
+
+    for(; x + 4 <= count; x += 4) {
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + x * 4)), shuffle));
+    }
+
+    __ulBitmapRowBGRA32Scalar(dst + x * 4, src + x * 4, count - x);
+}
 
-        f.seekg(BM_HEIGHT, std::ios_base::beg);
+__attribute__((target("avx2"))) static void __ulBitmapRowBGR24AVX2(uint8_t* dst, const uint8_t* src, uint32_t count) {
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+    uint32_t x = 0;
 
-        for(uint32_t i = 0; i < 4; i++) {
-            uint32_t cc = f.get();
+    // Every lane gets its own 4 pixels from separate 16 byte load
+    for(; x + 10 <= count; x += 8) {
+        __m256i pixels = _mm256_loadu2_m128i((const __m128i*)(src + x * 3 + 12), (const __m128i*)(src + x * 3));
 
-            *height |= cc << (i * 8);
+        _mm256_storeu_si256((__m256i*)(dst + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+    }
+
+    __ulBitmapRowBGR24Scalar(dst + x * 4, src + x * 3, count - x);
+}
+
+__attribute__((target("avx2"))) static void __ulBitmapRowBGRA32AVX2(uint8_t* dst, const uint8_t* src, uint32_t count) {
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    uint32_t x = 0;
+
+    for(; x + 8 <= count; x += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + x * 4), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + x * 4)), shuffle));
+    }
+
+    __ulBitmapRowBGRA32Scalar(dst + x * 4, src + x * 4, count - x);
+}
+#endif
+
+typedef void (*ul_bitmap_row_fn)(uint8_t* dst, const uint8_t* src, uint32_t count);
+
+static ul_bitmap_row_fn __ulBitmapPickRowBGR24() {
+#ifdef UL_BITMAP_X86_DISPATCH
+    if(__builtin_cpu_supports("avx2")) return __ulBitmapRowBGR24AVX2;
+    if(__builtin_cpu_supports("ssse3")) return __ulBitmapRowBGR24SSSE3;
+#endif
+
+    return __ulBitmapRowBGR24Scalar;
+}
+
+static ul_bitmap_row_fn __ulBitmapPickRowBGRA32() {
+#ifdef UL_BITMAP_X86_DISPATCH
+    if(__builtin_cpu_supports("avx2")) return __ulBitmapRowBGRA32AVX2;
+    if(__builtin_cpu_supports("ssse3")) return __ulBitmapRowBGRA32SSSE3;
+#endif
+
+    return __ulBitmapRowBGRA32Scalar;
+}
+
+/**
+ * @brief Decode bitmap from memory into RGBA8, top row first
+ *
+ * @param data whole .bmp file
+ * @param size size of data
+ * @param pResult output pixels, width * height * 4 bytes
+ * @param pWidth output width
+ * @param pHeight output height
+ * @return int 1 on success, 0 on unsupported or broken file
+ */
+int ulDecodeBitmap(const uint8_t* data, size_t size, std::vector<uint8_t>* pResult, uint32_t* pWidth, uint32_t* pHeight) {
+    if(size < HEADER_SIZE + 4 || data[0] != 'B' || data[1] != 'M') {
+        printf("Not a bitmap file!\n");
+
+        return 0;
+    }
+
+    const uint32_t pixel_offset = __ulBitmapRead32(data + BM_PIXEL_OFFSET);
+    const uint32_t header_size = __ulBitmapRead32(data + HEADER_SIZE);
+
+    if(header_size < BM_CORE_HEADER_SIZE || HEADER_SIZE + (size_t)header_size > size) {
+        printf("Broken bitmap header!\n");
+
+        return 0;
+    }
+
+    int64_t width, height;
+    uint32_t bits_per_pixel, compression = BM_BI_RGB, colors_used = 0;
+    uint32_t palette_entry_size = 4;
+
+    if(header_size == BM_CORE_HEADER_SIZE) {
+        // OS/2 header, 16 bit sizes and 3 byte palette entries
+        width = __ulBitmapRead16(data + BM_WIDTH);
+        height = __ulBitmapRead16(data + BM_WIDTH + 2);
+        bits_per_pixel = __ulBitmapRead16(data + BM_WIDTH + 6);
+        palette_entry_size = 3;
+    }
+    else {
+        if(header_size < BM_INFO_HEADER_SIZE) {
+            printf("Broken bitmap header!\n");
+
+            return 0;
         }
+
+        width = (int32_t)__ulBitmapRead32(data + BM_WIDTH);
+        height = (int32_t)__ulBitmapRead32(data + BM_HEIGHT);
+        bits_per_pixel = __ulBitmapRead16(data + BM_BITS_PER_PIXEL);
+        compression = __ulBitmapRead32(data + BM_COMPRESSION);
+        colors_used = __ulBitmapRead32(data + BM_COLORS_USED);
     }
 
-    f.seekg(BM_BITS_PER_PIXEL, std::ios_base::beg);
+    const int top_down = height < 0;
 
-    for(uint32_t i = 0; i < 2; i++) {
-        uint32_t cc = f.get();
+    if(top_down) height = -height;
 
-        bitsPerPixel |= cc << (i * 8);
+    if(width <= 0 || height <= 0 || width > 0xffff * 4 || height > 0xffff * 4) {
+        printf("Bitmap has invalid size!\n");
+
+        return 0;
     }
 
-    f.seekg(headerSize + DONT_CARE_OFFSET + 1, std::ios_base::beg);
+    if(compression != BM_BI_RGB && compression != BM_BI_BITFIELDS && compression != BM_BI_ALPHABITFIELDS) {
+        printf("Compressed bitmaps are not supported!\n");
 
-    std::vector<uint8_t> result;
-    uint32_t bytesCounter = (bitsPerPixel / 8) - 1;
+        return 0;
+    }
+
+    // Rows are padded to 4 bytes
+    const size_t row_size = (((size_t)width * bits_per_pixel + 31) / 32) * 4;
+
+    if(pixel_offset > size || row_size * (size_t)height > size - pixel_offset) {
+        printf("Bitmap pixel data is cut off!\n");
+
+        return 0;
+    }
+
+    const uint32_t w = (uint32_t)width, h = (uint32_t)height;
+    const uint8_t* pixels = data + pixel_offset;
+
+    pResult->resize((size_t)w * h * 4);
+
+    // Output row y comes from file row y for top-down files, from the mirrored one for bottom-up (most of them)
+    auto source_row = [&](uint32_t y) { return pixels + (size_t)(top_down ? y : h - 1 - y) * row_size; };
+    auto dest_row = [&](uint32_t y) { return pResult->data() + (size_t)y * w * 4; };
+
+    if(bits_per_pixel == BM_BPP_1 || bits_per_pixel == BM_BPP_4 || bits_per_pixel == BM_BPP_8) {
+        const uint32_t max_colors = 1u << bits_per_pixel;
+        const uint32_t palette_size = colors_used == 0 || colors_used > max_colors ? max_colors : colors_used;
+        const size_t palette_offset = HEADER_SIZE + header_size;
+        const uint32_t available = palette_offset < size ? (uint32_t)std::min<size_t>((size - palette_offset) / palette_entry_size, palette_size) : 0;
+
+        // Missing entries stay opaque black, broken files still decode
+        uint32_t palette[256];
+
+        for(uint32_t i = 0; i < 256; i++) palette[i] = 0xff000000u;
+
+        for(uint32_t i = 0; i < available; i++) {
+            const uint8_t* entry = data + palette_offset + (size_t)i * palette_entry_size;
+
+            palette[i] = (uint32_t)entry[2] | (uint32_t)entry[1] << 8 | (uint32_t)entry[0] << 16 | 0xff000000u;
+        }
+
+        const uint32_t pixel_mask = max_colors - 1;
+        const uint32_t pixels_per_byte = 8 / bits_per_pixel;
+
+        for(uint32_t y = 0; y < h; y++) {
+            const uint8_t* src = source_row(y);
+            uint8_t* dst = dest_row(y);
+
+            if(bits_per_pixel == BM_BPP_8) {
+                for(uint32_t x = 0; x < w; x++) memcpy(dst + x * 4, &palette[src[x]], 4);
+
+                continue;
+            }
+
+            // Leftmost pixel sits in highest bits
+            for(uint32_t x = 0; x < w; x++) {
+                const uint32_t shift = 8 - bits_per_pixel * (x % pixels_per_byte + 1);
+
+                memcpy(dst + x * 4, &palette[(src[x / pixels_per_byte] >> shift) & pixel_mask], 4);
+            }
+        }
+    }
+    else if(bits_per_pixel == BM_BPP_16 || bits_per_pixel == BM_BPP_32) {
+        uint32_t masks[4];
+
+        if(compression == BM_BI_RGB) {
+            // Defaults are 555 for 16 bit and BGRX for 32 bit
+            masks[0] = bits_per_pixel == BM_BPP_16 ? 0x7c00u : 0x00ff0000u;
+            masks[1] = bits_per_pixel == BM_BPP_16 ? 0x03e0u : 0x0000ff00u;
+            masks[2] = bits_per_pixel == BM_BPP_16 ? 0x001fu : 0x000000ffu;
+            masks[3] = bits_per_pixel == BM_BPP_16 ? 0 : 0xff000000u;
+        }
+        else {
+            // Masks follow info header or are part of bigger (V4/V5) header
+            const size_t mask_count = compression == BM_BI_ALPHABITFIELDS || header_size >= 56 ? 4 : 3;
+
+            if(BM_BITFIELDS + mask_count * 4 > size) {
+                printf("Broken bitmap header!\n");
 
-    uint8_t bytes[4] = {0, 0, 0, 0};
+                return 0;
+            }
+
+            for(size_t i = 0; i < 4; i++) masks[i] = i < mask_count ? __ulBitmapRead32(data + BM_BITFIELDS + i * 4) : 0;
+        }
+
+        if(bits_per_pixel == BM_BPP_32 && masks[0] == 0x00ff0000u && masks[1] == 0x0000ff00u && masks[2] == 0x000000ffu && (masks[3] == 0xff000000u || masks[3] == 0)) {
+            const ul_bitmap_row_fn convert = __ulBitmapPickRowBGRA32();
+            uint32_t alpha_or = 0;
 
-    while(!f.eof()) {
-        uint32_t cc = f.get();
+            for(uint32_t y = 0; y < h; y++) {
+                uint8_t* dst = dest_row(y);
 
-        bytes[bytesCounter] = cc;
+                convert(dst, source_row(y), w);
 
-        if(bytesCounter == 0) {
-            bytesCounter = (bitsPerPixel / 8);
-            for(uint32_t i = 0; i < (bitsPerPixel / 8); i++) {
-                result.push_back(bytes[i]);
+                for(uint32_t x = 0; x < w; x++) alpha_or |= dst[x * 4 + 3];
             }
 
-            if((bitsPerPixel / 8) == 3) {
-                result.push_back(0xff);
+            // Plenty of writers leave X of BGRX at zero, treat image without any alpha as opaque
+            if(masks[3] == 0 || alpha_or == 0) {
+                for(size_t i = 3; i < pResult->size(); i += 4) (*pResult)[i] = 0xff;
             }
         }
+        else {
+            ul_bitmap_channel_t channels[4];
 
-        if(bytesCounter > 0) {
-            bytesCounter--;
+            for(int i = 0; i < 4; i++) channels[i] = __ulBitmapChannel(masks[i]);
+
+            for(uint32_t y = 0; y < h; y++) {
+                const uint8_t* src = source_row(y);
+                uint8_t* dst = dest_row(y);
+
+                for(uint32_t x = 0; x < w; x++) {
+                    const uint32_t pixel = bits_per_pixel == BM_BPP_16 ? __ulBitmapRead16(src + x * 2) : __ulBitmapRead32(src + x * 4);
+
+                    dst[x * 4 + 0] = __ulBitmapExpand(pixel, &channels[0], 0);
+                    dst[x * 4 + 1] = __ulBitmapExpand(pixel, &channels[1], 0);
+                    dst[x * 4 + 2] = __ulBitmapExpand(pixel, &channels[2], 0);
+                    dst[x * 4 + 3] = __ulBitmapExpand(pixel, &channels[3], 0xff);
+                }
+            }
         }
+    }
+    else if(bits_per_pixel == BM_BPP_24) {
+        const ul_bitmap_row_fn convert = __ulBitmapPickRowBGR24();
+
+        for(uint32_t y = 0; y < h; y++) convert(dest_row(y), source_row(y), w);
+    }
+    else {
+        printf("Unsupported bitmap bit depth %u!\n", bits_per_pixel);
 
+        return 0;
+    }
+
+    *pWidth = w;
+    *pHeight = h;
+
+    return 1;
+}
+
+/**
+ * @brief Load bitmap file as RGBA8, top row first
+ *
+ * @param filename path to .bmp file
+ * @param w output width
+ * @param h output height
+ * @param recieveSizes when false w and h are left at 0
+ * @return std::vector<uint8_t> pixels, empty on failure
+ */
+std::vector<uint8_t> ulLoadBitmapFromFile(std::string filename, uint32_t* w, uint32_t* h, bool recieveSizes = true) {
+    *w = 0;
+    *h = 0;
+
+    std::vector<uint8_t> result;
+    ul_mapped_file_t file;
+
+    if(!ulMapFile(&file, filename.c_str())) {
+        printf("Cannot open bitmap file!\n");
+
+        return result;
+    }
+
+    uint32_t width = 0, height = 0;
+
+    if(!ulDecodeBitmap(file.data, file.size, &result, &width, &height)) {
+        result.clear();
+    }
+    else if(recieveSizes) {
+        *w = width;
+        *h = height;
     }
 
-    f.close();
+    ulUnmapFile(&file);
 
     return result;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file ul_hash.hpp
+ * @author Piotr "UjemnyGH" Plombon
+ * @brief Fast stable 64 bit hash of memory and files
+ * @version 0.1
+ * @date 2024-03-10
+ *
+ * @copyright Copyleft (c) 2024
+ *
+ * Used as content hash and cache key by mesh (.twm), texture (.twt) and shader program caches
+ */
+
+#pragma once
+#ifndef _UL_HASH_
+#define _UL_HASH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "ul_mapped_file.hpp"
+
+/**
+ * @brief 64 bit hash of memory, 4 independent lanes of 8 bytes so it runs close to memory speed. Stable between runs and
+ * platforms, so it can be stored in files
+ *
+ * @param data memory to hash
+ * @param size size of memory in bytes
+ * @param seed initial value
+ * @return uint64_t hash
+ */
+uint64_t ulHash64(const void* data, size_t size, uint64_t seed) {
+    const uint64_t prime_1 = 0x9e3779b185ebca87ULL;
+    const uint64_t prime_2 = 0xc2b2ae3d27d4eb4fULL;
+
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+
+    uint64_t lanes[4] = { seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1 };
+
+    while(end - p >= 32) {
+        for(int i = 0; i < 4; i++) {
+            uint64_t word;
+            memcpy(&word, p + i * 8, 8);
+
+            lanes[i] += word * prime_2;
+            lanes[i] = (lanes[i] << 31) | (lanes[i] >> 33);
+            lanes[i] *= prime_1;
+        }
+
+        p += 32;
+    }
+
+    uint64_t h = ((lanes[0] << 1) | (lanes[0] >> 63)) + ((lanes[1] << 7) | (lanes[1] >> 57)) + ((lanes[2] << 12) | (lanes[2] >> 52)) + ((lanes[3] << 18) | (lanes[3] >> 46));
+    h += (uint64_t)size;
+
+    while(end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+
+        h ^= ((word * prime_2) << 31 | (word * prime_2) >> 33) * prime_1;
+        h = ((h << 27) | (h >> 37)) * prime_1 + prime_2;
+        p += 8;
+    }
+
+    while(p < end) {
+        h ^= (uint64_t)(*p) * prime_1;
+        h = ((h << 11) | (h >> 53)) * prime_2;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= prime_2;
+    h ^= h >> 29;
+    h *= prime_1;
+    h ^= h >> 32;
+
+    return h;
+}
+
+/**
+ * @brief Hash whole file
+ *
+ * @param path path to file
+ * @param pHash output hash
+ * @return int 1 on success, 0 when file can`t be opened
+ */
+int ulHashFile(const char* path, uint64_t* pHash) {
+    ul_mapped_file_t file;
+
+    if(!ulMapFile(&file, path)) return 0;
+
+    *pHash = ulHash64(file.data, file.size, 0);
+
+    ulUnmapFile(&file);
+
+    return 1;
+}
+
+#endif
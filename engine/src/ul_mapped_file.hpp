@@ -0,0 +1,167 @@
+/**
+ * @file ul_mapped_file.hpp
+ * @author Piotr "UjemnyGH" Plombon
+ * @brief Read only memory mapped files for loaders
+ * @version 0.1
+ * @date 2024-03-10
+ *
+ * @copyright Copyleft (c) 2024
+ *
+ * Maps whole file into memory so loaders can walk bytes directly without
+ * copying them into temporary buffers first
+ */
+
+#pragma once
+#ifndef _UL_MAPPED_FILE_
+#define _UL_MAPPED_FILE_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <atomic>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Name of temporary file next to path, unique per process and call so writers of same file (threads or
+ * processes) never share one. Write it whole, then rename over path
+ *
+ * @param path final file
+ * @return std::string
+ */
+std::string ulTempPath(const char* path) {
+    static std::atomic<uint32_t> s_counter(0);
+
+#ifdef _WIN32
+    const unsigned long process = (unsigned long)GetCurrentProcessId();
+#else
+    const unsigned long process = (unsigned long)getpid();
+#endif
+
+    return std::string(path) + "." + std::to_string(process) + "." + std::to_string(s_counter++) + ".tmp";
+}
+
+typedef struct ul_mapped_file_s {
+    const uint8_t* data = (const uint8_t*)0;
+    size_t size = 0;
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = (HANDLE)0;
+#else
+    int fd = -1;
+#endif
+} ul_mapped_file_t;
+
+/**
+ * @brief Unmap file mapped with ulMapFile, safe to call on never mapped or already unmapped file
+ *
+ * @param pFile mapped file
+ */
+void ulUnmapFile(ul_mapped_file_t* pFile) {
+#ifdef _WIN32
+    if(pFile->data) UnmapViewOfFile(pFile->data);
+    if(pFile->mapping) CloseHandle(pFile->mapping);
+    if(pFile->file != INVALID_HANDLE_VALUE) CloseHandle(pFile->file);
+
+    pFile->mapping = (HANDLE)0;
+    pFile->file = INVALID_HANDLE_VALUE;
+#else
+    if(pFile->data && pFile->size) munmap((void*)pFile->data, pFile->size);
+    if(pFile->fd >= 0) close(pFile->fd);
+
+    pFile->fd = -1;
+#endif
+
+    pFile->data = (const uint8_t*)0;
+    pFile->size = 0;
+}
+
+/**
+ * @brief Map whole file read only into memory. Empty file maps successfully with data == 0 and size == 0
+ *
+ * @param pFile output mapping, release it with ulUnmapFile
+ * @param path path to file
+ * @return int 1 on success, 0 on failure
+ */
+int ulMapFile(ul_mapped_file_t* pFile, const char* path) {
+    ulUnmapFile(pFile);
+
+#ifdef _WIN32
+    pFile->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, (LPSECURITY_ATTRIBUTES)0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, (HANDLE)0);
+
+    if(pFile->file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER file_size;
+
+    if(!GetFileSizeEx(pFile->file, &file_size)) {
+        ulUnmapFile(pFile);
+
+        return 0;
+    }
+
+    pFile->size = (size_t)file_size.QuadPart;
+
+    if(pFile->size == 0) return 1;
+
+    pFile->mapping = CreateFileMappingA(pFile->file, (LPSECURITY_ATTRIBUTES)0, PAGE_READONLY, 0, 0, (LPCSTR)0);
+
+    if(!pFile->mapping) {
+        ulUnmapFile(pFile);
+
+        return 0;
+    }
+
+    pFile->data = (const uint8_t*)MapViewOfFile(pFile->mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if(!pFile->data) {
+        ulUnmapFile(pFile);
+
+        return 0;
+    }
+#else
+    pFile->fd = open(path, O_RDONLY);
+
+    if(pFile->fd < 0) return 0;
+
+    struct stat file_stat;
+
+    if(fstat(pFile->fd, &file_stat) != 0) {
+        ulUnmapFile(pFile);
+
+        return 0;
+    }
+
+    pFile->size = (size_t)file_stat.st_size;
+
+    if(pFile->size == 0) return 1;
+
+    void* mapped = mmap((void*)0, pFile->size, PROT_READ, MAP_PRIVATE, pFile->fd, 0);
+
+    if(mapped == MAP_FAILED) {
+        pFile->size = 0;
+        ulUnmapFile(pFile);
+
+        return 0;
+    }
+
+    // We walk loaders front to back, let kernel read ahead aggressively
+    madvise(mapped, pFile->size, MADV_SEQUENTIAL);
+
+    pFile->data = (const uint8_t*)mapped;
+#endif
+
+    return 1;
+}
+
+#endif
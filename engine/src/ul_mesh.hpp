@@ -22,6 +22,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <vector>
+#include <string>
+#include <thread>
+#include <span>
+#include "ul_mapped_file.hpp"
+#include "ul_hash.hpp"
+#include "ul_mesh_optimize.hpp"
 
 enum {
     ULMtype_ply,
@@ -31,10 +37,34 @@ enum {
     ULMtype_END_DONT_USE
 };
 
+enum {
+    // Use all hardware threads where loader supports it (currently obj and binary stl)
+    ULMflag_parallel = 0x1,
+    // Deduplicate vertices and fill indices instead of returning triangle soup
+    ULMflag_indexed = 0x2,
+    // Reorder indexed mesh for vertex cache and vertex fetch, implies ULMflag_indexed
+    ULMflag_optimize = 0x4,
+    // Also sort triangle clusters against overdraw, implies ULMflag_optimize
+    ULMflag_optimize_overdraw = 0x8
+};
+
+typedef struct ul_mesh_lod_s {
+    // Indexes same vertex buffers as full mesh
+    std::vector<uint32_t> indices;
+    // Triangle ratio to full mesh and largest surface deviation relative to mesh extent
+    float ratio, error;
+} ul_mesh_lod_t;
+
 typedef struct ul_mesh_s {
     // C implementation
     //float* vertices, *normals, *textureCoordinates;
     std::vector<float> vertices, normals, textureCoordinates;
+    // 3 per triangle when indexed, attributes above are then per unique vertex
+    std::vector<uint32_t> indices;
+    // 1 once attributes are per unique vertex, indices can still be empty (e.g. PLY point cloud), 0 for triangle soup
+    int indexed = 0;
+    // Simplified levels from ulMeshGenerateLODs (ul_mesh_simplify.hpp), most detailed first
+    std::vector<ul_mesh_lod_t> lods;
 } ul_mesh_t;
 
 // Needless
@@ -78,776 +108,1992 @@ size_t ulMeshCopyNumber(char* dst, char* src, size_t size, uint8_t stopVal) {
     return size;
 }
 
-int __ulMeshLoadPLY(ul_mesh_t* pMesh, const char* path) {
-    FILE* mesh_file = fopen(path, "rb+");
+static const double __ulMeshPow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Parse float from text without copying it anywhere first. Short decimals (everything mesh exporters write) are
+ * converted exactly on fast path, rest goes to strtod so result always equals (float)atof() of same text
+ *
+ * @param p first character of number
+ * @param end end of text, parser never reads past it
+ * @param pValue parsed value, 0.0f when there is no number
+ * @return const char* first character after number, p when there was no number
+ */
+const char* ulMeshParseFloat(const char* p, const char* end, float* pValue) {
+    const char* start = p;
+    int negative = 0;
+
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
 
-    fseek(mesh_file, 0, SEEK_END);
-    uint32_t len = ftell(mesh_file);
-    fseek(mesh_file, 0, SEEK_SET);
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    int exact = 1;
+    int any_digit = 0;
 
-    uint8_t *source_buffer = new uint8_t[len]; //(uint8_t*)calloc(len, sizeof(uint8_t));
+    while(p < end && (uint8_t)(*p - '0') < 10) {
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
 
-    fread(source_buffer, sizeof(uint8_t), len, mesh_file);
+            if(mantissa) digits++;
+        }
+        else {
+            exponent++;
+            exact = 0;
+        }
 
-    if(source_buffer[0] != 'p' && source_buffer[1] != 'l' && source_buffer[2] != 'y') {
-        fclose(mesh_file);
+        any_digit = 1;
+        p++;
+    }
 
-        printf("Desired model isn`t ply model!");
+    if(p < end && *p == '.') {
+        p++;
 
-        delete[] source_buffer;
-        //source_buffer = (uint8_t*)0;
+        while(p < end && (uint8_t)(*p - '0') < 10) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
 
-        return 0;
+                if(mantissa) digits++;
+            }
+            else if(*p != '0') {
+                exact = 0;
+            }
+
+            any_digit = 1;
+            p++;
+        }
+    }
+
+    if(!any_digit) {
+        *pValue = 0.0f;
+
+        return start;
     }
 
-    uint8_t* end_header = (uint8_t*)strstr((char*)source_buffer, "end_header");
-    uint8_t* vertex_element = (uint8_t*)strstr((char*)source_buffer, "element vertex ");
-    uint8_t* face_element = (uint8_t*)strstr((char*)source_buffer, "element face ");
-    uint8_t* format = (uint8_t*)strstr((char*)source_buffer, "format ascii 1.0 ");
-    uint8_t* prop_vertices = (uint8_t*)strstr((char*)source_buffer, "property float x\n");
-    uint8_t* prop_normals = (uint8_t*)strstr((char*)source_buffer, "property float nx\n");
-    uint8_t* prop_texpos = (uint8_t*)strstr((char*)source_buffer, "property float s\n");
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        int exp_negative = 0;
+        int exp_value = 0;
+
+        if(e < end && (*e == '-' || *e == '+')) {
+            exp_negative = *e == '-';
+            e++;
+        }
+
+        if(e < end && (uint8_t)(*e - '0') < 10) {
+            while(e < end && (uint8_t)(*e - '0') < 10) {
+                if(exp_value < 10000) exp_value = exp_value * 10 + (*e - '0');
+
+                e++;
+            }
+
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = e;
+        }
+    }
 
-    char number_buffer[256];
+    double value;
 
-    for(uint8_t* i = vertex_element; i < vertex_element + 256; i++) {
-        if(vertex_element[16 + (i - vertex_element)] == '\n') break;
+    if(exact && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        // Both operands are exact doubles, so single IEEE multiply/divide is correctly rounded
+        value = (double)mantissa;
+        value = exponent < 0 ? value / __ulMeshPow10[-exponent] : value * __ulMeshPow10[exponent];
 
-        number_buffer[i - vertex_element] = vertex_element[16 + (i - vertex_element)];
+        if(negative) value = -value;
     }
+    else {
+        char number[128];
+        size_t length = (size_t)(p - start) < sizeof(number) - 1 ? (size_t)(p - start) : sizeof(number) - 1;
+
+        memcpy(number, start, length);
+        number[length] = 0;
 
-    uint32_t vertex_amount = atoi(number_buffer);
+        value = strtod(number, (char**)0);
+    }
 
-    memset(number_buffer, 0, 256);
+    *pValue = (float)value;
 
-    for(uint8_t* i = face_element; i < face_element + 256; i++) {
-        if(face_element[16 + (i - face_element)] == '\n') break;
+    return p;
+}
 
-        number_buffer[i - face_element] = face_element[16 + (i - face_element)];
+/**
+ * @brief Parse integer from text
+ *
+ * @param p first character of number
+ * @param end end of text
+ * @param pValue parsed value, 0 when there is no number
+ * @return const char* first character after number, p when there was no number
+ */
+const char* ulMeshParseInt(const char* p, const char* end, int64_t* pValue) {
+    const char* start = p;
+    int negative = 0;
+    int64_t value = 0;
+
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
     }
 
-    uint32_t faces_amount = atoi(number_buffer);
+    if(p >= end || (uint8_t)(*p - '0') >= 10) {
+        *pValue = 0;
 
-    fseek(mesh_file, 0, SEEK_SET);
+        return start;
+    }
 
-    char *line = new char[len]; //(char*)calloc(len, sizeof(char));
+    while(p < end && (uint8_t)(*p - '0') < 10) {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
 
-    uint32_t vertex_counter = 0;
-    uint32_t faces_counter = 0;
+    *pValue = negative ? -value : value;
 
-    ul_mesh_t temp;
+    return p;
+}
 
-    // Needless
-    /*
-    uint32_t temp_vert_counter = 0;
-    uint32_t temp_norm_counter = 0;
-    uint32_t temp_texc_counter = 0;
-    
-    temp.meshSize = 0;
-    temp.vertices = (float*)0;
-    temp.normals = (float*)0;
-    temp.textureCoordinates = (float*)0;
+#define ULM_OBJ_NO_INDEX INT32_MIN
 
-    ulMeshAllocate(&temp, vertex_amount);
-    */
+#define ULM_OBJ_LOCAL_V 0x1
+#define ULM_OBJ_LOCAL_T 0x2
+#define ULM_OBJ_LOCAL_N 0x4
 
-    while(!feof(mesh_file)) {
-        uint8_t ch = 0;
+typedef struct ul_obj_corner_s {
+    // 0 based indices, ULM_OBJ_NO_INDEX when face corner doesn`t reference attribute
+    int32_t v, t, n;
+    // ULM_OBJ_LOCAL_ bits, set when index came from negative (relative) OBJ index and counts from start of chunk
+    uint8_t local;
+} ul_obj_corner_t;
 
-        if(format != (uint8_t*)0) {
-            fgets(line, (size_t)len, mesh_file);
-        }
-        else {
-            ch = (uint8_t)fgetc(mesh_file);
-        }
+typedef struct ul_obj_chunk_s {
+    std::vector<float> positions, normals, textureCoordinates;
+    // Already triangulated, 3 corners per triangle
+    std::vector<ul_obj_corner_t> corners;
+} ul_obj_chunk_t;
 
-        if(ftell(mesh_file) <= (long)(source_buffer - end_header + 11)) continue;
+/**
+ * @brief Resolve OBJ index (1 based or negative relative) into ul_obj_corner_t index
+ *
+ * @param index index as written in file
+ * @param count amount of attributes already seen in current chunk
+ * @param pLocal set to 1 when result is relative to chunk start
+ * @return int32_t 0 based index or ULM_OBJ_NO_INDEX
+ */
+int32_t __ulMeshResolveOBJIndex(int64_t index, size_t count, int* pLocal) {
+    *pLocal = 0;
 
-        if(format != (uint8_t*)0) {
-            if(strcmp(line, "end_header\n") == 0) continue;
+    if(index > 0) return (int32_t)(index - 1);
 
-            if(vertex_counter < vertex_amount) {
-                char number[256];
-                size_t current_pos = 0;
+    if(index < 0) {
+        *pLocal = 1;
 
-                if(prop_vertices != (uint8_t*)0) {
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.vertices.push_back(atof(number));
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.vertices.push_back(atof(number));
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.vertices.push_back(atof(number));
-                }
+        return (int32_t)((int64_t)count + index);
+    }
 
-                if(prop_normals != (uint8_t*)0) {
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.normals.push_back(atof(number));
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.normals.push_back(atof(number));
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.normals.push_back(atof(number));
-                }
+    return ULM_OBJ_NO_INDEX;
+}
 
-                if(prop_texpos != (uint8_t*)0) {
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.textureCoordinates.push_back(atof(number));
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.textureCoordinates.push_back(atof(number));
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    temp.textureCoordinates.push_back(atof(number));
-                }
+/**
+ * @brief Tokenize OBJ text in single pass. Reads v/vn/vt/f records, everything else is skipped. Polygons of any size are
+ * fan triangulated while their corners are read
+ *
+ * @param begin first byte of chunk, should be start of line
+ * @param end end of chunk, should be right after '\n' or end of file
+ * @param pChunk output arrays
+ */
+void __ulMeshParseOBJChunk(const char* begin, const char* end, ul_obj_chunk_t* pChunk) {
+    const char* p = begin;
 
-                vertex_counter++;
+    while(p < end) {
+        const char* line_end = (const char*)memchr(p, '\n', (size_t)(end - p));
 
-                continue;
-            }
+        if(!line_end) line_end = end;
 
-            if(faces_counter < faces_amount) {
-                char number[256];
-                size_t current_pos = 0;
-
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                int faces_value_amount = atoi(number);
-
-                if(faces_value_amount == 4) {
-                    uint32_t face[4] = { 0, 0, 0, 0 };
-
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[0] = atoi(number);
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[1] = atoi(number);
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[2] = atoi(number);
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[3] = atoi(number);
-
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[3] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[3] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[3] * 3 + 2]);
-
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[3] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[3] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[3] * 3 + 2]);
-
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[3] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[3] * 2 + 1]);
-                }
-                else {
-                    uint32_t face[3] = { 0, 0, 0 };
-
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[0] = atoi(number);
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[1] = atoi(number);
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face[2] = atoi(number);
-
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 2]);
-
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 2]);
-
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 1]);
-                }
+        while(p < line_end && (*p == ' ' || *p == '\t')) p++;
 
-                faces_counter++;
+        if(line_end - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            float value;
 
-                continue;
+            p += 2;
+
+            for(int i = 0; i < 3; i++) {
+                while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+                p = ulMeshParseFloat(p, line_end, &value);
+                pChunk->positions.push_back(value);
             }
         }
-        else {
-            uint32_t convert = 0;
-
-            if(vertex_counter < vertex_amount) {
-                if(prop_vertices != (uint8_t*)0) {
-                    convert = (uint32_t)ch | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.vertices.push_back(*(float*)&convert);
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.vertices.push_back(*(float*)&convert);
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.vertices.push_back(*(float*)&convert);
-                }
+        else if(line_end - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            float value;
 
-                if(prop_normals != (uint8_t*)0) {
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.normals.push_back(*(float*)&convert);
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.normals.push_back(*(float*)&convert);
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.normals.push_back(*(float*)&convert);
-                }
+            p += 3;
 
-                if(prop_texpos != (uint8_t*)0) {
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.textureCoordinates.push_back(*(float*)&convert);
-                    convert = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    temp.textureCoordinates.push_back(*(float*)&convert);
-                }
+            for(int i = 0; i < 3; i++) {
+                while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+                p = ulMeshParseFloat(p, line_end, &value);
+                pChunk->normals.push_back(value);
+            }
+        }
+        else if(line_end - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+            float value;
 
-                vertex_counter++;
+            p += 3;
 
-                continue;
+            for(int i = 0; i < 2; i++) {
+                while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+                p = ulMeshParseFloat(p, line_end, &value);
+                pChunk->textureCoordinates.push_back(value);
             }
+        }
+        else if(line_end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            // Fan needs only first and previous corner, no limit on polygon size
+            ul_obj_corner_t first = {}, previous = {};
+            uint32_t face_size = 0;
+
+            p += 2;
+
+            while(true) {
+                while(p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
 
-            if(faces_counter < faces_amount) {
-                uint8_t faces_value_amount = ch;
-
-                if(faces_value_amount == 4) {
-                    uint32_t face[4] = { 0, 0, 0, 0 };
-
-                    face[0] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    face[1] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    face[2] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    face[3] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[3] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[3] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[3] * 3 + 2]);
-
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[3] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[3] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[3] * 3 + 2]);
-
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[3] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[3] * 2 + 1]);
+                int64_t index;
+                const char* after = ulMeshParseInt(p, line_end, &index);
+
+                if(after == p) break;
+
+                p = after;
+
+                ul_obj_corner_t corner;
+                int local;
+
+                corner.local = 0;
+                corner.v = __ulMeshResolveOBJIndex(index, pChunk->positions.size() / 3, &local);
+                corner.local |= local ? ULM_OBJ_LOCAL_V : 0;
+                corner.t = ULM_OBJ_NO_INDEX;
+                corner.n = ULM_OBJ_NO_INDEX;
+
+                if(p < line_end && *p == '/') {
+                    p++;
+                    p = ulMeshParseInt(p, line_end, &index);
+
+                    corner.t = __ulMeshResolveOBJIndex(index, pChunk->textureCoordinates.size() / 2, &local);
+                    corner.local |= local ? ULM_OBJ_LOCAL_T : 0;
+
+                    if(p < line_end && *p == '/') {
+                        p++;
+                        p = ulMeshParseInt(p, line_end, &index);
+
+                        corner.n = __ulMeshResolveOBJIndex(index, pChunk->normals.size() / 3, &local);
+                        corner.local |= local ? ULM_OBJ_LOCAL_N : 0;
+                    }
                 }
-                else {
-                    uint32_t face[3] = { 0, 0, 0 };
-
-                    face[0] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    face[1] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-                    face[2] = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24;
-
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[0] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[1] * 3 + 2]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 0]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 1]);
-                    pMesh->vertices.push_back(temp.vertices[face[2] * 3 + 2]);
-
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[0] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[1] * 3 + 2]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 0]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 1]);
-                    pMesh->normals.push_back(temp.normals[face[2] * 3 + 2]);
-
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[0] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[1] * 2 + 1]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 0]);
-                    pMesh->textureCoordinates.push_back(temp.textureCoordinates[face[2] * 2 + 1]);
+
+                if(face_size == 0) first = corner;
+
+                if(face_size >= 2) {
+                    pChunk->corners.push_back(first);
+                    pChunk->corners.push_back(previous);
+                    pChunk->corners.push_back(corner);
                 }
 
-                faces_counter++;
+                previous = corner;
+                face_size++;
 
-                continue;
+                // Skip anything glued to corner we don`t understand
+                while(p < line_end && *p != ' ' && *p != '\t') p++;
             }
         }
+
+        p = line_end + 1;
+    }
+}
+
+/**
+ * @brief Resolve corners of parsed chunk against global attribute arrays and write them into preallocated mesh arrays
+ *
+ * @param pChunk parsed chunk
+ * @param pPositions all positions of file
+ * @param pNormals all normals of file
+ * @param pTexcoords all texture coordinates of file
+ * @param base amount of positions, normals and texture coordinates defined before this chunk (for relative indices)
+ * @param pVertices output position pointer, advanced by written floats
+ * @param pNormalsOut output normal pointer, advanced by written floats
+ * @param pTexcoordsOut output texture coordinate pointer, advanced by written floats
+ * @return int 1 on success, 0 when some index points outside of file data
+ */
+int __ulMeshEmitOBJChunk(const ul_obj_chunk_t* pChunk, const std::vector<float>* pPositions, const std::vector<float>* pNormals, const std::vector<float>* pTexcoords, const int64_t base[3], float** pVertices, float** pNormalsOut, float** pTexcoordsOut) {
+    const int64_t position_count = (int64_t)pPositions->size() / 3;
+    const int64_t normal_count = (int64_t)pNormals->size() / 3;
+    const int64_t texcoord_count = (int64_t)pTexcoords->size() / 2;
+
+    float* vertices = *pVertices;
+    float* normals = *pNormalsOut;
+    float* texcoords = *pTexcoordsOut;
+
+    for(const ul_obj_corner_t& c : pChunk->corners) {
+        int64_t v = (int64_t)c.v + ((c.local & ULM_OBJ_LOCAL_V) ? base[0] : 0);
+
+        if(c.v == ULM_OBJ_NO_INDEX || v < 0 || v >= position_count) return 0;
+
+        memcpy(vertices, pPositions->data() + v * 3, sizeof(float) * 3);
+        vertices += 3;
+
+        if(c.n != ULM_OBJ_NO_INDEX) {
+            int64_t n = (int64_t)c.n + ((c.local & ULM_OBJ_LOCAL_N) ? base[1] : 0);
+
+            if(n < 0 || n >= normal_count) return 0;
+
+            memcpy(normals, pNormals->data() + n * 3, sizeof(float) * 3);
+            normals += 3;
+        }
+
+        if(c.t != ULM_OBJ_NO_INDEX) {
+            int64_t t = (int64_t)c.t + ((c.local & ULM_OBJ_LOCAL_T) ? base[2] : 0);
+
+            if(t < 0 || t >= texcoord_count) return 0;
+
+            memcpy(texcoords, pTexcoords->data() + t * 2, sizeof(float) * 2);
+            texcoords += 2;
+        }
     }
 
-    // free(line);
-    // free(source_buffer);
-    delete[] line;
-    delete[] source_buffer;
-    fclose(mesh_file);
+    *pVertices = vertices;
+    *pNormalsOut = normals;
+    *pTexcoordsOut = texcoords;
 
     return 1;
 }
 
-int __ulMeshLoadOBJ(ul_mesh_t* pMesh, const char* path) {
-    FILE* mesh_file = fopen(path, "rb+");
-
-    fseek(mesh_file, 0, SEEK_END);
-    uint32_t len = ftell(mesh_file);
-    fseek(mesh_file, 0, SEEK_SET);
-
-    char *line = new char[len]; // (char*)calloc(len, sizeof(char));
-
-    float* temp_vert = (float*)0;
-    float* temp_norm = (float*)0;
-    float* temp_texc = (float*)0;
-    uint32_t tv_size = 0;
-    uint32_t tn_size = 0;
-    uint32_t tt_size = 0;
-
-    while(!feof(mesh_file)) {
-        char number[256];
-        size_t current_pos = 0;
-
-        fgets(line, (size_t)len, mesh_file);
-
-        if(strstr(line, "v ") != (char*)0) {
-            temp_vert = (float*)realloc(temp_vert, sizeof(float) * (++tv_size) * 3);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_vert[tv_size * 3 - 3] = atof(number);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_vert[tv_size * 3 - 2] = atof(number);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_vert[tv_size * 3 - 1] = atof(number);
-        }
-        else if(strstr(line, "vn ") != (char*)0) {
-            temp_norm = (float*)realloc(temp_norm, sizeof(float) * (++tn_size) * 3);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_norm[tn_size * 3 - 3] = atof(number);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_norm[tn_size * 3 - 2] = atof(number);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_norm[tn_size * 3 - 1] = atof(number);
-        }
-        else if(strstr(line, "vt ") != (char*)0) {
-            temp_texc = (float*)realloc(temp_texc, sizeof(float) * (++tt_size) * 2);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_texc[tt_size * 2 - 2] = atof(number);
-            current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-            temp_texc[tt_size * 2 - 1] = atof(number);
-        }
-        else if(strstr(line, "f ") != (char*)0) {
-            int slashes = 0;
-            int no_textures = 0;
-
-            for(int i = 0; i < len; i++) {
-                if(line[i] == 0) break;
-
-                if(line[i] == '/') slashes++;
-                if(line[i] == '/' && line[i + 1] == '/') no_textures = 1;
-            }
+/**
+ * @brief Count floats chunk will write to each of mesh arrays
+ *
+ * @param pChunk parsed chunk
+ * @param counts output, vertices/normals/texture coordinates floats
+ */
+void __ulMeshCountOBJChunk(const ul_obj_chunk_t* pChunk, size_t counts[3]) {
+    counts[0] = pChunk->corners.size() * 3;
+    counts[1] = 0;
+    counts[2] = 0;
+
+    for(const ul_obj_corner_t& c : pChunk->corners) {
+        if(c.n != ULM_OBJ_NO_INDEX) counts[1] += 3;
+        if(c.t != ULM_OBJ_NO_INDEX) counts[2] += 2;
+    }
+}
 
-            if(slashes >= 7) {
-                uint32_t face_v[4];
-                uint32_t face_t[4];
-                uint32_t face_n[4];
-
-                for(int i = 0; i < 4; i++) {
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, '/');
-                    face_v[i] = (uint32_t)atoi(number);
-                    
-                    if(!no_textures) {
-                        current_pos += ulMeshCopyNumber(number, line + current_pos, 256, '/');
-                        face_t[i] = (uint32_t)atoi(number);
-                    }
-                    else {
-                        current_pos++;
-                    }
+/**
+ * @brief Load OBJ split into chunks at line boundaries, every chunk is tokenized on its own thread into thread local arrays
+ * and then stitched with prefix sums of attribute counts, so relative indices resolve globally. Output is identical to
+ * single threaded load no matter how many threads are used
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param path path to mesh
+ * @param threadCount amount of threads, 0 means all hardware threads
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshLoadOBJParallel(ul_mesh_t* pMesh, const char* path, uint32_t threadCount) {
+    ul_mapped_file_t mesh_file;
 
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face_n[i] = (uint32_t)atoi(number);
-                }
+    if(!ulMapFile(&mesh_file, path)) {
+        printf("Cannot open obj model!\n");
 
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[2] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[2] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[2] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[3] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[3] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[3] * 3 + 2]);
-
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[2] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[2] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[2] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[3] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[3] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[3] * 3 + 2]);
-
-                if(no_textures) continue;
-
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[0] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[0] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[1] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[1] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[2] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[2] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[0] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[0] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[1] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[1] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[3] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[3] * 2 + 1]);
-            }
-            else {
-                uint32_t face_v[3];
-                uint32_t face_t[3];
-                uint32_t face_n[3];
-
-                for(int i = 0; i < 3; i++) {
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, '/');
-                    face_v[i] = (uint32_t)atoi(number);
-                    
-                    if(!no_textures) {
-                        current_pos += ulMeshCopyNumber(number, line + current_pos, 256, '/');
-                        face_t[i] = (uint32_t)atoi(number);
-                    }
-                    else {
-                        current_pos++;
-                    }
+        return 0;
+    }
 
-                    current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                    face_n[i] = (uint32_t)atoi(number);
-                }
+    const char* source = (const char*)mesh_file.data;
+    const size_t source_size = mesh_file.size;
 
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[0] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[1] * 3 + 2]);
-                pMesh->vertices.push_back(temp_vert[face_v[2] * 3 + 0]);
-                pMesh->vertices.push_back(temp_vert[face_v[2] * 3 + 1]);
-                pMesh->vertices.push_back(temp_vert[face_v[2] * 3 + 2]);
-
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[0] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[1] * 3 + 2]);
-                pMesh->normals.push_back(temp_norm[face_n[2] * 3 + 0]);
-                pMesh->normals.push_back(temp_norm[face_n[2] * 3 + 1]);
-                pMesh->normals.push_back(temp_norm[face_n[2] * 3 + 2]);
-
-                if(no_textures) continue;
-
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[0] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[0] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[1] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[1] * 2 + 1]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[2] * 2 + 0]);
-                pMesh->textureCoordinates.push_back(temp_texc[face_t[2] * 2 + 1]);
-            }
+    if(threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if(threadCount == 0) threadCount = 1;
+
+    // Chunks smaller than that aren`t worth starting thread for
+    const size_t min_chunk_size = 1 << 20;
+
+    if(source_size / min_chunk_size < threadCount) threadCount = (uint32_t)(source_size / min_chunk_size);
+    if(threadCount == 0) threadCount = 1;
+
+    std::vector<const char*> bounds(threadCount + 1);
+    bounds[0] = source;
+    bounds[threadCount] = source + source_size;
+
+    for(uint32_t i = 1; i < threadCount; i++) {
+        const char* split = source + source_size / threadCount * i;
+
+        if(split < bounds[i - 1]) split = bounds[i - 1];
+
+        const char* line_end = (const char*)memchr(split, '\n', (size_t)(bounds[threadCount] - split));
+
+        bounds[i] = line_end ? line_end + 1 : bounds[threadCount];
+    }
+
+    std::vector<ul_obj_chunk_t> chunks(threadCount);
+
+    if(threadCount == 1) {
+        __ulMeshParseOBJChunk(bounds[0], bounds[1], &chunks[0]);
+    }
+    else {
+        std::vector<std::thread> workers;
+
+        for(uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(__ulMeshParseOBJChunk, bounds[i], bounds[i + 1], &chunks[i]);
         }
+
+        for(std::thread& w : workers) w.join();
     }
 
-    free(temp_vert);
-    temp_vert = (float*)0;
-    tv_size = 0;
+    ulUnmapFile(&mesh_file);
 
-    free(temp_norm);
-    temp_norm = (float*)0;
-    tn_size = 0;
+    // Prefix sums, where each chunk attributes start globally and where each chunk writes into mesh
+    std::vector<int64_t> bases((threadCount + 1) * 3, 0);
+    std::vector<size_t> offsets((threadCount + 1) * 3, 0);
 
-    free(temp_texc);
-    temp_texc = (float*)0;
-    tt_size = 0;
+    offsets[0] = pMesh->vertices.size();
+    offsets[1] = pMesh->normals.size();
+    offsets[2] = pMesh->textureCoordinates.size();
 
-    free(line);
-    fclose(mesh_file);
+    for(uint32_t i = 0; i < threadCount; i++) {
+        size_t counts[3];
+        __ulMeshCountOBJChunk(&chunks[i], counts);
 
-    return 1;
-}
+        bases[(i + 1) * 3 + 0] = bases[i * 3 + 0] + (int64_t)chunks[i].positions.size() / 3;
+        bases[(i + 1) * 3 + 1] = bases[i * 3 + 1] + (int64_t)chunks[i].normals.size() / 3;
+        bases[(i + 1) * 3 + 2] = bases[i * 3 + 2] + (int64_t)chunks[i].textureCoordinates.size() / 2;
 
-int __ulMeshLoadSTL(ul_mesh_t* pMesh, const char* path) {
-    FILE* mesh_file = fopen(path, "rb+");
+        offsets[(i + 1) * 3 + 0] = offsets[i * 3 + 0] + counts[0];
+        offsets[(i + 1) * 3 + 1] = offsets[i * 3 + 1] + counts[1];
+        offsets[(i + 1) * 3 + 2] = offsets[i * 3 + 2] + counts[2];
+    }
+
+    std::vector<float> positions, normals, texcoords;
+
+    if(threadCount > 1) {
+        positions.resize((size_t)bases[threadCount * 3 + 0] * 3);
+        normals.resize((size_t)bases[threadCount * 3 + 1] * 3);
+        texcoords.resize((size_t)bases[threadCount * 3 + 2] * 2);
+    }
 
-    fseek(mesh_file, 0, SEEK_END);
-    uint32_t len = ftell(mesh_file);
-    fseek(mesh_file, 0, SEEK_SET);
+    const size_t vertices_offset = offsets[0];
+    const size_t normals_offset = offsets[1];
+    const size_t texcoords_offset = offsets[2];
 
-    uint8_t *source_buffer = new uint8_t[len]; // (uint8_t*)calloc(len, sizeof(uint8_t));
+    pMesh->vertices.resize(offsets[threadCount * 3 + 0]);
+    pMesh->normals.resize(offsets[threadCount * 3 + 1]);
+    pMesh->textureCoordinates.resize(offsets[threadCount * 3 + 2]);
 
-    fread(source_buffer, sizeof(uint8_t), len, mesh_file);
+    int result = 1;
 
-    int is_ascii = strstr((char*)source_buffer, "solid") != (char*)0;
+    if(threadCount == 1) {
+        float* vertices_out = pMesh->vertices.data() + offsets[0];
+        float* normals_out = pMesh->normals.data() + offsets[1];
+        float* texcoords_out = pMesh->textureCoordinates.data() + offsets[2];
 
-    if(is_ascii){
-        fseek(mesh_file, 0, SEEK_SET);
+        result = __ulMeshEmitOBJChunk(&chunks[0], &chunks[0].positions, &chunks[0].normals, &chunks[0].textureCoordinates, &bases[0], &vertices_out, &normals_out, &texcoords_out);
     }
     else {
-        fseek(mesh_file, 0x50, SEEK_SET);
-    }
-
-    char *line = new char[len]; // (char*)calloc(len, sizeof(char));
-
-    // It ain`t used
-    uint32_t number_of_triangles = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-
-    while(!feof(mesh_file)) {
-        if(is_ascii) {
-            char number[256];
-            size_t current_pos = 0;
-
-            fgets(line, len, mesh_file);
-
-            if(strstr(line, "facet normal ") != (char*)0) {
-                float normal[3];
-                float vertex[3][3];
-
-                current_pos += 13;
-
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                normal[0] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                normal[1] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                normal[2] = atof(number);
-
-                fgets(line, len, mesh_file);
-                fgets(line, len, mesh_file);
-                
-                current_pos = (line - strstr(line, "vertex ")) + 7;
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[0][0] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[1][0] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[2][0] = atof(number);
-
-                fgets(line, len, mesh_file);
-                
-                current_pos = (line - strstr(line, "vertex ")) + 7;
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[0][1] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[1][1] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[2][1] = atof(number);
-
-                fgets(line, len, mesh_file);
-                
-                current_pos = (line - strstr(line, "vertex ")) + 7;
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[0][2] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[1][2] = atof(number);
-                current_pos += ulMeshCopyNumber(number, line + current_pos, 256, ' ');
-                vertex[2][2] = atof(number);
-
-                fgets(line, len, mesh_file);
-                fgets(line, len, mesh_file);
-
-                pMesh->vertices.push_back(vertex[0][0]);
-                pMesh->vertices.push_back(vertex[1][0]);
-                pMesh->vertices.push_back(vertex[2][0]);
-                pMesh->vertices.push_back(vertex[0][1]);
-                pMesh->vertices.push_back(vertex[1][1]);
-                pMesh->vertices.push_back(vertex[2][1]);
-                pMesh->vertices.push_back(vertex[0][2]);
-                pMesh->vertices.push_back(vertex[1][2]);
-                pMesh->vertices.push_back(vertex[2][2]);
-
-                pMesh->normals.push_back(normal[0]);
-                pMesh->normals.push_back(normal[1]);
-                pMesh->normals.push_back(normal[2]);
-                pMesh->normals.push_back(normal[0]);
-                pMesh->normals.push_back(normal[1]);
-                pMesh->normals.push_back(normal[2]);
-                pMesh->normals.push_back(normal[0]);
-                pMesh->normals.push_back(normal[1]);
-                pMesh->normals.push_back(normal[2]);
-
-                // TODO: STL texture coordinates generating. Currently not generated!
-                pMesh->textureCoordinates.push_back(0.0f);
-                pMesh->textureCoordinates.push_back(0.0f);
-                pMesh->textureCoordinates.push_back(1.0f);
-                pMesh->textureCoordinates.push_back(0.0f);
-                pMesh->textureCoordinates.push_back(0.0f);
-                pMesh->textureCoordinates.push_back(1.0f);
-            }
+        std::vector<std::thread> workers;
+        std::vector<int> results(threadCount, 1);
+
+        // Gather attributes first, chunk faces can reference attributes of any chunk
+        for(uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([&, i]() {
+                const ul_obj_chunk_t& c = chunks[i];
+
+                if(!c.positions.empty()) memcpy(positions.data() + bases[i * 3 + 0] * 3, c.positions.data(), c.positions.size() * sizeof(float));
+                if(!c.normals.empty()) memcpy(normals.data() + bases[i * 3 + 1] * 3, c.normals.data(), c.normals.size() * sizeof(float));
+                if(!c.textureCoordinates.empty()) memcpy(texcoords.data() + bases[i * 3 + 2] * 2, c.textureCoordinates.data(), c.textureCoordinates.size() * sizeof(float));
+            });
         }
-        else {
-            uint32_t normal_x = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t normal_y = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t normal_z = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-
-            uint32_t vertex_x0 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t vertex_y0 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t vertex_z0 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-
-            uint32_t vertex_x1 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t vertex_y1 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t vertex_z1 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-
-            uint32_t vertex_x2 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t vertex_y2 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            uint32_t vertex_z2 = (uint32_t)fgetc(mesh_file) | (uint32_t)fgetc(mesh_file) << 8 | (uint32_t)fgetc(mesh_file) << 16 | (uint32_t)fgetc(mesh_file) << 24; 
-            // Basicly thrash bytes, always set to 0
-            uint16_t attrib_count = (uint16_t)fgetc(mesh_file) | (uint16_t)fgetc(mesh_file) << 8;
-
-            pMesh->vertices.push_back(*(float*)&vertex_x0);
-            pMesh->vertices.push_back(*(float*)&vertex_y0);
-            pMesh->vertices.push_back(*(float*)&vertex_z0);
-            pMesh->vertices.push_back(*(float*)&vertex_x1);
-            pMesh->vertices.push_back(*(float*)&vertex_y1);
-            pMesh->vertices.push_back(*(float*)&vertex_z1);
-            pMesh->vertices.push_back(*(float*)&vertex_x2);
-            pMesh->vertices.push_back(*(float*)&vertex_y2);
-            pMesh->vertices.push_back(*(float*)&vertex_z2);
-
-            pMesh->normals.push_back(*(float*)&normal_x);
-            pMesh->normals.push_back(*(float*)&normal_y);
-            pMesh->normals.push_back(*(float*)&normal_z);
-            pMesh->normals.push_back(*(float*)&normal_x);
-            pMesh->normals.push_back(*(float*)&normal_y);
-            pMesh->normals.push_back(*(float*)&normal_z);
-            pMesh->normals.push_back(*(float*)&normal_x);
-            pMesh->normals.push_back(*(float*)&normal_y);
-            pMesh->normals.push_back(*(float*)&normal_z);
 
-            // TODO: STL texture coordinates generating. Currently not generated!
-            pMesh->textureCoordinates.push_back(0.0f);
-            pMesh->textureCoordinates.push_back(0.0f);
-            pMesh->textureCoordinates.push_back(1.0f);
-            pMesh->textureCoordinates.push_back(0.0f);
-            pMesh->textureCoordinates.push_back(0.0f);
-            pMesh->textureCoordinates.push_back(1.0f);
+        for(std::thread& w : workers) w.join();
+
+        workers.clear();
+
+        for(uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([&, i]() {
+                float* vertices_out = pMesh->vertices.data() + offsets[i * 3 + 0];
+                float* normals_out = pMesh->normals.data() + offsets[i * 3 + 1];
+                float* texcoords_out = pMesh->textureCoordinates.data() + offsets[i * 3 + 2];
+
+                results[i] = __ulMeshEmitOBJChunk(&chunks[i], &positions, &normals, &texcoords, &bases[i * 3], &vertices_out, &normals_out, &texcoords_out);
+            });
         }
+
+        for(std::thread& w : workers) w.join();
+
+        for(int r : results) result &= r;
+    }
+
+    if(!result) {
+        pMesh->vertices.resize(vertices_offset);
+        pMesh->normals.resize(normals_offset);
+        pMesh->textureCoordinates.resize(texcoords_offset);
+
+        printf("Obj model face references vertex that doesn`t exist!\n");
+
+        return 0;
+    }
+
+    return 1;
+}
+
+int __ulMeshLoadOBJ(ul_mesh_t* pMesh, const char* path) {
+    return ulMeshLoadOBJParallel(pMesh, path, 1);
+}
+
+enum {
+    ULMply_none,
+    ULMply_int8,
+    ULMply_uint8,
+    ULMply_int16,
+    ULMply_uint16,
+    ULMply_int32,
+    ULMply_uint32,
+    ULMply_float32,
+    ULMply_float64
+};
+
+enum {
+    ULMply_ascii,
+    ULMply_binary_little_endian,
+    ULMply_binary_big_endian
+};
+
+static const uint32_t __ulMeshPLYTypeSize[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+typedef double (*ul_ply_read_fn)(const uint8_t*);
+
+typedef struct ul_ply_property_s {
+    std::string name;
+    // ULMply_ type of value, for lists type of items
+    uint8_t type;
+    // ULMply_ type of list length, ULMply_none for scalar property
+    uint8_t countType;
+    // Byte offset inside element, only valid when element has no list properties
+    uint32_t offset;
+} ul_ply_property_t;
+
+typedef struct ul_ply_element_s {
+    std::string name;
+    size_t count;
+    std::vector<ul_ply_property_t> properties;
+    // Bytes per binary element, 0 when element has list properties so size varies
+    uint32_t stride;
+} ul_ply_element_t;
+
+typedef struct ul_ply_header_s {
+    uint32_t format;
+    std::vector<ul_ply_element_t> elements;
+    // Offset of first byte after end_header line
+    size_t dataOffset;
+} ul_ply_header_t;
+
+template<class T, int Swap>
+double __ulMeshPLYRead(const uint8_t* p) {
+    uint8_t bytes[sizeof(T)];
+    T value;
+
+    if(Swap) {
+        for(size_t i = 0; i < sizeof(T); i++) bytes[i] = p[sizeof(T) - 1 - i];
+
+        memcpy(&value, bytes, sizeof(T));
+    }
+    else {
+        memcpy(&value, p, sizeof(T));
     }
 
-    //free(line);
-    //free(source_buffer);
-    delete[] line;
-    delete[] source_buffer;
-    fclose(mesh_file);
+    return (double)value;
 }
 
 /**
- * @brief Load mesh to ul_mesh_t struct, REMEMBER THAT STL ONLY HAVE VERTICES AND NORMALS!
- * 
- * @param pMesh ul_mesh_t struct
- * @param path path to mesh
- * @param type ULMtype_
+ * @brief Pick reader for type once, so decoding loops don`t switch on type for every value
+ *
+ * @param type ULMply_ type
+ * @param swap 1 when file endianness differs from host
+ * @return ul_ply_read_fn reader
  */
-void ulMeshLoad(ul_mesh_t* pMesh, const char* path, uint32_t type) {
-    if(type == ULMtype_ply) {
-        __ulMeshLoadPLY(pMesh, path);
+ul_ply_read_fn __ulMeshPLYReader(uint8_t type, int swap) {
+    switch(type) {
+        case ULMply_int8: return __ulMeshPLYRead<int8_t, 0>;
+        case ULMply_uint8: return __ulMeshPLYRead<uint8_t, 0>;
+        case ULMply_int16: return swap ? __ulMeshPLYRead<int16_t, 1> : __ulMeshPLYRead<int16_t, 0>;
+        case ULMply_uint16: return swap ? __ulMeshPLYRead<uint16_t, 1> : __ulMeshPLYRead<uint16_t, 0>;
+        case ULMply_int32: return swap ? __ulMeshPLYRead<int32_t, 1> : __ulMeshPLYRead<int32_t, 0>;
+        case ULMply_uint32: return swap ? __ulMeshPLYRead<uint32_t, 1> : __ulMeshPLYRead<uint32_t, 0>;
+        case ULMply_float32: return swap ? __ulMeshPLYRead<float, 1> : __ulMeshPLYRead<float, 0>;
+        case ULMply_float64: return swap ? __ulMeshPLYRead<double, 1> : __ulMeshPLYRead<double, 0>;
     }
-    else if(type == ULMtype_obj) {
-        __ulMeshLoadOBJ(pMesh, path);
+
+    return (ul_ply_read_fn)0;
+}
+
+uint8_t __ulMeshPLYParseType(const std::string& name) {
+    if(name == "char" || name == "int8") return ULMply_int8;
+    if(name == "uchar" || name == "uint8") return ULMply_uint8;
+    if(name == "short" || name == "int16") return ULMply_int16;
+    if(name == "ushort" || name == "uint16") return ULMply_uint16;
+    if(name == "int" || name == "int32") return ULMply_int32;
+    if(name == "uint" || name == "uint32") return ULMply_uint32;
+    if(name == "float" || name == "float32") return ULMply_float32;
+    if(name == "double" || name == "float64") return ULMply_float64;
+
+    return ULMply_none;
+}
+
+/**
+ * @brief Parse PLY header into element/property schema with per property offsets and per element strides
+ *
+ * @param data mapped file
+ * @param size size of mapped file
+ * @param pHeader output schema
+ * @return int 1 on success, 0 when header is malformed
+ */
+int __ulMeshParsePLYHeader(const char* data, size_t size, ul_ply_header_t* pHeader) {
+    const char* p = data;
+    const char* end = data + size;
+    int has_format = 0;
+
+    if(size < 4 || memcmp(data, "ply", 3) != 0 || (data[3] != '\n' && data[3] != '\r')) return 0;
+
+    while(p < end) {
+        const char* line_end = (const char*)memchr(p, '\n', (size_t)(end - p));
+
+        if(!line_end) return 0;
+
+        std::vector<std::string> tokens;
+        const char* t = p;
+
+        while(t < line_end) {
+            while(t < line_end && (*t == ' ' || *t == '\t' || *t == '\r')) t++;
+
+            const char* token_start = t;
+
+            while(t < line_end && *t != ' ' && *t != '\t' && *t != '\r') t++;
+
+            if(t > token_start) tokens.emplace_back(token_start, (size_t)(t - token_start));
+        }
+
+        p = line_end + 1;
+
+        if(tokens.empty() || tokens[0] == "ply" || tokens[0] == "comment" || tokens[0] == "obj_info") continue;
+
+        if(tokens[0] == "end_header") {
+            pHeader->dataOffset = (size_t)(p - data);
+
+            return has_format;
+        }
+
+        if(tokens[0] == "format" && tokens.size() >= 2) {
+            if(tokens[1] == "ascii") pHeader->format = ULMply_ascii;
+            else if(tokens[1] == "binary_little_endian") pHeader->format = ULMply_binary_little_endian;
+            else if(tokens[1] == "binary_big_endian") pHeader->format = ULMply_binary_big_endian;
+            else return 0;
+
+            has_format = 1;
+        }
+        else if(tokens[0] == "element" && tokens.size() >= 3) {
+            ul_ply_element_t element;
+
+            element.name = tokens[1];
+            element.count = (size_t)strtoull(tokens[2].c_str(), (char**)0, 10);
+            element.stride = 0;
+
+            pHeader->elements.push_back(element);
+        }
+        else if(tokens[0] == "property" && !pHeader->elements.empty()) {
+            ul_ply_element_t& element = pHeader->elements.back();
+            ul_ply_property_t property;
+
+            property.offset = element.stride;
+
+            if(tokens.size() >= 5 && tokens[1] == "list") {
+                property.countType = __ulMeshPLYParseType(tokens[2]);
+                property.type = __ulMeshPLYParseType(tokens[3]);
+                property.name = tokens[4];
+
+                if(property.countType == ULMply_none || property.type == ULMply_none) return 0;
+            }
+            else if(tokens.size() >= 3) {
+                property.countType = ULMply_none;
+                property.type = __ulMeshPLYParseType(tokens[1]);
+                property.name = tokens[2];
+
+                if(property.type == ULMply_none) return 0;
+            }
+            else {
+                return 0;
+            }
+
+            element.properties.push_back(property);
+        }
     }
-    else if(type == ULMtype_stl) {
-        __ulMeshLoadSTL(pMesh, path);
+
+    return 0;
+}
+
+/**
+ * @brief Compute byte offsets and stride of every element without list properties
+ *
+ * @param pHeader parsed schema
+ */
+void __ulMeshLayoutPLYElements(ul_ply_header_t* pHeader) {
+    for(ul_ply_element_t& element : pHeader->elements) {
+        uint32_t offset = 0;
+        int fixed = 1;
+
+        for(ul_ply_property_t& property : element.properties) {
+            property.offset = offset;
+
+            if(property.countType != ULMply_none) fixed = 0;
+
+            offset += __ulMeshPLYTypeSize[property.type];
+        }
+
+        element.stride = fixed ? offset : 0;
+    }
+}
+
+// Vertex attributes we understand, everything else (colors, confidence, ...) is skipped
+enum {
+    ULMply_slot_x, ULMply_slot_y, ULMply_slot_z,
+    ULMply_slot_nx, ULMply_slot_ny, ULMply_slot_nz,
+    ULMply_slot_s, ULMply_slot_t,
+
+    ULMply_slot_END_DONT_USE
+};
+
+int __ulMeshPLYVertexSlot(const std::string& name) {
+    if(name == "x") return ULMply_slot_x;
+    if(name == "y") return ULMply_slot_y;
+    if(name == "z") return ULMply_slot_z;
+    if(name == "nx") return ULMply_slot_nx;
+    if(name == "ny") return ULMply_slot_ny;
+    if(name == "nz") return ULMply_slot_nz;
+    if(name == "s" || name == "u" || name == "texture_u" || name == "texture_s") return ULMply_slot_s;
+    if(name == "t" || name == "v" || name == "texture_v" || name == "texture_t") return ULMply_slot_t;
+
+    return -1;
+}
+
+typedef struct ul_ply_op_s {
+    uint32_t offset;
+    uint32_t slot;
+    // Amount of consecutive native floats copied at once when read is 0
+    uint32_t count;
+    ul_ply_read_fn read;
+} ul_ply_op_t;
+
+/**
+ * @brief Compile decoder of fixed size binary vertex element. Consecutive native endian floats going into consecutive slots
+ * are merged into single copy, everything else gets its reader resolved here once
+ *
+ * @param pElement vertex element with stride != 0
+ * @param swap 1 when file endianness differs from host
+ * @param pOps output program
+ */
+void __ulMeshCompilePLYVertexDecoder(const ul_ply_element_t* pElement, int swap, std::vector<ul_ply_op_t>* pOps) {
+    for(const ul_ply_property_t& property : pElement->properties) {
+        int slot = __ulMeshPLYVertexSlot(property.name);
+
+        if(slot < 0) continue;
+
+        if(property.type == ULMply_float32 && !swap) {
+            if(!pOps->empty()) {
+                ul_ply_op_t& last = pOps->back();
+
+                if(!last.read && last.offset + last.count * 4 == property.offset && last.slot + last.count == (uint32_t)slot) {
+                    last.count++;
+
+                    continue;
+                }
+            }
+
+            pOps->push_back({ property.offset, (uint32_t)slot, 1, (ul_ply_read_fn)0 });
+        }
+        else {
+            pOps->push_back({ property.offset, (uint32_t)slot, 1, __ulMeshPLYReader(property.type, swap) });
+        }
     }
 }
 
-// TODO: Save model to file format
+/**
+ * @brief Decoded PLY before it is written into ul_mesh_t
+ */
+typedef struct ul_ply_data_s {
+    std::vector<float> positions, normals, textureCoordinates;
+    // Fan triangulated faces, 3 per triangle
+    std::vector<uint32_t> indices;
+} ul_ply_data_t;
+
+/**
+ * @brief Decode binary PLY body
+ *
+ * @param pHeader parsed schema
+ * @param data first byte after header
+ * @param end end of file
+ * @param pData output
+ * @return int 1 on success, 0 when file is truncated
+ */
+int __ulMeshDecodePLYBinary(const ul_ply_header_t* pHeader, const uint8_t* data, const uint8_t* end, ul_ply_data_t* pData) {
+    const uint16_t endian_probe = 1;
+    const int host_little_endian = *(const uint8_t*)&endian_probe == 1;
+    const int swap = (pHeader->format == ULMply_binary_little_endian) != host_little_endian;
+
+    const uint8_t* p = data;
+
+    for(const ul_ply_element_t& element : pHeader->elements) {
+        if(element.name == "vertex" && element.stride != 0) {
+            if((size_t)(end - p) / element.stride < element.count) return 0;
+
+            std::vector<ul_ply_op_t> ops;
+            __ulMeshCompilePLYVertexDecoder(&element, swap, &ops);
+
+            int present[ULMply_slot_END_DONT_USE] = { 0 };
+
+            for(const ul_ply_op_t& op : ops) {
+                for(uint32_t i = 0; i < op.count; i++) present[op.slot + i] = 1;
+            }
+
+            const int has_normals = present[ULMply_slot_nx] && present[ULMply_slot_ny] && present[ULMply_slot_nz];
+            const int has_texcoords = present[ULMply_slot_s] && present[ULMply_slot_t];
+
+            pData->positions.resize(element.count * 3);
+            if(has_normals) pData->normals.resize(element.count * 3);
+            if(has_texcoords) pData->textureCoordinates.resize(element.count * 2);
+
+            float slots[ULMply_slot_END_DONT_USE] = { 0.0f };
+
+            for(size_t i = 0; i < element.count; i++) {
+                const uint8_t* record = p + i * element.stride;
+
+                for(const ul_ply_op_t& op : ops) {
+                    if(op.read) {
+                        slots[op.slot] = (float)op.read(record + op.offset);
+                    }
+                    else {
+                        memcpy(&slots[op.slot], record + op.offset, op.count * sizeof(float));
+                    }
+                }
+
+                memcpy(&pData->positions[i * 3], &slots[ULMply_slot_x], sizeof(float) * 3);
+                if(has_normals) memcpy(&pData->normals[i * 3], &slots[ULMply_slot_nx], sizeof(float) * 3);
+                if(has_texcoords) memcpy(&pData->textureCoordinates[i * 2], &slots[ULMply_slot_s], sizeof(float) * 2);
+            }
+
+            p += element.count * element.stride;
+
+            continue;
+        }
+
+        if(element.stride != 0) {
+            if((size_t)(end - p) / element.stride < element.count) return 0;
+
+            p += element.count * element.stride;
+
+            continue;
+        }
+
+        // Variable size elements, walk property by property with readers resolved up front
+        const int is_face = element.name == "face";
+        const int is_vertex = element.name == "vertex";
+
+        std::vector<ul_ply_read_fn> count_readers, item_readers;
+        std::vector<int> vertex_slots;
+
+        for(const ul_ply_property_t& property : element.properties) {
+            count_readers.push_back(__ulMeshPLYReader(property.countType, swap));
+            item_readers.push_back(__ulMeshPLYReader(property.type, swap));
+            vertex_slots.push_back(is_vertex ? __ulMeshPLYVertexSlot(property.name) : -1);
+        }
+
+        int present[ULMply_slot_END_DONT_USE] = { 0 };
+
+        for(int slot : vertex_slots) {
+            if(slot >= 0) present[slot] = 1;
+        }
+
+        const int has_normals = is_vertex && present[ULMply_slot_nx] && present[ULMply_slot_ny] && present[ULMply_slot_nz];
+        const int has_texcoords = is_vertex && present[ULMply_slot_s] && present[ULMply_slot_t];
+
+        uint32_t face[256];
+
+        for(size_t i = 0; i < element.count; i++) {
+            float slots[ULMply_slot_END_DONT_USE] = { 0.0f };
+
+            for(size_t j = 0; j < element.properties.size(); j++) {
+                const ul_ply_property_t& property = element.properties[j];
+                const uint32_t item_size = __ulMeshPLYTypeSize[property.type];
+
+                if(property.countType == ULMply_none) {
+                    if((size_t)(end - p) < item_size) return 0;
+
+                    if(vertex_slots[j] >= 0) slots[vertex_slots[j]] = (float)item_readers[j](p);
+
+                    p += item_size;
+
+                    continue;
+                }
+
+                const uint32_t count_size = __ulMeshPLYTypeSize[property.countType];
+
+                if((size_t)(end - p) < count_size) return 0;
+
+                const size_t item_count = (size_t)count_readers[j](p);
+                p += count_size;
+
+                if((size_t)(end - p) / item_size < item_count) return 0;
+
+                if(is_face && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                    const size_t face_size = item_count < 256 ? item_count : 256;
+
+                    for(size_t k = 0; k < face_size; k++) face[k] = (uint32_t)item_readers[j](p + k * item_size);
+
+                    for(size_t k = 2; k < face_size; k++) {
+                        pData->indices.push_back(face[0]);
+                        pData->indices.push_back(face[k - 1]);
+                        pData->indices.push_back(face[k]);
+                    }
+                }
+
+                p += item_count * item_size;
+            }
+
+            if(is_vertex) {
+                pData->positions.insert(pData->positions.end(), &slots[ULMply_slot_x], &slots[ULMply_slot_x] + 3);
+                if(has_normals) pData->normals.insert(pData->normals.end(), &slots[ULMply_slot_nx], &slots[ULMply_slot_nx] + 3);
+                if(has_texcoords) pData->textureCoordinates.insert(pData->textureCoordinates.end(), &slots[ULMply_slot_s], &slots[ULMply_slot_s] + 2);
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Decode ascii PLY body, values are read in schema order regardless of line breaks
+ *
+ * @param pHeader parsed schema
+ * @param data first byte after header
+ * @param end end of file
+ * @param pData output
+ * @return int 1 on success, 0 when file is truncated
+ */
+int __ulMeshDecodePLYAscii(const ul_ply_header_t* pHeader, const char* data, const char* end, ul_ply_data_t* pData) {
+    const char* p = data;
+
+    for(const ul_ply_element_t& element : pHeader->elements) {
+        const int is_face = element.name == "face";
+        const int is_vertex = element.name == "vertex";
+
+        std::vector<int> vertex_slots;
+        int present[ULMply_slot_END_DONT_USE] = { 0 };
+
+        for(const ul_ply_property_t& property : element.properties) {
+            vertex_slots.push_back(is_vertex ? __ulMeshPLYVertexSlot(property.name) : -1);
+
+            if(vertex_slots.back() >= 0) present[vertex_slots.back()] = 1;
+        }
+
+        const int has_normals = is_vertex && present[ULMply_slot_nx] && present[ULMply_slot_ny] && present[ULMply_slot_nz];
+        const int has_texcoords = is_vertex && present[ULMply_slot_s] && present[ULMply_slot_t];
+
+        if(is_vertex) {
+            pData->positions.reserve(element.count * 3);
+            if(has_normals) pData->normals.reserve(element.count * 3);
+            if(has_texcoords) pData->textureCoordinates.reserve(element.count * 2);
+        }
+
+        uint32_t face[256];
+
+        for(size_t i = 0; i < element.count; i++) {
+            float slots[ULMply_slot_END_DONT_USE] = { 0.0f };
+
+            for(size_t j = 0; j < element.properties.size(); j++) {
+                const ul_ply_property_t& property = element.properties[j];
+                size_t item_count = 1;
+
+                if(property.countType != ULMply_none) {
+                    int64_t count;
+
+                    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+
+                    const char* after = ulMeshParseInt(p, end, &count);
+
+                    if(after == p || count < 0) return 0;
+
+                    p = after;
+                    item_count = (size_t)count;
+                }
+
+                const int is_indices = is_face && property.countType != ULMply_none && (property.name == "vertex_indices" || property.name == "vertex_index");
+
+                for(size_t k = 0; k < item_count; k++) {
+                    float value;
+
+                    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+
+                    const char* after = ulMeshParseFloat(p, end, &value);
+
+                    if(after == p) return 0;
+
+                    if(is_indices) {
+                        int64_t index;
+                        ulMeshParseInt(p, end, &index);
+
+                        if(k < 256) face[k] = (uint32_t)index;
+                    }
+                    else if(vertex_slots[j] >= 0) {
+                        slots[vertex_slots[j]] = value;
+                    }
+
+                    p = after;
+                }
+
+                if(is_indices) {
+                    const size_t face_size = item_count < 256 ? item_count : 256;
+
+                    for(size_t k = 2; k < face_size; k++) {
+                        pData->indices.push_back(face[0]);
+                        pData->indices.push_back(face[k - 1]);
+                        pData->indices.push_back(face[k]);
+                    }
+                }
+            }
+
+            if(is_vertex) {
+                pData->positions.insert(pData->positions.end(), &slots[ULMply_slot_x], &slots[ULMply_slot_x] + 3);
+                if(has_normals) pData->normals.insert(pData->normals.end(), &slots[ULMply_slot_nx], &slots[ULMply_slot_nx] + 3);
+                if(has_texcoords) pData->textureCoordinates.insert(pData->textureCoordinates.end(), &slots[ULMply_slot_s], &slots[ULMply_slot_s] + 2);
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Load ascii or binary (little/big endian) PLY. Header is parsed into schema first, so extra properties (colors,
+ * confidence, ...) and their order don`t matter
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param path path to mesh
+ * @param indexed 1 to keep PLY vertices and fill indices (only when pMesh is empty), 0 for triangle soup
+ * @return int 1 on success, 0 on failure
+ */
+int __ulMeshLoadPLY(ul_mesh_t* pMesh, const char* path, int indexed = 0) {
+    ul_mapped_file_t mesh_file;
+
+    if(!ulMapFile(&mesh_file, path)) {
+        printf("Cannot open ply model!\n");
+
+        return 0;
+    }
+
+    ul_ply_header_t header;
+
+    if(!__ulMeshParsePLYHeader((const char*)mesh_file.data, mesh_file.size, &header)) {
+        ulUnmapFile(&mesh_file);
+
+        printf("Desired model isn`t ply model!\n");
+
+        return 0;
+    }
+
+    __ulMeshLayoutPLYElements(&header);
+
+    ul_ply_data_t ply;
+    int result;
+
+    if(header.format == ULMply_ascii) {
+        result = __ulMeshDecodePLYAscii(&header, (const char*)mesh_file.data + header.dataOffset, (const char*)mesh_file.data + mesh_file.size, &ply);
+    }
+    else {
+        result = __ulMeshDecodePLYBinary(&header, mesh_file.data + header.dataOffset, mesh_file.data + mesh_file.size, &ply);
+    }
+
+    ulUnmapFile(&mesh_file);
+
+    if(!result) {
+        printf("Ply model is truncated!\n");
+
+        return 0;
+    }
+
+    const size_t vertex_count = ply.positions.size() / 3;
+
+    for(uint32_t index : ply.indices) {
+        if(index >= vertex_count) {
+            printf("Ply model face references vertex that doesn`t exist!\n");
+
+            return 0;
+        }
+    }
+
+    const int has_normals = !ply.normals.empty();
+    const int has_texcoords = !ply.textureCoordinates.empty();
+
+    if(indexed && pMesh->vertices.empty()) {
+        pMesh->vertices = std::move(ply.positions);
+        pMesh->normals = std::move(ply.normals);
+        pMesh->textureCoordinates = std::move(ply.textureCoordinates);
+        pMesh->indices = std::move(ply.indices);
+        pMesh->indexed = 1;
+
+        return 1;
+    }
+
+    const size_t vertices_offset = pMesh->vertices.size();
+    const size_t normals_offset = pMesh->normals.size();
+    const size_t texcoords_offset = pMesh->textureCoordinates.size();
+    const size_t corner_count = ply.indices.size();
+
+    pMesh->vertices.resize(vertices_offset + corner_count * 3);
+    if(has_normals) pMesh->normals.resize(normals_offset + corner_count * 3);
+    if(has_texcoords) pMesh->textureCoordinates.resize(texcoords_offset + corner_count * 2);
+
+    for(size_t c = 0; c < corner_count; c++) {
+        const size_t v = ply.indices[c];
+
+        memcpy(&pMesh->vertices[vertices_offset + c * 3], &ply.positions[v * 3], sizeof(float) * 3);
+        if(has_normals) memcpy(&pMesh->normals[normals_offset + c * 3], &ply.normals[v * 3], sizeof(float) * 3);
+        if(has_texcoords) memcpy(&pMesh->textureCoordinates[texcoords_offset + c * 2], &ply.textureCoordinates[v * 2], sizeof(float) * 2);
+    }
+
+    return 1;
+}
+
+// Placeholder texture coordinates of every STL triangle, STL doesn`t store any
+static const float __ulMeshSTLTexcoords[6] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+
+/**
+ * @brief Reverse bytes of every float, binary files are little endian and big endian hosts copy them swapped
+ *
+ * @param values
+ * @param count amount of floats
+ */
+void __ulMeshSwapFloats(float* values, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, values + i, sizeof(bits));
+
+        bits = (bits >> 24) | ((bits >> 8) & 0xff00u) | ((bits << 8) & 0xff0000u) | (bits << 24);
+
+        memcpy(values + i, &bits, sizeof(bits));
+    }
+}
+
+/**
+ * @brief Decode range of binary STL triangles straight into preallocated mesh arrays
+ *
+ * @param records first 50 byte record
+ * @param count amount of triangles
+ * @param vertices output, 9 floats per triangle
+ * @param normals output, 9 floats per triangle
+ * @param texcoords output, 6 floats per triangle
+ */
+void __ulMeshDecodeSTLRecords(const uint8_t* records, size_t count, float* vertices, float* normals, float* texcoords) {
+    for(size_t i = 0; i < count; i++) {
+        const uint8_t* record = records + i * 50;
+
+        // Record: normal (3 floats), 3 vertices (9 floats), attribute byte count (uint16), all little endian and unaligned
+        memcpy(normals + 0, record, sizeof(float) * 3);
+        memcpy(normals + 3, record, sizeof(float) * 3);
+        memcpy(normals + 6, record, sizeof(float) * 3);
+        memcpy(vertices, record + 12, sizeof(float) * 9);
+        memcpy(texcoords, __ulMeshSTLTexcoords, sizeof(float) * 6);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        __ulMeshSwapFloats(normals, 9);
+        __ulMeshSwapFloats(vertices, 9);
+#endif
+
+        vertices += 9;
+        normals += 9;
+        texcoords += 6;
+    }
+}
+
+/**
+ * @brief Load binary STL, triangle count comes from header and records are decoded directly from mapped file
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param data mapped file
+ * @param size size of mapped file
+ * @param threadCount amount of threads to decode with, 0 means all hardware threads
+ * @return int 1 on success, 0 on failure
+ */
+int __ulMeshLoadSTLBinary(ul_mesh_t* pMesh, const uint8_t* data, size_t size, uint32_t threadCount) {
+    if(size < 84) {
+        printf("Binary stl model is too short!\n");
+
+        return 0;
+    }
+
+    size_t triangle_count = (size_t)data[80] | (size_t)data[81] << 8 | (size_t)data[82] << 16 | (size_t)data[83] << 24;
+
+    if(84 + triangle_count * 50 > size) {
+        printf("Binary stl model is truncated, loading only complete triangles!\n");
+
+        triangle_count = (size - 84) / 50;
+    }
+
+    const size_t vertices_offset = pMesh->vertices.size();
+    const size_t normals_offset = pMesh->normals.size();
+    const size_t texcoords_offset = pMesh->textureCoordinates.size();
+
+    pMesh->vertices.resize(vertices_offset + triangle_count * 9);
+    pMesh->normals.resize(normals_offset + triangle_count * 9);
+    pMesh->textureCoordinates.resize(texcoords_offset + triangle_count * 6);
+
+    if(threadCount == 0) threadCount = std::thread::hardware_concurrency();
+
+    // Below that copying is faster than starting threads
+    const size_t min_triangles_per_thread = 1 << 16;
+
+    if(triangle_count / min_triangles_per_thread < threadCount) threadCount = (uint32_t)(triangle_count / min_triangles_per_thread);
+    if(threadCount == 0) threadCount = 1;
+
+    const uint8_t* records = data + 84;
+
+    if(threadCount == 1) {
+        __ulMeshDecodeSTLRecords(records, triangle_count, pMesh->vertices.data() + vertices_offset, pMesh->normals.data() + normals_offset, pMesh->textureCoordinates.data() + texcoords_offset);
+
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+
+    for(uint32_t i = 0; i < threadCount; i++) {
+        size_t first = triangle_count * i / threadCount;
+        size_t last = triangle_count * (i + 1) / threadCount;
+
+        workers.emplace_back(__ulMeshDecodeSTLRecords, records + first * 50, last - first, pMesh->vertices.data() + vertices_offset + first * 9, pMesh->normals.data() + normals_offset + first * 9, pMesh->textureCoordinates.data() + texcoords_offset + first * 6);
+    }
+
+    for(std::thread& w : workers) w.join();
+
+    return 1;
+}
+
+/**
+ * @brief Load ascii STL from mapped file
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param data mapped file
+ * @param size size of mapped file
+ * @return int 1 on success
+ */
+int __ulMeshLoadSTLAscii(ul_mesh_t* pMesh, const uint8_t* data, size_t size) {
+    const char* p = (const char*)data;
+    const char* end = p + size;
+
+    float normal[3] = { 0.0f, 0.0f, 0.0f };
+    uint32_t facet_vertices = 0;
+
+    while(p < end) {
+        const char* line_end = (const char*)memchr(p, '\n', (size_t)(end - p));
+
+        if(!line_end) line_end = end;
+
+        while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+
+        if(line_end - p >= 12 && memcmp(p, "facet normal", 12) == 0) {
+            p += 12;
+
+            for(int i = 0; i < 3; i++) {
+                while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+                p = ulMeshParseFloat(p, line_end, &normal[i]);
+            }
+
+            facet_vertices = 0;
+        }
+        else if(line_end - p >= 6 && memcmp(p, "vertex", 6) == 0) {
+            float vertex[3];
+
+            p += 6;
+
+            for(int i = 0; i < 3; i++) {
+                while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+                p = ulMeshParseFloat(p, line_end, &vertex[i]);
+            }
+
+            pMesh->vertices.insert(pMesh->vertices.end(), vertex, vertex + 3);
+            pMesh->normals.insert(pMesh->normals.end(), normal, normal + 3);
+
+            // TODO: STL texture coordinates generating. Currently not generated!
+            pMesh->textureCoordinates.push_back(__ulMeshSTLTexcoords[(facet_vertices % 3) * 2 + 0]);
+            pMesh->textureCoordinates.push_back(__ulMeshSTLTexcoords[(facet_vertices % 3) * 2 + 1]);
+
+            facet_vertices++;
+        }
+
+        p = line_end + 1;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Load STL, binary or ascii is decided by file size matching triangle count from binary header, because binary files
+ * can start with "solid" too
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param path path to mesh
+ * @param threadCount threads used for binary models, 0 means all hardware threads
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshLoadSTLParallel(ul_mesh_t* pMesh, const char* path, uint32_t threadCount) {
+    ul_mapped_file_t mesh_file;
+
+    if(!ulMapFile(&mesh_file, path)) {
+        printf("Cannot open stl model!\n");
+
+        return 0;
+    }
+
+    const uint8_t* data = mesh_file.data;
+    const size_t size = mesh_file.size;
+
+    int is_binary = 1;
+
+    if(size >= 84) {
+        size_t triangle_count = (size_t)data[80] | (size_t)data[81] << 8 | (size_t)data[82] << 16 | (size_t)data[83] << 24;
+
+        is_binary = 84 + triangle_count * 50 == size || size < 5 || memcmp(data, "solid", 5) != 0;
+    }
+    else {
+        is_binary = size < 5 || memcmp(data, "solid", 5) != 0;
+    }
+
+    int result = is_binary ? __ulMeshLoadSTLBinary(pMesh, data, size, threadCount) : __ulMeshLoadSTLAscii(pMesh, data, size);
+
+    ulUnmapFile(&mesh_file);
+
+    return result;
+}
+
+int __ulMeshLoadSTL(ul_mesh_t* pMesh, const char* path) {
+    return ulMeshLoadSTLParallel(pMesh, path, 1);
+}
+
+static inline uint32_t __ulMeshHashVertex(const uint32_t* key, uint32_t keySize) {
+    uint32_t h = 0x811c9dc5u;
+
+    for(uint32_t i = 0; i < keySize; i++) {
+        h ^= key[i];
+        h *= 0x9e3779b1u;
+        h ^= h >> 15;
+    }
+
+    return h;
+}
+
+/**
+ * @brief Turn triangle soup into indexed mesh. Corners with bitwise equal (position, normal, texture coordinate) are merged
+ * into one vertex. Attribute which doesn`t cover every corner can`t be indexed and is dropped. Already indexed mesh (indexed
+ * set or indices filled) is left alone
+ *
+ * @param pMesh ul_mesh_t struct
+ */
+void ulMeshIndex(ul_mesh_t* pMesh) {
+    // Meshes filled by hand may have indices without flag
+    if(pMesh->indexed || !pMesh->indices.empty()) {
+        pMesh->indexed = 1;
+
+        return;
+    }
+
+    const size_t corner_count = pMesh->vertices.size() / 3;
+
+    if(corner_count == 0) return;
+
+    if(corner_count > 0xffffffffu) {
+        printf("Mesh is too big to be indexed with 32 bit indices!\n");
+
+        return;
+    }
+
+    const int has_normals = pMesh->normals.size() == corner_count * 3;
+    const int has_texcoords = pMesh->textureCoordinates.size() == corner_count * 2;
+
+    if(!has_normals && !pMesh->normals.empty()) {
+        printf("Not every corner has normal, dropping normals while indexing!\n");
+        pMesh->normals.clear();
+    }
+
+    if(!has_texcoords && !pMesh->textureCoordinates.empty()) {
+        printf("Not every corner has texture coordinate, dropping texture coordinates while indexing!\n");
+        pMesh->textureCoordinates.clear();
+    }
+
+    const uint32_t key_size = 3 + (has_normals ? 3 : 0) + (has_texcoords ? 2 : 0);
+
+    size_t table_size = 1;
+    while(table_size < corner_count * 2) table_size <<= 1;
+
+    // Open addressing table of unique vertex ids, linear probing
+    std::vector<uint32_t> table(table_size, 0xffffffffu);
+    std::vector<uint32_t> keys;
+    keys.reserve(corner_count * key_size);
+
+    pMesh->indices.resize(corner_count);
+
+    uint32_t unique_count = 0;
+    uint32_t key[8];
+
+    for(size_t c = 0; c < corner_count; c++) {
+        memcpy(&key[0], &pMesh->vertices[c * 3], sizeof(float) * 3);
+
+        uint32_t k = 3;
+
+        if(has_normals) {
+            memcpy(&key[k], &pMesh->normals[c * 3], sizeof(float) * 3);
+            k += 3;
+        }
+
+        if(has_texcoords) {
+            memcpy(&key[k], &pMesh->textureCoordinates[c * 2], sizeof(float) * 2);
+        }
+
+        size_t slot = __ulMeshHashVertex(key, key_size) & (table_size - 1);
+
+        while(table[slot] != 0xffffffffu && memcmp(&keys[(size_t)table[slot] * key_size], key, key_size * sizeof(uint32_t)) != 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if(table[slot] == 0xffffffffu) {
+            table[slot] = unique_count++;
+            keys.insert(keys.end(), key, key + key_size);
+        }
+
+        pMesh->indices[c] = table[slot];
+    }
+
+    // Unique vertices are numbered in order of first use, so they can be compacted in place
+    uint32_t next = 0;
+
+    for(size_t c = 0; c < corner_count; c++) {
+        if(pMesh->indices[c] != next) continue;
+
+        memmove(&pMesh->vertices[(size_t)next * 3], &pMesh->vertices[c * 3], sizeof(float) * 3);
+        if(has_normals) memmove(&pMesh->normals[(size_t)next * 3], &pMesh->normals[c * 3], sizeof(float) * 3);
+        if(has_texcoords) memmove(&pMesh->textureCoordinates[(size_t)next * 2], &pMesh->textureCoordinates[c * 2], sizeof(float) * 2);
+
+        next++;
+    }
+
+    pMesh->vertices.resize((size_t)unique_count * 3);
+    pMesh->vertices.shrink_to_fit();
+
+    if(has_normals) {
+        pMesh->normals.resize((size_t)unique_count * 3);
+        pMesh->normals.shrink_to_fit();
+    }
+
+    if(has_texcoords) {
+        pMesh->textureCoordinates.resize((size_t)unique_count * 2);
+        pMesh->textureCoordinates.shrink_to_fit();
+    }
+
+    pMesh->indexed = 1;
+}
+
+/**
+ * @brief Check if indices of mesh fit into 16 bit index buffer
+ *
+ * @param pMesh indexed ul_mesh_t struct
+ * @return int 1 when every vertex can be addressed with uint16_t
+ */
+int ulMeshIndicesFit16(const ul_mesh_t* pMesh) {
+    return pMesh->vertices.size() / 3 <= 0x10000;
+}
+
+/**
+ * @brief Copy indices into 16 bit index buffer, check ulMeshIndicesFit16 first
+ *
+ * @param pMesh indexed ul_mesh_t struct
+ * @param pIndices output 16 bit indices
+ */
+void ulMeshCopyIndices16(const ul_mesh_t* pMesh, std::vector<uint16_t>* pIndices) {
+    pIndices->resize(pMesh->indices.size());
+
+    for(size_t i = 0; i < pMesh->indices.size(); i++) {
+        (*pIndices)[i] = (uint16_t)pMesh->indices[i];
+    }
+}
+
+typedef struct ul_mesh_optimize_report_s {
+    ul_mesh_cache_stats_t before, after;
+} ul_mesh_optimize_report_t;
+
+/**
+ * @brief Reorder triangles for vertex cache (and optionally overdraw), then reorder vertices for fetch locality.
+ * Triangle soup gets indexed first
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param overdraw 1 to also sort triangle clusters against overdraw
+ * @param pReport optional, simulated cache statistics before and after
+ */
+void ulMeshOptimize(ul_mesh_t* pMesh, int overdraw, ul_mesh_optimize_report_t* pReport = (ul_mesh_optimize_report_t*)0) {
+    ulMeshIndex(pMesh);
+
+    // Vertices get renumbered, old levels would index wrong ones
+    pMesh->lods.clear();
+
+    const size_t vertex_count = pMesh->vertices.size() / 3;
+    const size_t index_count = pMesh->indices.size();
+
+    if(pReport) pReport->before = ulMeshSimulateVertexCache(pMesh->indices.data(), index_count, vertex_count, ULM_DEFAULT_CACHE_SIZE);
+
+    std::vector<uint32_t> reordered(index_count);
+    ulMeshOptimizeVertexCache(reordered.data(), pMesh->indices.data(), index_count, vertex_count);
+
+    if(overdraw) {
+        ulMeshOptimizeOverdraw(pMesh->indices.data(), reordered.data(), index_count, pMesh->vertices.data(), vertex_count, 1.05f);
+    }
+    else {
+        pMesh->indices.swap(reordered);
+    }
+
+    std::vector<uint32_t> remap(vertex_count);
+    ulMeshOptimizeVertexFetchRemap(remap.data(), pMesh->indices.data(), index_count, vertex_count);
+
+    const int has_normals = pMesh->normals.size() == vertex_count * 3;
+    const int has_texcoords = pMesh->textureCoordinates.size() == vertex_count * 2;
+
+    std::vector<float> attribute(vertex_count * 3);
+
+    for(size_t v = 0; v < vertex_count; v++) memcpy(&attribute[(size_t)remap[v] * 3], &pMesh->vertices[v * 3], sizeof(float) * 3);
+
+    pMesh->vertices.swap(attribute);
+
+    if(has_normals) {
+        for(size_t v = 0; v < vertex_count; v++) memcpy(&attribute[(size_t)remap[v] * 3], &pMesh->normals[v * 3], sizeof(float) * 3);
+
+        pMesh->normals.swap(attribute);
+    }
+
+    if(has_texcoords) {
+        attribute.resize(vertex_count * 2);
+
+        for(size_t v = 0; v < vertex_count; v++) memcpy(&attribute[(size_t)remap[v] * 2], &pMesh->textureCoordinates[v * 2], sizeof(float) * 2);
+
+        pMesh->textureCoordinates.swap(attribute);
+    }
+
+    if(pReport) pReport->after = ulMeshSimulateVertexCache(pMesh->indices.data(), index_count, vertex_count, ULM_DEFAULT_CACHE_SIZE);
+}
+
+/**
+ * @brief Load mesh to ul_mesh_t struct, REMEMBER THAT STL ONLY HAVE VERTICES AND NORMALS!
+ * 
+ * @param pMesh ul_mesh_t struct
+ * @param path path to mesh
+ * @param type ULMtype_
+ * @param flags ULMflag_
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshLoad(ul_mesh_t* pMesh, const char* path, uint32_t type, uint32_t flags = 0) {
+    int result = 0;
+
+    if(type == ULMtype_ply) {
+        // Optimize flags imply indexed, PLY vertices are kept as they are then too
+        result = __ulMeshLoadPLY(pMesh, path, (flags & (ULMflag_indexed | ULMflag_optimize | ULMflag_optimize_overdraw)) != 0);
+    }
+    else if(type == ULMtype_obj) {
+        if(flags & ULMflag_parallel) {
+            result = ulMeshLoadOBJParallel(pMesh, path, 0);
+        }
+        else {
+            result = __ulMeshLoadOBJ(pMesh, path);
+        }
+    }
+    else if(type == ULMtype_stl) {
+        if(flags & ULMflag_parallel) {
+            result = ulMeshLoadSTLParallel(pMesh, path, 0);
+        }
+        else {
+            result = __ulMeshLoadSTL(pMesh, path);
+        }
+    }
+
+    if(result && (flags & (ULMflag_optimize | ULMflag_optimize_overdraw))) {
+        ulMeshOptimize(pMesh, (flags & ULMflag_optimize_overdraw) != 0);
+    }
+    else if(result && (flags & ULMflag_indexed)) {
+        ulMeshIndex(pMesh);
+    }
+
+    return result;
+}
+
+// Engine native binary mesh (.twm), everything little endian, streams 16 byte aligned so they can be used straight from mapping
+#define ULM_TWM_MAGIC 0x314d5754u // "TWM1"
+#define ULM_TWM_VERSION 2
+
+// ul_twm_header_t flags
+#define ULM_TWM_FLAG_INDEXED 0x1u
+
+enum {
+    ULMattrib_position,
+    ULMattrib_normal,
+    ULMattrib_texture_coordinate,
+    ULMattrib_index,
+    // Ratio and error of every LOD, 2 floats each
+    ULMattrib_lod_metrics,
+    // Indices of one LOD, one stream per LOD after metrics
+    ULMattrib_lod_index,
+
+    ULMattrib_END_DONT_USE
+};
+
+typedef struct ul_twm_header_s {
+    uint32_t magic;
+    uint32_t version;
+    // Hash of source model (and load flags) this file was generated from
+    uint64_t sourceHash;
+    // Hash of everything after header
+    uint64_t contentHash;
+    // 5 + LOD count
+    uint32_t streamCount;
+    // ULM_TWM_FLAG_
+    uint32_t flags;
+} ul_twm_header_t;
+
+typedef struct ul_twm_stream_s {
+    // ULMattrib_
+    uint32_t attribute;
+    // Components per element, type is float for attributes and uint32_t for indices
+    uint32_t components;
+    // Elements (not components) in stream
+    uint64_t count;
+    // Byte offset from start of file
+    uint64_t offset;
+} ul_twm_stream_t;
+
+typedef struct ul_twm_lod_view_s {
+    std::span<const uint32_t> indices;
+    float ratio, error;
+} ul_twm_lod_view_t;
+
+typedef struct ul_twm_view_s {
+    ul_mapped_file_t file;
+    uint64_t sourceHash;
+    // Same as ul_mesh_t::indexed
+    int indexed;
+
+    // Point straight into mapped file, valid until ulMeshUnmapTWM
+    std::span<const float> vertices, normals, textureCoordinates;
+    std::span<const uint32_t> indices;
+    std::vector<ul_twm_lod_view_t> lods;
+} ul_twm_view_t;
+
+/**
+ * @brief Save mesh with its LODs to engine native binary format
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param path path to .twm file, written through temporary file so readers never see half written file
+ * @param sourceHash hash identifying source of mesh, see ulMeshLoadCached
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshSaveTWM(const ul_mesh_t* pMesh, const char* path, uint64_t sourceHash) {
+    std::vector<float> lod_metrics;
+
+    for(const ul_mesh_lod_t& lod : pMesh->lods) {
+        lod_metrics.push_back(lod.ratio);
+        lod_metrics.push_back(lod.error);
+    }
+
+    std::vector<const void*> stream_data = { pMesh->vertices.data(), pMesh->normals.data(), pMesh->textureCoordinates.data(), pMesh->indices.data(), lod_metrics.data() };
+    std::vector<ul_twm_stream_t> streams = {
+        { ULMattrib_position, 3, pMesh->vertices.size() / 3, 0 },
+        { ULMattrib_normal, 3, pMesh->normals.size() / 3, 0 },
+        { ULMattrib_texture_coordinate, 2, pMesh->textureCoordinates.size() / 2, 0 },
+        { ULMattrib_index, 1, pMesh->indices.size(), 0 },
+        { ULMattrib_lod_metrics, 2, pMesh->lods.size(), 0 }
+    };
+
+    for(const ul_mesh_lod_t& lod : pMesh->lods) {
+        stream_data.push_back(lod.indices.data());
+        streams.push_back({ ULMattrib_lod_index, 1, lod.indices.size(), 0 });
+    }
+
+    const size_t table_size = streams.size() * sizeof(ul_twm_stream_t);
+
+    ul_twm_header_t header;
+    header.magic = ULM_TWM_MAGIC;
+    header.version = ULM_TWM_VERSION;
+    header.sourceHash = sourceHash;
+    header.streamCount = (uint32_t)streams.size();
+    header.flags = pMesh->indexed || !pMesh->indices.empty() ? ULM_TWM_FLAG_INDEXED : 0;
+
+    // Descriptor right after header, then streams each aligned to 16 bytes
+    std::vector<uint8_t> body(table_size);
+    uint64_t offset = sizeof(ul_twm_header_t) + table_size;
+
+    for(size_t i = 0; i < streams.size(); i++) {
+        const size_t bytes = streams[i].count * streams[i].components * 4;
+
+        while(offset % 16) {
+            body.push_back(0);
+            offset++;
+        }
+
+        streams[i].offset = offset;
+
+        if(bytes) body.insert(body.end(), (const uint8_t*)stream_data[i], (const uint8_t*)stream_data[i] + bytes);
+
+        offset += bytes;
+    }
+
+    memcpy(body.data(), streams.data(), table_size);
+
+    header.contentHash = ulHash64(body.data(), body.size(), 0);
+
+    // Unique per writer, two processes regenerating same cache must not write into one temporary file
+    std::string temp_path = ulTempPath(path);
+    FILE* twm_file = fopen(temp_path.c_str(), "wb");
+
+    if(!twm_file) {
+        printf("Cannot create twm file!\n");
+
+        return 0;
+    }
+
+    int written = fwrite(&header, sizeof(header), 1, twm_file) == 1 && fwrite(body.data(), 1, body.size(), twm_file) == body.size();
+    written &= fclose(twm_file) == 0;
+
+    if(!written) {
+        remove(temp_path.c_str());
+        printf("Cannot write twm file!\n");
+
+        return 0;
+    }
+
+    remove(path);
+
+    if(rename(temp_path.c_str(), path) != 0) {
+        remove(temp_path.c_str());
+        printf("Cannot write twm file!\n");
+
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Unmap view created by ulMeshMapTWM, spans are invalid after that
+ *
+ * @param pView view
+ */
+void ulMeshUnmapTWM(ul_twm_view_t* pView) {
+    ulUnmapFile(&pView->file);
+
+    pView->vertices = std::span<const float>();
+    pView->normals = std::span<const float>();
+    pView->textureCoordinates = std::span<const float>();
+    pView->indices = std::span<const uint32_t>();
+    pView->indexed = 0;
+    pView->lods.clear();
+}
+
+/**
+ * @brief Map .twm file and point spans into it, nothing is parsed or copied
+ *
+ * @param pView output view, release it with ulMeshUnmapTWM
+ * @param path path to .twm file
+ * @param verify 1 to check content hash (reads whole file), 0 to trust it
+ * @return int 1 on success, 0 when file is missing, damaged or from other version
+ */
+int ulMeshMapTWM(ul_twm_view_t* pView, const char* path, int verify) {
+    ulMeshUnmapTWM(pView);
+
+    if(!ulMapFile(&pView->file, path)) return 0;
+
+    const uint8_t* data = pView->file.data;
+    const size_t size = pView->file.size;
+
+    ul_twm_header_t header;
+
+    if(size < sizeof(header)) {
+        ulMeshUnmapTWM(pView);
+
+        return 0;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if(header.magic != ULM_TWM_MAGIC || header.version != ULM_TWM_VERSION || header.streamCount < 5 || header.streamCount > (size - sizeof(header)) / sizeof(ul_twm_stream_t)) {
+        ulMeshUnmapTWM(pView);
+
+        return 0;
+    }
+
+    if(verify && ulHash64(data + sizeof(header), size - sizeof(header), 0) != header.contentHash) {
+        ulMeshUnmapTWM(pView);
+
+        return 0;
+    }
+
+    std::vector<ul_twm_stream_t> streams(header.streamCount);
+    memcpy(streams.data(), data + sizeof(header), streams.size() * sizeof(ul_twm_stream_t));
+
+    // Spans below have fixed component counts, so file has to agree with them. Count is checked by division, file
+    // controls it and count * components * 4 can wrap around
+    const uint32_t components[5] = { 3, 3, 2, 1, 2 };
+
+    for(uint32_t i = 0; i < header.streamCount; i++) {
+        const uint32_t attribute = i < 5 ? i : (uint32_t)ULMattrib_lod_index;
+        const uint32_t expected = i < 5 ? components[i] : 1;
+
+        if(streams[i].attribute != attribute || streams[i].components != expected || streams[i].offset % 16 || streams[i].offset > size || streams[i].count > (size - streams[i].offset) / (expected * 4)) {
+            ulMeshUnmapTWM(pView);
+
+            return 0;
+        }
+    }
+
+    // One index stream per LOD
+    if(streams[4].count != header.streamCount - 5) {
+        ulMeshUnmapTWM(pView);
+
+        return 0;
+    }
+
+    const float* lod_metrics = (const float*)(data + streams[4].offset);
+
+    pView->sourceHash = header.sourceHash;
+    pView->indexed = (header.flags & ULM_TWM_FLAG_INDEXED) != 0;
+    pView->vertices = std::span<const float>((const float*)(data + streams[0].offset), streams[0].count * 3);
+    pView->normals = std::span<const float>((const float*)(data + streams[1].offset), streams[1].count * 3);
+    pView->textureCoordinates = std::span<const float>((const float*)(data + streams[2].offset), streams[2].count * 2);
+    pView->indices = std::span<const uint32_t>((const uint32_t*)(data + streams[3].offset), streams[3].count);
+
+    for(uint32_t i = 5; i < header.streamCount; i++) {
+        pView->lods.push_back({ std::span<const uint32_t>((const uint32_t*)(data + streams[i].offset), streams[i].count), lod_metrics[(i - 5) * 2], lod_metrics[(i - 5) * 2 + 1] });
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Hash cache entry of source model is keyed on: source content, type and flags changing output
+ *
+ * @param path path to source mesh
+ * @param type ULMtype_
+ * @param flags ULMflag_
+ * @param pHash output
+ * @return int 1 on success, 0 when source cannot be read
+ */
+int __ulMeshCacheKey(const char* path, uint32_t type, uint32_t flags, uint64_t* pHash) {
+    if(!ulHashFile(path, pHash)) {
+        printf("Cannot open source model!\n");
+
+        return 0;
+    }
+
+    // Indexed, optimized and soup output differ, so flags are part of cache key
+    const uint64_t key_data[2] = { (uint64_t)type, (uint64_t)(flags & (ULMflag_indexed | ULMflag_optimize | ULMflag_optimize_overdraw)) };
+    *pHash = ulHash64(key_data, sizeof(key_data), *pHash);
+
+    return 1;
+}
+
+/**
+ * @brief Store mesh as .twm cache of source model (path + ".twm"), e.g. after ulMeshGenerateLODs on mesh from
+ * ulMeshLoadCached so next load gets LODs too
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param path path to source mesh
+ * @param type ULMtype_ mesh was loaded with
+ * @param flags ULMflag_ mesh was loaded with
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshSaveCached(const ul_mesh_t* pMesh, const char* path, uint32_t type, uint32_t flags = 0) {
+    uint64_t source_hash;
+
+    if(!__ulMeshCacheKey(path, type, flags, &source_hash)) return 0;
+
+    return ulMeshSaveTWM(pMesh, (std::string(path) + ".twm").c_str(), source_hash);
+}
+
+/**
+ * @brief Map .twm cache next to source model (path + ".twm") without copying anything, spans of view point into cache file.
+ * Cache is used when it is intact and was generated from source with same content and flags, otherwise model is loaded
+ * with ulMeshLoad, cache is regenerated and mapped
+ *
+ * @param pView output view, release it with ulMeshUnmapTWM
+ * @param path path to source mesh
+ * @param type ULMtype_
+ * @param flags ULMflag_
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshMapCached(ul_twm_view_t* pView, const char* path, uint32_t type, uint32_t flags = 0) {
+    uint64_t source_hash;
+
+    if(!__ulMeshCacheKey(path, type, flags, &source_hash)) return 0;
+
+    std::string cache_path = std::string(path) + ".twm";
+
+    if(ulMeshMapTWM(pView, cache_path.c_str(), 1) && pView->sourceHash == source_hash) return 1;
+
+    ulMeshUnmapTWM(pView);
+
+    ul_mesh_t mesh;
+
+    if(!ulMeshLoad(&mesh, path, type, flags) || !ulMeshSaveTWM(&mesh, cache_path.c_str(), source_hash)) return 0;
+
+    return ulMeshMapTWM(pView, cache_path.c_str(), 1);
+}
+
+/**
+ * @brief Load mesh through .twm cache next to source model (path + ".twm"), streams and LODs are copied out of mapped cache
+ * into pMesh (ulMeshMapCached uses them in place). Cache is used when it is intact and was generated from source with same
+ * content and flags, otherwise model is loaded with ulMeshLoad and cache is regenerated. pMesh should be empty
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param path path to source mesh
+ * @param type ULMtype_
+ * @param flags ULMflag_
+ * @return int 1 on success, 0 on failure
+ */
+int ulMeshLoadCached(ul_mesh_t* pMesh, const char* path, uint32_t type, uint32_t flags = 0) {
+    uint64_t source_hash;
+
+    if(!__ulMeshCacheKey(path, type, flags, &source_hash)) return 0;
+
+    std::string cache_path = std::string(path) + ".twm";
+    ul_twm_view_t view;
+
+    if(ulMeshMapTWM(&view, cache_path.c_str(), 1)) {
+        if(view.sourceHash == source_hash) {
+            pMesh->vertices.assign(view.vertices.begin(), view.vertices.end());
+            pMesh->normals.assign(view.normals.begin(), view.normals.end());
+            pMesh->textureCoordinates.assign(view.textureCoordinates.begin(), view.textureCoordinates.end());
+            pMesh->indices.assign(view.indices.begin(), view.indices.end());
+            pMesh->indexed = view.indexed;
+            pMesh->lods.clear();
+
+            for(const ul_twm_lod_view_t& lod : view.lods) {
+                pMesh->lods.push_back({ std::vector<uint32_t>(lod.indices.begin(), lod.indices.end()), lod.ratio, lod.error });
+            }
+
+            ulMeshUnmapTWM(&view);
+
+            return 1;
+        }
+
+        ulMeshUnmapTWM(&view);
+    }
+
+    if(!ulMeshLoad(pMesh, path, type, flags)) return 0;
+
+    ulMeshSaveTWM(pMesh, cache_path.c_str(), source_hash);
+
+    return 1;
+}
 
 #endif
\ No newline at end of file
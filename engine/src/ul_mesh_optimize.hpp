@@ -0,0 +1,393 @@
+/**
+ * @file ul_mesh_optimize.hpp
+ * @author Piotr "UjemnyGH" Plombon
+ * @brief Reorders indexed geometry for GPU vertex cache, vertex fetch and overdraw
+ * @version 0.1
+ * @date 2024-03-10
+ *
+ * @copyright Copyleft (c) 2024
+ *
+ * Works on plain index buffers (3 indices per triangle) so it doesn`t care where geometry came from.
+ * ul_mesh.hpp wraps it for ul_mesh_t (ulMeshOptimize, ULMflag_optimize)
+ */
+
+#pragma once
+#ifndef _UL_MESH_OPTIMIZE_
+#define _UL_MESH_OPTIMIZE_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+// Cache size used by simulator when caller doesn`t care, close to what post transform caches behave like
+#define ULM_DEFAULT_CACHE_SIZE 16
+
+typedef struct ul_mesh_cache_stats_s {
+    // Average cache miss ratio, transformed vertices per triangle (0.5 best for big grids, 3.0 worst)
+    float acmr;
+    // Average transformed to vertex ratio, transformed vertices per unique vertex (1.0 best)
+    float atvr;
+    size_t misses;
+} ul_mesh_cache_stats_t;
+
+/**
+ * @brief Simulate FIFO post transform vertex cache on CPU
+ *
+ * @param indices index buffer, 3 per triangle
+ * @param indexCount amount of indices
+ * @param vertexCount amount of vertices indices point into
+ * @param cacheSize simulated cache entries
+ * @return ul_mesh_cache_stats_t statistics
+ */
+ul_mesh_cache_stats_t ulMeshSimulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    ul_mesh_cache_stats_t stats = { 0.0f, 0.0f, 0 };
+
+    // Timestamp of vertex insertion, vertex is in FIFO when inserted less than cacheSize insertions ago
+    std::vector<size_t> inserted(vertexCount, 0);
+    std::vector<uint8_t> used(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    size_t unique = 0;
+
+    for(size_t i = 0; i < indexCount; i++) {
+        const uint32_t v = indices[i];
+
+        if(!used[v]) {
+            used[v] = 1;
+            unique++;
+        }
+
+        if(time - inserted[v] > cacheSize) {
+            inserted[v] = time++;
+            stats.misses++;
+        }
+    }
+
+    if(indexCount) stats.acmr = (float)stats.misses / (float)(indexCount / 3);
+    if(unique) stats.atvr = (float)stats.misses / (float)unique;
+
+    return stats;
+}
+
+// Forsyth "Linear-speed vertex cache optimisation" scoring
+#define ULM_FORSYTH_CACHE_SIZE 32
+
+typedef struct __ul_mesh_forsyth_tables_t {
+    float cache[ULM_FORSYTH_CACHE_SIZE + 3];
+    float valence[64];
+} __ul_mesh_forsyth_tables_t;
+
+__ul_mesh_forsyth_tables_t __ulMeshForsythMakeTables() {
+    __ul_mesh_forsyth_tables_t tables;
+
+    for(int i = 0; i < ULM_FORSYTH_CACHE_SIZE + 3; i++) {
+        if(i < 3) {
+            // Vertices of last triangle get fixed score, so we don`t favour strips over fans
+            tables.cache[i] = 0.75f;
+        }
+        else if(i < ULM_FORSYTH_CACHE_SIZE) {
+            tables.cache[i] = powf(1.0f - (float)(i - 3) / (float)(ULM_FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+        else {
+            tables.cache[i] = 0.0f;
+        }
+    }
+
+    for(int i = 0; i < 64; i++) {
+        // Boost vertices with few triangles left so lonely triangles don`t get left behind
+        tables.valence[i] = i == 0 ? 0.0f : 2.0f * powf((float)i, -0.5f);
+    }
+
+    return tables;
+}
+
+// Built once on first use, static local initialization is thread safe so meshes can be optimized from many threads
+const __ul_mesh_forsyth_tables_t* __ulMeshForsythTables() {
+    static const __ul_mesh_forsyth_tables_t tables = __ulMeshForsythMakeTables();
+
+    return &tables;
+}
+
+static inline float __ulMeshForsythVertexScore(const __ul_mesh_forsyth_tables_t* pTables, int cachePosition, uint32_t remaining) {
+    if(remaining == 0) return -1.0f;
+
+    float score = cachePosition >= 0 ? pTables->cache[cachePosition] : 0.0f;
+
+    return score + pTables->valence[remaining < 64 ? remaining : 63];
+}
+
+/**
+ * @brief Reorder triangles for vertex cache locality (Forsyth). Can`t be done in place
+ *
+ * @param destination output index buffer, indexCount indices
+ * @param indices input index buffer
+ * @param indexCount amount of indices
+ * @param vertexCount amount of vertices
+ */
+void ulMeshOptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    const __ul_mesh_forsyth_tables_t* p_tables = __ulMeshForsythTables();
+
+    const size_t triangle_count = indexCount / 3;
+
+    // Triangle adjacency in CSR form
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+
+    for(size_t i = 0; i < triangle_count * 3; i++) remaining[indices[i]]++;
+    for(size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+    for(size_t t = 0; t < triangle_count; t++) {
+        for(int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+    }
+
+    std::vector<int> cache_position(vertexCount, -1);
+    std::vector<float> vertex_score(vertexCount);
+    std::vector<float> triangle_score(triangle_count, 0.0f);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+
+    for(size_t v = 0; v < vertexCount; v++) vertex_score[v] = __ulMeshForsythVertexScore(p_tables, -1, remaining[v]);
+
+    for(size_t t = 0; t < triangle_count; t++) {
+        for(int k = 0; k < 3; k++) triangle_score[t] += vertex_score[indices[t * 3 + k]];
+    }
+
+    uint32_t cache[ULM_FORSYTH_CACHE_SIZE + 3];
+    uint32_t cache_count = 0;
+    size_t input_cursor = 0;
+    size_t output_count = 0;
+    size_t best_triangle = triangle_count;
+
+    while(output_count < triangle_count) {
+        if(best_triangle == triangle_count) {
+            // Nothing in cache has triangles left, continue from first triangle not emitted yet
+            while(input_cursor < triangle_count && emitted[input_cursor]) input_cursor++;
+
+            best_triangle = input_cursor;
+        }
+
+        const uint32_t* tri = &indices[best_triangle * 3];
+
+        memcpy(&destination[output_count * 3], tri, sizeof(uint32_t) * 3);
+        output_count++;
+        emitted[best_triangle] = 1;
+
+        // Remove triangle from adjacency of its vertices
+        for(int k = 0; k < 3; k++) {
+            const uint32_t v = tri[k];
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* end = begin + remaining[v];
+
+            for(uint32_t* a = begin; a < end; a++) {
+                if(*a == best_triangle) {
+                    *a = *(end - 1);
+                    break;
+                }
+            }
+
+            remaining[v]--;
+        }
+
+        // New cache: triangle vertices first, then old entries that aren`t duplicates
+        uint32_t new_cache[ULM_FORSYTH_CACHE_SIZE + 3];
+        uint32_t new_count = 0;
+
+        for(int k = 0; k < 3; k++) new_cache[new_count++] = tri[k];
+
+        for(uint32_t i = 0; i < cache_count; i++) {
+            const uint32_t v = cache[i];
+
+            if(v != tri[0] && v != tri[1] && v != tri[2]) new_cache[new_count++] = v;
+        }
+
+        // Vertices pushed out of cache lose cache score, so do their triangles
+        for(uint32_t i = ULM_FORSYTH_CACHE_SIZE; i < new_count; i++) {
+            const uint32_t v = new_cache[i];
+
+            cache_position[v] = -1;
+
+            const float score = __ulMeshForsythVertexScore(p_tables, -1, remaining[v]);
+            const float delta = score - vertex_score[v];
+
+            vertex_score[v] = score;
+
+            for(uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++) triangle_score[adjacency[a]] += delta;
+        }
+
+        if(new_count > ULM_FORSYTH_CACHE_SIZE) new_count = ULM_FORSYTH_CACHE_SIZE;
+
+        memcpy(cache, new_cache, sizeof(uint32_t) * new_count);
+        cache_count = new_count;
+
+        // Rescore cached vertices and their triangles, best of those goes next
+        float best_score = -1.0f;
+        best_triangle = triangle_count;
+
+        for(uint32_t i = 0; i < cache_count; i++) {
+            const uint32_t v = cache[i];
+
+            cache_position[v] = (int)i;
+
+            const float score = __ulMeshForsythVertexScore(p_tables, (int)i, remaining[v]);
+            const float delta = score - vertex_score[v];
+
+            vertex_score[v] = score;
+
+            for(uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+                const uint32_t t = adjacency[a];
+
+                triangle_score[t] += delta;
+
+                if(triangle_score[t] > best_score) {
+                    best_score = triangle_score[t];
+                    best_triangle = t;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Reorder triangle clusters so triangles facing outwards are drawn first and occlude rest (view independent).
+ * Input should already be optimized for vertex cache, clusters are split where cache is cold anyway so ACMR stays close
+ *
+ * @param destination output index buffer, indexCount indices, can`t be same as indices
+ * @param indices input index buffer
+ * @param indexCount amount of indices
+ * @param positions vertex positions, 3 floats per vertex
+ * @param vertexCount amount of vertices
+ * @param threshold allowed ACMR increase (1.05 means 5% worse), bigger gives more clusters and less overdraw
+ */
+void ulMeshOptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, float threshold) {
+    const size_t triangle_count = indexCount / 3;
+
+    if(triangle_count == 0) return;
+
+    const ul_mesh_cache_stats_t base = ulMeshSimulateVertexCache(indices, indexCount, vertexCount, ULM_DEFAULT_CACHE_SIZE);
+    const float acmr_limit = base.acmr * threshold;
+
+    // Split into clusters where triangle misses all vertices (hard boundary) or where cluster so far is cheaper than limit
+    std::vector<size_t> clusters;
+    std::vector<size_t> inserted(vertexCount, 0);
+    size_t time = ULM_DEFAULT_CACHE_SIZE + 1;
+    size_t cluster_misses = 0;
+    size_t cluster_start = 0;
+
+    for(size_t t = 0; t < triangle_count; t++) {
+        uint32_t misses = 0;
+
+        for(int k = 0; k < 3; k++) {
+            const uint32_t v = indices[t * 3 + k];
+
+            if(time - inserted[v] > ULM_DEFAULT_CACHE_SIZE) {
+                inserted[v] = time++;
+                misses++;
+            }
+        }
+
+        const size_t cluster_size = t - cluster_start;
+
+        if(t == 0 || (misses == 3 && cluster_size > 0) || (cluster_size >= 16 && (float)cluster_misses / (float)cluster_size <= acmr_limit && misses >= 2)) {
+            clusters.push_back(t);
+            cluster_start = t;
+            cluster_misses = 0;
+        }
+
+        cluster_misses += misses;
+    }
+
+    clusters.push_back(triangle_count);
+
+    float mesh_centroid[3] = { 0.0f, 0.0f, 0.0f };
+
+    for(size_t i = 0; i < triangle_count * 3; i++) {
+        for(int k = 0; k < 3; k++) mesh_centroid[k] += positions[indices[i] * 3 + k];
+    }
+
+    for(int k = 0; k < 3; k++) mesh_centroid[k] /= (float)(triangle_count * 3);
+
+    // Sort key: how much cluster faces away from mesh centre
+    std::vector<float> sort_key(clusters.size() - 1);
+    std::vector<uint32_t> order(clusters.size() - 1);
+
+    for(size_t c = 0; c + 1 < clusters.size(); c++) {
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+
+        for(size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const float* p0 = &positions[indices[t * 3 + 0] * 3];
+            const float* p1 = &positions[indices[t * 3 + 1] * 3];
+            const float* p2 = &positions[indices[t * 3 + 2] * 3];
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for(int k = 0; k < 3; k++) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * a;
+                normal[k] += n[k];
+            }
+
+            area += a;
+        }
+
+        const float normal_length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+
+        if(area > 0.0f && normal_length > 0.0f) {
+            for(int k = 0; k < 3; k++) key += (centroid[k] / area - mesh_centroid[k]) * normal[k] / normal_length;
+        }
+
+        sort_key[c] = key;
+        order[c] = (uint32_t)c;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_key[a] > sort_key[b]; });
+
+    size_t output = 0;
+
+    for(uint32_t c : order) {
+        const size_t count = (clusters[c + 1] - clusters[c]) * 3;
+
+        memcpy(&destination[output], &indices[clusters[c] * 3], count * sizeof(uint32_t));
+        output += count;
+    }
+}
+
+/**
+ * @brief Build vertex remap so vertices are stored in order of first use by index buffer, unused vertices go last
+ *
+ * @param remap output, remap[old vertex] = new vertex
+ * @param indices index buffer, rewritten to new vertex numbering
+ * @param indexCount amount of indices
+ * @param vertexCount amount of vertices
+ * @return size_t amount of vertices referenced by index buffer
+ */
+size_t ulMeshOptimizeVertexFetchRemap(uint32_t* remap, uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    for(size_t v = 0; v < vertexCount; v++) remap[v] = 0xffffffffu;
+
+    uint32_t next = 0;
+
+    for(size_t i = 0; i < indexCount; i++) {
+        uint32_t& r = remap[indices[i]];
+
+        if(r == 0xffffffffu) r = next++;
+
+        indices[i] = r;
+    }
+
+    const size_t used = next;
+
+    for(size_t v = 0; v < vertexCount; v++) {
+        if(remap[v] == 0xffffffffu) remap[v] = next++;
+    }
+
+    return used;
+}
+
+#endif
@@ -0,0 +1,379 @@
+/**
+ * @file ul_mesh_pack.hpp
+ * @author Piotr "UjemnyGH" Plombon
+ * @brief Quantizes ul_mesh_t attributes into one interleaved vertex buffer
+ * @version 0.1
+ * @date 2024-03-10
+ *
+ * @copyright Copyleft (c) 2024
+ *
+ * Positions become 16 bit unorm relative to bounding box, normals octahedral 2x16 snorm or 10:10:10:2 snorm,
+ * texture coordinates half floats. Descriptor tells how to bind result and how to scale positions back in shader
+ */
+
+#pragma once
+#ifndef _UL_MESH_PACK_
+#define _UL_MESH_PACK_
+
+#include "ul_mesh.hpp"
+#include <math.h>
+
+enum {
+    ULMnormal_octahedral_16,
+    ULMnormal_10_10_10_2
+};
+
+// Component types of packed attributes, GL side maps them to GL_ enums
+enum {
+    ULMcomponent_float,
+    ULMcomponent_half,
+    ULMcomponent_uint16,
+    ULMcomponent_int16,
+    ULMcomponent_int_2_10_10_10_rev
+};
+
+typedef struct ul_vertex_attribute_s {
+    // ULMattrib_
+    uint32_t attribute;
+    uint32_t components;
+    // ULMcomponent_
+    uint32_t type;
+    // Integer components are read as [0, 1] / [-1, 1] floats
+    uint8_t normalized;
+    // Byte offset inside vertex
+    uint32_t offset;
+} ul_vertex_attribute_t;
+
+typedef struct ul_packed_mesh_s {
+    std::vector<uint8_t> data;
+    std::vector<ul_vertex_attribute_t> attributes;
+    uint32_t stride;
+    size_t vertexCount;
+
+    // position = positionMin + normalized position * positionScale
+    float positionMin[3];
+    float positionScale[3];
+    // ULMnormal_
+    uint32_t normalEncoding;
+
+    std::vector<uint32_t> indices;
+} ul_packed_mesh_t;
+
+/**
+ * @brief Convert float to IEEE half, round to nearest even, overflow goes to infinity
+ *
+ * @param value float
+ * @return uint16_t half bits
+ */
+uint16_t ulMeshFloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t abs_bits = bits & 0x7fffffffu;
+
+    // NaN stays NaN, infinity and overflow become infinity
+    if(abs_bits > 0x7f800000u) return (uint16_t)(sign | 0x7e00u);
+    if(abs_bits >= 0x477ff000u) return (uint16_t)(sign | 0x7c00u);
+
+    // Denormal half (or zero)
+    if(abs_bits < 0x38800000u) {
+        if(abs_bits < 0x33000000u) return (uint16_t)sign;
+
+        const uint32_t mantissa = (abs_bits & 0x007fffffu) | 0x00800000u;
+        const uint32_t shift = 126 - (abs_bits >> 23);
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+
+        if(rest > halfway || (rest == halfway && (half & 1))) half++;
+
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = ((abs_bits - 0x38000000u) >> 13);
+    const uint32_t rest = abs_bits & 0x1fffu;
+
+    if(rest > 0x1000u || (rest == 0x1000u && (half & 1))) half++;
+
+    return (uint16_t)(sign | half);
+}
+
+/**
+ * @brief Convert IEEE half to float
+ *
+ * @param half half bits
+ * @return float value
+ */
+float ulMeshHalfToFloat(uint16_t half) {
+    const uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits;
+
+    if(exponent == 0) {
+        if(mantissa == 0) {
+            bits = sign;
+        }
+        else {
+            // Normalize denormal
+            int e = -1;
+
+            do {
+                e++;
+                mantissa <<= 1;
+            } while(!(mantissa & 0x400u));
+
+            bits = sign | (uint32_t)(112 - e) << 23 | (mantissa & 0x3ffu) << 13;
+        }
+    }
+    else if(exponent == 31) {
+        bits = sign | 0x7f800000u | mantissa << 13;
+    }
+    else {
+        bits = sign | (exponent + 112) << 23 | mantissa << 13;
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+static inline int16_t __ulMeshToSnorm16(float value) {
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+
+    return (int16_t)lrintf(value * 32767.0f);
+}
+
+/**
+ * @brief Encode unit normal with octahedral mapping into 2 snorm16
+ *
+ * @param normal unit vector
+ * @param out encoded x, y
+ */
+void ulMeshEncodeOctahedral(const float normal[3], int16_t out[2]) {
+    const float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+
+    if(length == 0.0f) {
+        out[0] = 0;
+        out[1] = 0;
+
+        return;
+    }
+
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+
+    if(normal[2] < 0.0f) {
+        const float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+        x = ox;
+        y = oy;
+    }
+
+    out[0] = __ulMeshToSnorm16(x);
+    out[1] = __ulMeshToSnorm16(y);
+}
+
+/**
+ * @brief Decode octahedral snorm16 normal
+ *
+ * @param in encoded x, y
+ * @param normal output unit vector
+ */
+void ulMeshDecodeOctahedral(const int16_t in[2], float normal[3]) {
+    float x = (float)in[0] / 32767.0f;
+    float y = (float)in[1] / 32767.0f;
+    float z = 1.0f - fabsf(x) - fabsf(y);
+
+    if(z < 0.0f) {
+        const float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+        x = ox;
+        y = oy;
+    }
+
+    const float length = sqrtf(x * x + y * y + z * z);
+
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+/**
+ * @brief Encode normal as signed 10:10:10:2 (GL_INT_2_10_10_10_REV layout, w = 0)
+ *
+ * @param normal unit vector
+ * @return uint32_t packed
+ */
+uint32_t ulMeshEncode1010102(const float normal[3]) {
+    uint32_t packed = 0;
+
+    for(int i = 0; i < 3; i++) {
+        float value = normal[i] < -1.0f ? -1.0f : (normal[i] > 1.0f ? 1.0f : normal[i]);
+        int32_t q = (int32_t)lrintf(value * 511.0f);
+
+        packed |= ((uint32_t)q & 0x3ffu) << (i * 10);
+    }
+
+    return packed;
+}
+
+/**
+ * @brief Decode signed 10:10:10:2 normal
+ *
+ * @param packed packed normal
+ * @param normal output vector (not renormalized)
+ */
+void ulMeshDecode1010102(uint32_t packed, float normal[3]) {
+    for(int i = 0; i < 3; i++) {
+        int32_t q = (int32_t)((packed >> (i * 10)) & 0x3ffu);
+
+        if(q & 0x200) q -= 0x400;
+
+        float value = (float)q / 511.0f;
+        normal[i] = value < -1.0f ? -1.0f : value;
+    }
+}
+
+/**
+ * @brief Quantize and interleave mesh attributes. Normals and texture coordinates are packed only when there is one per vertex
+ *
+ * @param pMesh source mesh, indexed or soup
+ * @param pPacked output
+ * @param normalEncoding ULMnormal_
+ */
+void ulMeshPack(const ul_mesh_t* pMesh, ul_packed_mesh_t* pPacked, uint32_t normalEncoding) {
+    const size_t vertex_count = pMesh->vertices.size() / 3;
+    const int has_normals = vertex_count && pMesh->normals.size() == vertex_count * 3;
+    const int has_texcoords = vertex_count && pMesh->textureCoordinates.size() == vertex_count * 2;
+
+    pPacked->attributes.clear();
+    pPacked->vertexCount = vertex_count;
+    pPacked->normalEncoding = normalEncoding;
+    pPacked->indices = pMesh->indices;
+
+    // 3 x unorm16 + padding keeps following attributes 4 byte aligned
+    uint32_t stride = 8;
+    pPacked->attributes.push_back({ ULMattrib_position, 3, ULMcomponent_uint16, 1, 0 });
+
+    if(has_normals) {
+        if(normalEncoding == ULMnormal_octahedral_16) {
+            pPacked->attributes.push_back({ ULMattrib_normal, 2, ULMcomponent_int16, 1, stride });
+        }
+        else {
+            pPacked->attributes.push_back({ ULMattrib_normal, 4, ULMcomponent_int_2_10_10_10_rev, 1, stride });
+        }
+
+        stride += 4;
+    }
+
+    if(has_texcoords) {
+        pPacked->attributes.push_back({ ULMattrib_texture_coordinate, 2, ULMcomponent_half, 0, stride });
+        stride += 4;
+    }
+
+    pPacked->stride = stride;
+
+    float min[3] = { 0.0f, 0.0f, 0.0f };
+    float max[3] = { 0.0f, 0.0f, 0.0f };
+
+    for(size_t v = 0; v < vertex_count; v++) {
+        for(int k = 0; k < 3; k++) {
+            const float value = pMesh->vertices[v * 3 + k];
+
+            if(v == 0 || value < min[k]) min[k] = value;
+            if(v == 0 || value > max[k]) max[k] = value;
+        }
+    }
+
+    for(int k = 0; k < 3; k++) {
+        pPacked->positionMin[k] = min[k];
+        pPacked->positionScale[k] = max[k] - min[k];
+    }
+
+    pPacked->data.assign(vertex_count * stride, 0);
+
+    for(size_t v = 0; v < vertex_count; v++) {
+        uint8_t* vertex = &pPacked->data[v * stride];
+        uint16_t position[4] = { 0, 0, 0, 0 };
+
+        for(int k = 0; k < 3; k++) {
+            const float scale = pPacked->positionScale[k];
+            const float normalized = scale > 0.0f ? (pMesh->vertices[v * 3 + k] - min[k]) / scale : 0.0f;
+
+            position[k] = (uint16_t)lrintf(normalized * 65535.0f);
+        }
+
+        memcpy(vertex, position, sizeof(position));
+
+        uint32_t offset = 8;
+
+        if(has_normals) {
+            if(normalEncoding == ULMnormal_octahedral_16) {
+                int16_t encoded[2];
+                ulMeshEncodeOctahedral(&pMesh->normals[v * 3], encoded);
+                memcpy(vertex + offset, encoded, sizeof(encoded));
+            }
+            else {
+                const uint32_t encoded = ulMeshEncode1010102(&pMesh->normals[v * 3]);
+                memcpy(vertex + offset, &encoded, sizeof(encoded));
+            }
+
+            offset += 4;
+        }
+
+        if(has_texcoords) {
+            const uint16_t uv[2] = { ulMeshFloatToHalf(pMesh->textureCoordinates[v * 2]), ulMeshFloatToHalf(pMesh->textureCoordinates[v * 2 + 1]) };
+            memcpy(vertex + offset, uv, sizeof(uv));
+        }
+    }
+}
+
+/**
+ * @brief Decode one packed vertex back to floats (same math shader does)
+ *
+ * @param pPacked packed mesh
+ * @param index vertex index
+ * @param position output position
+ * @param normal output normal, untouched when mesh has no normals
+ * @param textureCoordinate output texture coordinate, untouched when mesh has no texture coordinates
+ */
+void ulMeshUnpackVertex(const ul_packed_mesh_t* pPacked, size_t index, float position[3], float normal[3], float textureCoordinate[2]) {
+    const uint8_t* vertex = &pPacked->data[index * pPacked->stride];
+
+    for(const ul_vertex_attribute_t& attribute : pPacked->attributes) {
+        const uint8_t* data = vertex + attribute.offset;
+
+        if(attribute.attribute == ULMattrib_position) {
+            uint16_t q[3];
+            memcpy(q, data, sizeof(q));
+
+            for(int k = 0; k < 3; k++) position[k] = pPacked->positionMin[k] + (float)q[k] / 65535.0f * pPacked->positionScale[k];
+        }
+        else if(attribute.attribute == ULMattrib_normal) {
+            if(attribute.type == ULMcomponent_int16) {
+                int16_t q[2];
+                memcpy(q, data, sizeof(q));
+                ulMeshDecodeOctahedral(q, normal);
+            }
+            else {
+                uint32_t q;
+                memcpy(&q, data, sizeof(q));
+                ulMeshDecode1010102(q, normal);
+            }
+        }
+        else if(attribute.attribute == ULMattrib_texture_coordinate) {
+            uint16_t q[2];
+            memcpy(q, data, sizeof(q));
+
+            textureCoordinate[0] = ulMeshHalfToFloat(q[0]);
+            textureCoordinate[1] = ulMeshHalfToFloat(q[1]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,524 @@
+/**
+ * @file ul_mesh_simplify.hpp
+ * @author Piotr "UjemnyGH" Plombon
+ * @brief Quadric error edge collapse simplification and LOD chains for indexed meshes
+ * @version 0.1
+ * @date 2024-03-10
+ *
+ * @copyright Copyleft (c) 2024
+ *
+ * Vertices are only moved onto their neighbours (half edge collapse), so attributes never need interpolation. Copies of
+ * one position (flat shading, normal seams) collapse together, every copy takes target copy on its side of collapsed
+ * edge. Geometric borders are locked. Seams of attributes passed in (e.g. uv) only collapse along themselves and their
+ * corners are locked, so silhouettes and uv islands stay intact
+ */
+
+#pragma once
+#ifndef _UL_MESH_SIMPLIFY_
+#define _UL_MESH_SIMPLIFY_
+
+#include "ul_mesh.hpp"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+typedef struct ul_quadric_s {
+    // Symmetric 4x4 matrix: xx xy xz xw yy yz yw zz zw ww
+    double a[10];
+    // Summed plane weights, error divided by it is mean squared distance
+    double weight;
+} ul_quadric_t;
+
+static inline void __ulMeshQuadricAddPlane(ul_quadric_t* pQ, double nx, double ny, double nz, double d, double weight) {
+    pQ->a[0] += weight * nx * nx;
+    pQ->a[1] += weight * nx * ny;
+    pQ->a[2] += weight * nx * nz;
+    pQ->a[3] += weight * nx * d;
+    pQ->a[4] += weight * ny * ny;
+    pQ->a[5] += weight * ny * nz;
+    pQ->a[6] += weight * ny * d;
+    pQ->a[7] += weight * nz * nz;
+    pQ->a[8] += weight * nz * d;
+    pQ->a[9] += weight * d * d;
+    pQ->weight += weight;
+}
+
+static inline double __ulMeshQuadricError(const ul_quadric_t* pQ, const float* p) {
+    const double x = p[0], y = p[1], z = p[2];
+    const double* a = pQ->a;
+
+    const double error = a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+        + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+        + a[7] * z * z + 2.0 * a[8] * z
+        + a[9];
+
+    return error > 0.0 && pQ->weight > 0.0 ? error / pQ->weight : 0.0;
+}
+
+static inline void __ulMeshTriangleNormal(const float* p0, const float* p1, const float* p2, double n[3]) {
+    const double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+    const double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Attributes of two vertex copies, 0 when they are the same or none were passed
+static inline double __ulMeshSimplifyAttributeDistance(uint32_t a, uint32_t b, const float* attributes, size_t attributeStride) {
+    if(a == b || !attributes) return 0.0;
+
+    double distance = 0.0;
+
+    for(size_t k = 0; k < attributeStride; k++) {
+        const double d = (double)attributes[(size_t)a * attributeStride + k] - attributes[(size_t)b * attributeStride + k];
+
+        distance += d * d;
+    }
+
+    return distance;
+}
+
+typedef struct ul_simplify_collapse_s {
+    uint32_t from, to;
+    double cost;
+} ul_simplify_collapse_t;
+
+/**
+ * @brief Simplify indexed triangle list with quadric error metric
+ *
+ * @param destination output index buffer, at least indexCount indices, may be same as indices
+ * @param indices input index buffer
+ * @param indexCount amount of indices
+ * @param positions vertex positions, 3 floats per vertex
+ * @param vertexCount amount of vertices
+ * @param targetIndexCount stop when index count gets to or below this
+ * @param targetError stop before collapse which would move surface further than that, relative to mesh extent (FLT_MAX for no limit)
+ * @param pResultError optional, largest error of performed collapses relative to mesh extent
+ * @param attributes optional, attributes which must not tear (e.g. texture coordinates), attributeStride floats per vertex
+ * @param attributeStride amount of floats per vertex in attributes
+ * @return size_t amount of indices written to destination
+ */
+size_t ulMeshSimplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t targetIndexCount, float targetError, float* pResultError, const float* attributes = (const float*)0, size_t attributeStride = 0) {
+    std::vector<uint32_t> result(indices, indices + indexCount);
+
+    if(pResultError) *pResultError = 0.0f;
+
+    // Weld vertices with same position, simplification works on positions only
+    std::vector<uint32_t> canonical(vertexCount);
+
+    size_t table_size = 1;
+    while(table_size < vertexCount * 2) table_size <<= 1;
+
+    std::vector<uint32_t> table(table_size, 0xffffffffu);
+
+    for(size_t v = 0; v < vertexCount; v++) {
+        const float* p = &positions[v * 3];
+        size_t slot = __ulMeshHashVertex((const uint32_t*)p, 3) & (table_size - 1);
+
+        while(table[slot] != 0xffffffffu && memcmp(&positions[(size_t)table[slot] * 3], p, sizeof(float) * 3) != 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if(table[slot] == 0xffffffffu) table[slot] = (uint32_t)v;
+
+        canonical[v] = table[slot];
+    }
+
+    table.clear();
+    table.shrink_to_fit();
+
+    // Copies of every welded position, collapse moves all of them
+    std::vector<uint32_t> copy_offsets(vertexCount + 1, 0);
+    std::vector<uint32_t> copies(vertexCount);
+
+    for(size_t v = 0; v < vertexCount; v++) copy_offsets[canonical[v] + 1]++;
+    for(size_t v = 0; v < vertexCount; v++) copy_offsets[v + 1] += copy_offsets[v];
+
+    {
+        std::vector<uint32_t> fill(copy_offsets.begin(), copy_offsets.end() - 1);
+
+        for(size_t v = 0; v < vertexCount; v++) copies[fill[canonical[v]]++] = (uint32_t)v;
+    }
+
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for(size_t i = 0; i < indexCount; i++) {
+        for(int k = 0; k < 3; k++) {
+            min[k] = std::min(min[k], positions[(size_t)indices[i] * 3 + k]);
+            max[k] = std::max(max[k], positions[(size_t)indices[i] * 3 + k]);
+        }
+    }
+
+    const double extent = indexCount ? std::max(std::max(max[0] - min[0], max[1] - min[1]), max[2] - min[2]) : 0.0;
+    const double error_limit = targetError >= FLT_MAX || extent == 0.0 ? DBL_MAX : (double)targetError * extent * (double)targetError * extent;
+
+    std::vector<ul_quadric_t> quadrics(vertexCount);
+    memset(quadrics.data(), 0, quadrics.size() * sizeof(ul_quadric_t));
+
+    for(size_t t = 0; t + 2 < indexCount; t += 3) {
+        const float* p0 = &positions[(size_t)indices[t] * 3];
+        double n[3];
+
+        __ulMeshTriangleNormal(p0, &positions[(size_t)indices[t + 1] * 3], &positions[(size_t)indices[t + 2] * 3], n);
+
+        const double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        if(length == 0.0) continue;
+
+        const double nx = n[0] / length, ny = n[1] / length, nz = n[2] / length;
+        const double d = -(nx * p0[0] + ny * p0[1] + nz * p0[2]);
+
+        for(int k = 0; k < 3; k++) __ulMeshQuadricAddPlane(&quadrics[canonical[indices[t + k]]], nx, ny, nz, d, length * 0.5);
+    }
+
+    std::vector<uint32_t> adjacency_offsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint32_t> replacement(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint8_t> locked(vertexCount);
+    std::vector<uint32_t> seam_edges(vertexCount);
+    std::vector<ul_simplify_collapse_t> collapses, sorted_collapses;
+    std::vector<uint32_t> histogram(0x10000 + 1);
+    std::vector<uint32_t> neighbours_from, neighbours_to;
+    double max_error = 0.0;
+    int first_pass = 1;
+
+    // Copy of welded vertex in triangle
+    auto copy_in = [&](uint32_t triangle, uint32_t vertex) {
+        const uint32_t* tri = &result[(size_t)triangle * 3];
+
+        for(int k = 0; k < 3; k++) {
+            if(canonical[tri[k]] == vertex) return tri[k];
+        }
+
+        return 0xffffffffu;
+    };
+
+    // Triangles using edge of welded vertices a and b, first two go to pEdge
+    auto edge_triangles = [&](uint32_t a, uint32_t b, uint32_t* pEdge) {
+        uint32_t users = 0;
+
+        for(uint32_t i = adjacency_offsets[a]; i < adjacency_offsets[a + 1]; i++) {
+            if(copy_in(adjacency[i], b) == 0xffffffffu) continue;
+
+            if(users < 2) pEdge[users] = adjacency[i];
+
+            users++;
+        }
+
+        return users;
+    };
+
+    // Edge is on seam when its triangles use copies with different attributes
+    auto is_seam = [&](uint32_t a, uint32_t b, const uint32_t* edge) {
+        return __ulMeshSimplifyAttributeDistance(copy_in(edge[0], a), copy_in(edge[1], a), attributes, attributeStride) > 0.0
+            || __ulMeshSimplifyAttributeDistance(copy_in(edge[0], b), copy_in(edge[1], b), attributes, attributeStride) > 0.0;
+    };
+
+    while(result.size() > targetIndexCount) {
+        const size_t triangle_count = result.size() / 3;
+
+        // Triangles around every canonical vertex
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+
+        for(uint32_t i : result) adjacency_offsets[canonical[i] + 1]++;
+        for(size_t v = 0; v < vertexCount; v++) adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+
+        for(size_t t = 0; t < triangle_count; t++) {
+            for(int k = 0; k < 3; k++) adjacency[fill[canonical[result[t * 3 + k]]]++] = (uint32_t)t;
+        }
+
+        // Lock geometric borders and non manifold edges, edge used by other than 2 triangles, and seam corners, vertex with
+        // other than 0 or 2 seam edges. Collapses keep borders, seams stay seams with 2 seam edges per vertex, so it is
+        // enough to do it once
+        if(first_pass) {
+            std::fill(locked.begin(), locked.end(), 0);
+            std::fill(seam_edges.begin(), seam_edges.end(), 0);
+
+            for(size_t t = 0; t < triangle_count; t++) {
+                for(int k = 0; k < 3; k++) {
+                    const uint32_t a = canonical[result[t * 3 + k]];
+                    const uint32_t b = canonical[result[t * 3 + (k + 1) % 3]];
+                    uint32_t edge[2];
+
+                    if(a == b) continue;
+
+                    if(edge_triangles(a, b, edge) != 2) {
+                        locked[a] = 1;
+                        locked[b] = 1;
+                    }
+                    else if(edge[0] == t && is_seam(a, b, edge)) {
+                        // Counted from first of its triangles only
+                        seam_edges[a]++;
+                        seam_edges[b]++;
+                    }
+                }
+            }
+
+            for(size_t v = 0; v < vertexCount; v++) {
+                if(seam_edges[v] != 0 && seam_edges[v] != 2) locked[v] = 1;
+            }
+
+            first_pass = 0;
+        }
+
+        collapses.clear();
+
+        // Every interior edge shows up in both its triangles, once in each winding, so take it only where a < b and keep cheaper direction
+        for(size_t t = 0; t < triangle_count; t++) {
+            for(int k = 0; k < 3; k++) {
+                const uint32_t a = canonical[result[t * 3 + k]];
+                const uint32_t b = canonical[result[t * 3 + (k + 1) % 3]];
+
+                if(a >= b || (locked[a] && locked[b])) continue;
+
+                // Seam vertex may only slide along its seam
+                int seam = 0;
+
+                if(seam_edges[a] || seam_edges[b]) {
+                    uint32_t edge[2];
+
+                    seam = edge_triangles(a, b, edge) == 2 && is_seam(a, b, edge);
+                }
+
+                const int can_ab = !locked[a] && (seam_edges[a] == 0 || seam);
+                const int can_ba = !locked[b] && (seam_edges[b] == 0 || seam);
+
+                if(!can_ab && !can_ba) continue;
+
+                const double cost_ab = can_ab ? __ulMeshQuadricError(&quadrics[a], &positions[(size_t)b * 3]) : DBL_MAX;
+                const double cost_ba = can_ba ? __ulMeshQuadricError(&quadrics[b], &positions[(size_t)a * 3]) : DBL_MAX;
+
+                if(cost_ab <= cost_ba) {
+                    collapses.push_back({ a, b, cost_ab });
+                }
+                else {
+                    collapses.push_back({ b, a, cost_ba });
+                }
+            }
+        }
+
+        // Costs are never negative, so upper bits of float cost sort the same way, 16 bits order collapses well enough
+        std::fill(histogram.begin(), histogram.end(), 0);
+
+        for(const ul_simplify_collapse_t& c : collapses) {
+            const float cost = (float)std::min(c.cost, (double)FLT_MAX);
+            uint32_t bits;
+            memcpy(&bits, &cost, sizeof(bits));
+
+            histogram[(bits >> 16) + 1]++;
+        }
+
+        for(size_t i = 1; i < histogram.size(); i++) histogram[i] += histogram[i - 1];
+
+        sorted_collapses.resize(collapses.size());
+
+        for(const ul_simplify_collapse_t& c : collapses) {
+            const float cost = (float)std::min(c.cost, (double)FLT_MAX);
+            uint32_t bits;
+            memcpy(&bits, &cost, sizeof(bits));
+
+            sorted_collapses[histogram[bits >> 16]++] = c;
+        }
+
+        for(size_t v = 0; v < vertexCount; v++) replacement[v] = (uint32_t)v;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t removed = 0;
+        size_t performed = 0;
+
+        for(const ul_simplify_collapse_t& c : sorted_collapses) {
+            if(result.size() - removed * 3 <= targetIndexCount || c.cost > error_limit) break;
+            if(touched[c.from] || touched[c.to]) continue;
+
+            // Triangles on collapsed edge
+            uint32_t edge[2];
+            uint32_t shared = 0;
+            int valid = 1;
+
+            neighbours_from.clear();
+            neighbours_to.clear();
+
+            for(uint32_t a = adjacency_offsets[c.from]; a < adjacency_offsets[c.from + 1] && valid; a++) {
+                const uint32_t* tri = &result[(size_t)adjacency[a] * 3];
+                int has_to = 0;
+
+                for(int k = 0; k < 3; k++) {
+                    if(canonical[tri[k]] == c.to) has_to = 1;
+
+                    if(canonical[tri[k]] != c.from) neighbours_from.push_back(canonical[tri[k]]);
+                }
+
+                if(has_to) {
+                    if(shared < 2) edge[shared] = adjacency[a];
+
+                    shared++;
+
+                    continue;
+                }
+
+                // Reject collapses which flip or squash remaining triangles
+                const float* p[3];
+
+                for(int k = 0; k < 3; k++) p[k] = &positions[(size_t)canonical[tri[k]] * 3];
+
+                double before[3], after[3];
+                __ulMeshTriangleNormal(p[0], p[1], p[2], before);
+
+                for(int k = 0; k < 3; k++) {
+                    if(canonical[tri[k]] == c.from) p[k] = &positions[(size_t)c.to * 3];
+                }
+
+                __ulMeshTriangleNormal(p[0], p[1], p[2], after);
+
+                const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                const double lengths = sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) * (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+
+                if(dot <= 0.25 * lengths) valid = 0;
+            }
+
+            if(!valid || shared != 2) continue;
+
+            // Link condition, edge ends may only share the two vertices opposite to edge
+            for(uint32_t a = adjacency_offsets[c.to]; a < adjacency_offsets[c.to + 1]; a++) {
+                const uint32_t* tri = &result[(size_t)adjacency[a] * 3];
+
+                for(int k = 0; k < 3; k++) {
+                    if(canonical[tri[k]] != c.to) neighbours_to.push_back(canonical[tri[k]]);
+                }
+            }
+
+            std::sort(neighbours_from.begin(), neighbours_from.end());
+            neighbours_from.erase(std::unique(neighbours_from.begin(), neighbours_from.end()), neighbours_from.end());
+            std::sort(neighbours_to.begin(), neighbours_to.end());
+            neighbours_to.erase(std::unique(neighbours_to.begin(), neighbours_to.end()), neighbours_to.end());
+
+            size_t common = 0;
+            size_t i = 0, j = 0;
+
+            while(i < neighbours_from.size() && j < neighbours_to.size()) {
+                if(neighbours_from[i] == neighbours_to[j]) {
+                    common++;
+                    i++;
+                    j++;
+                }
+                else if(neighbours_from[i] < neighbours_to[j]) {
+                    i++;
+                }
+                else {
+                    j++;
+                }
+            }
+
+            if(common != 2) continue;
+
+            // Every copy takes target copy of edge triangle on its side, copies which aren`t in edge triangles (flat
+            // shading) take one with closest attributes
+            for(uint32_t i = copy_offsets[c.from]; i < copy_offsets[c.from + 1]; i++) {
+                const uint32_t copy = copies[i];
+                double best = DBL_MAX;
+
+                for(int e = 0; e < 2; e++) {
+                    const uint32_t edge_copy = copy_in(edge[e], c.from);
+                    const double distance = edge_copy == copy ? -1.0 : __ulMeshSimplifyAttributeDistance(copy, edge_copy, attributes, attributeStride);
+
+                    if(distance < best) {
+                        best = distance;
+                        replacement[copy] = copy_in(edge[e], c.to);
+                    }
+                }
+            }
+
+            for(int k = 0; k < 10; k++) quadrics[c.to].a[k] += quadrics[c.from].a[k];
+            quadrics[c.to].weight += quadrics[c.from].weight;
+
+            touched[c.from] = 1;
+            touched[c.to] = 1;
+
+            for(uint32_t n : neighbours_from) touched[n] = 1;
+
+            max_error = std::max(max_error, c.cost);
+            removed += shared;
+            performed++;
+        }
+
+        if(performed == 0) break;
+
+        // Apply collapses and drop triangles which became degenerate
+        size_t write = 0;
+
+        for(size_t t = 0; t < triangle_count; t++) {
+            const uint32_t a = replacement[result[t * 3 + 0]];
+            const uint32_t b = replacement[result[t * 3 + 1]];
+            const uint32_t c = replacement[result[t * 3 + 2]];
+
+            if(canonical[a] == canonical[b] || canonical[b] == canonical[c] || canonical[a] == canonical[c]) continue;
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+
+        result.resize(write);
+    }
+
+    if(pResultError && extent > 0.0) *pResultError = (float)(sqrt(max_error) / extent);
+
+    memcpy(destination, result.data(), result.size() * sizeof(uint32_t));
+
+    return result.size();
+}
+
+/**
+ * @brief Generate LOD chain of indexed mesh (soup gets indexed first) and store it in pMesh->lods. Levels share vertex
+ * buffer of mesh, every level is simplified from previous one and reordered for vertex cache. Run ulMeshOptimize before
+ * this, not after, since it renumbers vertices
+ *
+ * @param pMesh ul_mesh_t struct
+ * @param ratios target triangle ratios relative to full mesh, descending (e.g. 0.5, 0.25, 0.125, 0.0625)
+ * @param ratioCount amount of ratios
+ * @param targetError largest allowed error relative to mesh extent, levels stop shrinking once it is reached
+ */
+void ulMeshGenerateLODs(ul_mesh_t* pMesh, const float* ratios, size_t ratioCount, float targetError = FLT_MAX) {
+    ulMeshIndex(pMesh);
+
+    pMesh->lods.clear();
+
+    const size_t vertex_count = pMesh->vertices.size() / 3;
+    const size_t full_count = pMesh->indices.size();
+
+    std::vector<uint32_t> previous = pMesh->indices;
+    float accumulated_error = 0.0f;
+
+    // Texture coordinate seams stay, normal ones (flat shading, hard edges) are kept in shape by quadrics already
+    const float* texcoords = pMesh->textureCoordinates.size() == vertex_count * 2 ? pMesh->textureCoordinates.data() : (const float*)0;
+
+    for(size_t i = 0; i < ratioCount; i++) {
+        const size_t target = (size_t)((double)full_count / 3 * ratios[i]) * 3;
+        float error = 0.0f;
+
+        ul_mesh_lod_t lod;
+        lod.indices.resize(previous.size());
+        lod.indices.resize(ulMeshSimplify(lod.indices.data(), previous.data(), previous.size(), pMesh->vertices.data(), vertex_count, target, targetError, &error, texcoords, texcoords ? 2 : 0));
+
+        // Every level starts from previous one, so errors add up
+        accumulated_error += error;
+
+        lod.ratio = full_count ? (float)lod.indices.size() / (float)full_count : 0.0f;
+        lod.error = accumulated_error;
+
+        previous = lod.indices;
+
+        ulMeshOptimizeVertexCache(previous.data(), lod.indices.data(), lod.indices.size(), vertex_count);
+        lod.indices = previous;
+
+        pMesh->lods.push_back(std::move(lod));
+    }
+}
+
+#endif
@@ -3,9 +3,13 @@
 #define _TE_WINDOW_
 
 #include "core.hpp"
+#include "gl_state.hpp"
+#include "fixed_step.hpp"
 #include <thread>
 #include <chrono>
 #include "scene.hpp"
+#include "asset_streamer.hpp"
+#include "job_system.hpp"
 
 namespace te {
     class Window {
@@ -13,25 +17,13 @@ namespace te {
         GLFWwindow* mWindowPtr;
         LayerHandler mLayerHandler;
         SceneHandler mSceneHandler;
+        AssetStreamer mAssetStreamer;
+        JobSystem mJobSystem;
 
         bool mWindowClosed = false;
 
         uint32_t mFixedUpdatesPerSecond = 128;
-
-        /**
-         * @brief Handle fixed update function
-         * 
-         */
-        void FixedUpdateHandler() {
-            while(!mWindowClosed) {
-                std::chrono::time_point start = std::chrono::high_resolution_clock::now();
-
-                LayerHandler::pGlobal->LayersFixedUpdate();
-
-                // Needed for stable mFixedUpdatesPerSecond (FixedUpdate sort of FPS)
-                std::this_thread::sleep_for(std::chrono::duration<long double, std::milli>(std::chrono::duration<long double, std::milli>(1.0 / (long double)mFixedUpdatesPerSecond).count() - std::chrono::duration<long double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()));
-            }
-        }
+        FixedStepScheduler mFixedUpdate;
 
     public:
         static Window* pGlobal;
@@ -47,6 +39,35 @@ namespace te {
             }
         }
 
+        /**
+         * @brief Set FixedUpdate rate, takes effect on next Run
+         *
+         * @param ticksPerSecond
+         */
+        void SetFixedUpdatesPerSecond(uint32_t ticksPerSecond) { mFixedUpdatesPerSecond = ticksPerSecond; }
+
+        /**
+         * @brief Tick timing of FixedUpdate thread, lateness and jitter are in milliseconds
+         *
+         * @return FixedStepStats
+         */
+        FixedStepStats GetFixedUpdateStats() { return mFixedUpdate.GetStats(); }
+
+        /**
+         * @brief Step FixedUpdate thread actually runs at, for SnapshotBuffer::GetAlpha. 0 before Run (GetAlpha then
+         * returns 1), rate set with SetFixedUpdatesPerSecond shows up only after next Run
+         *
+         * @return double
+         */
+        double GetFixedStepSeconds() { return mFixedUpdate.GetStepSeconds(); }
+
+        /**
+         * @brief GL calls issued and skipped by state cache of main thread during last finished frame
+         *
+         * @return GLStateCounters
+         */
+        GLStateCounters GetLastFrameGLCounters() { return GLStateCache::Get().mLastFrame; }
+
         /**
          * @brief Run main window
          * 
@@ -56,6 +77,9 @@ namespace te {
          */
         void Run(std::string title, uint32_t width, uint32_t height) {            
             LayerHandler::pGlobal->AddLayer(&mSceneHandler);
+
+            // Main thread takes part in jobs, so it has to be the one starting them
+            JobSystem::pGlobal->Start();
             
             LayerHandler::pGlobal->LayersAwake();
 
@@ -82,31 +106,53 @@ namespace te {
                 return;
             }
 
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_MULTISAMPLE);
+            // Fresh context, state cache of this thread knows nothing about it
+            GLStateCache::Get().Invalidate();
+            GLStateCache::Get().Enable(GL_DEPTH_TEST);
+            GLStateCache::Get().Enable(GL_MULTISAMPLE);
 
             LayerHandler::pGlobal->LayersStart();
 
-            std::jthread fixed_update_thread(&Window::FixedUpdateHandler, this);
-
-            fixed_update_thread.detach();
+            mFixedUpdate.Start(mFixedUpdatesPerSecond, [] { LayerHandler::pGlobal->LayersFixedUpdate(); });
 
             while(!(mWindowClosed = glfwWindowShouldClose(mWindowPtr))) {
                 glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
                 glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
-                LayerHandler::pGlobal->LayersUpdate();
+                // Upload assets streamed in since last frame, bounded by upload budget
+                AssetStreamer::pGlobal->Pump();
+
+                if(LayerHandler::pGlobal->GetConcurrentLayers()) {
+                    LayerHandler::pGlobal->LayersFrame([this]() { glfwSwapBuffers(mWindowPtr); });
+                }
+                else {
+                    LayerHandler::pGlobal->LayersUpdate();
 
-                glfwSwapBuffers(mWindowPtr);
+                    glfwSwapBuffers(mWindowPtr);
 
-                LayerHandler::pGlobal->LayersLateUpdate();
+                    LayerHandler::pGlobal->LayersLateUpdate();
+                }
 
                 glfwPollEvents();
+
+                GLStateCache::Get().EndFrame();
             }
 
+            // FixedUpdate must not run into or after End
+            mFixedUpdate.Stop();
+
+            const FixedStepStats stats = mFixedUpdate.GetStats();
+            TE_INFO("FixedUpdate: " << stats.mTicks << " ticks at " << stats.mTickRate << "/s, jitter " << stats.mJitterMs << " ms, max lateness " << stats.mMaxLatenessMs << " ms, " << stats.mDroppedTicks << " dropped")
+
+            const GLStateCounters& gl_counters = GLStateCache::Get().mLastFrame;
+            TE_INFO("GL state calls in last frame: " << gl_counters.GetIssued() << " issued, " << gl_counters.GetSkipped() << " skipped")
+
             LayerHandler::pGlobal->LayersEnd();
 
-            fixed_update_thread.request_stop();
+            JobSystem::pGlobal->Stop();
+
+            // Uploads need GL context, so streaming has to stop before it goes away
+            AssetStreamer::pGlobal->Stop();
 
             glfwTerminate();
         }
@@ -0,0 +1,281 @@
+// TE_TEST_LIBS: -lEGL
+#include "gl_context.hpp"
+#include "../engine/src/asset_streamer.hpp"
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace te;
+
+#define TEST_UPLOAD_SIZE 2048
+
+// Decode without file, RGBA8 TEST_UPLOAD_SIZE^2 (16 MB) pattern
+static bool DecodePattern(const std::string&, BitmapAsset* pBitmap) {
+    pBitmap->mWidth = pBitmap->mHeight = TEST_UPLOAD_SIZE;
+    pBitmap->mPixels.resize((size_t)TEST_UPLOAD_SIZE * TEST_UPLOAD_SIZE * 4);
+
+    for(size_t i = 0; i < pBitmap->mPixels.size(); i++) pBitmap->mPixels[i] = (uint8_t)(i * 31);
+
+    return true;
+}
+
+// Pump must stop starting uploads once budget is used up, so every frame stalls for at most budget plus one upload
+static void TestPumpBudget() {
+    AssetStreamer streamer;
+    streamer.SetThreadCount(2);
+
+    const double budget = 4.0;
+    streamer.SetUploadBudget(budget);
+
+    const uint32_t count = 24;
+    std::vector<double> upload_ms;
+    std::vector<GLuint> textures(count, 0);
+    std::vector<AssetHandle<BitmapAsset>> assets;
+
+    for(uint32_t i = 0; i < count; i++) {
+        assets.push_back(streamer.Load<BitmapAsset>("pattern", DecodePattern, [&upload_ms, &textures, i](BitmapAsset* pBitmap) {
+            const double start = TestNowMs();
+
+            glGenTextures(1, &textures[i]);
+            glBindTexture(GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pBitmap->mWidth, pBitmap->mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pBitmap->mPixels.data());
+            // Make upload cost visible on CPU, driver may defer copy otherwise
+            glFinish();
+
+            upload_ms.push_back(TestNowMs() - start);
+        }));
+    }
+
+    for(AssetHandle<BitmapAsset>& asset : assets) asset->mDecoded.wait();
+
+    uint32_t frames = 0;
+    double worst_pump = 0.0, worst_upload = 0.0;
+
+    while(streamer.GetPendingUploads() != 0) {
+        const size_t first = upload_ms.size();
+        const size_t done = streamer.Pump();
+
+        TE_CHECK(done >= 1)
+
+        // Budget was not used up before last upload of frame started
+        double before_last = 0.0;
+
+        for(size_t i = first; i + 1 < upload_ms.size(); i++) before_last += upload_ms[i];
+
+        TE_CHECK_MSG(before_last < budget, before_last << " ms of uploads before last one of frame " << frames)
+
+        for(size_t i = first; i < upload_ms.size(); i++) worst_upload = std::max(worst_upload, upload_ms[i]);
+
+        worst_pump = std::max(worst_pump, streamer.GetLastPumpTime());
+        frames++;
+    }
+
+    TE_CHECK(worst_pump < budget + worst_upload + 1.0)
+
+    for(AssetHandle<BitmapAsset>& asset : assets) TE_CHECK(asset->IsReady())
+
+    TE_INFO(count << " uploads of " << TEST_UPLOAD_SIZE * TEST_UPLOAD_SIZE * 4 / (1024 * 1024) << " MB over " << frames << " frames, worst Pump " << worst_pump << " ms (budget " << budget << " ms, worst single upload " << worst_upload << " ms)")
+
+    glDeleteTextures(count, textures.data());
+}
+
+// Stop fails every asset it drops, nothing stays queued or decoded
+static void TestStopFailsDropped() {
+    AssetStreamer streamer;
+    streamer.SetThreadCount(1);
+
+    std::vector<AssetHandle<BitmapAsset>> assets;
+    std::atomic<uint32_t> uploads = 0;
+
+    for(uint32_t i = 0; i < 64; i++) {
+        assets.push_back(streamer.Load<BitmapAsset>("slow", [](const std::string&, BitmapAsset* pBitmap) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            pBitmap->mWidth = pBitmap->mHeight = 1;
+
+            return true;
+        }, [&uploads](BitmapAsset*) { uploads++; }));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    streamer.Stop();
+
+    uint32_t failed = 0, broken = 0;
+
+    for(AssetHandle<BitmapAsset>& asset : assets) {
+        TE_CHECK(asset->IsDone())
+
+        if(asset->IsFailed()) failed++;
+
+        try {
+            asset->mDecoded.get();
+        }
+        catch(const std::future_error&) {
+            broken++;
+        }
+    }
+
+    TE_CHECK(failed > 0)
+    TE_CHECK(broken == 0)
+    TE_CHECK(uploads == 0)
+
+    // Streamer still works after Stop
+    AssetHandle<BitmapAsset> again = streamer.Load<BitmapAsset>("pattern", DecodePattern);
+    TE_CHECK(again->mDecoded.get())
+
+    while(!again->IsDone()) streamer.Pump();
+
+    TE_CHECK(again->IsReady())
+}
+
+// Load from decode callback while Stop joins workers used to stay queued without workers, promise broke once streamer
+// was gone and asset never failed
+static void TestLoadDuringStop() {
+    std::vector<AssetHandle<BitmapAsset>> nested;
+    std::mutex nested_mutex;
+
+    {
+        AssetStreamer streamer;
+        streamer.SetThreadCount(2);
+
+        for(uint32_t i = 0; i < 4; i++) {
+            streamer.Load<BitmapAsset>("outer", [&](const std::string&, BitmapAsset*) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+                AssetHandle<BitmapAsset> inner = streamer.Load<BitmapAsset>("inner", DecodePattern);
+
+                std::lock_guard<std::mutex> lock(nested_mutex);
+                nested.push_back(inner);
+
+                return true;
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        streamer.Stop();
+
+        for(AssetHandle<BitmapAsset>& asset : nested) {
+            TE_CHECK(asset->IsFailed())
+        }
+    }
+
+    TE_CHECK(!nested.empty())
+
+    for(AssetHandle<BitmapAsset>& asset : nested) {
+        bool decoded = true;
+
+        try {
+            decoded = asset->mDecoded.get();
+        }
+        catch(const std::future_error&) {
+            TE_CHECK_MSG(false, "broken promise")
+        }
+
+        TE_CHECK(!decoded)
+    }
+}
+
+// Throwing decode or upload fails its asset, workers and Pump keep going
+static void TestThrowingCallbacks() {
+    AssetStreamer streamer;
+    streamer.SetThreadCount(1);
+
+    AssetHandle<BitmapAsset> bad_decode = streamer.Load<BitmapAsset>("throws", [](const std::string&, BitmapAsset*) -> bool {
+        throw std::runtime_error("decode");
+    });
+
+    AssetHandle<BitmapAsset> bad_upload = streamer.Load<BitmapAsset>("pattern", DecodePattern, [](BitmapAsset*) {
+        throw std::runtime_error("upload");
+    });
+
+    AssetHandle<BitmapAsset> good = streamer.Load<BitmapAsset>("pattern", DecodePattern);
+
+    TE_CHECK(!bad_decode->mDecoded.get())
+    TE_CHECK(bad_decode->IsFailed())
+
+    bad_upload->mDecoded.wait();
+    good->mDecoded.wait();
+
+    while(!bad_upload->IsDone() || !good->IsDone()) streamer.Pump();
+
+    TE_CHECK(bad_upload->IsFailed())
+    TE_CHECK(good->IsReady())
+}
+
+// Worst frame while loading same textures synchronously (decode and upload in frame) and through streamer (decode on
+// worker, Pump with budget in frame)
+static void TestStall() {
+    const uint32_t count = 8;
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    auto upload = [texture](BitmapAsset* pBitmap) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pBitmap->mWidth, pBitmap->mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pBitmap->mPixels.data());
+        glFinish();
+    };
+
+    double sync_worst = 0.0;
+    const double sync_start = TestNowMs();
+
+    for(uint32_t i = 0; i < count; i++) {
+        const double start = TestNowMs();
+
+        BitmapAsset bitmap;
+        DecodePattern("pattern", &bitmap);
+        upload(&bitmap);
+
+        sync_worst = std::max(sync_worst, TestNowMs() - start);
+    }
+
+    const double sync_total = TestNowMs() - sync_start;
+
+    AssetStreamer streamer;
+    streamer.SetThreadCount(1);
+    streamer.SetUploadBudget(2.0);
+
+    std::vector<AssetHandle<BitmapAsset>> assets;
+    const double stream_start = TestNowMs();
+
+    for(uint32_t i = 0; i < count; i++) assets.push_back(streamer.Load<BitmapAsset>("pattern", DecodePattern, upload));
+
+    double stream_worst = 0.0;
+    uint32_t frames = 0;
+
+    while(!std::all_of(assets.begin(), assets.end(), [](const AssetHandle<BitmapAsset>& a) { return a->IsDone(); })) {
+        const double start = TestNowMs();
+
+        streamer.Pump();
+        glFinish();
+
+        stream_worst = std::max(stream_worst, TestNowMs() - start);
+        frames++;
+
+        // Rest of frame, lets worker run on machines with few cores
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const double stream_total = TestNowMs() - stream_start;
+
+    for(AssetHandle<BitmapAsset>& asset : assets) TE_CHECK(asset->IsReady())
+
+    TE_INFO(count << " textures of " << TEST_UPLOAD_SIZE * TEST_UPLOAD_SIZE * 4 / (1024 * 1024) << " MB, synchronous: worst frame " << sync_worst << " ms, total " << sync_total << " ms; streamed: worst frame " << stream_worst << " ms over " << frames << " frames, total " << stream_total << " ms")
+
+    TE_CHECK_MSG(stream_worst < sync_worst, "streamed worst frame " << stream_worst << " ms, synchronous " << sync_worst << " ms")
+
+    glDeleteTextures(1, &texture);
+}
+
+int main() {
+    if(!TestMakeGLContext()) return 1;
+
+    TestPumpBudget();
+    TestStopFailsDropped();
+    TestLoadDuringStop();
+    TestThrowingCallbacks();
+    TestStall();
+
+    return TestResult("asset_streamer_test");
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef _TE_TEST_BMP_WRITER_
+#define _TE_TEST_BMP_WRITER_
+
+#include <stdint.h>
+#include <vector>
+
+// BMP encoder for tests and benchmarks
+namespace te {
+    static void TestBMPPut(std::vector<uint8_t>& out, uint32_t value, uint32_t bytes) {
+        for(uint32_t i = 0; i < bytes; i++) out.push_back((uint8_t)(value >> (i * 8)));
+    }
+
+    /**
+     * @brief Encode RGBA8 image as 24 bit (alpha dropped) or 32 bit BGRA bitmap with BITMAPINFOHEADER
+     *
+     * @param pixels RGBA8, top row first
+     * @param width
+     * @param height
+     * @param bitsPerPixel 24 or 32
+     * @param topDown write negative height and rows top first, else rows bottom first like most writers
+     * @return std::vector<uint8_t> file
+     */
+    std::vector<uint8_t> TestEncodeBMP(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, uint32_t bitsPerPixel, bool topDown) {
+        const size_t row_size = (((size_t)width * bitsPerPixel + 31) / 32) * 4;
+        const uint32_t pixel_offset = 14 + 40;
+
+        std::vector<uint8_t> bmp = { 'B', 'M' };
+        bmp.reserve(pixel_offset + row_size * height);
+
+        TestBMPPut(bmp, (uint32_t)(pixel_offset + row_size * height), 4);
+        TestBMPPut(bmp, 0, 4);
+        TestBMPPut(bmp, pixel_offset, 4);
+
+        TestBMPPut(bmp, 40, 4);
+        TestBMPPut(bmp, width, 4);
+        TestBMPPut(bmp, topDown ? (uint32_t)-(int32_t)height : height, 4);
+        TestBMPPut(bmp, 1, 2);
+        TestBMPPut(bmp, bitsPerPixel, 2);
+        // BI_RGB, image size, resolution, palette
+        TestBMPPut(bmp, 0, 4);
+        TestBMPPut(bmp, (uint32_t)(row_size * height), 4);
+        TestBMPPut(bmp, 2835, 4);
+        TestBMPPut(bmp, 2835, 4);
+        TestBMPPut(bmp, 0, 4);
+        TestBMPPut(bmp, 0, 4);
+
+        for(uint32_t row = 0; row < height; row++) {
+            const uint32_t y = topDown ? row : height - 1 - row;
+            const size_t start = bmp.size();
+
+            for(uint32_t x = 0; x < width; x++) {
+                const uint8_t* p = &pixels[((size_t)y * width + x) * 4];
+
+                bmp.insert(bmp.end(), { p[2], p[1], p[0] });
+
+                if(bitsPerPixel == 32) bmp.push_back(p[3]);
+            }
+
+            bmp.resize(start + row_size, 0);
+        }
+
+        return bmp;
+    }
+}
+
+#endif
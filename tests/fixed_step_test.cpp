@@ -0,0 +1,85 @@
+#include "test.hpp"
+#include "../engine/src/fixed_step.hpp"
+#include <time.h>
+#include <thread>
+
+using namespace te;
+
+static double ProcessCpuSeconds() {
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Run scheduler for a while with main thread asleep, tick count has to match rate and process CPU time has
+ * to stay near spin window (the only part of step that doesn`t sleep)
+ *
+ * @param rate ticks per second
+ * @param seconds
+ */
+static void TestRate(uint32_t rate, double seconds) {
+    FixedStepScheduler scheduler;
+    std::atomic<uint64_t> ticks = 0;
+    const std::chrono::microseconds spin(200);
+
+    const double cpu_start = ProcessCpuSeconds();
+    const double start = TestNowMs();
+
+    scheduler.Start(rate, [&ticks]() { ticks++; }, 4, spin);
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+    scheduler.Stop();
+
+    const double wall = (TestNowMs() - start) / 1000.0;
+    const double cpu = ProcessCpuSeconds() - cpu_start;
+    const FixedStepStats stats = scheduler.GetStats();
+
+    // Scheduler runs exactly step it was given, Window::GetFixedStepSeconds hands this one to GetAlpha
+    TE_CHECK_MSG(std::abs(scheduler.GetStepSeconds() - 1.0 / rate) < 1e-9, scheduler.GetStepSeconds())
+
+    // Deadlines are absolute, so tick count only misses by startup/stop rounding and dropped ticks
+    const double expected = rate * wall;
+
+    TE_CHECK_MSG(std::abs((double)ticks - expected) <= 2.0 + expected * 0.005 + stats.mDroppedTicks, ticks << " ticks, expected " << expected)
+    TE_CHECK(stats.mTicks == ticks)
+    TE_CHECK_MSG(std::abs(stats.mTickRate - rate) <= rate * 0.01 + (2.0 + stats.mDroppedTicks) / seconds, stats.mTickRate)
+
+    // Spinning covers at most spin per tick, rest of step sleeps. Slack covers wakeups and stats
+    const double cpu_share = cpu / wall;
+    const double spin_share = std::min(1.0, rate * std::chrono::duration<double>(spin).count());
+
+    TE_CHECK_MSG(cpu_share <= spin_share * 1.5 + 0.03, "CPU " << cpu_share * 100.0 << " %, spin window " << spin_share * 100.0 << " %")
+
+    TE_INFO(rate << " Hz: " << ticks << " ticks in " << wall << " s (rate " << stats.mTickRate << "), lateness mean " << stats.mMeanLatenessMs << " ms max " << stats.mMaxLatenessMs << " ms, jitter " << stats.mJitterMs << " ms, dropped " << stats.mDroppedTicks << ", CPU " << cpu_share * 100.0 << " % (spin window " << spin_share * 100.0 << " %)")
+}
+
+// Tick longer than step, catch up is capped and rest is dropped instead of spiraling
+static void TestCatchUp() {
+    FixedStepScheduler scheduler;
+    std::atomic<uint64_t> ticks = 0;
+
+    scheduler.Start(1000, [&ticks]() {
+        if(ticks++ == 10) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }, 4);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    scheduler.Stop();
+
+    const FixedStepStats stats = scheduler.GetStats();
+
+    TE_CHECK(stats.mDroppedTicks >= 40)
+    TE_CHECK(stats.mLateWakeups >= 1)
+}
+
+int main() {
+    TestRate(60, 1.0);
+    TestRate(128, 1.0);
+    TestRate(1000, 1.0);
+    TestCatchUp();
+
+    return TestResult("fixed_step_test");
+}
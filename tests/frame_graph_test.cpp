@@ -0,0 +1,284 @@
+#include "test.hpp"
+#include "../engine/src/layer.hpp"
+#include <thread>
+#include <random>
+
+using namespace te;
+
+static std::atomic<uint32_t> gSequence = 0;
+
+class OrderLayer : public Layer {
+public:
+    uint32_t mUpdateEnd = 0;
+    uint32_t mLateUpdateStart = 0;
+    std::chrono::microseconds mWork;
+
+    OrderLayer(std::string name, uint32_t flags, std::chrono::microseconds work) : mWork(work) {
+        mName = name;
+        SetFlag(flags | LF_Update | LF_LateUpdate);
+    }
+
+    void Declare(const char* read, const char* write) {
+        if(read) Reads(read);
+        if(write) Writes(write);
+    }
+
+    virtual void Update() override {
+        std::this_thread::sleep_for(mWork);
+
+        mUpdateEnd = ++gSequence;
+    }
+
+    virtual void LateUpdate() override {
+        mLateUpdateStart = ++gSequence;
+    }
+};
+
+// Counts how layers of class reach it, through RunBatch or one by one
+class BatchLayer : public Layer {
+public:
+    static std::atomic<uint32_t> sBatchCalls;
+    static std::atomic<uint32_t> sBatchLayers;
+    uint32_t mUpdates = 0;
+
+    BatchLayer(std::string name) {
+        mName = name;
+        SetFlag(LF_Update | LF_LateUpdate | LF_Batch);
+        Reads("transforms");
+    }
+
+    void DeclareWrite(const char* write) {
+        Writes(write);
+    }
+
+    virtual void Update() override {
+        mUpdates++;
+    }
+
+    virtual void RunBatch(uint32_t phase, Layer* const* pLayers, size_t count) override {
+        if(phase == LF_Update) {
+            sBatchCalls++;
+            sBatchLayers += (uint32_t)count;
+        }
+
+        Layer::RunBatch(phase, pLayers, count);
+    }
+};
+
+std::atomic<uint32_t> BatchLayer::sBatchCalls = 0;
+std::atomic<uint32_t> BatchLayer::sBatchLayers = 0;
+
+// Build links each stage only to last writer or readers since, every conflicting pair (write/write, read/write, any
+// undeclared stage) still has to be ordered through some path, and Run has to keep that order on workers
+static void TestResourceEdges(JobSystem* pJobs) {
+    std::mt19937 random(11);
+    FrameGraph graph;
+    const uint32_t count = 300;
+    std::vector<uint32_t> finished(count);
+    std::atomic<uint32_t> sequence = 0;
+
+    for(uint32_t i = 0; i < count; i++) {
+        FrameStage stage = { "Stage" + std::to_string(i), [&, i]() { finished[i] = ++sequence; }, {}, {}, random() % 20 != 0, random() % 15 == 0, random() % 25 == 0 };
+
+        for(uint32_t r = random() % 3; r > 0; r--) stage.mReads.push_back(random() % 6);
+        for(uint32_t w = random() % 4 == 0 ? 1 + random() % 2 : 0; w > 0; w--) stage.mWrites.push_back(random() % 6);
+
+        graph.Add(std::move(stage));
+    }
+
+    graph.Build();
+
+    // Bits of stages that reach stage, predecessors always come first
+    std::vector<std::vector<bool>> reaches(count, std::vector<bool>(count, false));
+
+    for(uint32_t j = 0; j < count; j++) {
+        for(uint32_t p : graph.GetPredecessors(j)) {
+            TE_CHECK(p < j)
+
+            reaches[j][p] = true;
+
+            for(uint32_t k = 0; k < count; k++) {
+                if(reaches[p][k]) reaches[j][k] = true;
+            }
+        }
+    }
+
+    auto intersects = [](const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+        for(uint64_t x : a) {
+            if(std::find(b.begin(), b.end(), x) != b.end()) return true;
+        }
+
+        return false;
+    };
+
+    uint32_t unordered = 0, conflicts = 0;
+
+    for(uint32_t j = 0; j < count; j++) {
+        for(uint32_t i = 0; i < j; i++) {
+            const FrameStage& a = graph.GetStage(i);
+            const FrameStage& b = graph.GetStage(j);
+
+            if(a.mIndependent || b.mIndependent) continue;
+
+            if(a.mDeclared && b.mDeclared && !intersects(a.mWrites, b.mWrites) && !intersects(a.mWrites, b.mReads) && !intersects(a.mReads, b.mWrites)) continue;
+
+            conflicts++;
+            unordered += !reaches[j][i];
+        }
+    }
+
+    TE_CHECK_MSG(unordered == 0, unordered << " of " << conflicts << " conflicting pairs unordered")
+
+    for(uint32_t run = 0; run < 20; run++) {
+        graph.Run(pJobs, false);
+
+        for(uint32_t j = 0; j < count; j++) {
+            for(uint32_t p : graph.GetPredecessors(j)) TE_CHECK_MSG(finished[p] < finished[j], p << " after " << j)
+        }
+    }
+
+    TE_CHECK(graph.GetCriticalPath().empty())
+}
+
+// LF_Batch layers of one class share one stage in LayersFrame like in LayersUpdate
+static void TestBatchStages() {
+    LayerHandler handler;
+    handler.SetConcurrentLayers(true);
+
+    BatchLayer first("First"), second("Second"), third("Third");
+    OrderLayer writer("Writer", 0, std::chrono::microseconds(0));
+    OrderLayer other("Other", 0, std::chrono::microseconds(0));
+    writer.Declare(nullptr, "transforms");
+    other.Declare("config", nullptr);
+    second.DeclareWrite("config");
+
+    handler.AddLayer(&writer);
+    handler.AddLayer(&first);
+    handler.AddLayer(&other);
+    handler.AddLayer(&second);
+    handler.AddLayer(&third);
+
+    for(uint32_t frame = 0; frame < 10; frame++) handler.LayersFrame([]() {});
+
+    TE_CHECK(BatchLayer::sBatchCalls == 10 && BatchLayer::sBatchLayers == 30)
+    TE_CHECK(first.mUpdates == 10 && second.mUpdates == 10 && third.mUpdates == 10)
+
+    FrameGraph& frame_graph = handler.GetFrameGraph();
+    uint32_t batch_stages = 0;
+
+    for(uint32_t i = 0; i < frame_graph.GetSize(); i++) {
+        const FrameStage& stage = frame_graph.GetStage(i);
+
+        if(stage.mName != "First (batch of 3) Update") continue;
+
+        batch_stages++;
+
+        // Union of members, writes config so it orders with Other reading it
+        TE_CHECK(stage.mReads.size() == 1 && stage.mWrites.size() == 1)
+
+        const std::vector<uint32_t>& predecessors = frame_graph.GetPredecessors(i);
+        TE_CHECK(predecessors.size() == 1 && frame_graph.GetStage(predecessors[0]).mName == "Writer Update")
+    }
+
+    TE_CHECK(batch_stages == 1)
+}
+
+int main() {
+    LayerHandler handler;
+    JobSystem jobs;
+    jobs.Start(3);
+    handler.SetConcurrentLayers(true);
+
+    // Read only, undeclared and LF_Concurrent layers have no resource conflict between own Update and LateUpdate
+    OrderLayer reader("Reader", 0, std::chrono::microseconds(2000));
+    OrderLayer legacy("Legacy", 0, std::chrono::microseconds(500));
+    OrderLayer independent("Independent", LF_Concurrent, std::chrono::microseconds(2000));
+    OrderLayer writer("Writer", 0, std::chrono::microseconds(300));
+    OrderLayer observer("Observer", 0, std::chrono::microseconds(2000));
+    reader.Declare("transforms", nullptr);
+    observer.Declare("config", nullptr);
+    writer.Declare(nullptr, "transforms");
+
+    handler.AddLayer(&writer);
+    handler.AddLayer(&reader);
+    handler.AddLayer(&independent);
+    handler.AddLayer(&observer);
+
+    uint32_t presents = 0;
+
+    // Declared layers alone first, undeclared layer conflicts with everything and would chain all stages
+    for(uint32_t frame = 0; frame < 100; frame++) {
+        if(frame == 50) handler.AddLayer(&legacy);
+
+        gSequence = 0;
+        legacy.mUpdateEnd = legacy.mLateUpdateStart = 0;
+
+        handler.LayersFrame([&]() { presents++; });
+
+        for(OrderLayer* p_layer : { &reader, &observer, &legacy, &independent, &writer }) {
+            if(p_layer == &legacy && frame < 50) continue;
+
+            TE_CHECK_MSG(p_layer->mUpdateEnd < p_layer->mLateUpdateStart, p_layer->GetName() << " frame " << frame)
+        }
+
+        // Writer is added first and conflicts with reader
+        TE_CHECK(writer.mUpdateEnd < reader.mUpdateEnd)
+    }
+
+    TE_CHECK(presents == 100)
+
+    // LF_Concurrent stages stay free of undeclared legacy layer, only own Update -> LateUpdate edge is left
+    FrameGraph& frame_graph = handler.GetFrameGraph();
+
+    for(uint32_t i = 0; i < frame_graph.GetSize(); i++) {
+        const std::string& name = frame_graph.GetStage(i).mName;
+        const std::vector<uint32_t>& predecessors = frame_graph.GetPredecessors(i);
+
+        if(name == "Independent Update") {
+            TE_CHECK(predecessors.empty())
+            TE_CHECK(!frame_graph.GetStage(i).mMainThread)
+        }
+
+        if(name == "Independent LateUpdate") {
+            TE_CHECK(predecessors.size() == 1 && frame_graph.GetStage(predecessors[0]).mName == "Independent Update")
+        }
+
+        // Undeclared layer still orders after Writer, Reader and Observer updates
+        if(name == "Legacy Update") {
+            TE_CHECK(predecessors.size() == 3)
+        }
+    }
+
+    // Graph built on its own keeps extra edges through later Build calls
+    FrameGraph graph;
+    std::vector<uint32_t> order;
+    std::mutex order_mutex;
+
+    for(uint32_t i = 0; i < 4; i++) {
+        graph.Add({ "Stage" + std::to_string(i), [&, i]() {
+            std::this_thread::sleep_for(std::chrono::microseconds(i == 0 ? 2000 : 100));
+
+            std::lock_guard<std::mutex> lock(order_mutex);
+            order.push_back(i);
+        }, {}, {}, true });
+    }
+
+    graph.Depend(3, 0);
+    graph.Build();
+
+    for(uint32_t run = 0; run < 20; run++) {
+        order.clear();
+
+        graph.Run(&jobs);
+
+        TE_CHECK(order.size() == 4 && std::find(order.begin(), order.end(), 0u) < std::find(order.begin(), order.end(), 3u))
+    }
+
+    TestBatchStages();
+    TestResourceEdges(&jobs);
+    TestResourceEdges(nullptr);
+
+    jobs.Stop();
+
+    return TestResult("frame_graph_test");
+}
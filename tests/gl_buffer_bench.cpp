@@ -0,0 +1,132 @@
+// TE_TEST_LIBS: -lEGL
+#include "gl_context.hpp"
+#include "../engine/src/buffers_gl.hpp"
+#include <time.h>
+
+using namespace te;
+
+// CPU time of calling (render) thread per MB streamed, every frame uploads new data and draws from it so GPU is
+// still reading buffer when next upload comes
+
+static const char* gVertexSource = "#version 450 core\n"
+    "layout(location = 0) in vec2 position;\n"
+    "void main() { gl_Position = vec4(fract(position) * 2.0 - 1.0, 0.0, 1.0); gl_PointSize = 1.0; }\n";
+
+static const char* gFragmentSource = "#version 450 core\n"
+    "out vec4 outColor;\n"
+    "void main() { outColor = vec4(1.0); }\n";
+
+static double ThreadCpuMs() {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+    return time.tv_sec * 1e3 + time.tv_nsec * 1e-6;
+}
+
+enum UploadPath {
+    // Pre span API: vector taken by value, glBufferData every call
+    UPLOAD_VectorCopy,
+    UPLOAD_BindData,
+    // Partial update of storage GPU reads
+    UPLOAD_SubData,
+    UPLOAD_Ring
+};
+
+static const char* gPathNames[] = { "vector copy + glBufferData", "BindData (orphan)", "SubData in place", "GLStreamBuffer ring" };
+
+static void Run(UploadPath path, size_t frameBytes, uint32_t frames) {
+    std::vector<float> data(frameBytes / sizeof(float));
+
+    for(size_t i = 0; i < data.size(); i++) data[i] = (float)(i % 977) * 0.001f;
+
+    GLBuffer buffer;
+    GLStreamBuffer ring;
+    GLArray array;
+
+    const GLVertexAttribute position = { 0, 2, GL_FLOAT, false, false, 0 };
+
+    if(path == UPLOAD_Ring) {
+        ring.Init(frameBytes);
+        array.Configure(std::span<const GLVertexAttribute>(&position, 1), buffer, 8);
+    }
+    else {
+        buffer.BindData(data);
+        array.Configure(std::span<const GLVertexAttribute>(&position, 1), buffer, 8);
+    }
+
+    array.Bind();
+    glFinish();
+
+    // Points drawn each frame, enough to keep rasterizer busy with buffer
+    const uint32_t points = (uint32_t)std::min<size_t>(data.size() / 2, 4096);
+
+    const double cpu_start = ThreadCpuMs();
+    const double wall_start = TestNowMs();
+
+    for(uint32_t f = 0; f < frames; f++) {
+        data[0] = (float)f;
+
+        switch(path) {
+        case UPLOAD_VectorCopy: {
+            std::vector<float> copy = data;
+            glNamedBufferData(buffer.mId, copy.size() * sizeof(float), copy.data(), GL_DYNAMIC_DRAW);
+            break;
+        }
+        case UPLOAD_BindData: buffer.BindData(data); break;
+        case UPLOAD_SubData: buffer.SubData(data); break;
+        case UPLOAD_Ring: {
+            const size_t offset = ring.Write(std::span<const float>(data));
+            glVertexArrayVertexBuffer(array.mId, 0, ring.mId, offset, 8);
+            break;
+        }
+        }
+
+        glDrawArrays(GL_POINTS, 0, points);
+
+        if(path == UPLOAD_Ring) ring.EndFrame();
+        else glFlush();
+    }
+
+    glFinish();
+
+    const double cpu = ThreadCpuMs() - cpu_start;
+    const double wall = TestNowMs() - wall_start;
+    const double mb = (double)frameBytes * frames / (1024.0 * 1024.0);
+
+    TE_INFO(gPathNames[path] << ", " << frameBytes / 1024 << " KB/frame: " << cpu / mb << " ms CPU/MB, " << wall / mb << " ms wall/MB" << (path == UPLOAD_Ring ? ", fence waits " + std::to_string(ring.mWaitCount) : std::string()))
+}
+
+int main() {
+    if(!TestMakeGLContext()) return 1;
+
+    GLShader vertex, fragment;
+    GLProgram program;
+    vertex.LoadShader(gVertexSource, GL_VERTEX_SHADER);
+    fragment.LoadShader(gFragmentSource, GL_FRAGMENT_SHADER);
+    program.Attach(vertex);
+    program.Attach(fragment);
+    program.Link();
+    program.Use();
+
+    uint32_t texture, framebuffer;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, 256, 256);
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, 256, 256);
+
+    const size_t sizes[] = { 16 * 1024, 256 * 1024, 4 * 1024 * 1024 };
+
+    for(size_t size : sizes) {
+        const uint32_t frames = (uint32_t)std::max<size_t>(64, (256ull * 1024 * 1024) / size / 4);
+
+        for(uint32_t path = UPLOAD_VectorCopy; path <= UPLOAD_Ring; path++) Run((UploadPath)path, size, frames);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &texture);
+
+    return TestResult("gl_buffer_bench");
+}
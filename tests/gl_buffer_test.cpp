@@ -0,0 +1,171 @@
+// TE_TEST_LIBS: -lEGL
+#include "gl_context.hpp"
+#include "../engine/src/buffers_gl.hpp"
+
+using namespace te;
+
+typedef struct PointVertex {
+    float mPosition[2];
+    float mColor[4];
+} PointVertex;
+
+typedef GLVertexLayout<PointVertex, TE_VERTEX_ATTRIB(0, PointVertex, mPosition, ATTRIB_MODE_Float), TE_VERTEX_ATTRIB(1, PointVertex, mColor, ATTRIB_MODE_Float)> PointLayout;
+
+static const char* gVertexSource = "#version 450 core\n"
+    "layout(location = 0) in vec2 position;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "out vec4 vColor;\n"
+    "void main() { gl_Position = vec4(position, 0.0, 1.0); gl_PointSize = 1.0; vColor = color; }\n";
+
+static const char* gFragmentSource = "#version 450 core\n"
+    "in vec4 vColor;\n"
+    "out vec4 outColor;\n"
+    "void main() { outColor = vColor; }\n";
+
+// Draw first vertex as point into 1x1 target and read it back
+static uint32_t DrawFirstPoint(GLArray& array) {
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    array.Bind();
+    glDrawArrays(GL_POINTS, 0, 1);
+
+    uint8_t pixel[4] = {};
+    glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+
+    return (uint32_t)pixel[0] | (uint32_t)pixel[1] << 8 | (uint32_t)pixel[2] << 16 | (uint32_t)pixel[3] << 24;
+}
+
+// Growing buffer keeps name, so vertex array configured before reads new data without being configured again
+static void TestGrowKeepsVertexArray() {
+    GLShader vertex, fragment;
+    GLProgram program;
+
+    TE_CHECK(vertex.LoadShader(gVertexSource, GL_VERTEX_SHADER))
+    TE_CHECK(fragment.LoadShader(gFragmentSource, GL_FRAGMENT_SHADER))
+
+    program.Attach(vertex);
+    program.Attach(fragment);
+    TE_CHECK(program.Link())
+    program.Use();
+
+    uint32_t texture, framebuffer;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, 1, 1);
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, 1, 1);
+
+    GLBuffer buffer;
+    GLArray array;
+
+    std::vector<PointVertex> vertices = { { { 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f, 1.0f } } };
+    buffer.BindData(vertices);
+    array.Configure<PointLayout>(buffer);
+
+    const uint32_t id = buffer.mId;
+
+    TE_CHECK(DrawFirstPoint(array) == 0xff0000ffu)
+
+    // Same size, orphaned
+    vertices[0].mColor[2] = 1.0f;
+    buffer.BindData(vertices);
+
+    TE_CHECK(DrawFirstPoint(array) == 0xffff00ffu)
+
+    // Grows
+    vertices.assign(4096, { { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } });
+    buffer.BindData(vertices);
+
+    TE_CHECK(buffer.mId == id)
+    TE_CHECK(buffer.mCapacity >= vertices.size() * sizeof(PointVertex))
+
+    int bound = 0;
+    glGetVertexArrayIndexediv(array.mId, 0, GL_VERTEX_BINDING_BUFFER, &bound);
+
+    TE_CHECK((uint32_t)bound == buffer.mId)
+    TE_CHECK(DrawFirstPoint(array) == 0xff00ff00u)
+
+    // Reserve growth keeps name too, partial update lands in place
+    TE_CHECK(buffer.Reserve(buffer.mCapacity * 4))
+    TE_CHECK(buffer.mId == id)
+
+    const PointVertex blue = { { 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } };
+    buffer.SubData(&blue, sizeof(blue));
+
+    TE_CHECK(DrawFirstPoint(array) == 0xffff0000u)
+
+    // Smaller data reuses storage
+    const size_t capacity = buffer.mCapacity;
+    vertices.resize(2);
+    buffer.BindData(vertices);
+
+    TE_CHECK(buffer.mCapacity == capacity)
+    TE_CHECK(buffer.mSize == 2 * sizeof(PointVertex))
+    TE_CHECK(DrawFirstPoint(array) == 0xff00ff00u)
+
+    TE_CHECK(glGetError() == GL_NO_ERROR)
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &texture);
+}
+
+// Region size which isn`t multiple of offset alignment, offsets in every region must still bind as uniform and storage
+// ranges
+static void TestStreamBufferAlignment() {
+    GLint uniform_alignment = 0, storage_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+
+    const size_t alignment = std::max({ (size_t)256, (size_t)uniform_alignment, (size_t)storage_alignment });
+
+    GLStreamBuffer stream;
+    TE_CHECK(stream.Init(1000))
+    TE_CHECK(stream.mRegionSize % alignment == 0 && stream.mRegionSize >= 1000)
+
+    // Every region twice, second round reuses fenced regions
+    for(uint32_t frame = 0; frame < TE_STREAM_BUFFER_REGIONS * 2; frame++) {
+        uint8_t data[100];
+
+        for(size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(frame * 7 + i);
+
+        // Unaligned head first, then aligned uniform block
+        TE_CHECK(stream.Write(data, 3, 1) != SIZE_MAX)
+
+        const size_t offset = stream.Write(data, sizeof(data), 256);
+
+        TE_CHECK_MSG(offset != SIZE_MAX && offset % uniform_alignment == 0 && offset % storage_alignment == 0, "frame " << frame << " offset " << offset)
+
+        while(glGetError() != GL_NO_ERROR);
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, 0, stream.mId, offset, sizeof(data));
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stream.mId, offset, sizeof(data));
+
+        TE_CHECK_MSG(glGetError() == GL_NO_ERROR, "frame " << frame << " region " << stream.mRegion)
+
+        uint8_t read[sizeof(data)] = {};
+        glGetNamedBufferSubData(stream.mId, offset, sizeof(read), read);
+
+        TE_CHECK(memcmp(read, data, sizeof(data)) == 0)
+
+        // Full region fails without taking space
+        TE_CHECK(stream.Write(data, stream.mRegionSize, 1) == SIZE_MAX)
+        TE_CHECK(stream.Write(data, stream.mRegionSize, 1) == SIZE_MAX)
+
+        stream.EndFrame();
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+}
+
+int main() {
+    if(!TestMakeGLContext()) return 1;
+
+    TestGrowKeepsVertexArray();
+    TestStreamBufferAlignment();
+
+    return TestResult("gl_buffer_test");
+}
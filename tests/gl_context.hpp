@@ -0,0 +1,62 @@
+#pragma once
+#ifndef _TE_TEST_GL_CONTEXT_
+#define _TE_TEST_GL_CONTEXT_
+
+// EGL headers have to come before engine headers (glad)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "test.hpp"
+
+namespace te {
+    /**
+     * @brief Make headless GL 4.5 core context current (EGL surfaceless, works without display, e.g. Mesa llvmpipe)
+     * and load GL. Draws need bound framebuffer object, there is no default one
+     *
+     * @return bool
+     */
+    bool TestMakeGLContext() {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if(!get_platform_display) {
+            TE_ERR("EGL_EXT_platform_base missing!")
+
+            return false;
+        }
+
+        EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        EGLint major = 0, minor = 0;
+
+        if(!eglInitialize(display, &major, &minor)) {
+            TE_ERR("Cannot initialize EGL!")
+
+            return false;
+        }
+
+        eglBindAPI(EGL_OPENGL_API);
+
+        const EGLint config_attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = nullptr;
+        EGLint config_count = 0;
+
+        eglChooseConfig(display, config_attributes, &config, 1, &config_count);
+
+        const EGLint context_attributes[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5, EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+        EGLContext context = eglCreateContext(display, config_count ? config : nullptr, EGL_NO_CONTEXT, context_attributes);
+
+        if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            TE_ERR("Cannot create OpenGL 4.5 context!")
+
+            return false;
+        }
+
+        if(!gladLoadGL((GLADloadfunc)eglGetProcAddress)) {
+            TE_ERR("Cannot load OpenGL 4.5 context!")
+
+            return false;
+        }
+
+        return true;
+    }
+}
+
+#endif
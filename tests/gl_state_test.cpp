@@ -0,0 +1,104 @@
+// TE_TEST_LIBS: -lEGL
+#include "gl_context.hpp"
+#include "../engine/src/texture_compress.hpp"
+
+using namespace te;
+
+static uint32_t CreateTexture() {
+    uint32_t texture = 0;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, 4, 4);
+
+    return texture;
+}
+
+static GLint GetBound(GLenum binding) {
+    GLint value = -1;
+    glGetIntegerv(binding, &value);
+
+    return value;
+}
+
+// Repeated sets are skipped and counted, changed ones reach GL
+static void TestCounters() {
+    GLStateCache& state = GLStateCache::Get();
+
+    state.Invalidate();
+    state.ResetCounters();
+
+    uint32_t buffers[2];
+    glCreateBuffers(2, buffers);
+
+    for(uint32_t i = 0; i < 10; i++) {
+        state.BindBuffer(GL_ARRAY_BUFFER, buffers[i & 1 ? 1 : 0]);
+        state.BindBuffer(GL_ARRAY_BUFFER, buffers[i & 1 ? 1 : 0]);
+        state.Enable(GL_BLEND);
+        state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.DepthFunc(i < 5 ? GL_LESS : GL_LEQUAL);
+    }
+
+    const GLStateCounters& counters = state.mCounters;
+
+    TE_CHECK_MSG(counters.mIssued[GSC_Buffer] == 10 && counters.mSkipped[GSC_Buffer] == 10, counters.mIssued[GSC_Buffer] << " issued, " << counters.mSkipped[GSC_Buffer] << " skipped")
+    TE_CHECK(counters.mIssued[GSC_Capability] == 1 && counters.mSkipped[GSC_Capability] == 9)
+    TE_CHECK(counters.mIssued[GSC_Blend] == 1 && counters.mSkipped[GSC_Blend] == 9)
+    TE_CHECK(counters.mIssued[GSC_Depth] == 2 && counters.mSkipped[GSC_Depth] == 8)
+    TE_CHECK(counters.GetIssued() == 14 && counters.GetSkipped() == 36)
+
+    // Shadow matches what GL really has
+    TE_CHECK(GetBound(GL_ARRAY_BUFFER_BINDING) == (GLint)buffers[1])
+    TE_CHECK(glIsEnabled(GL_BLEND) && GetBound(GL_DEPTH_FUNC) == GL_LEQUAL)
+
+    // Frame end keeps finished frame and starts counting from zero
+    state.EndFrame();
+
+    TE_CHECK(state.mLastFrame.GetIssued() == 14 && state.mLastFrame.GetSkipped() == 36)
+    TE_CHECK(state.mCounters.GetIssued() == 0 && state.mCounters.GetSkipped() == 0)
+
+    state.BindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(2, buffers);
+    state.OnDeleteBuffer(buffers[0]);
+    state.OnDeleteBuffer(buffers[1]);
+    state.Disable(GL_BLEND);
+}
+
+// Texture deleted while bound is forgotten by cache, next texture on same unit is really bound
+static void TestDeletedTexture() {
+    GLStateCache& state = GLStateCache::Get();
+
+    state.Invalidate();
+    state.ResetCounters();
+
+    const uint32_t first = CreateTexture();
+
+    state.BindTextureUnit(0, first);
+    state.BindTextureUnit(0, first);
+
+    TE_CHECK(state.mCounters.mIssued[GSC_Texture] == 1 && state.mCounters.mSkipped[GSC_Texture] == 1)
+
+    TWTDeleteTexture(first);
+
+    // GL unbinds deleted texture, cache may not keep claiming it is bound as name can come back from glCreateTextures
+    TE_CHECK(GetBound(GL_TEXTURE_BINDING_2D) == 0)
+    TE_CHECK(state.mTextures[0] == TE_GL_STATE_UNKNOWN)
+
+    const uint32_t second = CreateTexture();
+
+    state.BindTextureUnit(0, second);
+
+    TE_CHECK_MSG(state.mCounters.mIssued[GSC_Texture] == 2, "rebind after delete skipped, texture " << second << " after " << first)
+    TE_CHECK(GetBound(GL_TEXTURE_BINDING_2D) == (GLint)second)
+
+    TWTDeleteTexture(second);
+    TE_CHECK(glGetError() == GL_NO_ERROR)
+}
+
+int main() {
+    if(!TestMakeGLContext()) return 1;
+
+    TestCounters();
+    TestDeletedTexture();
+
+    return TestResult("gl_state_test");
+}
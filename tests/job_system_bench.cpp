@@ -0,0 +1,109 @@
+#include "test.hpp"
+#include "../engine/src/job_system.hpp"
+#include <math.h>
+
+using namespace te;
+
+static double Spin(uint32_t iterations) {
+    double value = 1.0;
+
+    for(uint32_t i = 0; i < iterations; i++) value = sqrt(value + i);
+
+    return value;
+}
+
+int main() {
+    JobSystem jobs;
+    const uint32_t hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    const uint32_t max_workers = std::max(hardware, 4u) - 1;
+
+    TE_INFO("Hardware threads: " << hardware)
+
+    // Spawn: submit one job and wait for it, caller pops it back itself
+    for(uint32_t workers : { 0u, max_workers }) {
+        jobs.Start(workers);
+
+        const uint32_t count = 200000;
+        JobCounter counter = 0;
+
+        const double round_trip = TestBestMs(3, [&]() {
+            for(uint32_t i = 0; i < count; i++) {
+                jobs.Submit([]() {}, &counter);
+                jobs.Wait(&counter);
+            }
+        }) * 1e6 / count;
+
+        const double batch = TestBestMs(3, [&]() {
+            for(uint32_t i = 0; i < count; i++) jobs.Submit([]() {}, &counter);
+
+            jobs.Wait(&counter);
+        }) * 1e6 / count;
+
+        TE_INFO(workers << " workers: submit + wait " << round_trip << " ns/job, " << count << " submits + one wait " << batch << " ns/job")
+
+        jobs.Stop();
+    }
+
+    // Steal: caller submits and doesn`t help, time until worker starts job
+    {
+        jobs.Start(max_workers);
+
+        std::vector<double> hot, cold;
+
+        for(uint32_t i = 0; i < 2000; i++) {
+            // Every 10th job after idle pause, workers are asleep then
+            const bool idle = i % 10 == 0;
+
+            if(idle) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+            std::atomic<double> started = 0.0;
+            const double submitted = TestNowMs();
+
+            jobs.Submit([&]() { started = TestNowMs(); });
+
+            // Yield, spinning caller would keep worker off single core machine
+            while(started.load() == 0.0) std::this_thread::yield();
+
+            (idle ? cold : hot).push_back((started.load() - submitted) * 1e6);
+        }
+
+        std::sort(hot.begin(), hot.end());
+        std::sort(cold.begin(), cold.end());
+
+        TE_INFO("Steal latency, workers spinning: median " << hot[hot.size() / 2] << " ns, p99 " << hot[hot.size() * 99 / 100] << " ns")
+        TE_INFO("Steal latency, workers asleep: median " << cold[cold.size() / 2] << " ns, p99 " << cold[cold.size() * 99 / 100] << " ns")
+
+        jobs.Stop();
+    }
+
+    // Frame scaling: 64 layer sized jobs and one ParallelFor per frame
+    double base = 0.0;
+
+    for(uint32_t workers = 0; workers <= max_workers; workers++) {
+        jobs.Start(workers);
+
+        std::vector<double> results(1 << 16);
+
+        const double frame = TestBestMs(5, [&]() {
+            for(uint32_t f = 0; f < 10; f++) {
+                JobCounter counter = 0;
+
+                for(uint32_t layer = 0; layer < 64; layer++) jobs.Submit([]() { volatile double sink = Spin(20000); (void)sink; }, &counter);
+
+                jobs.ParallelFor(results.size(), 1024, [&](size_t begin, size_t end) {
+                    for(size_t i = begin; i < end; i++) results[i] = Spin(16);
+                });
+
+                jobs.Wait(&counter);
+            }
+        }) / 10.0;
+
+        if(workers == 0) base = frame;
+
+        TE_INFO("1 + " << workers << " workers: " << frame << " ms/frame, speedup " << base / frame << (workers + 1 > hardware ? " (more threads than hardware)" : ""))
+
+        jobs.Stop();
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "test.hpp"
+#include "../engine/src/job_system.hpp"
+
+using namespace te;
+
+int main() {
+    JobSystem jobs;
+
+    // Stop while worker is inside job that submits continuation, continuation must still run
+    for(uint32_t run = 0; run < 20; run++) {
+        jobs.Start(2);
+
+        JobCounter counter = 0;
+        std::atomic<bool> started = false;
+        std::atomic<uint32_t> ran = 0;
+
+        jobs.Submit([&]() {
+            started = true;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+            jobs.Submit([&]() { ran++; }, &counter);
+
+            ran++;
+        }, &counter);
+
+        // Let worker take it, drain in Stop would run it on this thread otherwise
+        const double start = TestNowMs();
+
+        while(!started && TestNowMs() - start < 1000.0) std::this_thread::yield();
+
+        jobs.Stop();
+
+        TE_CHECK_MSG(ran == 2 && counter == 0, "run " << run << " ran " << ran << " counter " << counter)
+    }
+
+    // Graph continuations submitted from workers until last node
+    jobs.Start(3);
+
+    for(uint32_t run = 0; run < 200; run++) {
+        JobGraph graph;
+        std::atomic<uint32_t> order = 0;
+        uint32_t first = 0, last = 0;
+        std::vector<uint32_t> middle(16);
+
+        const uint32_t root = graph.Add([&]() { first = ++order; });
+        std::vector<uint32_t> fan;
+
+        for(uint32_t i = 0; i < 16; i++) {
+            fan.push_back(graph.Add([&, i]() { middle[i] = ++order; }));
+            graph.Depend(fan.back(), root);
+        }
+
+        const uint32_t sink = graph.Add([&]() { last = ++order; });
+
+        for(uint32_t node : fan) graph.Depend(sink, node);
+
+        graph.Run(&jobs);
+
+        TE_CHECK(first == 1 && last == 18)
+
+        for(uint32_t value : middle) TE_CHECK(value > 1 && value < 18)
+    }
+
+    // ParallelFor covers every index exactly once
+    std::vector<std::atomic<uint32_t>> hits(100000);
+
+    jobs.ParallelFor(hits.size(), 1000, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) hits[i]++;
+    });
+
+    bool once = true;
+
+    for(std::atomic<uint32_t>& hit : hits) once &= hit == 1;
+
+    TE_CHECK(once)
+
+    jobs.Stop();
+
+    return TestResult("job_system_test");
+}
@@ -0,0 +1,130 @@
+#include "test.hpp"
+#include "../engine/src/layer.hpp"
+#include <random>
+#include <memory>
+
+using namespace te;
+
+// Cost of running phase over 10k layers in ns per layer: old loop testing flags of every layer against dispatch lists
+// (RunPhase) and frame graph (LayersFrame), without and with LF_Batch, serial and on started JobSystem. Layers of 5 classes of different size are
+// shuffled in memory order, about half of them have LF_Update
+
+static const uint32_t sLayerCount = 10000;
+
+template<uint32_t K>
+class BenchLayer : public Layer {
+public:
+    uint64_t mValue = 0;
+    uint8_t mPadding[K * 8] = {};
+
+    virtual void Update() override { mValue += K; }
+
+    virtual void LateUpdate() override { mValue += 2 * K; }
+
+    // Batch of one class skips virtual call per layer
+    virtual void RunBatch(uint32_t phase, Layer* const* pLayers, size_t count) override {
+        if(phase != LF_Update) {
+            Layer::RunBatch(phase, pLayers, count);
+
+            return;
+        }
+
+        for(size_t i = 0; i < count; i++) static_cast<BenchLayer*>(pLayers[i])->mValue += K;
+    }
+
+    void DeclareRead(const char* read) {
+        Reads(read);
+    }
+};
+
+static void OldPhase(const std::vector<Layer*>& layers, uint32_t flag, void (Layer::*phase)()) {
+    for(Layer* l : layers) {
+        if(l->GetFlags() & flag) (l->*phase)();
+    }
+}
+
+template<uint32_t K>
+static Layer* MakeLayer(bool declared) {
+    BenchLayer<K>* p_layer = new BenchLayer<K>();
+
+    // Read only layers don`t conflict, undeclared ones would conflict with every stage
+    if(declared) p_layer->DeclareRead("scene");
+
+    return p_layer;
+}
+
+static double NsPerLayer(const std::function<void()>& fn) {
+    const uint32_t loops = 50;
+
+    fn();
+
+    return TestBestMs(5, [&]() {
+        for(uint32_t i = 0; i < loops; i++) fn();
+    }) * 1e6 / loops / sLayerCount;
+}
+
+static void Bench(bool batch, JobSystem* pJobs) {
+    std::mt19937 random(7);
+    std::vector<std::unique_ptr<Layer>> owned;
+    // Allocations between layers so they don`t sit next to each other like in real scene
+    std::vector<std::unique_ptr<uint8_t[]>> gaps;
+    std::vector<Layer*> layers;
+
+    for(uint32_t i = 0; i < sLayerCount; i++) {
+        Layer* l = nullptr;
+
+        switch(random() % 5) {
+        case 0: l = MakeLayer<1>(true); break;
+        case 1: l = MakeLayer<2>(true); break;
+        case 2: l = MakeLayer<3>(true); break;
+        case 3: l = MakeLayer<5>(true); break;
+        default: l = MakeLayer<8>(true); break;
+        }
+
+        l->SetFlag(LF_LateUpdate | (random() % 2 ? LF_Update : 0) | (batch ? LF_Batch : 0));
+
+        owned.emplace_back(l);
+        gaps.emplace_back(new uint8_t[64 + random() % 512]);
+        layers.push_back(l);
+    }
+
+    std::shuffle(layers.begin(), layers.end(), random);
+
+    LayerHandler handler;
+
+    for(Layer* l : layers) handler.AddLayer(l);
+
+    handler.ApplyLayerChanges();
+
+    const double old_update = NsPerLayer([&]() { OldPhase(layers, LF_Update, &Layer::Update); });
+    const double update = NsPerLayer([&]() { handler.LayersUpdate(); });
+    const double old_late_update = NsPerLayer([&]() { OldPhase(layers, LF_LateUpdate, &Layer::LateUpdate); });
+    const double late_update = NsPerLayer([&]() { handler.LayersLateUpdate(); });
+
+    // Graph build is first call, not timed
+    const double build_start = TestNowMs();
+    handler.LayersFrame([]() {});
+    const double build_ms = TestNowMs() - build_start;
+
+    const double frame = NsPerLayer([&]() { handler.LayersFrame([]() {}); });
+
+    TE_INFO((batch ? "LF_Batch " : "Unbatched") << (pJobs ? " on " + std::to_string(pJobs->GetThreadCount()) + " threads" : " serial") << " " << sLayerCount << " layers, ns/layer: Update old " << old_update << " dispatch " << update << ", LateUpdate old " << old_late_update << " dispatch " << late_update << ", LayersFrame (both phases) " << frame << " with " << handler.GetFrameGraph().GetSize() << " stages, built in " << build_ms << " ms")
+
+    TE_CHECK(handler.GetFrameGraph().GetSize() > 0)
+}
+
+int main() {
+    Bench(false, nullptr);
+    Bench(true, nullptr);
+
+    // LayersFrame runs on JobSystem::pGlobal
+    JobSystem jobs;
+    jobs.Start(0);
+
+    Bench(false, &jobs);
+    Bench(true, &jobs);
+
+    jobs.Stop();
+
+    return TestResult("layer_dispatch_bench");
+}
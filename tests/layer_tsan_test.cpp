@@ -0,0 +1,199 @@
+#include "test.hpp"
+#include "../engine/src/layer.hpp"
+#include "../engine/src/fixed_step.hpp"
+#include <thread>
+
+// Built with ThreadSanitizer (see mk_tests), any race it finds fails run on its own
+
+using namespace te;
+
+typedef struct SimState {
+    uint64_t mTick = 0;
+    uint64_t mDouble = 0;
+    uint64_t mPadding[6] = {};
+} SimState;
+
+static SnapshotBuffer<SimState> gState;
+static std::atomic<uint32_t> gTornReads = 0;
+
+// FixedUpdate writer, fills whole slot every tick
+class SimLayer : public Layer {
+public:
+    uint64_t mTicks = 0;
+
+    SimLayer() {
+        mName = "Sim";
+        SetFlag(LF_FixedUpdate);
+    }
+
+    void FixedUpdate() override {
+        mTicks++;
+
+        SimState& state = gState.GetWrite();
+        state.mTick = mTicks;
+        state.mDouble = mTicks * 2;
+
+        for(uint64_t& p : state.mPadding) p = mTicks;
+
+        gState.Publish(mTicks);
+    }
+};
+
+// Render side reader, state has to be whole and never go back in time
+class ViewLayer : public Layer {
+public:
+    uint64_t mLast = 0;
+    uint64_t mFresh = 0;
+
+    ViewLayer() {
+        mName = "View";
+        SetFlag(LF_Update);
+    }
+
+    void Update() override {
+        if(gState.Acquire()) mFresh++;
+
+        const SimState& current = gState.GetCurrent();
+        const SimState& previous = gState.GetPrevious();
+
+        if(current.mDouble != current.mTick * 2 || current.mPadding[5] != current.mTick) gTornReads++;
+        if(previous.mTick && previous.mTick >= current.mTick) gTornReads++;
+        if(current.mTick < mLast) gTornReads++;
+
+        const float alpha = gState.GetAlpha(1.0 / 2000.0);
+
+        if(alpha < 0.0f || alpha > 1.0f) gTornReads++;
+
+        mLast = current.mTick;
+    }
+};
+
+// Layer on every list, counts calls after it was retired
+class ChurnLayer : public Layer {
+public:
+    std::atomic<bool> mRetired = false;
+    std::atomic<uint64_t> mLateCalls = 0;
+
+    ChurnLayer(uint32_t i) {
+        mName = "Churn" + std::to_string(i);
+        SetFlag(LF_FixedUpdate | LF_Update | LF_LateUpdate);
+    }
+
+    void FixedUpdate() override { if(mRetired.load()) mLateCalls++; }
+    void Update() override { if(mRetired.load()) mLateCalls++; }
+};
+
+// Pushes and pops churn layers from inside its own Update, while list is being dispatched
+class SpawnerLayer : public Layer {
+public:
+    LayerHandler* pHandler;
+    std::vector<ChurnLayer*> mPool;
+    ChurnLayer* pActive = nullptr;
+    uint64_t mNext = 0;
+
+    SpawnerLayer(LayerHandler* pLayerHandler) : pHandler(pLayerHandler) {
+        mName = "Spawner";
+        SetFlag(LF_Update);
+    }
+
+    void Update() override {
+        if(pActive) {
+            pHandler->RemoveLayer(pActive);
+            pActive = nullptr;
+
+            return;
+        }
+
+        pActive = mPool[mNext++ % mPool.size()];
+        pHandler->AddLayer(pActive);
+    }
+};
+
+int main() {
+    LayerHandler handler;
+    SimLayer sim;
+    ViewLayer view;
+    SpawnerLayer spawner(&handler);
+
+    std::vector<std::unique_ptr<ChurnLayer>> pool;
+
+    for(uint32_t i = 0; i < 48; i++) pool.push_back(std::make_unique<ChurnLayer>(i));
+
+    // Main loop pushes 0..15, spawner 16..31, side thread 32..47
+    for(uint32_t i = 16; i < 32; i++) spawner.mPool.push_back(pool[i].get());
+
+    handler.AddLayer(&sim);
+    handler.AddLayer(&view);
+    handler.AddLayer(&spawner);
+    handler.LayersAwake();
+
+    FixedStepScheduler fixed;
+    fixed.Start(2000, [&handler]() { handler.LayersFixedUpdate(); });
+
+    // Changes queued from thread other than main one
+    std::atomic<bool> stop = false;
+    std::thread side([&]() {
+        for(uint32_t i = 0; !stop; i++) {
+            ChurnLayer* p_layer = pool[32 + i % 16].get();
+
+            handler.AddLayer(p_layer);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            handler.RemoveLayer(p_layer);
+        }
+    });
+
+    // Layer may only be reused or retired once FixedUpdate thread stopped using list that still had it
+    std::vector<std::pair<ChurnLayer*, uint64_t>> retiring;
+    uint64_t frames = 0;
+    const double start = TestNowMs();
+
+    while(TestNowMs() - start < 2000.0) {
+        ChurnLayer* p_layer = pool[frames % 16].get();
+        bool pending = false;
+
+        for(std::pair<ChurnLayer*, uint64_t>& r : retiring) pending |= r.first == p_layer;
+
+        if(!pending) {
+            p_layer->mRetired = false;
+
+            handler.AddLayer(p_layer);
+            handler.LayersUpdate();
+            handler.LayersLateUpdate();
+            handler.RemoveLayer(p_layer);
+
+            retiring.push_back({ p_layer, handler.GetLayerGeneration() + 1 });
+        }
+
+        handler.LayersUpdate();
+        handler.LayersLateUpdate();
+
+        for(size_t i = 0; i < retiring.size();) {
+            if(handler.IsFixedUpdateCaughtUp(retiring[i].second)) {
+                retiring[i].first->mRetired = true;
+                retiring.erase(retiring.begin() + i);
+            }
+            else {
+                i++;
+            }
+        }
+
+        frames++;
+    }
+
+    stop = true;
+    side.join();
+    fixed.Stop();
+    handler.ApplyLayerChanges();
+
+    uint64_t late_calls = 0;
+
+    for(std::unique_ptr<ChurnLayer>& layer : pool) late_calls += layer->mLateCalls;
+
+    TE_CHECK(gTornReads == 0)
+    TE_CHECK(late_calls == 0)
+    TE_CHECK(sim.mTicks > 0 && view.mFresh > 0)
+
+    TE_INFO(frames << " frames, " << sim.mTicks << " fixed ticks, " << view.mFresh << " snapshots taken, " << handler.GetLayerGeneration() << " layer list changes")
+
+    return TestResult("layer_tsan_test");
+}
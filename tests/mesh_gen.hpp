@@ -0,0 +1,120 @@
+#pragma once
+#ifndef _TE_TEST_MESH_GEN_
+#define _TE_TEST_MESH_GEN_
+
+#include "../engine/src/ul_mesh.hpp"
+#include <math.h>
+
+// Procedural meshes for tests and benchmarks, built as soup and indexed like loaders leave them
+namespace te {
+    static void TestMeshPushCorner(ul_mesh_t* pMesh, const float* p, const float* n, float u, float v) {
+        pMesh->vertices.insert(pMesh->vertices.end(), { p[0], p[1], p[2] });
+        pMesh->normals.insert(pMesh->normals.end(), { n[0], n[1], n[2] });
+        pMesh->textureCoordinates.insert(pMesh->textureCoordinates.end(), { u, v });
+    }
+
+    /**
+     * @brief Cube from -1 to 1, every face grid of segments * segments quads with its normal. Face f gets its own uv
+     * island inside of u from f / 6 to (f + 1) / 6, so every cube edge is normal and uv seam
+     *
+     * @param pMesh
+     * @param segments
+     */
+    void TestMakeCube(ul_mesh_t* pMesh, uint32_t segments) {
+        *pMesh = ul_mesh_t();
+
+        for(uint32_t f = 0; f < 6; f++) {
+            const uint32_t axis = f / 2;
+            const float side = f % 2 ? 1.0f : -1.0f;
+            const uint32_t u_axis = (axis + 1) % 3, v_axis = (axis + 2) % 3;
+
+            float n[3] = { 0.0f, 0.0f, 0.0f };
+            n[axis] = side;
+
+            auto corner = [&](uint32_t x, uint32_t y) {
+                float p[3];
+                p[axis] = side;
+                p[u_axis] = -1.0f + 2.0f * x / segments;
+                p[v_axis] = -1.0f + 2.0f * y / segments;
+
+                TestMeshPushCorner(pMesh, p, n, (f + 0.05f + 0.9f * x / segments) / 6.0f, (float)y / segments);
+            };
+
+            for(uint32_t y = 0; y < segments; y++) {
+                for(uint32_t x = 0; x < segments; x++) {
+                    // Outward winding on both sides of axis
+                    if(side > 0.0f) {
+                        corner(x, y); corner(x + 1, y); corner(x + 1, y + 1);
+                        corner(x, y); corner(x + 1, y + 1); corner(x, y + 1);
+                    }
+                    else {
+                        corner(x, y); corner(x + 1, y + 1); corner(x + 1, y);
+                        corner(x, y); corner(x, y + 1); corner(x + 1, y + 1);
+                    }
+                }
+            }
+        }
+
+        ulMeshIndex(pMesh);
+    }
+
+    /**
+     * @brief Unit uv sphere, flat shaded (normal of every triangle, no texture coordinates) or smooth with uv seam
+     * along u = 0
+     *
+     * @param pMesh
+     * @param slices
+     * @param stacks
+     * @param flat
+     */
+    void TestMakeSphere(ul_mesh_t* pMesh, uint32_t slices, uint32_t stacks, bool flat) {
+        *pMesh = ul_mesh_t();
+
+        auto point = [&](uint32_t slice, uint32_t stack, float* p) {
+            const double theta = M_PI * stack / stacks, phi = 2.0 * M_PI * (slice % slices) / slices;
+
+            // sin(M_PI) isn`t 0, poles have to be one point
+            const double radius = stack == 0 || stack == stacks ? 0.0 : sin(theta);
+
+            p[0] = (float)(radius * cos(phi));
+            p[1] = (float)cos(theta);
+            p[2] = (float)(radius * sin(phi));
+        };
+
+        auto triangle = [&](const uint32_t (*corners)[2]) {
+            float p[3][3];
+
+            for(int k = 0; k < 3; k++) point(corners[k][0], corners[k][1], p[k]);
+
+            float n[3] = {
+                (p[1][1] - p[0][1]) * (p[2][2] - p[0][2]) - (p[1][2] - p[0][2]) * (p[2][1] - p[0][1]),
+                (p[1][2] - p[0][2]) * (p[2][0] - p[0][0]) - (p[1][0] - p[0][0]) * (p[2][2] - p[0][2]),
+                (p[1][0] - p[0][0]) * (p[2][1] - p[0][1]) - (p[1][1] - p[0][1]) * (p[2][0] - p[0][0])
+            };
+            const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for(int k = 0; k < 3; k++) n[k] /= length;
+
+            for(int k = 0; k < 3; k++) {
+                TestMeshPushCorner(pMesh, p[k], flat ? n : p[k], (float)corners[k][0] / slices, (float)corners[k][1] / stacks);
+            }
+        };
+
+        for(uint32_t stack = 0; stack < stacks; stack++) {
+            for(uint32_t slice = 0; slice < slices; slice++) {
+                const uint32_t a[3][2] = { { slice, stack }, { slice + 1, stack + 1 }, { slice, stack + 1 } };
+                const uint32_t b[3][2] = { { slice, stack }, { slice + 1, stack }, { slice + 1, stack + 1 } };
+
+                // Pole rows have one triangle per slice, other one would be degenerate
+                if(stack != stacks - 1) triangle(a);
+                if(stack != 0) triangle(b);
+            }
+        }
+
+        if(flat) pMesh->textureCoordinates.clear();
+
+        ulMeshIndex(pMesh);
+    }
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _TE_TEST_OBJ_WRITER_
+#define _TE_TEST_OBJ_WRITER_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// OBJ text writer for tests and benchmarks
+namespace te {
+    /**
+     * @brief Write grid of size * size quads as OBJ with v/vt/vn per vertex and "f v/t/n" triangles, like exporters do
+     *
+     * @param path
+     * @param size quads per side
+     * @return size_t file size in bytes, 0 on failure
+     */
+    size_t TestWriteOBJGrid(const char* path, uint32_t size) {
+        FILE* p_file = fopen(path, "wb");
+
+        if(!p_file) return 0;
+
+        const uint32_t side = size + 1;
+
+        for(uint32_t y = 0; y < side; y++) {
+            for(uint32_t x = 0; x < side; x++) {
+                const float u = (float)x / size, v = (float)y / size;
+
+                fprintf(p_file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0.000000 0.000000 1.000000\n", u * 10.0f - 5.0f, v * 10.0f - 5.0f, 0.25f * u * v, u, v);
+            }
+        }
+
+        for(uint32_t y = 0; y < size; y++) {
+            for(uint32_t x = 0; x < size; x++) {
+                const uint32_t a = y * side + x + 1, b = a + 1, c = a + side + 1, d = a + side;
+
+                fprintf(p_file, "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d);
+            }
+        }
+
+        const size_t bytes = (size_t)ftell(p_file);
+
+        return fclose(p_file) == 0 ? bytes : 0;
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+// TE_TEST_LIBS: -lz
+#include "test.hpp"
+#include "png_writer.hpp"
+#include "../engine/src/load_png.hpp"
+
+using namespace te;
+
+// Serial PNGDecode throughput in MB of RGBA8 output per second, best of runs. Repo images are tiny, they run in a
+// loop so per file setup (parse, tables) shows up
+
+static std::vector<uint8_t> ReadFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* p_file = fopen(path, "rb");
+
+    if(!p_file) return data;
+
+    fseek(p_file, 0, SEEK_END);
+    data.resize(ftell(p_file));
+    fseek(p_file, 0, SEEK_SET);
+
+    if(fread(data.data(), 1, data.size(), p_file) != data.size()) data.clear();
+
+    fclose(p_file);
+
+    return data;
+}
+
+static void Bench(const char* name, const std::vector<uint8_t>& png, uint32_t loops) {
+    PNGInfo info;
+
+    if(!PNGReadInfo(png.data(), png.size(), &info)) {
+        TE_CHECK_MSG(false, name)
+
+        return;
+    }
+
+    std::vector<uint8_t> out(PNGOutputSize(&info, PNG_RGBA8));
+    bool ok = true;
+
+    const double ms = TestBestMs(5, [&]() {
+        for(uint32_t i = 0; i < loops; i++) ok &= PNGDecode(png.data(), png.size(), out.data(), out.size());
+    });
+
+    TE_CHECK_MSG(ok, name)
+
+    const double mb = (double)out.size() * loops / (1024.0 * 1024.0);
+
+    TE_INFO(name << " " << info.mWidth << "x" << info.mHeight << " (" << png.size() / 1024.0 << " KB file): " << ms / loops << " ms, " << mb / (ms / 1000.0) << " MB/s")
+}
+
+int main() {
+    const char* paths[] = { "1.png", "2.png", "tweLogo.png" };
+
+    for(const char* path : paths) {
+        const std::vector<uint8_t> png = ReadFile(path);
+
+        TE_CHECK_MSG(!png.empty(), path)
+
+        if(!png.empty()) Bench(path, png, 2000);
+    }
+
+    const std::vector<uint8_t> rgb = TestEncodePNG(TestMakeImage(4096, 4096, 3), 4096, 4096, PNG_CT_RGB, 3);
+    Bench("synthetic RGB", rgb, 1);
+
+    const std::vector<uint8_t> rgba = TestEncodePNG(TestMakeImage(4096, 4096, 4), 4096, 4096, PNG_CT_RGBA, 4);
+    Bench("synthetic RGBA", rgba, 1);
+
+    // zlib inflate of same RGBA stream as reference for inflate share of decode
+    PNGDecodeState state;
+    PNGParse(rgba.data(), rgba.size(), &state);
+
+    std::vector<uint8_t> inflated((size_t)4096 * (4096 * 4 + 1));
+
+    const double zlib_ms = TestBestMs(5, [&]() {
+        uLongf size = (uLongf)inflated.size();
+        uncompress(inflated.data(), &size, state.mIdat, (uLong)state.mIdatSize);
+    });
+
+    TE_INFO("zlib uncompress of synthetic RGBA stream: " << zlib_ms << " ms, " << 64.0 / (zlib_ms / 1000.0) << " MB/s of RGBA")
+
+    return TestResult("png_bench");
+}
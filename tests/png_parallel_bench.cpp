@@ -0,0 +1,49 @@
+// TE_TEST_LIBS: -lz
+#include "test.hpp"
+#include "png_writer.hpp"
+#include "../engine/src/load_png.hpp"
+#include <thread>
+
+using namespace te;
+
+// PNGDecodeParallel scaling over thread counts against serial PNGDecode. File with full flush points lets segments
+// inflate concurrently, file without them only overlaps inflate with unfilter (pipeline)
+
+static void Scale(const char* name, const std::vector<uint8_t>& png, uint32_t maxThreads) {
+    PNGInfo info;
+    PNGReadInfo(png.data(), png.size(), &info);
+
+    std::vector<uint8_t> reference(PNGOutputSize(&info, PNG_RGBA8)), out(reference.size());
+    const double mb = reference.size() / (1024.0 * 1024.0);
+
+    const double serial = TestBestMs(3, [&]() { TE_CHECK(PNGDecode(png.data(), png.size(), reference.data(), reference.size())) });
+
+    TE_INFO(name << " " << info.mWidth << "x" << info.mHeight << ", serial PNGDecode: " << serial << " ms, " << mb / (serial / 1000.0) << " MB/s")
+
+    for(uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+        const double ms = TestBestMs(3, [&]() { TE_CHECK(PNGDecodeParallel(png.data(), png.size(), out.data(), out.size(), PNG_RGBA8, threads)) });
+
+        TE_CHECK_MSG(out == reference, name << " " << threads << " threads")
+
+        TE_INFO("    " << threads << " threads: " << ms << " ms, " << mb / (ms / 1000.0) << " MB/s, speedup " << serial / ms << "x")
+    }
+}
+
+int main() {
+    const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    // Always show few steps, past hardware threads they show oversubscription cost
+    const uint32_t max_threads = std::max(8u, hardware);
+
+    TE_INFO("Hardware threads: " << hardware)
+
+    const std::vector<uint8_t> pixels = TestMakeImage(4096, 4096, 4);
+
+    // Flush every 64 rows, about 1 MB of raw data
+    const std::vector<uint8_t> flushed = TestEncodePNG(pixels, 4096, 4096, PNG_CT_RGBA, 4, {}, (4096 * 4 + 1) * 64);
+    Scale("RGBA with flush points", flushed, max_threads);
+
+    const std::vector<uint8_t> plain = TestEncodePNG(pixels, 4096, 4096, PNG_CT_RGBA, 4);
+    Scale("RGBA without flush points", plain, max_threads);
+
+    return TestResult("png_parallel_bench");
+}
@@ -0,0 +1,203 @@
+// TE_TEST_LIBS: -lz
+#include "test.hpp"
+#include "png_writer.hpp"
+#include "../engine/src/load_png.hpp"
+
+using namespace te;
+
+// Indices past PLTE end are invalid, they have to come out as opaque black and not as whatever was on stack
+static void TestPaletteOutOfRange() {
+    const std::vector<uint8_t> palette = { 255, 0, 0, 0, 255, 0 };
+    const std::vector<uint8_t> indices = { 0, 1, 2, 255, 1, 0, 7, 128 };
+
+    const std::vector<uint8_t> png = TestEncodePNG(indices, 4, 2, PNG_CT_Palette, 1, palette);
+
+    for(uint32_t run = 0; run < 2; run++) {
+        // Dirty stack and output so leftovers can`t pass by luck
+        volatile uint8_t garbage[8192];
+
+        for(size_t i = 0; i < sizeof(garbage); i++) garbage[i] = (uint8_t)(0x5a + i);
+
+        std::vector<uint8_t> out(4 * 2 * 4, 0x77);
+
+        TE_CHECK(run == 0 ? PNGDecode(png.data(), png.size(), out.data(), out.size()) : PNGDecodeParallel(png.data(), png.size(), out.data(), out.size(), PNG_RGBA8, 2))
+
+        for(uint32_t i = 0; i < indices.size(); i++) {
+            uint8_t expected[4] = { 0, 0, 0, 255 };
+
+            if(indices[i] < 2) memcpy(expected, &palette[indices[i] * 3], 3);
+
+            TE_CHECK_MSG(memcmp(&out[i * 4], expected, 4) == 0, "pixel " << i << " index " << (int)indices[i] << " = " << (int)out[i * 4] << " " << (int)out[i * 4 + 1] << " " << (int)out[i * 4 + 2] << " " << (int)out[i * 4 + 3])
+        }
+    }
+}
+
+// Serial and parallel decode give back encoded pixels
+static void TestRoundTrip(uint32_t channels) {
+    const uint32_t width = 333, height = 517;
+    const std::vector<uint8_t> pixels = TestMakeImage(width, height, channels);
+    const std::vector<uint8_t> png = TestEncodePNG(pixels, width, height, channels == 4 ? PNG_CT_RGBA : PNG_CT_RGB, channels, {}, 64 * 1024);
+
+    std::vector<uint8_t> serial((size_t)width * height * 4), parallel(serial.size());
+
+    TE_CHECK(PNGDecode(png.data(), png.size(), serial.data(), serial.size()))
+    TE_CHECK(PNGDecodeParallel(png.data(), png.size(), parallel.data(), parallel.size(), PNG_RGBA8, 4))
+    TE_CHECK(serial == parallel)
+
+    uint32_t mismatches = 0;
+
+    for(size_t i = 0; i < (size_t)width * height; i++) {
+        for(uint32_t c = 0; c < 4; c++) {
+            const uint8_t expected = c < channels ? pixels[i * channels + c] : 255;
+
+            if(serial[i * 4 + c] != expected) mismatches++;
+        }
+    }
+
+    TE_CHECK(mismatches == 0)
+}
+
+// 8 and 16 bit gray, gray alpha, RGB and RGBA, plain and Adam7, with tRNS color key, to RGBA8 and RGBA16 on both decoders
+static void TestFormats() {
+    typedef struct Case {
+        uint8_t mColorType;
+        uint32_t mChannels, mDepth;
+        bool mAdam7, mKey;
+    } Case;
+
+    const Case cases[] = {
+        { PNG_CT_RGBA, 4, 16, false, false }, { PNG_CT_RGBA, 4, 8, true, false },
+        { PNG_CT_RGB, 3, 16, true, true }, { PNG_CT_RGB, 3, 8, false, true },
+        { PNG_CT_Grayscale, 1, 8, false, true }, { PNG_CT_Grayscale, 1, 16, true, false },
+        { PNG_CT_GrayscaleAlpha, 2, 8, true, false }, { PNG_CT_GrayscaleAlpha, 2, 16, false, false }
+    };
+    const uint32_t width = 61, height = 37;
+
+    for(const Case& c : cases) {
+        const uint32_t sample_bytes = c.mDepth / 8, pixel_bytes = c.mChannels * sample_bytes;
+        const std::vector<uint8_t> samples = TestMakeImage(width, height, pixel_bytes, c.mColorType + c.mDepth);
+
+        auto sample = [&](size_t pixel, uint32_t channel) {
+            const uint8_t* p = &samples[pixel * pixel_bytes + channel * sample_bytes];
+
+            return sample_bytes == 2 ? (uint32_t)(p[0] << 8 | p[1]) : (uint32_t)p[0];
+        };
+
+        // Key is color of pixel 5, in file as 16 bit sample per channel
+        std::vector<uint8_t> trns;
+
+        for(uint32_t k = 0; c.mKey && k < c.mChannels; k++) trns.insert(trns.end(), { (uint8_t)(sample(5, k) >> 8), (uint8_t)sample(5, k) });
+
+        const std::vector<uint8_t> png = TestEncodePNGEx(samples, width, height, c.mColorType, c.mChannels, c.mDepth, c.mAdam7, trns);
+        std::vector<uint8_t> rgba8((size_t)width * height * 4), parallel(rgba8.size());
+        std::vector<uint16_t> rgba16((size_t)width * height * 4);
+
+        TE_CHECK(PNGDecode(png.data(), png.size(), rgba8.data(), rgba8.size(), PNG_RGBA8))
+        TE_CHECK(PNGDecode(png.data(), png.size(), rgba16.data(), rgba16.size() * 2, PNG_RGBA16))
+        TE_CHECK(PNGDecodeParallel(png.data(), png.size(), parallel.data(), parallel.size(), PNG_RGBA8, 3))
+
+        const uint32_t max = c.mDepth == 16 ? 65535 : 255;
+        uint32_t mismatches = 0;
+
+        for(size_t i = 0; i < (size_t)width * height; i++) {
+            const bool gray = c.mColorType == PNG_CT_Grayscale || c.mColorType == PNG_CT_GrayscaleAlpha;
+            bool keyed = c.mKey;
+
+            for(uint32_t k = 0; k < c.mChannels && keyed; k++) keyed = sample(i, k) == sample(5, k);
+
+            uint32_t expected[4];
+
+            for(uint32_t k = 0; k < 3; k++) expected[k] = sample(i, gray ? 0 : k);
+
+            expected[3] = c.mChannels == 2 || c.mChannels == 4 ? sample(i, c.mChannels - 1) : (keyed ? 0 : max);
+
+            for(uint32_t k = 0; k < 4; k++) {
+                const uint32_t wide = c.mDepth == 16 ? expected[k] : expected[k] * 257;
+                const uint32_t narrow = c.mDepth == 16 ? expected[k] >> 8 : expected[k];
+
+                mismatches += rgba16[i * 4 + k] != wide || rgba8[i * 4 + k] != narrow || parallel[i * 4 + k] != narrow;
+            }
+        }
+
+        TE_CHECK_MSG(mismatches == 0, "color type " << (int)c.mColorType << " depth " << c.mDepth << (c.mAdam7 ? " Adam7" : "") << (c.mKey ? " tRNS" : "") << ": " << mismatches << " samples differ")
+    }
+}
+
+// Damaged data that still inflates (stored blocks) or damaged trailer is caught by Adler-32
+static void TestAdler() {
+    const uint32_t width = 64, height = 64;
+    const std::vector<uint8_t> pixels = TestMakeImage(width, height, 4);
+    std::vector<uint8_t> out((size_t)width * height * 4);
+
+    for(int level : { 0, 6 }) {
+        const std::vector<uint8_t> png = TestEncodePNG(pixels, width, height, PNG_CT_RGBA, 4, {}, 0, level);
+
+        TE_CHECK(PNGDecode(png.data(), png.size(), out.data(), out.size()))
+        TE_CHECK(PNGDecodeParallel(png.data(), png.size(), out.data(), out.size(), PNG_RGBA8, 2))
+
+        // IDAT data ends before its CRC and IEND chunk, trailer is its last 4 bytes
+        std::vector<uint8_t> damaged = png;
+        damaged[level == 0 ? damaged.size() / 2 : damaged.size() - 12 - 4 - 1] ^= 0x10;
+
+        TE_CHECK_MSG(!PNGDecode(damaged.data(), damaged.size(), out.data(), out.size()), "level " << level)
+        TE_CHECK_MSG(!PNGDecodeParallel(damaged.data(), damaged.size(), out.data(), out.size(), PNG_RGBA8, 2), "level " << level)
+    }
+}
+
+// IHDR claiming huge image is rejected before output is allocated, not thrown out of as bad_alloc
+static void TestOversized() {
+    const char* path = "tests/bin/png_test_oversized.png";
+    const uint32_t sizes[][2] = { { 100000, 100000 }, { 20000, 20000 }, { 0x80000000u, 1 }, { 8000, 8000 } };
+    const std::vector<uint8_t> raw(64, 0);
+
+    for(const uint32_t* size : sizes) {
+        const std::vector<uint8_t> png = TestPNGAssemble(raw, size[0], size[1], PNG_CT_RGBA, 8, false, {}, {}, 0, 6);
+        FILE* p_file = fopen(path, "wb");
+
+        TE_CHECK(p_file && fwrite(png.data(), 1, png.size(), p_file) == png.size())
+
+        if(p_file) fclose(p_file);
+
+        uint32_t w = 1, h = 1;
+        bool thrown = false;
+        std::vector<uint8_t> pixels;
+
+        try {
+            pixels = PNGLoadPNGFile(path, &w, &h);
+        }
+        catch(...) {
+            thrown = true;
+        }
+
+        PNGInfo info;
+
+        TE_CHECK_MSG(!thrown && pixels.empty() && w == 0 && h == 0, size[0] << "x" << size[1])
+        TE_CHECK(!PNGReadInfo(png.data(), png.size(), &info))
+    }
+
+    remove(path);
+}
+
+// Repo images decode
+static void TestRepoImages() {
+    const char* paths[] = { "1.png", "1n.png", "2.png", "2n.png", "tweLogo.png" };
+
+    for(const char* path : paths) {
+        uint32_t width = 0, height = 0;
+        const std::vector<uint8_t> pixels = PNGLoadPNGFile(path, &width, &height);
+
+        TE_CHECK_MSG(!pixels.empty() && pixels.size() == (size_t)width * height * 4, path)
+    }
+}
+
+int main() {
+    TestPaletteOutOfRange();
+    TestRoundTrip(3);
+    TestRoundTrip(4);
+    TestFormats();
+    TestAdler();
+    TestOversized();
+    TestRepoImages();
+
+    return TestResult("png_test");
+}
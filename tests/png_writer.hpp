@@ -0,0 +1,191 @@
+#pragma once
+#ifndef _TE_TEST_PNG_WRITER_
+#define _TE_TEST_PNG_WRITER_
+
+#include <zlib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+// PNG encoder for tests and benchmarks, needs "// TE_TEST_LIBS: -lz"
+namespace te {
+    static void TestPNGPut32(std::vector<uint8_t>& out, uint32_t value) {
+        for(int i = 3; i >= 0; i--) out.push_back((uint8_t)(value >> (i * 8)));
+    }
+
+    static void TestPNGChunk(std::vector<uint8_t>& png, const char* type, const uint8_t* data, size_t size) {
+        TestPNGPut32(png, (uint32_t)size);
+
+        const size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data, data + size);
+
+        TestPNGPut32(png, (uint32_t)crc32(0, png.data() + start, (uInt)(png.size() - start)));
+    }
+
+    // Filter rows of raw scanlines (filter type cycles per row, palette rows stay unfiltered like encoders write them)
+    static void TestPNGFilterRows(std::vector<uint8_t>& raw, const uint8_t* pixels, size_t rowBytes, uint32_t height, uint32_t bpp, uint8_t colorType) {
+        for(uint32_t y = 0; y < height; y++) {
+            const uint8_t filter = colorType == 3 ? 0 : (uint8_t)(y % 5);
+            const uint8_t* row = &pixels[y * rowBytes];
+            const uint8_t* prev = y ? &pixels[(y - 1) * rowBytes] : nullptr;
+
+            raw.push_back(filter);
+
+            for(size_t i = 0; i < rowBytes; i++) {
+                const int a = i >= bpp ? row[i - bpp] : 0;
+                const int b = prev ? prev[i] : 0;
+                const int c = prev && i >= bpp ? prev[i - bpp] : 0;
+                int predictor = 0;
+
+                switch(filter) {
+                case 1: predictor = a; break;
+                case 2: predictor = b; break;
+                case 3: predictor = (a + b) / 2; break;
+                case 4: {
+                    const int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    predictor = pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+                    break;
+                }
+                }
+
+                raw.push_back((uint8_t)(row[i] - predictor));
+            }
+        }
+    }
+
+    static std::vector<uint8_t> TestPNGAssemble(const std::vector<uint8_t>& raw, uint32_t width, uint32_t height, uint8_t colorType, uint32_t bitDepth, bool adam7, const std::vector<uint8_t>& palette, const std::vector<uint8_t>& trns, size_t flushEvery, int level) {
+        z_stream stream = {};
+        deflateInit(&stream, level);
+
+        std::vector<uint8_t> compressed(deflateBound(&stream, raw.size()) + (flushEvery ? raw.size() / flushEvery * 16 + 64 : 0));
+        stream.next_out = compressed.data();
+        stream.avail_out = (uInt)compressed.size();
+
+        const size_t step = flushEvery ? flushEvery : raw.size();
+
+        for(size_t offset = 0; offset < raw.size(); offset += step) {
+            stream.next_in = (Bytef*)raw.data() + offset;
+            stream.avail_in = (uInt)std::min(step, raw.size() - offset);
+
+            deflate(&stream, offset + step >= raw.size() ? Z_FINISH : Z_FULL_FLUSH);
+        }
+
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        std::vector<uint8_t> header;
+        TestPNGPut32(header, width);
+        TestPNGPut32(header, height);
+        header.insert(header.end(), { (uint8_t)bitDepth, colorType, 0, 0, (uint8_t)adam7 });
+
+        TestPNGChunk(png, "IHDR", header.data(), header.size());
+
+        if(!palette.empty()) TestPNGChunk(png, "PLTE", palette.data(), palette.size());
+        if(!trns.empty()) TestPNGChunk(png, "tRNS", trns.data(), trns.size());
+
+        // 1 MB IDAT chunks like common encoders
+        for(size_t offset = 0; offset < compressed.size(); offset += 1 << 20) {
+            TestPNGChunk(png, "IDAT", compressed.data() + offset, std::min<size_t>(1 << 20, compressed.size() - offset));
+        }
+
+        TestPNGChunk(png, "IEND", nullptr, 0);
+
+        return png;
+    }
+
+    /**
+     * @brief Encode 8 bit image, filter type cycles per row
+     *
+     * @param pixels rows of width * channels bytes (indices for palette)
+     * @param width
+     * @param height
+     * @param colorType PNGColorType
+     * @param channels samples per pixel of colorType
+     * @param palette RGB triplets, palette images only
+     * @param flushEvery raw bytes between Z_FULL_FLUSH points (what PNGDecodeParallel splits on), 0 for none
+     * @param level zlib level
+     * @return std::vector<uint8_t> file
+     */
+    std::vector<uint8_t> TestEncodePNG(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, uint8_t colorType, uint32_t channels, const std::vector<uint8_t>& palette = {}, size_t flushEvery = 0, int level = 6) {
+        std::vector<uint8_t> raw;
+        raw.reserve(((size_t)width * channels + 1) * height);
+
+        TestPNGFilterRows(raw, pixels.data(), (size_t)width * channels, height, channels, colorType);
+
+        return TestPNGAssemble(raw, width, height, colorType, 8, false, palette, {}, flushEvery, level);
+    }
+
+    /**
+     * @brief Encode 8 or 16 bit image, optionally Adam7 interlaced and with tRNS chunk
+     *
+     * @param samples rows of width * channels samples, 16 bit samples big endian like in file
+     * @param width
+     * @param height
+     * @param colorType PNGColorType
+     * @param channels samples per pixel of colorType
+     * @param bitDepth 8 or 16
+     * @param adam7 interlace
+     * @param trns tRNS chunk data as in file, empty for none
+     * @param level zlib level
+     * @return std::vector<uint8_t> file
+     */
+    std::vector<uint8_t> TestEncodePNGEx(const std::vector<uint8_t>& samples, uint32_t width, uint32_t height, uint8_t colorType, uint32_t channels, uint32_t bitDepth, bool adam7, const std::vector<uint8_t>& trns = {}, int level = 6) {
+        static const uint32_t passes[7][4] = { { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+        const uint32_t bpp = channels * bitDepth / 8;
+        std::vector<uint8_t> raw;
+
+        if(!adam7) {
+            TestPNGFilterRows(raw, samples.data(), (size_t)width * bpp, height, bpp, colorType);
+        }
+
+        for(uint32_t pass = 0; pass < 7 && adam7; pass++) {
+            if(width <= passes[pass][0] || height <= passes[pass][1]) continue;
+
+            const uint32_t w = (width - passes[pass][0] + passes[pass][2] - 1) / passes[pass][2];
+            const uint32_t h = (height - passes[pass][1] + passes[pass][3] - 1) / passes[pass][3];
+            std::vector<uint8_t> sub;
+
+            for(uint32_t y = 0; y < h; y++) {
+                for(uint32_t x = 0; x < w; x++) {
+                    const size_t source = ((size_t)(passes[pass][1] + y * passes[pass][3]) * width + passes[pass][0] + x * passes[pass][2]) * bpp;
+
+                    sub.insert(sub.end(), &samples[source], &samples[source] + bpp);
+                }
+            }
+
+            TestPNGFilterRows(raw, sub.data(), (size_t)w * bpp, h, bpp, colorType);
+        }
+
+        return TestPNGAssemble(raw, width, height, colorType, bitDepth, adam7, {}, trns, 0, level);
+    }
+
+    /**
+     * @brief Photo like content, gradients with noise and blocks, compresses roughly like real images
+     *
+     * @param width
+     * @param height
+     * @param channels
+     * @return std::vector<uint8_t>
+     */
+    std::vector<uint8_t> TestMakeImage(uint32_t width, uint32_t height, uint32_t channels, uint32_t seed = 1) {
+        std::mt19937 random(seed);
+        std::vector<uint8_t> pixels((size_t)width * height * channels);
+
+        for(uint32_t y = 0; y < height; y++) {
+            for(uint32_t x = 0; x < width; x++) {
+                for(uint32_t c = 0; c < channels; c++) {
+                    pixels[((size_t)y * width + x) * channels + c] = (uint8_t)((x * (c + 1) + y * (3 - c)) / 7 + random() % 9 + (((x / 64) + (y / 64)) & 1) * 40);
+                }
+            }
+        }
+
+        return pixels;
+    }
+}
+
+#endif
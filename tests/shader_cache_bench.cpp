@@ -0,0 +1,136 @@
+// TE_TEST_LIBS: -lEGL
+#include "gl_context.hpp"
+#include "../engine/src/shader_cache.hpp"
+#include <stdlib.h>
+
+using namespace te;
+
+// ShaderCache over 48 programs: cold run on fresh cache directory (compile, link, save binaries), warm run on same
+// directory (glProgramBinary only) and warm run with one damaged .twp, which has to compile that one program again and
+// rewrite its file. Mesa`s own disk cache (program binaries need it on) starts empty too so cold run really compiles
+
+static const uint32_t sProgramCount = 48;
+static const char* sDirectory = "tests/bin/shader_cache_bench_twp";
+static const char* sMesaDirectory = "tests/bin/shader_cache_bench_mesa";
+
+static std::vector<GLShaderSource> MakeStages(uint32_t variant) {
+    const std::string define = "#version 450 core\n#define VARIANT " + std::to_string(variant) + "\n";
+
+    return {
+        { GL_VERTEX_SHADER, define +
+            "layout(location = 0) in vec3 position;\n"
+            "layout(location = 1) in vec2 texcoord;\n"
+            "layout(location = 0) uniform mat4 transform;\n"
+            "out vec2 vTexcoord;\n"
+            "void main() { vTexcoord = texcoord * float(VARIANT + 1); gl_Position = transform * vec4(position, 1.0); }\n" },
+        { GL_FRAGMENT_SHADER, define +
+            "in vec2 vTexcoord;\n"
+            "layout(binding = 0) uniform sampler2D albedo;\n"
+            "layout(location = 1) uniform vec3 lights[8];\n"
+            "out vec4 color;\n"
+            "void main() {\n"
+            "    vec3 sum = vec3(0.0);\n"
+            "    for(int i = 0; i < 8; i++) sum += texture(albedo, vTexcoord + lights[i].xy).rgb * max(dot(normalize(lights[i]), vec3(0.0, 0.0, 1.0)), 0.0);\n"
+            "    for(int i = 0; i < VARIANT % 5; i++) sum = sqrt(sum + vec3(float(i)));\n"
+            "    color = vec4(sum, 1.0);\n"
+            "}\n" }
+    };
+}
+
+// Requests every program, waits for all of them
+static double RequestAll(ShaderCache* pCache, uint32_t* pReady) {
+    const double start = TestNowMs();
+    std::vector<CachedProgram*> programs;
+
+    for(uint32_t i = 0; i < sProgramCount; i++) programs.push_back(pCache->Request(MakeStages(i)));
+
+    *pReady = 0;
+
+    for(CachedProgram* p_program : programs) *pReady += pCache->Wait(p_program);
+
+    return TestNowMs() - start;
+}
+
+int main() {
+    std::filesystem::remove_all(sDirectory);
+    std::filesystem::remove_all(sMesaDirectory);
+    setenv("MESA_SHADER_CACHE_DIR", sMesaDirectory, 1);
+
+    if(!TestMakeGLContext()) return 1;
+
+    uint32_t ready = 0;
+    double cold_ms, warm_ms, damaged_ms;
+    uint32_t warm_hits = 0, damaged_hits = 0, damaged_compiles = 0;
+
+    {
+        ShaderCache cache;
+        TE_CHECK(cache.Init(sDirectory, (GLADloadfunc)eglGetProcAddress))
+
+        cold_ms = RequestAll(&cache, &ready);
+
+        TE_CHECK(ready == sProgramCount && cache.mCompiles == sProgramCount)
+    }
+
+    std::vector<std::filesystem::path> binaries;
+
+    for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(sDirectory)) binaries.push_back(entry.path());
+
+    TE_CHECK_MSG(binaries.size() == sProgramCount, binaries.size() << " files in cache")
+
+    {
+        ShaderCache cache;
+        TE_CHECK(cache.Init(sDirectory, (GLADloadfunc)eglGetProcAddress))
+
+        warm_ms = RequestAll(&cache, &ready);
+        warm_hits = cache.mBinaryHits;
+
+        TE_CHECK(ready == sProgramCount && cache.mBinaryHits == sProgramCount && cache.mCompiles == 0)
+    }
+
+    // Flip byte in middle of one binary, content hash catches it
+    std::sort(binaries.begin(), binaries.end());
+
+    const std::string damaged = binaries.empty() ? std::string() : binaries[0].string();
+    FILE* p_file = fopen(damaged.c_str(), "r+b");
+
+    TE_CHECK(p_file)
+
+    if(p_file) {
+        fseek(p_file, 0, SEEK_END);
+        const long size = ftell(p_file);
+        fseek(p_file, size / 2, SEEK_SET);
+
+        const int value = fgetc(p_file);
+        fseek(p_file, size / 2, SEEK_SET);
+        fputc(value ^ 0x5a, p_file);
+        fclose(p_file);
+    }
+
+    {
+        ShaderCache cache;
+        TE_CHECK(cache.Init(sDirectory, (GLADloadfunc)eglGetProcAddress))
+
+        damaged_ms = RequestAll(&cache, &ready);
+        damaged_hits = cache.mBinaryHits;
+        damaged_compiles = cache.mCompiles;
+
+        TE_CHECK(ready == sProgramCount && damaged_hits == sProgramCount - 1 && damaged_compiles == 1)
+    }
+
+    // Damaged file was rewritten by compile
+    {
+        ShaderCache cache;
+        TE_CHECK(cache.Init(sDirectory, (GLADloadfunc)eglGetProcAddress))
+
+        RequestAll(&cache, &ready);
+
+        TE_CHECK(ready == sProgramCount && cache.mBinaryHits == sProgramCount)
+    }
+
+    TE_INFO(sProgramCount << " programs: cold " << cold_ms << " ms (" << cold_ms / sProgramCount << " ms per program), warm " << warm_ms << " ms (" << warm_hits << " binaries, " << cold_ms / warm_ms << "x), one damaged binary " << damaged_ms << " ms (" << damaged_hits << " binaries, " << damaged_compiles << " compile)")
+
+    std::filesystem::remove_all(sDirectory);
+    std::filesystem::remove_all(sMesaDirectory);
+
+    return TestResult("shader_cache_bench");
+}
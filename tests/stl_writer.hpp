@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _TE_TEST_STL_WRITER_
+#define _TE_TEST_STL_WRITER_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Binary STL encoder for tests and benchmarks, bytes are written little endian by hand so files are same on any host
+namespace te {
+    static void TestSTLPut(std::vector<uint8_t>& out, uint32_t value, uint32_t bytes) {
+        for(uint32_t i = 0; i < bytes; i++) out.push_back((uint8_t)(value >> (i * 8)));
+    }
+
+    static void TestSTLPutFloat(std::vector<uint8_t>& out, float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        TestSTLPut(out, bits, 4);
+    }
+
+    /**
+     * @brief Encode triangles as binary STL
+     *
+     * @param vertices 9 floats per triangle
+     * @param normals 3 floats per triangle
+     * @return std::vector<uint8_t> file
+     */
+    std::vector<uint8_t> TestEncodeSTL(const std::vector<float>& vertices, const std::vector<float>& normals) {
+        const size_t triangles = vertices.size() / 9;
+        std::vector<uint8_t> stl(80, 0);
+        stl.reserve(84 + triangles * 50);
+
+        TestSTLPut(stl, (uint32_t)triangles, 4);
+
+        for(size_t t = 0; t < triangles; t++) {
+            for(size_t k = 0; k < 3; k++) TestSTLPutFloat(stl, normals[t * 3 + k]);
+            for(size_t k = 0; k < 9; k++) TestSTLPutFloat(stl, vertices[t * 9 + k]);
+
+            TestSTLPut(stl, 0, 2);
+        }
+
+        return stl;
+    }
+}
+
+#endif
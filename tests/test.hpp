@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _TE_TEST_
+#define _TE_TEST_
+
+#include "../engine/src/core.hpp"
+#include <chrono>
+
+// Tests are plain programs, failed check logs and makes main return 1 (see mk_tests)
+namespace te {
+    int gTestFailures = 0;
+
+    #define TE_CHECK(cond) if(!(cond)) { TE_ERR("Check failed: " << #cond) te::gTestFailures++; }
+    #define TE_CHECK_MSG(cond, msg) if(!(cond)) { TE_ERR("Check failed: " << #cond << " > " << msg) te::gTestFailures++; }
+
+    /**
+     * @brief Exit code of test, logs summary
+     *
+     * @param name
+     * @return int
+     */
+    int TestResult(const char* name) {
+        if(gTestFailures) {
+            TE_ERR(name << ": " << gTestFailures << " checks failed")
+
+            return 1;
+        }
+
+        TE_INFO(name << ": passed")
+
+        return 0;
+    }
+
+    double TestNowMs() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Best of runs in milliseconds, for benchmarks
+     *
+     * @param runs
+     * @param fn
+     * @return double
+     */
+    template<typename F>
+    double TestBestMs(uint32_t runs, F&& fn) {
+        double best = 1e30;
+
+        for(uint32_t i = 0; i < runs; i++) {
+            const double start = TestNowMs();
+
+            fn();
+
+            best = std::min(best, TestNowMs() - start);
+        }
+
+        return best;
+    }
+}
+
+#endif
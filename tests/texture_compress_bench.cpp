@@ -0,0 +1,60 @@
+// TE_TEST_LIBS: -lz
+#include "test.hpp"
+#include "png_writer.hpp"
+#include "../engine/src/texture_compress.hpp"
+
+using namespace te;
+
+// BCCompress throughput on 2K RGBA8 per format on one and all threads, then TWTLoadCached of 2K PNG cold (decode,
+// mips, BC7 encode, save) and warm (map and verify content hash)
+
+static const uint32_t sSize = 2048;
+
+static void BenchEncode(const std::vector<uint8_t>& pixels, uint32_t format, const char* name) {
+    std::vector<uint8_t> blocks(BCGetCompressedSize(format, sSize, sSize));
+    const double mpix = (double)sSize * sSize / 1e6;
+    BCStats stats;
+
+    const double single = TestBestMs(2, [&]() { BCCompress(blocks.data(), pixels.data(), sSize, sSize, format, 1); });
+    const double all = TestBestMs(2, [&]() { BCCompress(blocks.data(), pixels.data(), sSize, sSize, format, 0); });
+
+    TE_CHECK(BCCompress(blocks.data(), pixels.data(), sSize, sSize, format, 0, &stats))
+
+    TE_INFO(name << " " << sSize << "x" << sSize << ": 1 thread " << single << " ms (" << mpix / (single / 1000.0) << " MPix/s), " << std::thread::hardware_concurrency() << " threads " << all << " ms (" << mpix / (all / 1000.0) << " MPix/s), PSNR " << stats.mPSNR << " dB")
+}
+
+static void BenchCache(const std::vector<uint8_t>& pixels) {
+    const char* png_path = "tests/bin/texture_compress_bench.png";
+    const std::string cache_path = std::string(png_path) + ".twt";
+    const std::vector<uint8_t> png = TestEncodePNG(pixels, sSize, sSize, PNG_CT_RGBA, 4);
+    FILE* p_file = fopen(png_path, "wb");
+
+    TE_CHECK(p_file && fwrite(png.data(), 1, png.size(), p_file) == png.size())
+
+    if(p_file) fclose(p_file);
+
+    TWTView view;
+
+    remove(cache_path.c_str());
+
+    const double cold = TestBestMs(1, [&]() { TE_CHECK(TWTLoadCached(&view, png_path, BC_FORMAT_BC7, true, true, 0)) });
+    const double warm = TestBestMs(5, [&]() { TE_CHECK(TWTLoadCached(&view, png_path, BC_FORMAT_BC7, true, true, 0)) });
+    const double mb = view.mFile.size / (1024.0 * 1024.0);
+
+    TE_INFO("TWTLoadCached BC7 " << sSize << "x" << sSize << " with mips (" << mb << " MB cache): cold " << cold << " ms, warm " << warm << " ms (" << mb / (warm / 1000.0) << " MB/s with source hash and cache verify)")
+
+    TWTUnmap(&view);
+    remove(png_path);
+    remove(cache_path.c_str());
+}
+
+int main() {
+    const std::vector<uint8_t> pixels = TestMakeImage(sSize, sSize, 4);
+
+    BenchEncode(pixels, BC_FORMAT_BC1, "BC1");
+    BenchEncode(pixels, BC_FORMAT_BC3, "BC3");
+    BenchEncode(pixels, BC_FORMAT_BC7, "BC7");
+    BenchCache(pixels);
+
+    return TestResult("texture_compress_bench");
+}
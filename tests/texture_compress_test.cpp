@@ -0,0 +1,166 @@
+// TE_TEST_LIBS: -lEGL -lz
+#include "gl_context.hpp"
+#include "png_writer.hpp"
+#include "../engine/src/texture_compress.hpp"
+#include <filesystem>
+
+using namespace te;
+
+static const uint32_t sWidth = 256, sHeight = 192;
+
+static std::vector<uint8_t> MakeImage(bool opaque) {
+    std::vector<uint8_t> pixels = TestMakeImage(sWidth, sHeight, 4);
+
+    if(opaque) {
+        for(size_t i = 3; i < pixels.size(); i += 4) pixels[i] = 255;
+    }
+
+    return pixels;
+}
+
+static std::vector<uint8_t> ReadFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* p_file = fopen(path, "rb");
+
+    if(!p_file) return data;
+
+    fseek(p_file, 0, SEEK_END);
+    data.resize((size_t)ftell(p_file));
+    fseek(p_file, 0, SEEK_SET);
+
+    if(fread(data.data(), 1, data.size(), p_file) != data.size()) data.clear();
+
+    fclose(p_file);
+
+    return data;
+}
+
+static bool WriteFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* p_file = fopen(path, "wb");
+
+    if(!p_file) return false;
+
+    const bool ok = fwrite(data.data(), 1, data.size(), p_file) == data.size();
+    fclose(p_file);
+
+    return ok;
+}
+
+// Blocks decoded by GL (driver decoder, not ours) have to be close to source, and our decoder has to agree with GL
+static void TestGLDecode(uint32_t format, double minPSNR) {
+    const std::vector<uint8_t> pixels = MakeImage(format == BC_FORMAT_BC1);
+    std::vector<uint8_t> blocks(BCGetCompressedSize(format, sWidth, sHeight));
+
+    TE_CHECK(BCCompress(blocks.data(), pixels.data(), sWidth, sHeight, format))
+
+    uint32_t texture = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, BCGetGLFormat(format, false), sWidth, sHeight);
+    glCompressedTextureSubImage2D(texture, 0, 0, 0, sWidth, sHeight, BCGetGLFormat(format, false), (GLsizei)blocks.size(), blocks.data());
+
+    std::vector<uint8_t> gl_pixels(pixels.size()), our_pixels(pixels.size());
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)gl_pixels.size(), gl_pixels.data());
+    glDeleteTextures(1, &texture);
+
+    TE_CHECK(glGetError() == GL_NO_ERROR)
+    TE_CHECK(BCDecompress(our_pixels.data(), blocks.data(), sWidth, sHeight, format))
+
+    const uint32_t mask = BCGetChannelMask(format);
+    const double gl_psnr = BCComputePSNR(pixels.data(), gl_pixels.data(), sWidth, sHeight, mask);
+    const double agree_psnr = BCComputePSNR(our_pixels.data(), gl_pixels.data(), sWidth, sHeight, mask);
+
+    TE_INFO("Format " << format << ": GL decode PSNR " << gl_psnr << " dB, our decode against GL " << agree_psnr << " dB")
+
+    TE_CHECK_MSG(gl_psnr >= minPSNR, "format " << format << " PSNR " << gl_psnr << " dB under " << minPSNR)
+    // BC1 interpolation rounding differs between decoders by 1
+    TE_CHECK_MSG(agree_psnr >= 45.0, "format " << format << " decoders differ, " << agree_psnr << " dB")
+}
+
+// Cache is rebuilt when its level data got damaged, not mapped and uploaded as is
+static void TestCorruptedCache() {
+    const char* png_path = "tests/bin/texture_compress_test.png";
+    const std::string cache_path = std::string(png_path) + ".twt";
+
+    TE_CHECK(WriteFile(png_path, TestEncodePNG(MakeImage(false), sWidth, sHeight, PNG_CT_RGBA, 4)))
+    remove(cache_path.c_str());
+
+    TWTView view;
+
+    TE_CHECK(TWTLoadCached(&view, png_path, BC_FORMAT_BC7, false, true, 1))
+
+    const std::vector<uint8_t> good = ReadFile(cache_path.c_str());
+
+    TE_CHECK(good.size() > 64)
+
+    std::vector<uint8_t> damaged = good;
+    damaged[damaged.size() - 5] ^= 0x5a;
+
+    TE_CHECK(WriteFile(cache_path.c_str(), damaged))
+    TE_CHECK(TWTLoadCached(&view, png_path, BC_FORMAT_BC7, false, true, 1))
+    TE_CHECK(view.mLevels.size() > 1 && view.mFile.size == good.size() && memcmp(view.mFile.data, good.data(), good.size()) == 0)
+    TE_CHECK(ReadFile(cache_path.c_str()) == good)
+
+    // Mapping same view over and over keeps one mapping
+    auto open_files = []() {
+        size_t count = 0;
+
+        for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/proc/self/fd")) count += !entry.path().empty();
+
+        return count;
+    };
+
+    const size_t files = open_files();
+
+    for(uint32_t i = 0; i < 200; i++) TE_CHECK(TWTMap(&view, cache_path.c_str(), false))
+
+    TE_CHECK_MSG(open_files() == files, open_files() << " open files, " << files << " before")
+
+    TWTUnmap(&view);
+    remove(png_path);
+    remove(cache_path.c_str());
+}
+
+// Writers of same cache never share temporary file, every save lands whole
+static void TestConcurrentSave() {
+    const char* path = "tests/bin/texture_compress_test_save.twt";
+    std::vector<std::vector<uint8_t>> levels = { std::vector<uint8_t>(BCGetCompressedSize(BC_FORMAT_BC1, 512, 512)) };
+    const std::vector<uint32_t> sizes = { 512, 512 };
+    std::atomic<uint32_t> failed = 0;
+    std::vector<std::thread> threads;
+
+    for(uint32_t t = 0; t < 8; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<std::vector<uint8_t>> own = levels;
+
+            for(uint32_t i = 0; i < 20; i++) {
+                memset(own[0].data(), (int)(t * 20 + i), own[0].size());
+
+                if(!TWTSave(path, BC_FORMAT_BC1, 0, own, sizes, t)) failed++;
+            }
+        });
+    }
+
+    for(std::thread& thread : threads) thread.join();
+
+    TWTView view;
+
+    TE_CHECK_MSG(failed == 0, failed << " saves failed")
+    TE_CHECK(TWTMap(&view, path, true))
+
+    TWTUnmap(&view);
+    remove(path);
+}
+
+int main() {
+    if(!TestMakeGLContext()) return 1;
+
+    TestGLDecode(BC_FORMAT_BC1, 36.0);
+    TestGLDecode(BC_FORMAT_BC3, 36.0);
+    TestGLDecode(BC_FORMAT_BC7, 40.0);
+    TestCorruptedCache();
+    TestConcurrentSave();
+
+    return TestResult("texture_compress_test");
+}
@@ -0,0 +1,53 @@
+#include "test.hpp"
+#include "../engine/src/texture_mips.hpp"
+#include <random>
+
+using namespace te;
+
+// MipBuildChain on 4K and 8K RGBA8 against scalar MipBuildChainReference, reference only where it finishes in seconds.
+// Alpha weighted (default) against independent channels shows cost of premultiply and divide
+
+static std::vector<uint8_t> MakeImage(uint32_t size) {
+    std::mt19937 random(7);
+    std::vector<uint8_t> pixels((size_t)size * size * 4);
+
+    for(size_t i = 0; i < pixels.size(); i++) pixels[i] = (uint8_t)((i / 4 % size) * 255 / size + (random() & 15));
+
+    return pixels;
+}
+
+static void Bench(uint32_t size, uint32_t filter, bool reference) {
+    const std::vector<uint8_t> pixels = MakeImage(size);
+    const char* name = filter == MIP_FILTER_Box ? "box" : "Kaiser";
+    MipChain chain;
+
+    // Tables are built on first use, keep that out of timing
+    MipGetTables();
+
+    const double fast = TestBestMs(3, [&]() { MipBuildChain(&chain, pixels, size, size, true, filter); });
+    const double independent = TestBestMs(3, [&]() { MipBuildChain(&chain, pixels, size, size, true, filter, false); });
+    const double mpix = (double)size * size / 1e6;
+
+    TE_INFO(size << "x" << size << " sRGB " << name << " independent channels: " << independent << " ms (" << mpix / (independent / 1000.0) << " Mpix/s of source)")
+
+    if(!reference) {
+        TE_INFO(size << "x" << size << " sRGB " << name << " alpha weighted: " << fast << " ms (" << mpix / (fast / 1000.0) << " Mpix/s of source)")
+
+        return;
+    }
+
+    const double slow = TestBestMs(1, [&]() { MipBuildChainReference(&chain, pixels.data(), size, size, true, filter); });
+
+    TE_INFO(size << "x" << size << " sRGB " << name << " alpha weighted: " << fast << " ms (" << mpix / (fast / 1000.0) << " Mpix/s of source), reference " << slow << " ms, " << slow / fast << "x")
+}
+
+int main() {
+    Bench(1024, MIP_FILTER_Box, true);
+    Bench(1024, MIP_FILTER_Kaiser, true);
+    Bench(4096, MIP_FILTER_Box, true);
+    Bench(4096, MIP_FILTER_Kaiser, false);
+    Bench(8192, MIP_FILTER_Box, false);
+    Bench(8192, MIP_FILTER_Kaiser, false);
+
+    return TestResult("texture_mips_bench");
+}
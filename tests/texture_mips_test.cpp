@@ -0,0 +1,125 @@
+#include "test.hpp"
+#include "../engine/src/texture_mips.hpp"
+#include <random>
+
+using namespace te;
+
+// Fast path (SIMD, float, tables) against double precision MipBuildChainReference. Every level is built from previous
+// one of its own chain, so values off by one carry into next level, filtering averages them out again
+
+static std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+
+    for(uint32_t y = 0; y < height; y++) {
+        for(uint32_t x = 0; x < width; x++) {
+            uint8_t* p = &pixels[((size_t)y * width + x) * 4];
+
+            // Gradients, hard edges and noise, alpha varies too
+            p[0] = (uint8_t)(x * 255 / std::max(1u, width - 1));
+            p[1] = (uint8_t)(((x / 7 + y / 5) & 1) ? 250 : 5);
+            p[2] = (uint8_t)(random() & 0xff);
+            p[3] = (uint8_t)(y * 255 / std::max(1u, height - 1));
+        }
+    }
+
+    return pixels;
+}
+
+static void Compare(uint32_t width, uint32_t height, bool srgb, uint32_t filter, bool alphaWeighted) {
+    const std::vector<uint8_t> pixels = MakeImage(width, height, width * 31 + height);
+
+    MipChain fast, reference;
+
+    TE_CHECK(MipBuildChain(&fast, pixels, width, height, srgb, filter, alphaWeighted))
+    TE_CHECK(MipBuildChainReference(&reference, pixels.data(), width, height, srgb, filter, alphaWeighted))
+    TE_CHECK(fast.mLevels.size() == reference.mLevels.size())
+    TE_CHECK(fast.mData.size() == reference.mData.size())
+
+    TE_CHECK(memcmp(fast.GetLevel(0), pixels.data(), pixels.size()) == 0)
+
+    // Levels 1 and down
+    const size_t first = fast.mLevels.size() > 1 ? fast.mLevels[1].mOffset : fast.mData.size();
+    uint32_t worst = 0;
+    size_t off = 0;
+
+    for(size_t i = first; i < fast.mData.size(); i++) {
+        uint32_t diff = (uint32_t)abs((int)fast.mData[i] - (int)reference.mData[i]);
+
+        // Color of nearly transparent pixel comes from few weighted samples and swings with every rounding, what is
+        // seen is color times alpha
+        if(alphaWeighted && i % 4 != 3) {
+            const size_t a = i - i % 4 + 3;
+
+            diff = (uint32_t)(fabs(fast.mData[i] * fast.mData[a] - reference.mData[i] * reference.mData[a]) / 255.0 + 0.5);
+        }
+
+        worst = std::max(worst, diff);
+
+        if(diff > 0) off++;
+    }
+
+    // Float path may round exact .5 (gradients hit it a lot) other way than double one, never further. Premultiplied
+    // color can be off by one in both color and alpha
+    TE_CHECK_MSG(worst <= (alphaWeighted ? 2u : 1u), width << "x" << height << " srgb " << srgb << " filter " << filter << " weighted " << alphaWeighted << ": worst difference " << worst)
+
+    TE_INFO(width << "x" << height << (srgb ? " sRGB" : " linear") << (filter == MIP_FILTER_Box ? " box" : " Kaiser") << (alphaWeighted ? " alpha weighted" : "") << ": " << fast.mLevels.size() << " levels, worst difference " << worst << ", " << (double)off / std::max<size_t>(1, fast.mData.size() - first) * 100.0 << " % of mip values off")
+}
+
+// Color under alpha 0 must not show up in mips, opaque red next to transparent green stays red
+static void TestAlphaBleed() {
+    const uint32_t width = 64, height = 64;
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+
+    for(uint32_t i = 0; i < width * height; i++) {
+        const bool opaque = ((i % width) / 3 + (i / width) / 5) % 2 == 0;
+        uint8_t* p = &pixels[(size_t)i * 4];
+
+        p[0] = opaque ? 255 : 0;
+        p[1] = opaque ? 0 : 255;
+        p[2] = 0;
+        p[3] = opaque ? 255 : 0;
+    }
+
+    for(uint32_t filter = MIP_FILTER_Box; filter <= MIP_FILTER_Kaiser; filter++) {
+        MipChain weighted, independent;
+
+        TE_CHECK(MipBuildChain(&weighted, pixels, width, height, true, filter))
+        TE_CHECK(MipBuildChain(&independent, pixels, width, height, true, filter, false))
+
+        uint32_t worst_green = 0, bleeding = 0;
+
+        for(size_t i = weighted.mLevels[1].mOffset; i < weighted.mData.size(); i += 4) {
+            if(weighted.mData[i + 3] > 8) worst_green = std::max<uint32_t>(worst_green, weighted.mData[i + 1]);
+            if(independent.mData[i + 3] > 8 && independent.mData[i + 1] > 64) bleeding++;
+        }
+
+        // Kaiser rings a little past edges, never anywhere near half green
+        TE_CHECK_MSG(worst_green <= (filter == MIP_FILTER_Box ? 0u : 16u), "filter " << filter << ": green " << worst_green << " in visible mip pixel")
+        TE_CHECK_MSG(bleeding > 0, "filter " << filter << ": independent channels expected to bleed")
+    }
+}
+
+int main() {
+    // Power of two, odd and non square sizes, 1 pixel wide strip
+    const uint32_t sizes[][2] = { { 256, 256 }, { 257, 129 }, { 100, 37 }, { 1, 64 } };
+
+    for(const auto& size : sizes) {
+        for(uint32_t filter = MIP_FILTER_Box; filter <= MIP_FILTER_Kaiser; filter++) {
+            Compare(size[0], size[1], true, filter, true);
+            Compare(size[0], size[1], false, filter, true);
+            Compare(size[0], size[1], true, filter, false);
+            Compare(size[0], size[1], false, filter, false);
+        }
+    }
+
+    TestAlphaBleed();
+
+    // Kaiser is symmetric windowed sinc, 1 at center and 0 at integers and at window edge
+    TE_CHECK(fabs(MipKaiser(0.0) - 1.0) < 1e-12)
+    TE_CHECK(fabs(MipKaiser(1.0)) < 1e-12 && fabs(MipKaiser(2.0)) < 1e-12)
+    TE_CHECK(MipKaiser(3.0) == 0.0)
+    TE_CHECK(fabs(MipKaiser(0.37) - MipKaiser(-0.37)) < 1e-15)
+
+    return TestResult("texture_mips_test");
+}
@@ -0,0 +1,201 @@
+// TE_TEST_LIBS: -lz
+#include "test.hpp"
+#include "png_writer.hpp"
+#include "tiff_writer.hpp"
+#include <filesystem>
+
+using namespace te;
+
+static const char* sPath = "tests/bin/tiff_test.tif";
+
+static bool WriteFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* p_file = fopen(path, "wb");
+
+    if(!p_file) return false;
+
+    const bool ok = fwrite(data.data(), 1, data.size(), p_file) == data.size();
+    fclose(p_file);
+
+    return ok;
+}
+
+// Every layout, compression and byte order loads back to source samples on one and several threads
+static void TestLayouts() {
+    typedef struct Case {
+        const char* mName;
+        uint16_t mSamples, mBits;
+        TestTIFFOptions mOptions;
+    } Case;
+
+    TestTIFFOptions lzw_strips;
+    lzw_strips.mCompression = TIFF_COMPRESSION_LZW;
+    lzw_strips.mPredictor = TIFF_PREDICTOR_HORIZONTAL;
+    lzw_strips.mRowsPerStrip = 7;
+
+    TestTIFFOptions big_tiles;
+    big_tiles.mLittleEndian = false;
+    big_tiles.mTileWidth = big_tiles.mTileHeight = 16;
+    big_tiles.mCompression = TIFF_COMPRESSION_PACKBITS;
+    big_tiles.mPredictor = TIFF_PREDICTOR_HORIZONTAL;
+
+    TestTIFFOptions planar;
+    planar.mPlanarConfig = TIFF_PLANAR_SEPARATE;
+    planar.mRowsPerStrip = 5;
+    planar.mCompression = TIFF_COMPRESSION_LZW;
+
+    TestTIFFOptions big_float;
+    big_float.mLittleEndian = false;
+    big_float.mSampleFormat = TIFF_SAMPLE_FLOAT;
+    big_float.mTileWidth = 32;
+    big_float.mTileHeight = 16;
+
+    const Case cases[] = {
+        { "RGBA8 LZW strips", 4, 8, lzw_strips },
+        { "RGB8 uncompressed", 3, 8, {} },
+        { "gray16 big endian PackBits tiles", 1, 16, big_tiles },
+        { "RGBA16 LZW strips", 4, 16, lzw_strips },
+        { "RGB8 planar LZW", 3, 8, planar },
+        { "gray float big endian tiles", 1, 32, big_float },
+        { "gray alpha 8 PackBits tiles", 2, 8, big_tiles }
+    };
+    const uint32_t width = 50, height = 37;
+
+    for(const Case& c : cases) {
+        std::vector<uint8_t> pixels = TestMakeImage(width, height, c.mSamples * c.mBits / 8, c.mBits + c.mSamples);
+
+        // Long runs for PackBits and LZW to find
+        for(size_t i = 0; i < pixels.size() / 3; i++) pixels[i] = (uint8_t)(i / 97);
+
+        TE_CHECK(WriteFile(sPath, TestEncodeTIFF(pixels, width, height, c.mSamples, c.mBits, c.mOptions)))
+
+        for(uint32_t threads : { 1u, 3u }) {
+            TIFF tiff;
+
+            TE_CHECK_MSG(tiff.Load(sPath, threads), c.mName)
+            TE_CHECK_MSG(tiff.mWidth == width && tiff.mHeight == height && tiff.mPixels == pixels, c.mName << " on " << threads << " threads")
+        }
+    }
+
+    remove(sPath);
+}
+
+// ReadTile gives same pixels as whole image load, rows past image edge are zero
+static void TestReadTile() {
+    const uint32_t width = 45, height = 29;
+    const std::vector<uint8_t> pixels = TestMakeImage(width, height, 4);
+
+    TestTIFFOptions options;
+    options.mTileWidth = options.mTileHeight = 16;
+    options.mCompression = TIFF_COMPRESSION_LZW;
+
+    TE_CHECK(WriteFile(sPath, TestEncodeTIFF(pixels, width, height, 4, 8, options)))
+
+    TIFF tiff;
+
+    TE_CHECK(tiff.Open(sPath))
+    TE_CHECK(tiff.GetTileCount() == 6)
+
+    uint32_t mismatches = 0;
+    std::vector<uint8_t> tile;
+
+    for(uint32_t t = 0; t < tiff.GetTileCount(); t++) {
+        TE_CHECK(tiff.ReadTile(t, &tile))
+
+        for(uint32_t y = 0; y < 16; y++) {
+            for(uint32_t x = 0; x < 16; x++) {
+                const uint32_t ix = (t % 3) * 16 + x, iy = (t / 3) * 16 + y;
+                const bool inside = ix < width && iy < height;
+
+                for(uint32_t k = 0; k < 4; k++) {
+                    mismatches += tile[(y * 16 + x) * 4 + k] != (inside ? pixels[((size_t)iy * width + ix) * 4 + k] : 0);
+                }
+            }
+        }
+    }
+
+    TE_CHECK_MSG(mismatches == 0, mismatches << " tile samples differ")
+
+    std::vector<uint8_t> rgba;
+
+    TE_CHECK(tiff.Load(sPath, 1) && tiff.ConvertToRGBA8(&rgba) && rgba == pixels)
+
+    remove(sPath);
+}
+
+// Reopening same TIFF keeps one mapping and failed open leaves nothing mapped
+static void TestReopen() {
+    auto open_files = []() {
+        size_t count = 0;
+
+        for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/proc/self/fd")) count += !entry.path().empty();
+
+        return count;
+    };
+
+    TE_CHECK(WriteFile(sPath, TestEncodeTIFF(TestMakeImage(8, 8, 1), 8, 8, 1, 8)))
+
+    TIFF tiff;
+    const size_t files = open_files();
+
+    for(uint32_t i = 0; i < 200; i++) TE_CHECK(tiff.Open(sPath))
+
+    TE_CHECK_MSG(open_files() == files + 1, open_files() << " open files, " << files << " before")
+
+    std::vector<uint8_t> tile;
+
+    TE_CHECK(!tiff.Open("tests/bin/tiff_test_missing.tif"))
+    TE_CHECK(open_files() == files && tiff.mFile.data == nullptr)
+    TE_CHECK(!tiff.ReadTile(0, &tile))
+
+    remove(sPath);
+}
+
+// Stream long enough for 12 bit codes and several table resets, output can end mid string
+static void TestLZWTableReset() {
+    std::vector<uint8_t> data = TestMakeImage(512, 512, 1, 7);
+
+    for(size_t i = 0; i < data.size() / 2; i++) data[i] = (uint8_t)(i * i >> 11);
+
+    const std::vector<uint8_t> lzw = TestTIFFEncodeLZW(data);
+    std::vector<uint8_t> out(data.size());
+    bool error = true;
+
+    TE_CHECK(TIFFDecodeLZW(lzw.data(), lzw.size(), out.data(), out.size(), &error) == data.size() && !error && out == data)
+
+    std::vector<uint8_t> part(data.size() / 3 + 5);
+
+    TE_CHECK(TIFFDecodeLZW(lzw.data(), lzw.size(), part.data(), part.size(), &error) == part.size() && !error)
+    TE_CHECK(memcmp(part.data(), data.data(), part.size()) == 0)
+}
+
+// Damaged LZW stream fails load instead of returning garbage
+static void TestCorrupted() {
+    const uint32_t width = 64, height = 64;
+    TestTIFFOptions options;
+    options.mCompression = TIFF_COMPRESSION_LZW;
+
+    std::vector<uint8_t> tiff_file = TestEncodeTIFF(TestMakeImage(width, height, 3), width, height, 3, 8, options);
+
+    // Code far past table end right after clear code
+    tiff_file[8] = 0x80;
+    tiff_file[9] = 0x7f;
+    tiff_file[10] = 0xf0;
+
+    TE_CHECK(WriteFile(sPath, tiff_file))
+
+    TIFF tiff;
+
+    TE_CHECK(!tiff.Load(sPath, 2) && tiff.mPixels.empty())
+
+    remove(sPath);
+}
+
+int main() {
+    TestLayouts();
+    TestReadTile();
+    TestReopen();
+    TestLZWTableReset();
+    TestCorrupted();
+
+    return TestResult("tiff_test");
+}
@@ -0,0 +1,270 @@
+#pragma once
+#ifndef _TE_TEST_TIFF_WRITER_
+#define _TE_TEST_TIFF_WRITER_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include "../engine/src/tiff_loader.hpp"
+
+// TIFF encoder for tests and benchmarks: strips or tiles, chunky or planar, none/LZW/PackBits, horizontal predictor
+namespace te {
+    typedef struct TestTIFFOptions {
+        bool mLittleEndian = true;
+        // Tiles when mTileWidth is set, else strips of mRowsPerStrip rows (0 for one strip)
+        uint32_t mTileWidth = 0, mTileHeight = 0;
+        uint32_t mRowsPerStrip = 0;
+        uint16_t mCompression = TIFF_COMPRESSION_NONE;
+        uint16_t mPredictor = TIFF_PREDICTOR_NONE;
+        uint16_t mPlanarConfig = TIFF_PLANAR_CHUNKY;
+        uint16_t mSampleFormat = TIFF_SAMPLE_UINT;
+    } TestTIFFOptions;
+
+    static void TestTIFFPut(std::vector<uint8_t>& out, uint64_t value, uint32_t bytes, bool littleEndian) {
+        for(uint32_t i = 0; i < bytes; i++) out.push_back((uint8_t)(value >> ((littleEndian ? i : bytes - 1 - i) * 8)));
+    }
+
+    /**
+     * @brief LZW encode (MSB first, early change) the way libtiff does, table is cleared when full
+     *
+     * @param data
+     * @return std::vector<uint8_t> compressed data
+     */
+    std::vector<uint8_t> TestTIFFEncodeLZW(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out;
+        uint64_t bits = 0;
+        uint32_t count = 0;
+
+        // Decoder adds its entry one code later, so its table is one entry behind and its width follows that size
+        uint32_t next = 258;
+        auto emit = [&](uint32_t code) {
+            const uint32_t decoder_next = std::max(258u, next - 1);
+            const uint32_t width = decoder_next < 511 ? 9 : decoder_next < 1023 ? 10 : decoder_next < 2047 ? 11 : 12;
+
+            bits = bits << width | code;
+            count += width;
+
+            while(count >= 8) {
+                out.push_back((uint8_t)(bits >> (count - 8)));
+                count -= 8;
+            }
+        };
+
+        std::unordered_map<uint32_t, uint32_t> table;
+
+        emit(256);
+
+        if(data.empty()) {
+            emit(257);
+        }
+        else {
+            uint32_t prefix = data[0];
+
+            for(size_t i = 1; i < data.size(); i++) {
+                const uint32_t key = prefix << 8 | data[i];
+                const auto it = table.find(key);
+
+                if(it != table.end()) {
+                    prefix = it->second;
+
+                    continue;
+                }
+
+                emit(prefix);
+                table[key] = next++;
+                prefix = data[i];
+
+                if(next == 4094) {
+                    emit(256);
+                    table.clear();
+                    next = 258;
+                }
+            }
+
+            emit(prefix);
+            emit(257);
+        }
+
+        if(count > 0) out.push_back((uint8_t)(bits << (8 - count)));
+
+        return out;
+    }
+
+    /**
+     * @brief PackBits encode, runs of 3 or more equal bytes are repeated, the rest is literal
+     *
+     * @param data
+     * @return std::vector<uint8_t> compressed data
+     */
+    std::vector<uint8_t> TestTIFFEncodePackBits(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out;
+        size_t i = 0;
+
+        while(i < data.size()) {
+            size_t run = 1;
+
+            while(i + run < data.size() && run < 128 && data[i + run] == data[i]) run++;
+
+            if(run >= 3) {
+                out.push_back((uint8_t)(1 - (int)run));
+                out.push_back(data[i]);
+                i += run;
+
+                continue;
+            }
+
+            // Literal until next run of 3
+            size_t literal = 0;
+
+            while(i + literal < data.size() && literal < 128) {
+                if(i + literal + 2 < data.size() && data[i + literal] == data[i + literal + 1] && data[i + literal] == data[i + literal + 2]) break;
+
+                literal++;
+            }
+
+            out.push_back((uint8_t)(literal - 1));
+            out.insert(out.end(), data.begin() + i, data.begin() + i + literal);
+            i += literal;
+        }
+
+        return out;
+    }
+
+    /**
+     * @brief Encode image as baseline TIFF with one IFD after pixel data
+     *
+     * @param pixels chunky samples of bitsPerSample in native byte order, top row first
+     * @param width
+     * @param height
+     * @param samplesPerPixel 1 gray, 2 gray + alpha, 3 RGB, 4 RGBA
+     * @param bitsPerSample 8, 16, 32 or 64
+     * @param options layout, compression and byte order
+     * @return std::vector<uint8_t> file
+     */
+    std::vector<uint8_t> TestEncodeTIFF(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, uint16_t samplesPerPixel, uint16_t bitsPerSample, const TestTIFFOptions& options = {}) {
+        const bool le = options.mLittleEndian;
+        const bool tiled = options.mTileWidth != 0;
+        const bool planar = options.mPlanarConfig == TIFF_PLANAR_SEPARATE;
+        const uint32_t sample_size = bitsPerSample / 8;
+        const uint32_t tile_width = tiled ? options.mTileWidth : width;
+        const uint32_t tile_height = tiled ? options.mTileHeight : (options.mRowsPerStrip ? std::min(options.mRowsPerStrip, height) : height);
+        const uint32_t across = (width + tile_width - 1) / tile_width, down = (height + tile_height - 1) / tile_height;
+        const uint32_t plane_samples = planar ? 1 : samplesPerPixel;
+        const uint64_t mask = bitsPerSample == 64 ? ~0ull : (1ull << bitsPerSample) - 1;
+
+        std::vector<uint8_t> tiff = { le ? (uint8_t)'I' : (uint8_t)'M', le ? (uint8_t)'I' : (uint8_t)'M' };
+        TestTIFFPut(tiff, 42, 2, le);
+        TestTIFFPut(tiff, 0, 4, le);
+
+        std::vector<uint32_t> offsets, byte_counts;
+
+        for(uint32_t plane = 0; plane < (planar ? samplesPerPixel : 1u); plane++) {
+            for(uint32_t t = 0; t < across * down; t++) {
+                const uint32_t x0 = (t % across) * tile_width, y0 = (t / across) * tile_height;
+                // Tiles are stored whole, last strip only has rows in image
+                const uint32_t rows = tiled ? tile_height : std::min(tile_height, height - y0);
+
+                std::vector<uint8_t> raw;
+                std::vector<uint64_t> row((size_t)tile_width * plane_samples);
+
+                for(uint32_t y = 0; y < rows; y++) {
+                    for(uint32_t x = 0; x < tile_width; x++) {
+                        for(uint32_t s = 0; s < plane_samples; s++) {
+                            uint64_t v = 0;
+
+                            if(x0 + x < width && y0 + y < height) {
+                                memcpy(&v, &pixels[(((size_t)(y0 + y) * width + x0 + x) * samplesPerPixel + (planar ? plane : s)) * sample_size], sample_size);
+                            }
+
+                            row[(size_t)x * plane_samples + s] = v;
+                        }
+                    }
+
+                    if(options.mPredictor == TIFF_PREDICTOR_HORIZONTAL) {
+                        for(size_t i = row.size() - 1; i >= plane_samples; i--) row[i] = (row[i] - row[i - plane_samples]) & mask;
+                    }
+
+                    for(uint64_t v : row) TestTIFFPut(raw, v, sample_size, le);
+                }
+
+                if(options.mCompression == TIFF_COMPRESSION_LZW) raw = TestTIFFEncodeLZW(raw);
+                else if(options.mCompression == TIFF_COMPRESSION_PACKBITS) raw = TestTIFFEncodePackBits(raw);
+
+                offsets.push_back((uint32_t)tiff.size());
+                byte_counts.push_back((uint32_t)raw.size());
+                tiff.insert(tiff.end(), raw.begin(), raw.end());
+            }
+        }
+
+        if(tiff.size() & 1) tiff.push_back(0);
+
+        typedef struct Tag {
+            uint16_t mId, mType;
+            std::vector<uint32_t> mValues;
+        } Tag;
+
+        const uint16_t SHORT = 3, LONG = 4;
+        std::vector<Tag> tags = {
+            { 256, LONG, { width } },
+            { 257, LONG, { height } },
+            { 258, SHORT, std::vector<uint32_t>(samplesPerPixel, bitsPerSample) },
+            { 259, SHORT, { options.mCompression } },
+            { 262, SHORT, { samplesPerPixel >= 3 ? 2u : 1u } },
+            { 277, SHORT, { samplesPerPixel } },
+            { 284, SHORT, { options.mPlanarConfig } },
+            { 317, SHORT, { options.mPredictor } },
+            { 339, SHORT, std::vector<uint32_t>(samplesPerPixel, options.mSampleFormat) }
+        };
+
+        if(tiled) {
+            tags.push_back({ 322, LONG, { tile_width } });
+            tags.push_back({ 323, LONG, { tile_height } });
+            tags.push_back({ 324, LONG, offsets });
+            tags.push_back({ 325, LONG, byte_counts });
+        }
+        else {
+            tags.push_back({ 273, LONG, offsets });
+            tags.push_back({ 278, LONG, { tile_height } });
+            tags.push_back({ 279, LONG, byte_counts });
+        }
+
+        std::sort(tags.begin(), tags.end(), [](const Tag& a, const Tag& b) { return a.mId < b.mId; });
+
+        const uint32_t ifd_offset = (uint32_t)tiff.size();
+        uint32_t extra_offset = ifd_offset + 2 + (uint32_t)tags.size() * 12 + 4;
+        std::vector<uint8_t> extra;
+
+        std::vector<uint8_t> header_offset;
+        TestTIFFPut(header_offset, ifd_offset, 4, le);
+        memcpy(&tiff[4], header_offset.data(), 4);
+
+        TestTIFFPut(tiff, tags.size(), 2, le);
+
+        for(const Tag& tag : tags) {
+            const uint32_t size = tag.mType == SHORT ? 2 : 4;
+
+            TestTIFFPut(tiff, tag.mId, 2, le);
+            TestTIFFPut(tiff, tag.mType, 2, le);
+            TestTIFFPut(tiff, tag.mValues.size(), 4, le);
+
+            // Values that fit in 4 bytes are stored in entry, left aligned
+            std::vector<uint8_t>& target = tag.mValues.size() * size <= 4 ? tiff : extra;
+
+            if(&target == &extra) TestTIFFPut(tiff, extra_offset + extra.size(), 4, le);
+
+            const size_t start = target.size();
+
+            for(uint32_t v : tag.mValues) TestTIFFPut(target, v, size, le);
+
+            if(&target == &tiff) tiff.resize(start + 4, 0);
+        }
+
+        TestTIFFPut(tiff, 0, 4, le);
+        tiff.insert(tiff.end(), extra.begin(), extra.end());
+
+        return tiff;
+    }
+}
+
+#endif
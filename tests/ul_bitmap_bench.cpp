@@ -0,0 +1,58 @@
+#include "test.hpp"
+#include "bmp_writer.hpp"
+#include "ul_bitmap_old.hpp"
+#include "../engine/src/ul_bitmap.hpp"
+#include <random>
+
+using namespace te;
+
+// ulLoadBitmapFromFile against loader it replaced (ifstream byte by byte, file row order) on 8K images. Old one gives
+// rows bottom first, rows of new one are flipped back before comparing
+
+static const uint32_t sWidth = 7680, sHeight = 4320;
+
+static void Bench(uint32_t bits) {
+    std::mt19937 random(bits);
+    std::vector<uint8_t> pixels((size_t)sWidth * sHeight * 4);
+
+    for(size_t i = 0; i < pixels.size(); i++) pixels[i] = (uint8_t)((i / 4 % sWidth) / 31 + (i % 4) * 60 + random() % 7);
+
+    const char* path = "tests/bin/ul_bitmap_bench.bmp";
+    const std::vector<uint8_t> bmp = TestEncodeBMP(pixels, sWidth, sHeight, bits, false);
+    FILE* p_file = fopen(path, "wb");
+
+    TE_CHECK(p_file && fwrite(bmp.data(), 1, bmp.size(), p_file) == bmp.size())
+
+    if(p_file) fclose(p_file);
+
+    std::vector<uint8_t> old_pixels, new_pixels;
+    uint32_t width = 0, height = 0;
+
+    const double old_ms = TestBestMs(2, [&]() { old_pixels = ulLoadBitmapFromFileOld(path, &width, &height); });
+    const double new_ms = TestBestMs(5, [&]() { new_pixels = ulLoadBitmapFromFile(path, &width, &height); });
+
+    TE_CHECK(width == sWidth && height == sHeight && new_pixels.size() == pixels.size())
+
+    // Old loader handles 24 bit BI_RGB only
+    if(bits == 24) {
+        const size_t row = (size_t)sWidth * 4;
+        bool same = old_pixels.size() == new_pixels.size();
+
+        for(uint32_t y = 0; y < sHeight && same; y++) same = memcmp(&old_pixels[y * row], &new_pixels[(sHeight - 1 - y) * row], row) == 0;
+
+        TE_CHECK_MSG(same, "old and new pixels differ")
+    }
+
+    const double mb = bmp.size() / (1024.0 * 1024.0);
+
+    TE_INFO(sWidth << "x" << sHeight << " " << bits << " bit (" << mb << " MB file): old " << old_ms << " ms, new " << new_ms << " ms (" << mb / (new_ms / 1000.0) << " MB/s), " << old_ms / new_ms << "x")
+
+    remove(path);
+}
+
+int main() {
+    Bench(24);
+    Bench(32);
+
+    return TestResult("ul_bitmap_bench");
+}
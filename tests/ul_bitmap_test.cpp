@@ -0,0 +1,77 @@
+// TE_TEST_LIBS: -lz
+#include "test.hpp"
+#include "bmp_writer.hpp"
+#include "png_writer.hpp"
+#include "../engine/src/texture_compress.hpp"
+
+using namespace te;
+
+static bool WriteFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* p_file = fopen(path, "wb");
+
+    if(!p_file) return false;
+
+    const bool ok = fwrite(data.data(), 1, data.size(), p_file) == data.size();
+    fclose(p_file);
+
+    return ok;
+}
+
+// Bottom-up and top-down files, 24 bit with row padding and 32 bit, all come back top row first
+static void TestRowOrder() {
+    const uint32_t width = 37, height = 23;
+    const std::vector<uint8_t> pixels = TestMakeImage(width, height, 4);
+
+    for(uint32_t bits : { 24u, 32u }) {
+        for(bool top_down : { false, true }) {
+            const std::vector<uint8_t> bmp = TestEncodeBMP(pixels, width, height, bits, top_down);
+            std::vector<uint8_t> out;
+            uint32_t w = 0, h = 0;
+
+            TE_CHECK(ulDecodeBitmap(bmp.data(), bmp.size(), &out, &w, &h))
+            TE_CHECK(w == width && h == height && out.size() == pixels.size())
+
+            uint32_t mismatches = 0;
+
+            for(size_t i = 0; i < out.size() && out.size() == pixels.size(); i++) {
+                const uint8_t expected = bits == 24 && i % 4 == 3 ? 255 : pixels[i];
+
+                if(out[i] != expected) mismatches++;
+            }
+
+            TE_CHECK_MSG(mismatches == 0, bits << " bit " << (top_down ? "top-down" : "bottom-up") << ": " << mismatches << " bytes differ")
+        }
+    }
+}
+
+// TWTLoadSourceImage gives same pixels for same image saved as BMP and PNG
+static void TestSourceImageMatchesPNG() {
+    const uint32_t width = 64, height = 48;
+    std::vector<uint8_t> pixels = TestMakeImage(width, height, 4);
+
+    for(size_t i = 3; i < pixels.size(); i += 4) pixels[i] = 255;
+
+    const char* bmp_path = "tests/bin/ul_bitmap_test.bmp";
+    const char* png_path = "tests/bin/ul_bitmap_test.png";
+
+    TE_CHECK(WriteFile(bmp_path, TestEncodeBMP(pixels, width, height, 24, false)))
+    TE_CHECK(WriteFile(png_path, TestEncodePNG(pixels, width, height, PNG_CT_RGBA, 4)))
+
+    std::vector<uint8_t> from_bmp, from_png;
+    uint32_t bmp_width = 0, bmp_height = 0, png_width = 0, png_height = 0;
+
+    TE_CHECK(TWTLoadSourceImage(bmp_path, &from_bmp, &bmp_width, &bmp_height))
+    TE_CHECK(TWTLoadSourceImage(png_path, &from_png, &png_width, &png_height))
+    TE_CHECK(bmp_width == png_width && bmp_height == png_height)
+    TE_CHECK(from_bmp == pixels && from_png == pixels)
+
+    remove(bmp_path);
+    remove(png_path);
+}
+
+int main() {
+    TestRowOrder();
+    TestSourceImageMatchesPNG();
+
+    return TestResult("ul_bitmap_test");
+}
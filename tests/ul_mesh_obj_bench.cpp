@@ -0,0 +1,37 @@
+#include "test.hpp"
+#include "obj_writer.hpp"
+#include "../engine/src/ul_mesh.hpp"
+
+using namespace te;
+
+// Single threaded OBJ load (ulMeshLoad without ULMflag_parallel) in MB/s of text, on grid files of about 10 and 100 MB
+
+static void Bench(uint32_t size) {
+    const char* path = "tests/bin/ul_mesh_obj_bench.obj";
+    const size_t bytes = TestWriteOBJGrid(path, size);
+
+    TE_CHECK(bytes > 0)
+
+    ul_mesh_t mesh;
+
+    // Loaders append to mesh, every run starts from empty one
+    const double ms = TestBestMs(3, [&]() {
+        mesh = ul_mesh_t();
+
+        TE_CHECK(ulMeshLoad(&mesh, path, ULMtype_obj))
+    });
+    const double mb = bytes / (1024.0 * 1024.0);
+
+    TE_CHECK(mesh.vertices.size() == (size_t)size * size * 2 * 9)
+
+    TE_INFO(mb << " MB, " << (size_t)size * size * 2 << " triangles: " << ms << " ms, " << mb / (ms / 1000.0) << " MB/s")
+
+    remove(path);
+}
+
+int main() {
+    Bench(250);
+    Bench(800);
+
+    return TestResult("ul_mesh_obj_bench");
+}
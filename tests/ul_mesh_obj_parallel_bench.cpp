@@ -0,0 +1,46 @@
+#include "test.hpp"
+#include "obj_writer.hpp"
+#include "../engine/src/ul_mesh.hpp"
+#include <thread>
+
+using namespace te;
+
+// ulMeshLoadOBJParallel on about 127 MB OBJ over 1, 2, 4 ... threads up to twice hardware threads (at least 8, shows
+// cost of oversubscribing on small machines), MB/s and speedup against one thread. Output of every thread count has to
+// match one thread
+
+int main() {
+    const char* path = "tests/bin/ul_mesh_obj_parallel_bench.obj";
+    const size_t bytes = TestWriteOBJGrid(path, 800);
+    const double mb = bytes / (1024.0 * 1024.0);
+
+    TE_CHECK(bytes > 0)
+
+    const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    ul_mesh_t reference;
+
+    TE_CHECK(ulMeshLoadOBJParallel(&reference, path, 1))
+
+    double single_ms = 0.0;
+
+    for(uint32_t threads = 1; threads <= std::max(8u, hardware * 2); threads *= 2) {
+        ul_mesh_t mesh;
+
+        // Loaders append to mesh, every run starts from empty one
+        const double ms = TestBestMs(3, [&]() {
+            mesh = ul_mesh_t();
+
+            TE_CHECK(ulMeshLoadOBJParallel(&mesh, path, threads))
+        });
+
+        if(threads == 1) single_ms = ms;
+
+        TE_CHECK_MSG(mesh.vertices == reference.vertices && mesh.normals == reference.normals && mesh.textureCoordinates == reference.textureCoordinates, threads << " threads differ from 1")
+
+        TE_INFO(mb << " MB on " << threads << " of " << hardware << " hardware threads: " << ms << " ms, " << mb / (ms / 1000.0) << " MB/s, " << single_ms / ms << "x")
+    }
+
+    remove(path);
+
+    return TestResult("ul_mesh_obj_parallel_bench");
+}
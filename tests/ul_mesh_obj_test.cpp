@@ -0,0 +1,65 @@
+#include "test.hpp"
+#include "obj_writer.hpp"
+#include "../engine/src/ul_mesh.hpp"
+
+using namespace te;
+
+// Polygon with more corners than any fixed buffer, every corner ends up in fan
+static void TestLargePolygon() {
+    const char* path = "tests/bin/ul_mesh_obj_test.obj";
+    const uint32_t corners = 300;
+    FILE* p_file = fopen(path, "wb");
+
+    TE_CHECK(p_file)
+
+    if(!p_file) return;
+
+    for(uint32_t i = 0; i < corners; i++) fprintf(p_file, "v %f %f 0\n", cos(2.0 * M_PI * i / corners), sin(2.0 * M_PI * i / corners));
+
+    fprintf(p_file, "f");
+
+    for(uint32_t i = 0; i < corners; i++) fprintf(p_file, " %u", i + 1);
+
+    fprintf(p_file, "\n");
+    fclose(p_file);
+
+    for(uint32_t threads : { 1u, 4u }) {
+        ul_mesh_t mesh;
+
+        TE_CHECK(ulMeshLoadOBJParallel(&mesh, path, threads))
+        TE_CHECK_MSG(mesh.vertices.size() == (size_t)(corners - 2) * 9, mesh.vertices.size() / 9 << " triangles of " << corners - 2)
+
+        // Last triangle is first, second to last and last corner
+        if(mesh.vertices.size() == (size_t)(corners - 2) * 9) {
+            const float* last = &mesh.vertices[mesh.vertices.size() - 3];
+
+            TE_CHECK(fabs(last[0] - cos(2.0 * M_PI * (corners - 1) / corners)) < 1e-5 && fabs(last[1] - sin(2.0 * M_PI * (corners - 1) / corners)) < 1e-5)
+            TE_CHECK(mesh.vertices[0] == 1.0f && mesh.vertices[1] == 0.0f)
+        }
+    }
+
+    remove(path);
+}
+
+// Chunked load gives same mesh as single threaded one
+static void TestParallelMatchesSerial() {
+    const char* path = "tests/bin/ul_mesh_obj_test_grid.obj";
+
+    TE_CHECK(TestWriteOBJGrid(path, 200) > 0)
+
+    ul_mesh_t serial, parallel;
+
+    TE_CHECK(ulMeshLoadOBJParallel(&serial, path, 1))
+    TE_CHECK(ulMeshLoadOBJParallel(&parallel, path, 7))
+    TE_CHECK(serial.vertices.size() == (size_t)200 * 200 * 2 * 9)
+    TE_CHECK(serial.vertices == parallel.vertices && serial.normals == parallel.normals && serial.textureCoordinates == parallel.textureCoordinates)
+
+    remove(path);
+}
+
+int main() {
+    TestLargePolygon();
+    TestParallelMatchesSerial();
+
+    return TestResult("ul_mesh_obj_test");
+}
@@ -0,0 +1,61 @@
+#include "test.hpp"
+#include "../engine/src/ul_mesh_optimize.hpp"
+#include <thread>
+
+// Built with ThreadSanitizer (see mk_tests). Meshes optimized on many threads at once, first call of process included,
+// Forsyth score tables must not race and every thread gets same order as serial run
+
+using namespace te;
+
+// Grid of quads, 2 triangles each, rows shuffled so there is something to reorder
+static std::vector<uint32_t> MakeGrid(uint32_t size) {
+    std::vector<uint32_t> indices;
+
+    for(uint32_t y = 0; y < size; y++) {
+        const uint32_t row = (y * 7) % size;
+
+        for(uint32_t x = 0; x < size; x++) {
+            const uint32_t v = row * (size + 1) + x;
+
+            indices.insert(indices.end(), { v, v + 1, v + size + 1, v + 1, v + size + 2, v + size + 1 });
+        }
+    }
+
+    return indices;
+}
+
+int main() {
+    const uint32_t size = 48;
+    const size_t vertex_count = (size_t)(size + 1) * (size + 1);
+    const std::vector<uint32_t> indices = MakeGrid(size);
+
+    const uint32_t thread_count = 8;
+    std::vector<std::vector<uint32_t>> results(thread_count, std::vector<uint32_t>(indices.size()));
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> ready = 0;
+
+    for(uint32_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            // Start together so first calls overlap
+            ready++;
+
+            while(ready.load() < thread_count) std::this_thread::yield();
+
+            ulMeshOptimizeVertexCache(results[t].data(), indices.data(), indices.size(), vertex_count);
+        });
+    }
+
+    for(std::thread& thread : threads) thread.join();
+
+    std::vector<uint32_t> serial(indices.size());
+    ulMeshOptimizeVertexCache(serial.data(), indices.data(), indices.size(), vertex_count);
+
+    for(uint32_t t = 0; t < thread_count; t++) TE_CHECK_MSG(results[t] == serial, "thread " << t)
+
+    const float before = ulMeshSimulateVertexCache(indices.data(), indices.size(), vertex_count, 32).acmr;
+    const float after = ulMeshSimulateVertexCache(serial.data(), serial.size(), vertex_count, 32).acmr;
+
+    TE_CHECK_MSG(after < before, "ACMR " << before << " -> " << after)
+
+    return TestResult("ul_mesh_optimize_tsan_test");
+}
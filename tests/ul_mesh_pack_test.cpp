@@ -0,0 +1,178 @@
+#include "test.hpp"
+#include "../engine/src/ul_mesh_pack.hpp"
+#include <float.h>
+#include <random>
+
+using namespace te;
+
+// Error bounds follow from encodings, not from measured errors:
+// - position: unorm16 over bounding box rounds to nearest, so at most half a step (extent / 65535 / 2) per axis
+// - 10:10:10:2: snorm10 rounds each component to nearest of 511 steps, at most 1 / 1022 per component
+// - octahedral: each snorm16 coordinate is off by at most d = 1 / 65534, that moves point on octahedron by at most
+//   sqrt(6) d and point is at least 1 / sqrt(3) from origin, so angle is at most sqrt(18) d
+// - half: 11 significant bits round to nearest, relative error at most 2^-11, below 2^-14 half is denormal and
+//   absolute error is at most half of 2^-24
+// Float math on the way adds few ulps on top, that is the eps part
+
+static float Dot(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static void Normalize(float* v) {
+    const float length = sqrtf(Dot(v, v));
+
+    for(int k = 0; k < 3; k++) v[k] /= length;
+}
+
+// Random mesh plus edge cases: axis normals, normals on octahedron fold (z < 0), flat axis, tiny and large uvs
+static void MakeMesh(ul_mesh_t* pMesh, size_t count, float flatZ) {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-37.5f, 112.25f);
+    std::normal_distribution<float> direction(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uv(-4.0f, 4.0f);
+
+    const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+    for(size_t v = 0; v < count; v++) {
+        pMesh->vertices.push_back(position(random));
+        pMesh->vertices.push_back(position(random) * 0.01f);
+        pMesh->vertices.push_back(flatZ);
+
+        float normal[3] = { direction(random), direction(random), direction(random) };
+
+        if(v < 6) memcpy(normal, axes[v], sizeof(normal));
+        else if(v < 64) normal[2] = -fabsf(normal[2]) * 0.01f;
+
+        Normalize(normal);
+        pMesh->normals.insert(pMesh->normals.end(), normal, normal + 3);
+
+        float u = uv(random), w = uv(random);
+
+        if(v % 16 == 0) u *= 1e-6f;
+        if(v % 16 == 1) w = 1.0f - 1e-4f;
+
+        pMesh->textureCoordinates.push_back(u);
+        pMesh->textureCoordinates.push_back(w);
+    }
+
+    for(size_t v = 0; v + 2 < count; v += 3) {
+        pMesh->indices.push_back((uint32_t)v);
+        pMesh->indices.push_back((uint32_t)v + 1);
+        pMesh->indices.push_back((uint32_t)v + 2);
+    }
+}
+
+static void TestRoundTrip(uint32_t encoding) {
+    ul_mesh_t mesh;
+    MakeMesh(&mesh, 30000, 3.0f);
+
+    ul_packed_mesh_t packed;
+    ulMeshPack(&mesh, &packed, encoding);
+
+    TE_CHECK(packed.vertexCount == 30000)
+    TE_CHECK(packed.stride == 16)
+    TE_CHECK(packed.indices == mesh.indices)
+
+    float position_bound[3];
+
+    for(int k = 0; k < 3; k++) {
+        const float magnitude = std::max(fabsf(packed.positionMin[k]), fabsf(packed.positionMin[k] + packed.positionScale[k]));
+
+        position_bound[k] = packed.positionScale[k] / 65535.0f / 2.0f + 4.0f * FLT_EPSILON * magnitude;
+    }
+
+    const float component_bound = 1.0f / 1022.0f + 4.0f * FLT_EPSILON;
+    const float angle_bound = sqrtf(18.0f) / 65534.0f + 2e-6f;
+
+    double worst_position[3] = {}, worst_normal = 0.0, worst_uv = 0.0;
+
+    for(size_t v = 0; v < packed.vertexCount; v++) {
+        float position[3], normal[3], uv[2];
+        ulMeshUnpackVertex(&packed, v, position, normal, uv);
+
+        for(int k = 0; k < 3; k++) {
+            const float error = fabsf(position[k] - mesh.vertices[v * 3 + k]);
+
+            TE_CHECK_MSG(error <= position_bound[k], "vertex " << v << " axis " << k << " error " << error << " > " << position_bound[k])
+            worst_position[k] = std::max(worst_position[k], (double)error / std::max(packed.positionScale[k], FLT_MIN));
+        }
+
+        const float* source = &mesh.normals[v * 3];
+
+        if(encoding == ULMnormal_10_10_10_2) {
+            for(int k = 0; k < 3; k++) {
+                const float error = fabsf(normal[k] - source[k]);
+
+                TE_CHECK_MSG(error <= component_bound, "vertex " << v << " normal " << k << " error " << error)
+                worst_normal = std::max(worst_normal, (double)error);
+            }
+        }
+        else {
+            TE_CHECK(fabsf(Dot(normal, normal) - 1.0f) < 1e-5f)
+
+            const float angle = acosf(std::min(1.0f, Dot(normal, source)));
+
+            // acos near 1 loses precision, cross product length is the angle there
+            const float cross[3] = { normal[1] * source[2] - normal[2] * source[1], normal[2] * source[0] - normal[0] * source[2], normal[0] * source[1] - normal[1] * source[0] };
+            const float error = std::min(angle, asinf(std::min(1.0f, sqrtf(Dot(cross, cross)))));
+
+            TE_CHECK_MSG(error <= angle_bound, "vertex " << v << " normal angle " << error << " > " << angle_bound)
+            worst_normal = std::max(worst_normal, (double)error);
+        }
+
+        for(int k = 0; k < 2; k++) {
+            const float value = mesh.textureCoordinates[v * 2 + k];
+            const float error = fabsf(uv[k] - value);
+            const float bound = std::max(fabsf(value) * 0x1p-11f, 0x1p-25f);
+
+            TE_CHECK_MSG(error <= bound, "vertex " << v << " uv " << value << " error " << error)
+            worst_uv = std::max(worst_uv, (double)error / std::max(fabsf(value), 0x1p-14f));
+        }
+    }
+
+    TE_INFO((encoding == ULMnormal_10_10_10_2 ? "10:10:10:2" : "octahedral") << ": worst position error " << worst_position[0] * 65535.0 << ", " << worst_position[1] * 65535.0 << " steps, normal " << (encoding == ULMnormal_10_10_10_2 ? worst_normal * 511.0 : worst_normal) << (encoding == ULMnormal_10_10_10_2 ? " steps" : " rad") << " (bound " << (encoding == ULMnormal_10_10_10_2 ? component_bound * 511.0f : angle_bound) << "), uv relative " << worst_uv << " (bound " << 0x1p-11 << ")")
+}
+
+// Flat axis has no extent, all its vertices decode exactly
+static void TestFlatAxis() {
+    ul_mesh_t mesh;
+    MakeMesh(&mesh, 300, -2.5f);
+
+    ul_packed_mesh_t packed;
+    ulMeshPack(&mesh, &packed, ULMnormal_octahedral_16);
+
+    TE_CHECK(packed.positionScale[2] == 0.0f)
+
+    for(size_t v = 0; v < packed.vertexCount; v++) {
+        float position[3], normal[3], uv[2];
+        ulMeshUnpackVertex(&packed, v, position, normal, uv);
+
+        TE_CHECK(position[2] == -2.5f)
+    }
+}
+
+// Every half converts back to same bits, and float to half rounds to nearest
+static void TestHalfExhaustive() {
+    uint32_t mismatches = 0;
+
+    for(uint32_t h = 0; h < 0x10000; h++) {
+        // NaN payloads are not kept
+        if((h & 0x7c00u) == 0x7c00u && (h & 0x3ffu)) continue;
+
+        if(ulMeshFloatToHalf(ulMeshHalfToFloat((uint16_t)h)) != h) mismatches++;
+    }
+
+    TE_CHECK(mismatches == 0)
+
+    // Halfway between 1 and next half rounds to even (1), just above it rounds up
+    TE_CHECK(ulMeshFloatToHalf(1.0f + 0x1p-11f) == 0x3c00)
+    TE_CHECK(ulMeshFloatToHalf(1.0f + 0x1p-11f + 0x1p-20f) == 0x3c01)
+    TE_CHECK(ulMeshFloatToHalf(70000.0f) == 0x7c00)
+}
+
+int main() {
+    TestRoundTrip(ULMnormal_octahedral_16);
+    TestRoundTrip(ULMnormal_10_10_10_2);
+    TestFlatAxis();
+    TestHalfExhaustive();
+
+    return TestResult("ul_mesh_pack_test");
+}
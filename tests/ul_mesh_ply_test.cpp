@@ -0,0 +1,83 @@
+#include "test.hpp"
+#include "../engine/src/ul_mesh.hpp"
+#include <stdio.h>
+#include <string>
+
+using namespace te;
+
+static void WriteText(const char* path, const std::string& text) {
+    FILE* p_file = fopen(path, "wb");
+
+    TE_CHECK(p_file && fwrite(text.data(), 1, text.size(), p_file) == text.size())
+
+    if(p_file) fclose(p_file);
+}
+
+// Point cloud has vertices and no faces, indexed load keeps every point and must not read them as triangle soup
+static void TestPointCloud() {
+    const char* path = "tests/bin/ul_mesh_ply_test_points.ply";
+    std::string ply = "ply\nformat ascii 1.0\nelement vertex 7\nproperty float x\nproperty float y\nproperty float z\nend_header\n";
+
+    // Points 0, 1 and 2 are equal, soup indexing would merge them
+    for(int i = 0; i < 7; i++) ply += std::to_string(i < 3 ? 1 : i) + " 2 3\n";
+
+    WriteText(path, ply);
+
+    for(uint32_t flags : { (uint32_t)ULMflag_indexed, (uint32_t)ULMflag_optimize }) {
+        ul_mesh_t mesh;
+
+        TE_CHECK(ulMeshLoad(&mesh, path, ULMtype_ply, flags))
+        TE_CHECK_MSG(mesh.indexed && mesh.vertices.size() == 21 && mesh.indices.empty(), "flags " << flags << ": " << mesh.vertices.size() / 3 << " points")
+
+        ulMeshIndex(&mesh);
+
+        TE_CHECK(mesh.vertices.size() == 21 && mesh.indices.empty())
+    }
+
+    // Indexed flag survives cache, loaded point cloud is not indexed again as soup either
+    const std::string cache_path = std::string(path) + ".twm";
+
+    remove(cache_path.c_str());
+
+    for(int pass = 0; pass < 2; pass++) {
+        ul_mesh_t mesh;
+
+        TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_ply, ULMflag_indexed))
+        TE_CHECK_MSG(mesh.indexed && mesh.vertices.size() == 21, "pass " << pass)
+
+        ulMeshIndex(&mesh);
+
+        TE_CHECK(mesh.vertices.size() == 21)
+    }
+
+    remove(cache_path.c_str());
+    remove(path);
+}
+
+// Quad is 2 triangles over 4 vertices indexed, 6 corners as soup until ulMeshIndex merges them
+static void TestFaces() {
+    const char* path = "tests/bin/ul_mesh_ply_test_quad.ply";
+
+    WriteText(path, "ply\nformat ascii 1.0\nelement vertex 4\nproperty float x\nproperty float y\nproperty float z\nelement face 1\nproperty list uchar int vertex_indices\nend_header\n0 0 0\n1 0 0\n1 1 0\n0 1 0\n4 0 1 2 3\n");
+
+    ul_mesh_t indexed, soup;
+
+    TE_CHECK(ulMeshLoad(&indexed, path, ULMtype_ply, ULMflag_indexed))
+    TE_CHECK(indexed.indexed && indexed.vertices.size() == 12 && indexed.indices.size() == 6)
+
+    TE_CHECK(ulMeshLoad(&soup, path, ULMtype_ply, 0))
+    TE_CHECK(!soup.indexed && soup.vertices.size() == 18 && soup.indices.empty())
+
+    ulMeshIndex(&soup);
+
+    TE_CHECK(soup.indexed && soup.vertices.size() == 12 && soup.indices.size() == 6)
+
+    remove(path);
+}
+
+int main() {
+    TestPointCloud();
+    TestFaces();
+
+    return TestResult("ul_mesh_ply_test");
+}
@@ -0,0 +1,39 @@
+#include "test.hpp"
+#include "mesh_gen.hpp"
+#include "../engine/src/ul_mesh_simplify.hpp"
+
+using namespace te;
+
+// Simplification throughput in millions of input triangles per second: one ulMeshSimplify to half and whole 4 level
+// LOD chain (every level from previous one), on smooth uv sphere with uv seam and on flat shaded one
+
+static void Bench(const char* name, ul_mesh_t* pMesh) {
+    const size_t vertex_count = pMesh->vertices.size() / 3;
+    const size_t triangles = pMesh->indices.size() / 3;
+    std::vector<uint32_t> result(pMesh->indices.size());
+    size_t half = 0;
+
+    const double half_ms = TestBestMs(3, [&]() {
+        half = ulMeshSimplify(result.data(), pMesh->indices.data(), pMesh->indices.size(), pMesh->vertices.data(), vertex_count, pMesh->indices.size() / 2, FLT_MAX, (float*)0) / 3;
+    });
+
+    const float ratios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+
+    const double chain_ms = TestBestMs(2, [&]() { ulMeshGenerateLODs(pMesh, ratios, 4); });
+
+    TE_CHECK(pMesh->lods.size() == 4 && half <= triangles / 2 + triangles / 100)
+
+    TE_INFO(name << " " << triangles << " triangles, " << vertex_count << " vertices: to half " << half_ms << " ms (" << triangles / (half_ms * 1000.0) << " Mtri/s), 4 level chain " << chain_ms << " ms (" << triangles / (chain_ms * 1000.0) << " Mtri/s), last level " << pMesh->lods.back().indices.size() / 3 << " triangles, error " << pMesh->lods.back().error)
+}
+
+int main() {
+    ul_mesh_t mesh;
+
+    TestMakeSphere(&mesh, 800, 400, false);
+    Bench("Smooth sphere", &mesh);
+
+    TestMakeSphere(&mesh, 800, 400, true);
+    Bench("Flat sphere", &mesh);
+
+    return TestResult("ul_mesh_simplify_bench");
+}
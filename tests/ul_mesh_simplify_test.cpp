@@ -0,0 +1,143 @@
+#include "test.hpp"
+#include "mesh_gen.hpp"
+#include "../engine/src/ul_mesh_simplify.hpp"
+
+using namespace te;
+
+static void Sub(const float* a, const float* b, double* out) {
+    for(int k = 0; k < 3; k++) out[k] = (double)a[k] - b[k];
+}
+
+static void Cross(const double* a, const double* b, double* out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Area weighted normal of triangle, twice its area long
+static void TriangleNormal(const ul_mesh_t& mesh, const uint32_t* tri, double* n) {
+    double e1[3], e2[3];
+
+    Sub(&mesh.vertices[(size_t)tri[1] * 3], &mesh.vertices[(size_t)tri[0] * 3], e1);
+    Sub(&mesh.vertices[(size_t)tri[2] * 3], &mesh.vertices[(size_t)tri[0] * 3], e2);
+    Cross(e1, e2, n);
+}
+
+// Flat shaded cube: every edge vertex has copy per face. Cube edges slide along themselves, only corners stay, so
+// faces go down to few triangles and surface stays exactly cube
+static void TestFlatCube() {
+    ul_mesh_t mesh;
+    TestMakeCube(&mesh, 16);
+    mesh.textureCoordinates.clear();
+
+    const size_t vertex_count = mesh.vertices.size() / 3;
+    std::vector<uint32_t> result(mesh.indices.size());
+    float error = 1.0f;
+
+    result.resize(ulMeshSimplify(result.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), vertex_count, 36, 1e-4f, &error));
+
+    const size_t triangles = result.size() / 3;
+    double area = 0.0;
+    uint32_t off_face = 0;
+
+    for(size_t t = 0; t < triangles; t++) {
+        double n[3];
+        TriangleNormal(mesh, &result[t * 3], n);
+
+        area += 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        // All corners on one face plane
+        int on_face = 0;
+
+        for(int axis = 0; axis < 3; axis++) {
+            for(float side : { -1.0f, 1.0f }) {
+                int count = 0;
+
+                for(int k = 0; k < 3; k++) count += mesh.vertices[(size_t)result[t * 3 + k] * 3 + axis] == side;
+
+                on_face |= count == 3;
+            }
+        }
+
+        off_face += !on_face;
+    }
+
+    TE_INFO("Flat cube: " << mesh.indices.size() / 3 << " -> " << triangles << " triangles, error " << error)
+
+    TE_CHECK_MSG(triangles <= 24, triangles << " triangles left of " << mesh.indices.size() / 3)
+    TE_CHECK(off_face == 0)
+    TE_CHECK_MSG(fabs(area - 24.0) < 1e-3, "area " << area)
+    TE_CHECK(error < 1e-4f)
+}
+
+// Same cube with own uv island per face through LOD chain, uv seams stay so every triangle keeps corners of one island
+static void TestUVSeams() {
+    ul_mesh_t mesh;
+    TestMakeCube(&mesh, 16);
+
+    const size_t full = mesh.indices.size() / 3;
+    const float ratios[] = { 0.5f, 0.1f, 0.01f };
+
+    ulMeshGenerateLODs(&mesh, ratios, 3, 1e-4f);
+
+    TE_CHECK(mesh.lods.size() == 3)
+
+    const std::vector<uint32_t>& last = mesh.lods.back().indices;
+    uint32_t torn = 0;
+
+    for(size_t t = 0; t + 2 < last.size(); t += 3) {
+        int island[3];
+
+        for(int k = 0; k < 3; k++) island[k] = (int)(mesh.textureCoordinates[(size_t)last[t + k] * 2] * 6.0f);
+
+        torn += island[0] != island[1] || island[1] != island[2];
+    }
+
+    TE_INFO("Cube with uv islands: " << full << " -> " << last.size() / 3 << " triangles")
+
+    TE_CHECK_MSG(last.size() / 3 <= 48, last.size() / 3 << " triangles left of " << full)
+    TE_CHECK(torn == 0)
+}
+
+// Flat shaded sphere, every vertex has copy per triangle around it and used to be locked whole
+static void TestFlatSphere() {
+    ul_mesh_t mesh;
+    TestMakeSphere(&mesh, 48, 24, true);
+
+    const size_t vertex_count = mesh.vertices.size() / 3;
+    const size_t full = mesh.indices.size() / 3;
+    std::vector<uint32_t> result(mesh.indices.size());
+    float error = 1.0f;
+
+    result.resize(ulMeshSimplify(result.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), vertex_count, full / 4 * 3, FLT_MAX, &error));
+
+    const size_t triangles = result.size() / 3;
+    uint32_t inward = 0;
+
+    for(size_t t = 0; t < triangles; t++) {
+        double n[3];
+        TriangleNormal(mesh, &result[t * 3], n);
+
+        double centroid[3] = { 0.0, 0.0, 0.0 };
+
+        for(int k = 0; k < 3; k++) {
+            for(int c = 0; c < 3; c++) centroid[c] += mesh.vertices[(size_t)result[t * 3 + k] * 3 + c];
+        }
+
+        inward += n[0] * centroid[0] + n[1] * centroid[1] + n[2] * centroid[2] <= 0.0;
+    }
+
+    TE_INFO("Flat sphere: " << full << " -> " << triangles << " triangles, error " << error)
+
+    TE_CHECK_MSG(triangles <= full / 4 + full / 20, triangles << " triangles left of " << full)
+    TE_CHECK(inward == 0)
+    TE_CHECK_MSG(error < 0.05f, "error " << error)
+}
+
+int main() {
+    TestFlatCube();
+    TestUVSeams();
+    TestFlatSphere();
+
+    return TestResult("ul_mesh_simplify_test");
+}
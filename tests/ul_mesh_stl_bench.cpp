@@ -0,0 +1,45 @@
+#include "test.hpp"
+#include "stl_writer.hpp"
+#include "../engine/src/ul_mesh.hpp"
+#include <thread>
+
+using namespace te;
+
+// Binary STL of 4M triangles (about 190 MB) through ulMeshLoad, one thread and ULMflag_parallel, in MB/s and
+// triangles per second
+
+int main() {
+    const char* path = "tests/bin/ul_mesh_stl_bench.stl";
+    const size_t triangles = 4000000;
+    std::vector<float> vertices(triangles * 9), normals(triangles * 3);
+
+    for(size_t i = 0; i < vertices.size(); i++) vertices[i] = (float)(i % 10007) * 0.01f;
+    for(size_t i = 0; i < normals.size(); i++) normals[i] = i % 3 == 2 ? 1.0f : 0.0f;
+
+    const std::vector<uint8_t> stl = TestEncodeSTL(vertices, normals);
+    FILE* p_file = fopen(path, "wb");
+
+    TE_CHECK(p_file && fwrite(stl.data(), 1, stl.size(), p_file) == stl.size())
+
+    if(p_file) fclose(p_file);
+
+    const double mb = stl.size() / (1024.0 * 1024.0);
+    ul_mesh_t mesh;
+
+    for(uint32_t flags : { 0u, (uint32_t)ULMflag_parallel }) {
+        // Loaders append to mesh, every run starts from empty one
+        const double ms = TestBestMs(3, [&]() {
+            mesh = ul_mesh_t();
+
+            TE_CHECK(ulMeshLoad(&mesh, path, ULMtype_stl, flags))
+        });
+
+        TE_CHECK(mesh.vertices == vertices)
+
+        TE_INFO((flags ? "Parallel on " + std::to_string(std::thread::hardware_concurrency()) + " threads" : std::string("1 thread")) << ", " << triangles << " triangles, " << mb << " MB: " << ms << " ms, " << mb / (ms / 1000.0) << " MB/s, " << triangles / (ms / 1000.0) / 1e6 << " M triangles/s")
+    }
+
+    remove(path);
+
+    return TestResult("ul_mesh_stl_bench");
+}
@@ -0,0 +1,66 @@
+#include "test.hpp"
+#include "stl_writer.hpp"
+#include "../engine/src/ul_mesh.hpp"
+
+using namespace te;
+
+static bool WriteFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* p_file = fopen(path, "wb");
+
+    if(!p_file) return false;
+
+    const bool ok = fwrite(data.data(), 1, data.size(), p_file) == data.size();
+    fclose(p_file);
+
+    return ok;
+}
+
+// Little endian file decodes to same floats on one and many threads
+static void TestBinary() {
+    const char* path = "tests/bin/ul_mesh_stl_test.stl";
+    const size_t triangles = 200000;
+    std::vector<float> vertices(triangles * 9), normals(triangles * 3);
+
+    for(size_t i = 0; i < vertices.size(); i++) vertices[i] = (float)i * 0.25f - 1000.5f;
+    for(size_t i = 0; i < normals.size(); i++) normals[i] = (float)(i % 3) - 1.0f;
+
+    TE_CHECK(WriteFile(path, TestEncodeSTL(vertices, normals)))
+
+    for(uint32_t threads : { 1u, 3u }) {
+        ul_mesh_t mesh;
+
+        TE_CHECK(ulMeshLoadSTLParallel(&mesh, path, threads))
+        TE_CHECK(mesh.vertices == vertices)
+        TE_CHECK(mesh.normals.size() == triangles * 9)
+
+        uint32_t wrong_normals = 0;
+
+        for(size_t i = 0; i < mesh.normals.size() && mesh.normals.size() == triangles * 9; i++) wrong_normals += mesh.normals[i] != normals[i / 9 * 3 + i % 3];
+
+        TE_CHECK_MSG(wrong_normals == 0, threads << " threads: " << wrong_normals << " wrong normals")
+    }
+
+    remove(path);
+}
+
+// Swap used on big endian hosts, 1.0f is 00 00 80 3f in file
+static void TestSwap() {
+    float value = 1.0f;
+    uint32_t bits;
+
+    __ulMeshSwapFloats(&value, 1);
+    memcpy(&bits, &value, sizeof(bits));
+
+    TE_CHECK(bits == 0x0000803fu)
+
+    __ulMeshSwapFloats(&value, 1);
+
+    TE_CHECK(value == 1.0f)
+}
+
+int main() {
+    TestBinary();
+    TestSwap();
+
+    return TestResult("ul_mesh_stl_test");
+}
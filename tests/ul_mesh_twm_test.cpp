@@ -0,0 +1,216 @@
+#include "test.hpp"
+#include "obj_writer.hpp"
+#include "../engine/src/ul_mesh.hpp"
+#include "../engine/src/ul_mesh_simplify.hpp"
+#include <stdio.h>
+
+using namespace te;
+
+// Rewrite stream table entry of saved file
+static void PatchStream(const char* source, const char* path, int stream, uint32_t components, uint64_t count) {
+    FILE* p_in = fopen(source, "rb");
+    std::vector<uint8_t> data;
+    int c;
+
+    while((c = fgetc(p_in)) != EOF) data.push_back((uint8_t)c);
+
+    fclose(p_in);
+
+    ul_twm_stream_t entry;
+    uint8_t* p_entry = data.data() + sizeof(ul_twm_header_t) + stream * sizeof(ul_twm_stream_t);
+    memcpy(&entry, p_entry, sizeof(entry));
+    entry.components = components;
+    entry.count = count;
+    memcpy(p_entry, &entry, sizeof(entry));
+
+    FILE* p_out = fopen(path, "wb");
+    fwrite(data.data(), 1, data.size(), p_out);
+    fclose(p_out);
+}
+
+static std::vector<uint8_t> ReadFile(const char* path) {
+    std::vector<uint8_t> data;
+    FILE* p_file = fopen(path, "rb");
+
+    if(!p_file) return data;
+
+    fseek(p_file, 0, SEEK_END);
+    data.resize((size_t)ftell(p_file));
+    fseek(p_file, 0, SEEK_SET);
+
+    if(fread(data.data(), 1, data.size(), p_file) != data.size()) data.clear();
+
+    fclose(p_file);
+
+    return data;
+}
+
+static void WriteFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* p_file = fopen(path, "wb");
+
+    TE_CHECK(p_file && fwrite(data.data(), 1, data.size(), p_file) == data.size())
+
+    if(p_file) fclose(p_file);
+}
+
+static bool SameMesh(const ul_mesh_t& a, const ul_mesh_t& b) {
+    return a.vertices == b.vertices && a.normals == b.normals && a.textureCoordinates == b.textureCoordinates && a.indices == b.indices;
+}
+
+// Cache made from other source or damaged is replaced with one made from current source
+static void TestCacheRegenerated() {
+    const char* path = "tests/bin/twm_test_grid.obj";
+    const std::string cache_path = std::string(path) + ".twm";
+
+    remove(cache_path.c_str());
+    TE_CHECK(TestWriteOBJGrid(path, 8) > 0)
+
+    ul_mesh_t expected, mesh;
+
+    TE_CHECK(ulMeshLoad(&expected, path, ULMtype_obj, ULMflag_indexed))
+    TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_obj, ULMflag_indexed) && SameMesh(mesh, expected))
+
+    const std::vector<uint8_t> good = ReadFile(cache_path.c_str());
+
+    TE_CHECK(good.size() > sizeof(ul_twm_header_t))
+
+    // Damaged vertex data, header still fine
+    std::vector<uint8_t> damaged = good;
+    damaged[damaged.size() / 2] ^= 0x40;
+    WriteFile(cache_path.c_str(), damaged);
+
+    mesh = ul_mesh_t();
+    TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_obj, ULMflag_indexed) && SameMesh(mesh, expected))
+    TE_CHECK(ReadFile(cache_path.c_str()) == good)
+
+    WriteFile(cache_path.c_str(), damaged);
+
+    ul_twm_view_t view;
+
+    TE_CHECK(ulMeshMapCached(&view, path, ULMtype_obj, ULMflag_indexed))
+    TE_CHECK(ReadFile(cache_path.c_str()) == good)
+
+    ulMeshUnmapTWM(&view);
+
+    // Truncated file
+    WriteFile(cache_path.c_str(), std::vector<uint8_t>(good.begin(), good.begin() + good.size() / 3));
+
+    mesh = ul_mesh_t();
+    TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_obj, ULMflag_indexed) && SameMesh(mesh, expected))
+    TE_CHECK(ReadFile(cache_path.c_str()) == good)
+
+    // Stale, source changed after cache was made
+    TE_CHECK(TestWriteOBJGrid(path, 5) > 0)
+
+    expected = ul_mesh_t();
+    mesh = ul_mesh_t();
+
+    TE_CHECK(ulMeshLoad(&expected, path, ULMtype_obj, ULMflag_indexed))
+    TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_obj, ULMflag_indexed) && SameMesh(mesh, expected))
+    TE_CHECK(ReadFile(cache_path.c_str()) != good)
+
+    // Other flags give other output, soup must not come from indexed cache
+    ul_mesh_t soup;
+
+    mesh = ul_mesh_t();
+    TE_CHECK(ulMeshLoad(&soup, path, ULMtype_obj, 0))
+    TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_obj, 0) && SameMesh(mesh, soup) && mesh.indices.empty())
+
+    remove(path);
+    remove(cache_path.c_str());
+}
+
+// LODs saved into cache come back on load, mapped view points into file instead of copies
+static void TestCacheLODs() {
+    const char* path = "tests/bin/twm_test_lods.obj";
+    const std::string cache_path = std::string(path) + ".twm";
+
+    remove(cache_path.c_str());
+    TE_CHECK(TestWriteOBJGrid(path, 32) > 0)
+
+    ul_mesh_t mesh;
+
+    TE_CHECK(ulMeshLoadCached(&mesh, path, ULMtype_obj, ULMflag_indexed) && mesh.lods.empty())
+
+    const float ratios[] = { 0.5f, 0.25f };
+    ulMeshGenerateLODs(&mesh, ratios, 2);
+
+    TE_CHECK(mesh.lods.size() == 2)
+    TE_CHECK(ulMeshSaveCached(&mesh, path, ULMtype_obj, ULMflag_indexed))
+
+    ul_mesh_t loaded;
+
+    TE_CHECK(ulMeshLoadCached(&loaded, path, ULMtype_obj, ULMflag_indexed) && SameMesh(loaded, mesh))
+    TE_CHECK(loaded.lods.size() == mesh.lods.size())
+
+    for(size_t i = 0; i < loaded.lods.size() && i < mesh.lods.size(); i++) {
+        TE_CHECK(loaded.lods[i].indices == mesh.lods[i].indices && loaded.lods[i].ratio == mesh.lods[i].ratio && loaded.lods[i].error == mesh.lods[i].error)
+    }
+
+    ul_twm_view_t view;
+
+    TE_CHECK(ulMeshMapCached(&view, path, ULMtype_obj, ULMflag_indexed))
+    TE_CHECK(view.lods.size() == 2 && view.indices.size() == mesh.indices.size())
+
+    const uint8_t* begin = view.file.data, *end = view.file.data + view.file.size;
+    const uint8_t* vertices = (const uint8_t*)view.vertices.data(), *lod = (const uint8_t*)view.lods[1].indices.data();
+
+    TE_CHECK(vertices >= begin && vertices < end && lod >= begin && lod < end)
+    TE_CHECK(view.lods.size() == 2 && std::equal(view.lods[1].indices.begin(), view.lods[1].indices.end(), mesh.lods[1].indices.begin(), mesh.lods[1].indices.end()))
+
+    ulMeshUnmapTWM(&view);
+
+    remove(path);
+    remove(cache_path.c_str());
+}
+
+int main() {
+    ul_mesh_t mesh;
+
+    for(int i = 0; i < 30; i++) {
+        mesh.vertices.push_back((float)i);
+        mesh.normals.push_back(1.0f);
+    }
+
+    for(int i = 0; i < 20; i++) mesh.textureCoordinates.push_back(0.5f);
+    for(uint32_t i = 0; i < 9; i++) mesh.indices.push_back(i);
+
+    const char* path = "tests/bin/twm_test.twm";
+    const char* bad_path = "tests/bin/twm_test_bad.twm";
+
+    TE_CHECK(ulMeshSaveTWM(&mesh, path, 42))
+
+    ul_twm_view_t view;
+
+    TE_CHECK(ulMeshMapTWM(&view, path, 1))
+    TE_CHECK(view.sourceHash == 42 && view.vertices.size() == 30 && view.textureCoordinates.size() == 20 && view.indices.size() == 9)
+    TE_CHECK(view.vertices[29] == 29.0f)
+
+    ulMeshUnmapTWM(&view);
+
+    // Components other than layout, spans would be sized with wrong stride
+    PatchStream(path, bad_path, 0, 4, 10);
+    TE_CHECK(!ulMeshMapTWM(&view, bad_path, 0))
+
+    PatchStream(path, bad_path, 2, 1, 20);
+    TE_CHECK(!ulMeshMapTWM(&view, bad_path, 0))
+
+    // count * 3 * 4 wraps to 0, old check passed it and span covered whole address space
+    PatchStream(path, bad_path, 0, 3, 0x4000000000000000ull);
+    TE_CHECK(!ulMeshMapTWM(&view, bad_path, 0))
+
+    PatchStream(path, bad_path, 3, 1, 0x4000000000000000ull);
+    TE_CHECK(!ulMeshMapTWM(&view, bad_path, 0))
+
+    // One element past end of file
+    PatchStream(path, bad_path, 3, 1, 10000);
+    TE_CHECK(!ulMeshMapTWM(&view, bad_path, 0))
+
+    remove(path);
+    remove(bad_path);
+
+    TestCacheRegenerated();
+    TestCacheLODs();
+
+    return TestResult("ul_mesh_twm_test");
+}